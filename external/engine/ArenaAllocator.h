@@ -0,0 +1,160 @@
+#pragma once
+
+#include <memory_resource>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <utility>
+
+// bump allocator for short lived scratch data, nothing is freed until Release() or destruction.
+// destructors of objects made with Create() are the caller's business, see ArenaDeleter
+class ArenaAllocator : public std::pmr::memory_resource
+{
+public:
+	static const size_t DefaultChunkSize = 0x10000;
+
+	ArenaAllocator(size_t chunkSize = DefaultChunkSize) : ChunkSize(chunkSize) {}
+	ArenaAllocator(const ArenaAllocator&) = delete;
+	ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+	~ArenaAllocator() { Release(); }
+
+	template <typename T, typename... Arguments>
+	T* Create(Arguments&&... arguments)
+	{
+		return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Arguments>(arguments)...);
+	}
+
+	template <typename T>
+	std::span<T> AllocateArray(size_t count)
+	{
+		if (count == 0)
+			return {};
+
+		T* data = reinterpret_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+
+		for (size_t i = 0; i < count; ++i)
+			new (data + i) T();
+
+		return std::span<T>(data, count);
+	}
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		size_t offset = AlignedOffset(alignment);
+
+		if (Current == nullptr || offset + size > Current->Size)
+		{
+			AddChunk(size + alignment);
+
+			offset = AlignedOffset(alignment);
+		}
+
+		Offset = offset + size;
+		BytesUsed += size;
+
+		if (BytesUsed > PeakBytesUsed)
+			PeakBytesUsed = BytesUsed;
+
+		return Current->Memory() + offset;
+	}
+
+	// makes sure the next chunk can hold at least this much, use before parsing when the total is roughly known
+	void Reserve(size_t size)
+	{
+		if (Current == nullptr || Current->Size - Offset < size)
+			AddChunk(size);
+	}
+
+	void Release()
+	{
+		while (Chunks != nullptr)
+		{
+			Chunk* next = Chunks->Next;
+
+			::operator delete(Chunks);
+
+			Chunks = next;
+		}
+
+		Current = nullptr;
+		Offset = 0;
+		BytesUsed = 0;
+		BytesReserved = 0;
+	}
+
+	size_t GetBytesUsed() const { return BytesUsed; }
+	size_t GetBytesReserved() const { return BytesReserved; }
+	size_t GetPeakBytesUsed() const { return PeakBytesUsed; }
+
+private:
+	struct Chunk
+	{
+		Chunk* Next = nullptr;
+		size_t Size = 0;
+
+		char* Memory() { return reinterpret_cast<char*>(this + 1); }
+	};
+
+	Chunk* Chunks = nullptr;
+	Chunk* Current = nullptr;
+	size_t Offset = 0;
+	size_t ChunkSize = DefaultChunkSize;
+	size_t BytesUsed = 0;
+	size_t BytesReserved = 0;
+	size_t PeakBytesUsed = 0;
+
+	size_t AlignedOffset(size_t alignment) const
+	{
+		if (Current == nullptr)
+			return 0;
+
+		uintptr_t address = reinterpret_cast<uintptr_t>(Current->Memory()) + Offset;
+
+		return Offset + (((address + alignment - 1) & ~(uintptr_t)(alignment - 1)) - address);
+	}
+
+	void AddChunk(size_t minimumSize)
+	{
+		size_t size = minimumSize > ChunkSize ? minimumSize : ChunkSize;
+
+		Chunk* chunk = new (::operator new(sizeof(Chunk) + size)) Chunk();
+
+		chunk->Size = size;
+		chunk->Next = Chunks;
+
+		Chunks = chunk;
+		Current = chunk;
+		Offset = 0;
+		BytesReserved += size;
+	}
+
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		return Allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void*, size_t, size_t) override
+	{
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+// runs the destructor but leaves the memory to the arena
+struct ArenaDeleter
+{
+	template <typename T>
+	void operator()(T* object) const
+	{
+		if (object != nullptr)
+			object->~T();
+	}
+};
+
+template <typename T>
+using ArenaPointer = std::unique_ptr<T, ArenaDeleter>;
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+
+// interns shared objects under a 64 bit hash so any number of threads can share them.
+// lookups never block, an insert only makes threads asking for that same hash wait until it's published.
+// entries are never removed, so the index an entry gets is stable for the life of the table.
+// a hash only picks the slots to look at, matches is called with a published entry to tell whether it's really the one
+// asked for. objects whose hashes collide get slots of their own further along the probe sequence
+template <typename T, size_t SlotCount = 0x1000>
+class ConcurrentInternTable
+{
+public:
+	typedef std::shared_ptr<T> Pointer;
+
+	static_assert((SlotCount & (SlotCount - 1)) == 0, "slot count has to be a power of two");
+
+	ConcurrentInternTable() = default;
+	ConcurrentInternTable(const ConcurrentInternTable&) = delete;
+	ConcurrentInternTable& operator=(const ConcurrentInternTable&) = delete;
+
+	~ConcurrentInternTable()
+	{
+		for (size_t i = 0; i < SegmentCount; ++i)
+			delete[] Segments[i].load(std::memory_order_relaxed);
+	}
+
+	// the first published entry under the hash, for callers that only kept the hash
+	Pointer Find(uint64_t hash) const
+	{
+		return Find(hash, [](const T&) { return true; });
+	}
+
+	template <typename Matches>
+	Pointer Find(uint64_t hash, Matches&& matches) const
+	{
+		uint64_t key = MakeKey(hash);
+
+		for (size_t probe = 0; probe < SlotCount; ++probe)
+		{
+			const Slot& slot = Slots[(key + probe) & (SlotCount - 1)];
+			uint64_t current = slot.Key.load(std::memory_order_acquire);
+
+			if (current == 0)
+				return nullptr;
+
+			if (current == key)
+			{
+				Pointer value = At(slot.Index.load(std::memory_order_acquire));
+
+				if (value != nullptr && matches(*value))
+					return value;
+			}
+		}
+
+		return nullptr;
+	}
+
+	Pointer At(int index) const
+	{
+		if (index < 0 || index >= (int)SlotCount)
+			return nullptr;
+
+		const Entry* segment = Segments[index / SegmentSize].load(std::memory_order_acquire);
+
+		if (segment == nullptr)
+			return nullptr;
+
+		const Entry& entry = segment[index % SegmentSize];
+
+		return entry.State.load(std::memory_order_acquire) == Ready ? entry.Value : nullptr;
+	}
+
+	// factory is called with the index the new entry gets, by one thread at a time. if it throws the entry is marked
+	// failed and the exception passes on, the next Intern of that hash runs the factory again under the same index
+	template <typename Matches, typename Factory>
+	Pointer Intern(uint64_t hash, Matches&& matches, Factory&& factory)
+	{
+		uint64_t key = MakeKey(hash);
+
+		for (size_t probe = 0; probe < SlotCount; ++probe)
+		{
+			Slot& slot = Slots[(key + probe) & (SlotCount - 1)];
+			uint64_t current = slot.Key.load(std::memory_order_acquire);
+
+			if (current == 0 && slot.Key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+			{
+				int index = Count.fetch_add(1, std::memory_order_relaxed);
+				Entry& entry = FetchEntry(index);
+
+				slot.Index.store(index, std::memory_order_release);
+
+				return Build(entry, index, factory);
+			}
+
+			if (current == key)
+			{
+				int index;
+
+				while ((index = slot.Index.load(std::memory_order_acquire)) < 0)
+					std::this_thread::yield();
+
+				Entry& entry = FetchEntry(index);
+
+				int state;
+
+				while ((state = entry.State.load(std::memory_order_acquire)) != Ready)
+				{
+					if (state == Failed && entry.State.compare_exchange_strong(state, Building, std::memory_order_acq_rel))
+						return Build(entry, index, factory);
+
+					std::this_thread::yield();
+				}
+
+				// the same hash for another object, it goes in a slot further along
+				if (entry.Value != nullptr && matches(*entry.Value))
+					return entry.Value;
+			}
+		}
+
+		throw std::runtime_error("intern table is full");
+	}
+
+	size_t Size() const
+	{
+		return (size_t)Count.load(std::memory_order_acquire);
+	}
+
+private:
+	static const size_t SegmentSize = 0x100;
+	static const size_t SegmentCount = (SlotCount + SegmentSize - 1) / SegmentSize;
+
+	struct Slot
+	{
+		std::atomic<uint64_t> Key = 0;
+		std::atomic<int> Index = -1;
+	};
+
+	enum EntryState
+	{
+		Building,
+		Ready,
+		Failed
+	};
+
+	struct Entry
+	{
+		std::atomic<int> State = Building;
+		Pointer Value;
+	};
+
+	Slot Slots[SlotCount];
+	std::atomic<Entry*> Segments[SegmentCount] = {};
+	std::atomic<int> Count = 0;
+
+	// 0 marks an empty slot
+	static uint64_t MakeKey(uint64_t hash)
+	{
+		return hash == 0 ? 1 : hash;
+	}
+
+	// the caller owns the entry while it's in the building state
+	template <typename Factory>
+	static Pointer Build(Entry& entry, int index, Factory& factory)
+	{
+		try
+		{
+			entry.Value = factory(index);
+		}
+		catch (...)
+		{
+			entry.State.store(Failed, std::memory_order_release);
+
+			throw;
+		}
+
+		entry.State.store(Ready, std::memory_order_release);
+
+		return entry.Value;
+	}
+
+	Entry& FetchEntry(int index)
+	{
+		std::atomic<Entry*>& segmentSlot = Segments[index / SegmentSize];
+		Entry* segment = segmentSlot.load(std::memory_order_acquire);
+
+		if (segment == nullptr)
+		{
+			Entry* newSegment = new Entry[SegmentSize];
+
+			if (segmentSlot.compare_exchange_strong(segment, newSegment, std::memory_order_acq_rel))
+				segment = newSegment;
+			else
+				delete[] newSegment;
+		}
+
+		return segment[index % SegmentSize];
+	}
+};
@@ -1,142 +1,147 @@
 #include "IdentifierHeap.h"
 
+#include <bit>
+
 IDHeap::~IDHeap()
 {
 	Clear();
 }
 
-constexpr unsigned short rshift(unsigned short value, int offset)
+size_t IDHeap::FindFree() const
 {
-	return offset > 0 ? value << offset : value >> -offset;
-}
+	if (Levels.empty())
+		return 0;
 
-void IDHeap::Write(size_t index, unsigned char bits, unsigned char srcMask)
-{
-	unsigned char& value = Nodes[index / 4];
-	size_t offset = 2 * (index % 4);
-	srcMask = (unsigned char)rshift(0xFCFF, ((int)offset - 8)) | (srcMask << offset);
-	value = ((unsigned short)value & ((unsigned short)srcMask)) | (bits << offset);
-}
+	size_t index = 0;
 
-void IDHeap::Write(size_t index, unsigned char bits, bool value)
-{
-	Write(index, value ? bits : 0, (unsigned char)(0x3 ^ bits));
+	// walk down from the top, taking the lowest word that still has room at every level
+	for (size_t level = Levels.size(); level-- > 0;)
+	{
+		if (index >= Levels[level].size())
+			return index << (WordShift * (level + 1));
+
+		index = (index << WordShift) + std::countr_one(Levels[level][index]);
+	}
+
+	return index;
 }
 
-constexpr unsigned char IDHeap::Read(size_t index) const
+void IDHeap::Reserve(size_t id)
 {
-	unsigned char value = Nodes[index / 4];
-	size_t offset = 2 * (index % 4);
-	return (value >> offset) & 0x3;
+	size_t words = (id >> WordShift) + 1;
+
+	if (Levels.empty())
+		Levels.push_back(WordLevel());
+
+	if (Levels[0].size() >= words)
+		return;
+
+	Levels[0].resize(words, 0);
+
+	// new words are empty so their summary bits are clear, only a brand new level has to be filled in
+	for (size_t level = 1; level < Levels.size(); ++level)
+		Levels[level].resize((Levels[level - 1].size() + WordBits - 1) >> WordShift, 0);
+
+	if (Levels.back().size() > 1)
+		RebuildLevels();
 }
 
-constexpr unsigned char IDHeap::Read(size_t index, unsigned char mask) const
+void IDHeap::MarkWord(size_t wordIndex, Word bits)
 {
-	return (Read(index) & mask) != 0;
+	Word word = Levels[0][wordIndex] |= bits;
+
+	for (size_t level = 1; level < Levels.size() && word == FullWord; ++level)
+	{
+		word = Levels[level][wordIndex >> WordShift] |= Word(1) << (wordIndex & (WordBits - 1));
+
+		wordIndex >>= WordShift;
+	}
 }
 
 size_t IDHeap::RequestID()
 {
-	size_t id = Allocate();
+	size_t id = FindFree();
+
+	Reserve(id);
+	MarkWord(id >> WordShift, Word(1) << (id & (WordBits - 1)));
 
 	++Allocated;
 
-	Write(id, Used, true);
+	if (id >= Capacity)
+		Capacity = id + 1;
+
+	return id;
+}
+
+std::vector<size_t> IDHeap::RequestIDs(size_t count)
+{
+	std::vector<size_t> ids;
+
+	ids.reserve(count);
 
-	if (id > 0)
+	while (ids.size() < count)
 	{
-		size_t currentID = (id - 1) / 2;
+		size_t first = FindFree();
+		size_t wordIndex = first >> WordShift;
 
-		while (currentID < Capacity)
-		{
-			size_t left = 2 * currentID + 1;
-			size_t right = 2 * currentID + 2;
+		Reserve(first);
 
-			bool childrenUsed = (left >= Capacity || Read(left, ChildrenUsed)) && (right >= Capacity || Read(right, ChildrenUsed));
+		// take every free bit of the word at once instead of walking the levels per id
+		Word free = ~Levels[0][wordIndex];
+		Word taken = 0;
 
-			Write(currentID, ChildrenUsed, childrenUsed);
+		while (free != 0 && ids.size() < count)
+		{
+			Word bit = free & (~free + 1);
 
-			if (currentID == 0)
-				currentID = -1;
-			else
-				currentID = (currentID - 1) / 2;
+			ids.push_back((wordIndex << WordShift) + std::countr_zero(free));
+			taken |= bit;
+			free ^= bit;
 		}
+
+		MarkWord(wordIndex, taken);
 	}
 
-	return id;
+	Allocated += count;
+
+	if (count > 0 && ids.back() >= Capacity)
+		Capacity = ids.back() + 1;
+
+	return ids;
 }
+
 void IDHeap::Release(size_t id)
 {
-	if (id >= Capacity || !Read(id, Used))
+	if (id >= Capacity)
 		return;
 
-	--Allocated;
-
-	Write(id, Used, false);
+	size_t wordIndex = id >> WordShift;
+	Word bit = Word(1) << (id & (WordBits - 1));
 
-	if (id == 0)
+	if ((Levels[0][wordIndex] & bit) == 0)
 		return;
 
-	id = (id - 1) / 2;
+	--Allocated;
 
-	while (id < Capacity)
-	{
-		Write(id, ChildrenUsed, false);
+	bool wasFull = Levels[0][wordIndex] == FullWord;
 
-		if (id == 0)
-			id = -1;
-		else
-			id = (id - 1) / 2;
-	}
-}
+	Levels[0][wordIndex] &= ~bit;
 
-size_t IDHeap::Allocate()
-{
-	if (Nodes.size() > 0 && !Read(0, Used))
-		return 0;
-
-	if (Nodes.size() > 0 && !Read(0, ChildrenUsed))
+	// only words that were full have their bit set above, so stop as soon as a level wasn't
+	for (size_t level = 1; level < Levels.size() && wasFull; ++level)
 	{
-		size_t id = 0;
+		Word& parent = Levels[level][wordIndex >> WordShift];
 
-		while (Read(id, Used))
-		{
-			size_t left = 2 * id + 1;
-			size_t right = 2 * id + 2;
-
-			if (left < int(Capacity) && (!Read(left, Used) || !Read(left, ChildrenUsed)))
-				id = left;
-			else if (right < int(Capacity) && (!Read(right, Used) || !Read(right, ChildrenUsed)))
-				id = right;
-			else
-				throw "shts fucked";
-		}
+		wasFull = parent == FullWord;
+		parent &= ~(Word(1) << (wordIndex & (WordBits - 1)));
 
-		return id;
-	}
-	else
-	{
-		size_t capacity = Nodes.size() * 4;
-		size_t id = Capacity;
-
-		if (id >= capacity)
-		{
-			Nodes.push_back(0x3);
-		}
-		else
-		{
-			Write(id, Used | ChildrenUsed, true);
-		}
-
-		++Capacity;
-
-		return id;
+		wordIndex >>= WordShift;
 	}
 }
 
 size_t IDHeap::Size() const
 {
-	return Nodes.size() * 4;
+	return Levels.empty() ? 0 : Levels[0].size() * WordBits;
 }
 
 size_t IDHeap::AllocatedIDs() const
@@ -146,21 +151,49 @@ size_t IDHeap::AllocatedIDs() const
 
 bool IDHeap::NodeAllocated(size_t id) const
 {
-	if (id >= 0 && id < Capacity)
-		return Read(id, Used);
+	if (id < Capacity)
+		return (Levels[0][id >> WordShift] >> (id & (WordBits - 1))) & 1;
 	else
 		throw "Attempt to access out of bounds ID";
 }
 
 void IDHeap::Clear()
 {
-	Nodes.clear();
+	Levels.clear();
 	Allocated = 0;
 	Capacity = 0;
 }
 
 void IDHeap::ShrinkToAllocated()
 {
-	Nodes.resize((Capacity / 4) + std::max(1ull, Capacity % 4));
-	std::memset(Nodes.data(), 0xFF, Nodes.size());
-}
\ No newline at end of file
+	if (Levels.empty())
+		return;
+
+	WordLevel& used = Levels[0];
+
+	while (!used.empty() && used.back() == 0)
+		used.pop_back();
+
+	Capacity = used.empty() ? 0 : ((used.size() - 1) << WordShift) + WordBits - std::countl_zero(used.back());
+
+	used.shrink_to_fit();
+
+	RebuildLevels();
+}
+
+void IDHeap::RebuildLevels()
+{
+	Levels.resize(1);
+
+	for (size_t level = 1; Levels[level - 1].size() > 1; ++level)
+	{
+		const WordLevel& below = Levels[level - 1];
+		WordLevel summary((below.size() + WordBits - 1) >> WordShift, 0);
+
+		for (size_t i = 0; i < below.size(); ++i)
+			if (below[i] == FullWord)
+				summary[i >> WordShift] |= Word(1) << (i & (WordBits - 1));
+
+		Levels.push_back(std::move(summary));
+	}
+}
@@ -1,13 +1,18 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 
+// hands out the lowest free id. used ids are kept as a bitset with summary levels stacked on top,
+// a set bit in level n + 1 means the whole 64 bit word below it in level n is taken
 class IDHeap
 {
 public:
 	~IDHeap();
 
 	size_t RequestID();
+	std::vector<size_t> RequestIDs(size_t count);
 	void Release(size_t id);
 	size_t Size() const;
 	size_t AllocatedIDs() const;
@@ -22,19 +27,21 @@ public:
 	size_t Allocate(std::vector<T>& vector, const T& newValue);
 
 private:
-	typedef std::vector<unsigned char> NodeHeap;
-	const unsigned char Used = 0x1;
-	const unsigned char ChildrenUsed = 0x2;
+	typedef uint64_t Word;
+	typedef std::vector<Word> WordLevel;
 
-	NodeHeap Nodes;
+	static const size_t WordBits = 64;
+	static const size_t WordShift = 6;
+	static const Word FullWord = ~Word(0);
+
+	std::vector<WordLevel> Levels;
 	size_t Allocated = 0;
 	size_t Capacity = 0;
 
-	size_t Allocate();
-	void Write(size_t index, unsigned char bits, unsigned char srcMask);
-	void Write(size_t index, unsigned char bits, bool value);
-	constexpr unsigned char Read(size_t index) const;
-	constexpr unsigned char Read(size_t index, unsigned char mask) const;
+	size_t FindFree() const;
+	void Reserve(size_t id);
+	void MarkWord(size_t wordIndex, Word bits);
+	void RebuildLevels();
 };
 
 template <typename T>
@@ -61,4 +68,4 @@ size_t IDHeap::Allocate(std::vector<T>& vector, const T& newValue)
 		vector[id] = newValue;
 
 	return id;
-}
\ No newline at end of file
+}
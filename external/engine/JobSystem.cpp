@@ -0,0 +1,300 @@
+#include "JobSystem.h"
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Engine
+{
+	namespace
+	{
+		struct QueuedJob
+		{
+			JobSystem::Job Work;
+			JobCounter* Counter = nullptr;
+		};
+
+		struct JobQueue
+		{
+			std::mutex Lock;
+			std::deque<QueuedJob> Jobs;
+		};
+
+		// queue 0 is shared by every thread outside the pool, workers own the rest
+		struct Scheduler
+		{
+			std::vector<std::unique_ptr<JobQueue>> Queues;
+			std::vector<std::thread> Workers;
+			std::atomic<int> QueuedJobs = 0;
+			std::atomic<bool> Stopping = false;
+			std::mutex SleepLock;
+			std::condition_variable WakeUp;
+		};
+
+		thread_local int ThreadIndex = 0;
+		thread_local unsigned int StealOffset = 0;
+
+		std::mutex SchedulerLock;
+		std::atomic<Scheduler*> ActiveScheduler = nullptr;
+
+		void WorkerLoop(Scheduler* scheduler, int index);
+
+		Scheduler* StartScheduler(int workerCount)
+		{
+			if (workerCount <= 0)
+			{
+				int cores = int(std::thread::hardware_concurrency());
+
+				workerCount = cores > 2 ? cores - 1 : 1;
+			}
+
+			Scheduler* scheduler = new Scheduler();
+
+			for (int i = 0; i <= workerCount; ++i)
+				scheduler->Queues.push_back(std::make_unique<JobQueue>());
+
+			for (int i = 1; i <= workerCount; ++i)
+				scheduler->Workers.push_back(std::thread(WorkerLoop, scheduler, i));
+
+			return scheduler;
+		}
+
+		Scheduler* GetScheduler()
+		{
+			Scheduler* scheduler = ActiveScheduler.load(std::memory_order_acquire);
+
+			if (scheduler != nullptr)
+				return scheduler;
+
+			std::lock_guard<std::mutex> lock(SchedulerLock);
+
+			scheduler = ActiveScheduler.load(std::memory_order_relaxed);
+
+			if (scheduler == nullptr)
+			{
+				scheduler = StartScheduler(0);
+
+				ActiveScheduler.store(scheduler, std::memory_order_release);
+			}
+
+			return scheduler;
+		}
+
+		bool PopJob(Scheduler* scheduler, QueuedJob& job)
+		{
+			int queueCount = int(scheduler->Queues.size());
+			int home = ThreadIndex < queueCount ? ThreadIndex : 0;
+
+			{
+				JobQueue& queue = *scheduler->Queues[home];
+
+				std::lock_guard<std::mutex> lock(queue.Lock);
+
+				if (!queue.Jobs.empty())
+				{
+					job = std::move(queue.Jobs.back());
+					queue.Jobs.pop_back();
+					scheduler->QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+					return true;
+				}
+			}
+
+			// steal the oldest job, it's the most likely to spawn more work
+			unsigned int offset = StealOffset++;
+
+			for (int i = 0; i < queueCount; ++i)
+			{
+				int victim = int((offset + i) % queueCount);
+
+				if (victim == home)
+					continue;
+
+				JobQueue& queue = *scheduler->Queues[victim];
+
+				std::lock_guard<std::mutex> lock(queue.Lock);
+
+				if (!queue.Jobs.empty())
+				{
+					job = std::move(queue.Jobs.front());
+					queue.Jobs.pop_front();
+					scheduler->QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void RunJob(QueuedJob& job)
+		{
+			std::exception_ptr error;
+
+			try
+			{
+				job.Work();
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			if (job.Counter != nullptr)
+				job.Counter->Done(error);
+			else if (error != nullptr)
+				std::cerr << "[JobSystem] a job without a counter threw an exception" << std::endl;
+		}
+
+		void WorkerLoop(Scheduler* scheduler, int index)
+		{
+			ThreadIndex = index;
+			StealOffset = unsigned(index);
+
+			while (true)
+			{
+				QueuedJob job;
+
+				if (PopJob(scheduler, job))
+				{
+					RunJob(job);
+
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(scheduler->SleepLock);
+
+				scheduler->WakeUp.wait(lock, [scheduler]()
+				{
+					return scheduler->Stopping.load(std::memory_order_acquire) || scheduler->QueuedJobs.load(std::memory_order_acquire) > 0;
+				});
+
+				if (scheduler->Stopping.load(std::memory_order_acquire) && scheduler->QueuedJobs.load(std::memory_order_acquire) == 0)
+					return;
+			}
+		}
+
+		void PushJob(QueuedJob&& job)
+		{
+			Scheduler* scheduler = GetScheduler();
+
+			int queueCount = int(scheduler->Queues.size());
+			JobQueue& queue = *scheduler->Queues[ThreadIndex < queueCount ? ThreadIndex : 0];
+
+			{
+				std::lock_guard<std::mutex> lock(queue.Lock);
+
+				queue.Jobs.push_back(std::move(job));
+			}
+
+			scheduler->QueuedJobs.fetch_add(1, std::memory_order_release);
+
+			// taking the lock makes sure a worker that just checked for work is already waiting
+			{
+				std::lock_guard<std::mutex> lock(scheduler->SleepLock);
+			}
+
+			scheduler->WakeUp.notify_one();
+		}
+
+		// joins the workers when the program exits
+		struct SchedulerShutdown
+		{
+			~SchedulerShutdown()
+			{
+				JobSystem::Shutdown();
+			}
+		} ShutdownAtExit;
+	}
+
+	void JobSystem::Initialize(int workerCount)
+	{
+		std::lock_guard<std::mutex> lock(SchedulerLock);
+
+		if (ActiveScheduler.load(std::memory_order_acquire) != nullptr)
+			throw "job system is already running";
+
+		ActiveScheduler.store(StartScheduler(workerCount), std::memory_order_release);
+	}
+
+	void JobSystem::Shutdown()
+	{
+		std::lock_guard<std::mutex> lock(SchedulerLock);
+
+		Scheduler* scheduler = ActiveScheduler.load(std::memory_order_acquire);
+
+		if (scheduler == nullptr)
+			return;
+
+		{
+			std::lock_guard<std::mutex> sleepLock(scheduler->SleepLock);
+
+			scheduler->Stopping.store(true, std::memory_order_release);
+		}
+
+		scheduler->WakeUp.notify_all();
+
+		// workers drain the queues before they stop
+		for (std::thread& worker : scheduler->Workers)
+			worker.join();
+
+		ActiveScheduler.store(nullptr, std::memory_order_release);
+
+		delete scheduler;
+	}
+
+	int JobSystem::GetWorkerCount()
+	{
+		return int(GetScheduler()->Workers.size());
+	}
+
+	int JobSystem::GetThreadIndex()
+	{
+		return ThreadIndex;
+	}
+
+	void JobSystem::Schedule(Job job, JobCounter& counter)
+	{
+		counter.Add();
+
+		PushJob(QueuedJob{ std::move(job), &counter });
+	}
+
+	void JobSystem::Schedule(Job job)
+	{
+		PushJob(QueuedJob{ std::move(job), nullptr });
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		while (!counter.IsDone())
+			if (!RunPendingJob())
+				std::this_thread::yield();
+
+		std::exception_ptr error;
+
+		{
+			std::lock_guard<std::mutex> lock(counter.ErrorLock);
+
+			std::swap(error, counter.Error);
+		}
+
+		if (error != nullptr)
+			std::rethrow_exception(error);
+	}
+
+	bool JobSystem::RunPendingJob()
+	{
+		QueuedJob job;
+
+		if (!PopJob(GetScheduler(), job))
+			return false;
+
+		RunJob(job);
+
+		return true;
+	}
+}
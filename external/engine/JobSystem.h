@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <cstddef>
+
+namespace Engine
+{
+	// counts the jobs of a group that haven't finished yet. one counter can be shared by any number of jobs
+	class JobCounter
+	{
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool IsDone() const { return Pending.load(std::memory_order_acquire) == 0; }
+		int GetPending() const { return Pending.load(std::memory_order_acquire); }
+
+		// Schedule does these itself, they're public so work that isn't a job can hold a group open too
+		void Add(int jobs = 1)
+		{
+			Pending.fetch_add(jobs, std::memory_order_relaxed);
+		}
+
+		void Done(std::exception_ptr error = nullptr)
+		{
+			if (error != nullptr)
+			{
+				std::lock_guard<std::mutex> lock(ErrorLock);
+
+				if (Error == nullptr)
+					Error = error;
+			}
+
+			Pending.fetch_sub(1, std::memory_order_acq_rel);
+		}
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> Pending = 0;
+		std::mutex ErrorLock;
+		std::exception_ptr Error;
+	};
+
+	// one shared pool of worker threads, each with its own deque. a worker pops its newest job and
+	// steals the oldest one from someone else when it runs dry. threads that wait on a counter run
+	// queued jobs in the meantime, so waiting from inside a job is fine.
+	// the pool starts with one worker less than there are cores the first time it's used
+	class JobSystem
+	{
+	public:
+		typedef std::function<void()> Job;
+
+		static void Initialize(int workerCount = 0);
+		static void Shutdown();
+
+		static int GetWorkerCount();
+
+		// 0 on threads outside the pool, 1 and up on workers
+		static int GetThreadIndex();
+		static bool IsWorkerThread() { return GetThreadIndex() != 0; }
+
+		static void Schedule(Job job, JobCounter& counter);
+		static void Schedule(Job job);
+
+		// runs jobs on the calling thread until the counter is done, then rethrows the first exception one of its jobs threw
+		static void Wait(JobCounter& counter);
+
+		// calls body(begin, end) for batches of at most batchSize covering [0, count) and waits for all of them.
+		// the first batch runs on the calling thread
+		template <typename Body>
+		static void ParallelFor(size_t count, size_t batchSize, Body&& body);
+
+	private:
+		static bool RunPendingJob();
+	};
+
+	template <typename Body>
+	void JobSystem::ParallelFor(size_t count, size_t batchSize, Body&& body)
+	{
+		if (batchSize == 0)
+			batchSize = 1;
+
+		if (count <= batchSize)
+		{
+			if (count > 0)
+				body(size_t(0), count);
+
+			return;
+		}
+
+		JobCounter counter;
+
+		for (size_t begin = batchSize; begin < count; begin += batchSize)
+		{
+			size_t end = count - begin < batchSize ? count : begin + batchSize;
+
+			Schedule([&body, begin, end]() { body(begin, end); }, counter);
+		}
+
+		// the other batches reference body and counter, so they have to finish before anything leaves this frame
+		std::exception_ptr error;
+
+		try
+		{
+			body(size_t(0), batchSize);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		Wait(counter);
+
+		if (error != nullptr)
+			std::rethrow_exception(error);
+	}
+}
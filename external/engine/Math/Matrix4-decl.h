@@ -46,6 +46,7 @@ public:
 	constexpr Matrix4Type(const Vec3& vector);
 	constexpr Matrix4Type(const Vec3& position, const Vec3& right, const Vec3& up, const Vec3& front);
 	Matrix4Type(const Vec3& position, const Vec3& direction, const Vec3& globalUp = Vec3(0, 1, 0));
+	constexpr Matrix4Type(const Matrix4Type& other);
 
 	template <typename OtherNumber>
 	constexpr Matrix4Type(const Matrix3Type<OtherNumber>& mat, const Vec3& translation = Vec3(0, 0, 0));
@@ -73,6 +74,7 @@ public:
 	Matrix4Type& RotateEulerAnglesYaw(Number yaw, Number pitch, Number roll);
 	Matrix4Type& Inverse();
 	Matrix4Type& Invert(const Matrix4Type& other);
+	Matrix4Type& FullInverse();
 	Matrix4Type& Projection(Number distance, Number near, Number far, Number width, Number height);
 	Matrix4Type& Projection(Number fov, Number aspectRatio, Number nearPlane, Number farPlane);
 	Matrix4Type& ExtractRotation(const Matrix4Type& matrix, const Vec3& newTranslation = Vec3());
@@ -81,6 +83,7 @@ public:
 
 	Matrix4Type Transposed() const;
 	Matrix4Type Inverted() const;
+	Matrix4Type FullInverted() const;
 	Matrix4Type Rotation(const Vec3& newTranslation = Vec3()) const;
 	Matrix4Type TransformedAround(const Vec3& point) const;
 
@@ -156,7 +159,7 @@ using Matrix4 = Matrix4Type<Float>;
 template <typename Number>
 constexpr Matrix4Type<Number> operator*(Number scalar, const Matrix4Type<Number>& matrix)
 {
-	Matrix4Type result;
+	Matrix4Type<Number> result;
 
 	for (int x = 0; x < 3; ++x)
 		for (int y = 0; y < 3; ++y)
@@ -56,6 +56,15 @@ Matrix4Type<Number>::Matrix4Type(const Vec3& position, const Vec3& direction, co
 	Face(position, direction, globalUp);
 }
 
+// declared since operator= is user-provided, an implicit copy constructor next to it is deprecated
+template <typename Number>
+constexpr Matrix4Type<Number>::Matrix4Type(const Matrix4Type& other)
+{
+	for (int x = 0; x < 4; ++x)
+		for (int y = 0; y < 4; ++y)
+			Data[y][x] = other.Data[y][x];
+}
+
 template <typename Number>
 template <typename OtherNumber>
 constexpr Matrix4Type<Number>::Matrix4Type(const Matrix3Type<OtherNumber>& mat, const Vec3& translation)
@@ -359,6 +368,62 @@ Matrix4Type<Number>& Matrix4Type<Number>::Inverse()
 	return *this;
 }
 
+// Inverse() only handles affine matrices, this one works for projections too
+template <typename Number>
+Matrix4Type<Number>& Matrix4Type<Number>::FullInverse()
+{
+	const Number (&m)[4][4] = Data;
+
+	Number s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	Number s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	Number s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	Number s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	Number s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	Number s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+	Number c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+	Number c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	Number c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	Number c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	Number c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	Number c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+	Number inverseDeterminant = 1 / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+	Number inverseData[4][4] = {
+		{
+			(m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inverseDeterminant,
+			(-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inverseDeterminant,
+			(m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inverseDeterminant,
+			(-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inverseDeterminant
+		},
+		{
+			(-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inverseDeterminant,
+			(m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inverseDeterminant,
+			(-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inverseDeterminant,
+			(m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inverseDeterminant
+		},
+		{
+			(m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inverseDeterminant,
+			(-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inverseDeterminant,
+			(m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inverseDeterminant,
+			(-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inverseDeterminant
+		},
+		{
+			(-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inverseDeterminant,
+			(m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inverseDeterminant,
+			(-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inverseDeterminant,
+			(m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inverseDeterminant
+		}
+	};
+
+	for (int x = 0; x < 4; ++x)
+		for (int y = 0; y < 4; ++y)
+			Data[y][x] = inverseData[y][x];
+
+	return *this;
+}
+
 template <typename Number>
 Matrix4Type<Number>& Matrix4Type<Number>::Invert(const Matrix4Type& other)
 {
@@ -430,6 +495,12 @@ Matrix4Type<Number> Matrix4Type<Number>::Inverted() const
 	return Matrix4Type(*this).Inverse();
 }
 
+template <typename Number>
+Matrix4Type<Number> Matrix4Type<Number>::FullInverted() const
+{
+	return Matrix4Type(*this).FullInverse();
+}
+
 template <typename Number>
 Matrix4Type<Number> Matrix4Type<Number>::Rotation(const Vec3& newTranslation) const
 {
@@ -854,3 +925,18 @@ std::ostream& operator<<(std::ostream& out, const Matrix4Type<Number>& matrix)
 
 	return out;
 }
+
+#if ENGINE_SIMD_MATH
+// the float versions of the hot operations are vectorized, see SimdMath.cpp
+template <>
+Matrix4Type<float> Matrix4Type<float>::operator*(const Matrix4Type<float>& other) const;
+
+template <>
+Vector3Type<float, float> Matrix4Type<float>::operator*(const Vec3& other) const;
+
+template <>
+Matrix4Type<float>& Matrix4Type<float>::Inverse();
+
+template <>
+Matrix4Type<float>& Matrix4Type<float>::FullInverse();
+#endif
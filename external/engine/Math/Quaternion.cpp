@@ -200,13 +200,21 @@ Quaternion Quaternion::Slerp(const Quaternion& destination, Float t) const
 	return (ratioA * *this + ratioB * destination).Normalize();
 }
 
+// cheaper than Slerp and close enough for the small steps between animation keys
+Quaternion Quaternion::Nlerp(const Quaternion& destination, Float t) const
+{
+	Float scalar = Dot(destination) < 0 ? -1 : 1;
+
+	return ((1 - t) * *this + scalar * t * destination).Normalize();
+}
+
 Quaternion Quaternion::operator*(const Quaternion& rhs) const
 {
 	return Quaternion(
+		W * rhs.W - X * rhs.X - Y * rhs.Y - Z * rhs.Z,
 		W * rhs.X + X * rhs.W + Y * rhs.Z - Z * rhs.Y,
 		W * rhs.Y - X * rhs.Z + Y * rhs.W + Z * rhs.X,
-		W * rhs.Z + X * rhs.Y - Y * rhs.X + Z * rhs.W,
-		W * rhs.W - X * rhs.X - Y * rhs.Y - Z * rhs.Z
+		W * rhs.Z + X * rhs.Y - Y * rhs.X + Z * rhs.W
 	);
 }
 
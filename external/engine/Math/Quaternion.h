@@ -21,6 +21,7 @@ public:
 	Quaternion& Invert();
 	Quaternion Inverse() const { return Quaternion(*this).Invert(); }
 	Quaternion Slerp(const Quaternion& destination, Float t) const;
+	Quaternion Nlerp(const Quaternion& destination, Float t) const;
 
 	Quaternion operator*(const Quaternion& rhs) const;
 
@@ -0,0 +1,784 @@
+#include "SimdMath.h"
+
+#include "Quaternion.h"
+#include "Vector3.h"
+
+#include <atomic>
+#include <cmath>
+
+#if ENGINE_SIMD_MATH
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX_KERNEL
+#else
+#define AVX_KERNEL __attribute__((target("avx")))
+#endif
+#endif
+
+// matrices are stored column major (TransposedMatrices), so Data[i] is column i and a column is one __m128
+
+namespace
+{
+	typedef void (*MultiplyKernel)(const Matrix4F* left, size_t leftStride, const Matrix4F* right, Matrix4F* results, size_t count);
+	typedef void (*TransformKernel)(const Matrix4F& matrix, const float* vectors, size_t inputStride, float* results, size_t outputStride, size_t count, bool points);
+	typedef void (*InterpolateKernel)(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count);
+	typedef void (*ToMatrixKernel)(const Quaternion* quaternions, Matrix4F* results, size_t count);
+
+	struct KernelTable
+	{
+		SimdMath::InstructionSet InstructionSet;
+		MultiplyKernel Multiply;
+		TransformKernel Transform;
+		InterpolateKernel Nlerp;
+		InterpolateKernel Slerp;
+		ToMatrixKernel ToMatrices;
+	};
+
+	// scalar kernels, these follow the operation order of the generic Matrix4Type/Quaternion code
+
+	void MultiplyScalar(const Matrix4F* left, size_t leftStride, const Matrix4F* right, Matrix4F* results, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Matrix4F& a = left[i * leftStride];
+			const Matrix4F& b = right[i];
+
+			float result[4][4];
+
+			for (int x = 0; x < 4; ++x)
+				for (int y = 0; y < 4; ++y)
+				{
+					result[y][x] = 0;
+
+					for (int j = 0; j < 4; ++j)
+						result[y][x] += a.Data[j][x] * b.Data[y][j];
+				}
+
+			for (int x = 0; x < 4; ++x)
+				for (int y = 0; y < 4; ++y)
+					results[i].Data[y][x] = result[y][x];
+		}
+	}
+
+	void TransformScalar(const Matrix4F& matrix, const float* vectors, size_t inputStride, float* results, size_t outputStride, size_t count, bool points)
+	{
+		const float (&m)[4][4] = matrix.Data;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float* vector = vectors + i * inputStride;
+			float* result = results + i * outputStride;
+
+			float x = vector[0];
+			float y = vector[1];
+			float z = vector[2];
+			float w = points ? 1.f : 0.f;
+
+			float transformed[4];
+
+			for (int j = 0; j < 4; ++j)
+				transformed[j] = x * m[0][j] + y * m[1][j] + z * m[2][j] + w * m[3][j];
+
+			for (size_t j = 0; j < outputStride; ++j)
+				result[j] = transformed[j];
+		}
+	}
+
+	void NlerpScalar(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			results[i] = from[i].Nlerp(to[i], t[i]);
+	}
+
+	void SlerpScalar(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			results[i] = from[i].Slerp(to[i], t[i]);
+	}
+
+	void ToMatricesScalar(const Quaternion* quaternions, Matrix4F* results, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			results[i] = quaternions[i].MatrixF();
+	}
+
+	const KernelTable ScalarKernels = { SimdMath::InstructionSet::Scalar, MultiplyScalar, TransformScalar, NlerpScalar, SlerpScalar, ToMatricesScalar };
+
+#if ENGINE_SIMD_MATH
+	// SSE kernels, x64 always has SSE2 so these need no checks
+
+	inline __m128 MultiplyColumn(__m128 a0, __m128 a1, __m128 a2, __m128 a3, const float* column)
+	{
+		__m128 result = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+
+		result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+
+		return _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+	}
+
+	inline void MultiplySse(const Matrix4F& a, const Matrix4F& b, Matrix4F& result)
+	{
+		__m128 a0 = _mm_loadu_ps(a.Data[0]);
+		__m128 a1 = _mm_loadu_ps(a.Data[1]);
+		__m128 a2 = _mm_loadu_ps(a.Data[2]);
+		__m128 a3 = _mm_loadu_ps(a.Data[3]);
+
+		__m128 r0 = MultiplyColumn(a0, a1, a2, a3, b.Data[0]);
+		__m128 r1 = MultiplyColumn(a0, a1, a2, a3, b.Data[1]);
+		__m128 r2 = MultiplyColumn(a0, a1, a2, a3, b.Data[2]);
+		__m128 r3 = MultiplyColumn(a0, a1, a2, a3, b.Data[3]);
+
+		_mm_storeu_ps(result.Data[0], r0);
+		_mm_storeu_ps(result.Data[1], r1);
+		_mm_storeu_ps(result.Data[2], r2);
+		_mm_storeu_ps(result.Data[3], r3);
+	}
+
+	inline __m128 TransformSse(const Matrix4F& matrix, float x, float y, float z, float w)
+	{
+		__m128 result = _mm_mul_ps(_mm_loadu_ps(matrix.Data[0]), _mm_set1_ps(x));
+
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(matrix.Data[1]), _mm_set1_ps(y)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(matrix.Data[2]), _mm_set1_ps(z)));
+
+		return _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(matrix.Data[3]), _mm_set1_ps(w)));
+	}
+
+	inline void StoreVector(float* result, __m128 vector, size_t stride)
+	{
+		if (stride == 4)
+		{
+			_mm_storeu_ps(result, vector);
+
+			return;
+		}
+
+		_mm_storel_pi(reinterpret_cast<__m64*>(result), vector);
+		_mm_store_ss(result + 2, _mm_movehl_ps(vector, vector));
+	}
+
+	inline __m128 Cross(__m128 a, __m128 b)
+	{
+		__m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+
+		return _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+	}
+
+	void MultiplySseKernel(const Matrix4F* left, size_t leftStride, const Matrix4F* right, Matrix4F* results, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			MultiplySse(left[i * leftStride], right[i], results[i]);
+	}
+
+	void TransformSseKernel(const Matrix4F& matrix, const float* vectors, size_t inputStride, float* results, size_t outputStride, size_t count, bool points)
+	{
+		__m128 c0 = _mm_loadu_ps(matrix.Data[0]);
+		__m128 c1 = _mm_loadu_ps(matrix.Data[1]);
+		__m128 c2 = _mm_loadu_ps(matrix.Data[2]);
+		__m128 c3 = points ? _mm_loadu_ps(matrix.Data[3]) : _mm_setzero_ps();
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float* vector = vectors + i * inputStride;
+
+			__m128 result = _mm_mul_ps(c0, _mm_set1_ps(vector[0]));
+
+			result = _mm_add_ps(result, _mm_mul_ps(c1, _mm_set1_ps(vector[1])));
+			result = _mm_add_ps(result, _mm_mul_ps(c2, _mm_set1_ps(vector[2])));
+			result = _mm_add_ps(result, c3);
+
+			StoreVector(results + i * outputStride, result, outputStride);
+		}
+	}
+
+	// 4 quaternions at a time with one component per register, the tail is padded with identities
+	template <typename Operation>
+	void ForEachQuaternionBlock(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count, Operation operation)
+	{
+		static_assert(sizeof(Quaternion) == 4 * sizeof(float), "quaternions have to be 4 packed floats");
+
+		for (size_t i = 0; i < count; i += 4)
+		{
+			size_t blockSize = count - i < 4 ? count - i : 4;
+
+			alignas(16) Quaternion fromBlock[4];
+			alignas(16) Quaternion toBlock[4];
+			alignas(16) float tBlock[4] = {};
+			alignas(16) Quaternion resultBlock[4];
+
+			for (size_t j = 0; j < 4; ++j)
+			{
+				fromBlock[j] = j < blockSize ? from[i + j] : Quaternion(1, 0, 0, 0);
+				toBlock[j] = j < blockSize ? to[i + j] : Quaternion(1, 0, 0, 0);
+
+				if (j < blockSize)
+					tBlock[j] = t[i + j];
+			}
+
+			__m128 fromX = _mm_load_ps(&fromBlock[0].X);
+			__m128 fromY = _mm_load_ps(&fromBlock[1].X);
+			__m128 fromZ = _mm_load_ps(&fromBlock[2].X);
+			__m128 fromW = _mm_load_ps(&fromBlock[3].X);
+			__m128 toX = _mm_load_ps(&toBlock[0].X);
+			__m128 toY = _mm_load_ps(&toBlock[1].X);
+			__m128 toZ = _mm_load_ps(&toBlock[2].X);
+			__m128 toW = _mm_load_ps(&toBlock[3].X);
+
+			_MM_TRANSPOSE4_PS(fromX, fromY, fromZ, fromW);
+			_MM_TRANSPOSE4_PS(toX, toY, toZ, toW);
+
+			__m128 dot = _mm_mul_ps(fromX, toX);
+
+			dot = _mm_add_ps(dot, _mm_mul_ps(fromY, toY));
+			dot = _mm_add_ps(dot, _mm_mul_ps(fromZ, toZ));
+			dot = _mm_add_ps(dot, _mm_mul_ps(fromW, toW));
+
+			// take the short way around
+			__m128 sign = _mm_and_ps(dot, _mm_set1_ps(-0.f));
+
+			dot = _mm_xor_ps(dot, sign);
+
+			__m128 fromWeight;
+			__m128 toWeight;
+
+			operation(dot, _mm_load_ps(tBlock), fromWeight, toWeight);
+
+			toWeight = _mm_xor_ps(toWeight, sign);
+
+			__m128 x = _mm_add_ps(_mm_mul_ps(fromX, fromWeight), _mm_mul_ps(toX, toWeight));
+			__m128 y = _mm_add_ps(_mm_mul_ps(fromY, fromWeight), _mm_mul_ps(toY, toWeight));
+			__m128 z = _mm_add_ps(_mm_mul_ps(fromZ, fromWeight), _mm_mul_ps(toZ, toWeight));
+			__m128 w = _mm_add_ps(_mm_mul_ps(fromW, fromWeight), _mm_mul_ps(toW, toWeight));
+
+			__m128 squareLength = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+			__m128 inverseLength = _mm_div_ps(_mm_set1_ps(1), _mm_sqrt_ps(squareLength));
+
+			x = _mm_mul_ps(x, inverseLength);
+			y = _mm_mul_ps(y, inverseLength);
+			z = _mm_mul_ps(z, inverseLength);
+			w = _mm_mul_ps(w, inverseLength);
+
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+
+			_mm_store_ps(&resultBlock[0].X, x);
+			_mm_store_ps(&resultBlock[1].X, y);
+			_mm_store_ps(&resultBlock[2].X, z);
+			_mm_store_ps(&resultBlock[3].X, w);
+
+			for (size_t j = 0; j < blockSize; ++j)
+				results[i + j] = resultBlock[j];
+		}
+	}
+
+	void NlerpSseKernel(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count)
+	{
+		ForEachQuaternionBlock(from, to, t, results, count, [](__m128, __m128 t, __m128& fromWeight, __m128& toWeight)
+		{
+			fromWeight = _mm_sub_ps(_mm_set1_ps(1), t);
+			toWeight = t;
+		});
+	}
+
+	// polynomial slerp from David Eberly's "A Fast and Accurate Algorithm for Computing SLERP".
+	// the weights sin((1 - t) * theta) / sin(theta) and sin(t * theta) / sin(theta) are evaluated as
+	// series in cos(theta) - 1 so there's no acos, sin or division by a tiny sine. 14 terms with the
+	// last one stretched by 1 + mu keep the weights within 1.5e-7 over the whole 0 - 90 degree range
+	struct SlerpSeries
+	{
+		static const int Terms = 14;
+
+		float U[Terms];
+		float V[Terms];
+
+		constexpr SlerpSeries() : U(), V()
+		{
+			const double onePlusMu = 1.906589356021535;
+
+			for (int i = 0; i < Terms; ++i)
+			{
+				double scale = i == Terms - 1 ? onePlusMu : 1;
+
+				U[i] = float(scale / ((i + 1) * (2 * i + 3)));
+				V[i] = float(scale * (i + 1) / (2 * i + 3));
+			}
+		}
+	};
+
+	constexpr SlerpSeries SlerpCoefficients;
+
+	void SlerpSseKernel(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count)
+	{
+		ForEachQuaternionBlock(from, to, t, results, count, [](__m128 cosine, __m128 t, __m128& fromWeight, __m128& toWeight)
+		{
+			__m128 one = _mm_set1_ps(1);
+			__m128 cosineMinusOne = _mm_sub_ps(cosine, one);
+			__m128 d = _mm_sub_ps(one, t);
+			__m128 squareT = _mm_mul_ps(t, t);
+			__m128 squareD = _mm_mul_ps(d, d);
+
+			__m128 seriesT = one;
+			__m128 seriesD = one;
+
+			for (int i = SlerpSeries::Terms - 1; i >= 0; --i)
+			{
+				__m128 u = _mm_set1_ps(SlerpCoefficients.U[i]);
+				__m128 v = _mm_set1_ps(SlerpCoefficients.V[i]);
+
+				__m128 termT = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, squareT), v), cosineMinusOne);
+				__m128 termD = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, squareD), v), cosineMinusOne);
+
+				seriesT = _mm_add_ps(one, _mm_mul_ps(termT, seriesT));
+				seriesD = _mm_add_ps(one, _mm_mul_ps(termD, seriesD));
+			}
+
+			fromWeight = _mm_mul_ps(d, seriesD);
+			toWeight = _mm_mul_ps(t, seriesT);
+		});
+	}
+
+	void ToMatricesSseKernel(const Quaternion* quaternions, Matrix4F* results, size_t count)
+	{
+		for (size_t i = 0; i < count; i += 4)
+		{
+			size_t blockSize = count - i < 4 ? count - i : 4;
+
+			alignas(16) Quaternion block[4];
+
+			for (size_t j = 0; j < 4; ++j)
+				block[j] = j < blockSize ? quaternions[i + j] : Quaternion(1, 0, 0, 0);
+
+			__m128 x = _mm_load_ps(&block[0].X);
+			__m128 y = _mm_load_ps(&block[1].X);
+			__m128 z = _mm_load_ps(&block[2].X);
+			__m128 w = _mm_load_ps(&block[3].X);
+
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+
+			__m128 xx = _mm_mul_ps(x, x);
+			__m128 yy = _mm_mul_ps(y, y);
+			__m128 zz = _mm_mul_ps(z, z);
+			__m128 xy = _mm_mul_ps(x, y);
+			__m128 xz = _mm_mul_ps(x, z);
+			__m128 yz = _mm_mul_ps(y, z);
+			__m128 wx = _mm_mul_ps(w, x);
+			__m128 wy = _mm_mul_ps(w, y);
+			__m128 wz = _mm_mul_ps(w, z);
+
+			// 2 / |q|^2 instead of 2 keeps the rows unit length for quaternions that drifted off unit length
+			__m128 scale = _mm_div_ps(_mm_set1_ps(2), _mm_add_ps(_mm_add_ps(xx, yy), _mm_add_ps(zz, _mm_mul_ps(w, w))));
+			__m128 one = _mm_set1_ps(1);
+			__m128 zero = _mm_setzero_ps();
+
+			__m128 right0 = _mm_sub_ps(one, _mm_mul_ps(scale, _mm_add_ps(yy, zz)));
+			__m128 right1 = _mm_mul_ps(scale, _mm_add_ps(xy, wz));
+			__m128 right2 = _mm_mul_ps(scale, _mm_sub_ps(xz, wy));
+			__m128 right3 = zero;
+
+			__m128 up0 = _mm_mul_ps(scale, _mm_sub_ps(xy, wz));
+			__m128 up1 = _mm_sub_ps(one, _mm_mul_ps(scale, _mm_add_ps(xx, zz)));
+			__m128 up2 = _mm_mul_ps(scale, _mm_add_ps(yz, wx));
+			__m128 up3 = zero;
+
+			__m128 front0 = _mm_mul_ps(scale, _mm_add_ps(xz, wy));
+			__m128 front1 = _mm_mul_ps(scale, _mm_sub_ps(yz, wx));
+			__m128 front2 = _mm_sub_ps(one, _mm_mul_ps(scale, _mm_add_ps(xx, yy)));
+			__m128 front3 = zero;
+
+			_MM_TRANSPOSE4_PS(right0, right1, right2, right3);
+			_MM_TRANSPOSE4_PS(up0, up1, up2, up3);
+			_MM_TRANSPOSE4_PS(front0, front1, front2, front3);
+
+			__m128 rights[4] = { right0, right1, right2, right3 };
+			__m128 ups[4] = { up0, up1, up2, up3 };
+			__m128 fronts[4] = { front0, front1, front2, front3 };
+
+			for (size_t j = 0; j < blockSize; ++j)
+			{
+				Matrix4F& result = results[i + j];
+
+				_mm_storeu_ps(result.Data[0], rights[j]);
+				_mm_storeu_ps(result.Data[1], ups[j]);
+				_mm_storeu_ps(result.Data[2], fronts[j]);
+				_mm_storeu_ps(result.Data[3], _mm_setr_ps(0, 0, 0, 1));
+			}
+		}
+	}
+
+	const KernelTable SseKernels = { SimdMath::InstructionSet::SSE, MultiplySseKernel, TransformSseKernel, NlerpSseKernel, SlerpSseKernel, ToMatricesSseKernel };
+
+	// AVX kernels work on two columns or two vectors per register, the quaternion kernels stay on SSE
+
+	AVX_KERNEL void MultiplyAvxKernel(const Matrix4F* left, size_t leftStride, const Matrix4F* right, Matrix4F* results, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Matrix4F& a = left[i * leftStride];
+			const Matrix4F& b = right[i];
+
+			__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a.Data[0]));
+			__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a.Data[1]));
+			__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a.Data[2]));
+			__m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a.Data[3]));
+
+			__m256 b01 = _mm256_loadu_ps(b.Data[0]);
+			__m256 b23 = _mm256_loadu_ps(b.Data[2]);
+
+			__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+			__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+
+			r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_permute_ps(b01, 0x55)));
+			r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_permute_ps(b23, 0x55)));
+			r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_permute_ps(b01, 0xAA)));
+			r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_permute_ps(b23, 0xAA)));
+			r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_permute_ps(b01, 0xFF)));
+			r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_permute_ps(b23, 0xFF)));
+
+			_mm256_storeu_ps(results[i].Data[0], r01);
+			_mm256_storeu_ps(results[i].Data[2], r23);
+		}
+	}
+
+	AVX_KERNEL void TransformAvxKernel(const Matrix4F& matrix, const float* vectors, size_t inputStride, float* results, size_t outputStride, size_t count, bool points)
+	{
+		__m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix.Data[0]));
+		__m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix.Data[1]));
+		__m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix.Data[2]));
+		__m256 c3 = points ? _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix.Data[3])) : _mm256_setzero_ps();
+
+		size_t i = 0;
+
+		// a 4 wide load of a packed xyz vector reads one float into the next vector, so the last one is done separately
+		for (; i + 2 < count || (inputStride == 4 && i + 2 <= count); i += 2)
+		{
+			const float* vector = vectors + i * inputStride;
+
+			__m256 pair = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(vector)), _mm_loadu_ps(vector + inputStride), 1);
+
+			__m256 result = _mm256_mul_ps(c0, _mm256_permute_ps(pair, 0x00));
+
+			result = _mm256_add_ps(result, _mm256_mul_ps(c1, _mm256_permute_ps(pair, 0x55)));
+			result = _mm256_add_ps(result, _mm256_mul_ps(c2, _mm256_permute_ps(pair, 0xAA)));
+			result = _mm256_add_ps(result, c3);
+
+			if (outputStride == 4)
+			{
+				_mm256_storeu_ps(results + i * 4, result);
+
+				continue;
+			}
+
+			__m128 first = _mm256_castps256_ps128(result);
+			__m128 second = _mm256_extractf128_ps(result, 1);
+			float* output = results + i * outputStride;
+
+			_mm_storel_pi(reinterpret_cast<__m64*>(output), first);
+			_mm_store_ss(output + 2, _mm_movehl_ps(first, first));
+			_mm_storel_pi(reinterpret_cast<__m64*>(output + outputStride), second);
+			_mm_store_ss(output + outputStride + 2, _mm_movehl_ps(second, second));
+		}
+
+		for (; i < count; ++i)
+		{
+			const float* vector = vectors + i * inputStride;
+
+			__m128 result = _mm_mul_ps(_mm256_castps256_ps128(c0), _mm_set1_ps(vector[0]));
+
+			result = _mm_add_ps(result, _mm_mul_ps(_mm256_castps256_ps128(c1), _mm_set1_ps(vector[1])));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm256_castps256_ps128(c2), _mm_set1_ps(vector[2])));
+			result = _mm_add_ps(result, _mm256_castps256_ps128(c3));
+
+			float* output = results + i * outputStride;
+
+			if (outputStride == 4)
+			{
+				_mm_storeu_ps(output, result);
+
+				continue;
+			}
+
+			_mm_storel_pi(reinterpret_cast<__m64*>(output), result);
+			_mm_store_ss(output + 2, _mm_movehl_ps(result, result));
+		}
+	}
+
+	const KernelTable AvxKernels = { SimdMath::InstructionSet::AVX, MultiplyAvxKernel, TransformAvxKernel, NlerpSseKernel, SlerpSseKernel, ToMatricesSseKernel };
+
+	bool CpuSupportsAvx()
+	{
+#ifdef _MSC_VER
+		int info[4];
+
+		__cpuid(info, 1);
+
+		bool osSavesYmm = (info[2] & (1 << 27)) != 0;
+		bool hasAvx = (info[2] & (1 << 28)) != 0;
+
+		return osSavesYmm && hasAvx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+		return __builtin_cpu_supports("avx");
+#endif
+	}
+#endif
+
+	const KernelTable* GetWidestKernels()
+	{
+#if ENGINE_SIMD_MATH
+		static const KernelTable* widest = CpuSupportsAvx() ? &AvxKernels : &SseKernels;
+
+		return widest;
+#else
+		return &ScalarKernels;
+#endif
+	}
+
+	std::atomic<const KernelTable*> ActiveKernels = nullptr;
+
+	const KernelTable& Kernels()
+	{
+		const KernelTable* kernels = ActiveKernels.load(std::memory_order_acquire);
+
+		if (kernels == nullptr)
+		{
+			kernels = GetWidestKernels();
+
+			ActiveKernels.store(kernels, std::memory_order_release);
+		}
+
+		return *kernels;
+	}
+}
+
+namespace SimdMath
+{
+	InstructionSet GetInstructionSet()
+	{
+		return Kernels().InstructionSet;
+	}
+
+	InstructionSet GetSupportedInstructionSet()
+	{
+		return GetWidestKernels()->InstructionSet;
+	}
+
+	const char* GetInstructionSetName(InstructionSet set)
+	{
+		switch (set)
+		{
+		case InstructionSet::SSE: return "SSE";
+		case InstructionSet::AVX: return "AVX";
+		default: return "Scalar";
+		}
+	}
+
+	void SetInstructionSet(InstructionSet set)
+	{
+		const KernelTable* kernels = &ScalarKernels;
+
+#if ENGINE_SIMD_MATH
+		if (set == InstructionSet::AVX && GetSupportedInstructionSet() == InstructionSet::AVX)
+			kernels = &AvxKernels;
+		else if (set != InstructionSet::Scalar)
+			kernels = &SseKernels;
+#endif
+
+		ActiveKernels.store(kernels, std::memory_order_release);
+	}
+
+	void Multiply(const Matrix4F* left, const Matrix4F* right, Matrix4F* results, size_t count)
+	{
+		Kernels().Multiply(left, 1, right, results, count);
+	}
+
+	void Multiply(const Matrix4F& left, const Matrix4F* right, Matrix4F* results, size_t count)
+	{
+		Kernels().Multiply(&left, 0, right, results, count);
+	}
+
+	void TransformPoints(const Matrix4F& matrix, const Vector3F* points, Vector3F* results, size_t count)
+	{
+		Kernels().Transform(matrix, reinterpret_cast<const float*>(points), 4, reinterpret_cast<float*>(results), 4, count, true);
+	}
+
+	void TransformPoints(const Matrix4F& matrix, const Vector3SF* points, Vector3SF* results, size_t count)
+	{
+		Kernels().Transform(matrix, reinterpret_cast<const float*>(points), 3, reinterpret_cast<float*>(results), 3, count, true);
+	}
+
+	void TransformNormals(const Matrix4F& matrix, const Vector3F* normals, Vector3F* results, size_t count)
+	{
+		Kernels().Transform(matrix, reinterpret_cast<const float*>(normals), 4, reinterpret_cast<float*>(results), 4, count, false);
+	}
+
+	void TransformNormals(const Matrix4F& matrix, const Vector3SF* normals, Vector3SF* results, size_t count)
+	{
+		Kernels().Transform(matrix, reinterpret_cast<const float*>(normals), 3, reinterpret_cast<float*>(results), 3, count, false);
+	}
+
+	void Nlerp(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count)
+	{
+		Kernels().Nlerp(from, to, t, results, count);
+	}
+
+	void Slerp(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count)
+	{
+		Kernels().Slerp(from, to, t, results, count);
+	}
+
+	void ToMatrices(const Quaternion* quaternions, Matrix4F* results, size_t count)
+	{
+		Kernels().ToMatrices(quaternions, results, count);
+	}
+}
+
+#if ENGINE_SIMD_MATH
+// single matrix operations go straight to SSE, a dispatch per call would cost more than AVX saves here
+
+template <>
+Matrix4Type<float> Matrix4Type<float>::operator*(const Matrix4Type<float>& other) const
+{
+	Matrix4Type<float> result(true);
+
+	MultiplySse(*this, other, result);
+
+	return result;
+}
+
+template <>
+Vector3Type<float, float> Matrix4Type<float>::operator*(const Vec3& other) const
+{
+	alignas(16) float result[4];
+
+	_mm_store_ps(result, TransformSse(*this, other.X, other.Y, other.Z, other.W));
+
+	return Vec3(result[0], result[1], result[2], result[3]);
+}
+
+template <>
+Matrix4Type<float>& Matrix4Type<float>::Inverse()
+{
+	__m128 c0 = _mm_loadu_ps(Data[0]);
+	__m128 c1 = _mm_loadu_ps(Data[1]);
+	__m128 c2 = _mm_loadu_ps(Data[2]);
+	__m128 translation = _mm_loadu_ps(Data[3]);
+
+	// the rows of the inverse rotation are the cross products of the columns
+	__m128 r0 = Cross(c1, c2);
+	__m128 r1 = Cross(c2, c0);
+	__m128 r2 = Cross(c0, c1);
+	__m128 r3 = _mm_setzero_ps();
+
+	__m128 determinant = _mm_mul_ps(c0, r0);
+
+	determinant = _mm_add_ss(_mm_add_ss(determinant, _mm_shuffle_ps(determinant, determinant, _MM_SHUFFLE(1, 1, 1, 1))), _mm_movehl_ps(determinant, determinant));
+	determinant = _mm_shuffle_ps(determinant, determinant, 0);
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	__m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1), determinant);
+
+	// the last row of the 3x3 part is left alone, same as the generic version
+	__m128 lastRow = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+
+	r0 = _mm_or_ps(_mm_andnot_ps(lastRow, _mm_mul_ps(r0, inverseDeterminant)), _mm_and_ps(lastRow, c0));
+	r1 = _mm_or_ps(_mm_andnot_ps(lastRow, _mm_mul_ps(r1, inverseDeterminant)), _mm_and_ps(lastRow, c1));
+	r2 = _mm_or_ps(_mm_andnot_ps(lastRow, _mm_mul_ps(r2, inverseDeterminant)), _mm_and_ps(lastRow, c2));
+
+	__m128 inverseTranslation = _mm_mul_ps(r0, _mm_shuffle_ps(translation, translation, _MM_SHUFFLE(0, 0, 0, 0)));
+
+	inverseTranslation = _mm_add_ps(inverseTranslation, _mm_mul_ps(r1, _mm_shuffle_ps(translation, translation, _MM_SHUFFLE(1, 1, 1, 1))));
+	inverseTranslation = _mm_add_ps(inverseTranslation, _mm_mul_ps(r2, _mm_shuffle_ps(translation, translation, _MM_SHUFFLE(2, 2, 2, 2))));
+	inverseTranslation = _mm_xor_ps(inverseTranslation, _mm_set1_ps(-0.f));
+	inverseTranslation = _mm_or_ps(_mm_andnot_ps(lastRow, inverseTranslation), _mm_and_ps(lastRow, _mm_set1_ps(1)));
+
+	_mm_storeu_ps(Data[0], r0);
+	_mm_storeu_ps(Data[1], r1);
+	_mm_storeu_ps(Data[2], r2);
+	_mm_storeu_ps(Data[3], inverseTranslation);
+
+	return *this;
+}
+
+namespace
+{
+	// 2x2 blocks packed as (m00, m01, m10, m11)
+	inline __m128 Multiply2x2(__m128 a, __m128 b)
+	{
+		return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+	}
+
+	// adjugate(a) * b
+	inline __m128 AdjugateMultiply2x2(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+	}
+
+	// a * adjugate(b)
+	inline __m128 MultiplyAdjugate2x2(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+	}
+}
+
+// block wise inverse, inverting the transpose gives the transposed inverse so the storage order doesn't matter
+template <>
+Matrix4Type<float>& Matrix4Type<float>::FullInverse()
+{
+	__m128 row0 = _mm_loadu_ps(Data[0]);
+	__m128 row1 = _mm_loadu_ps(Data[1]);
+	__m128 row2 = _mm_loadu_ps(Data[2]);
+	__m128 row3 = _mm_loadu_ps(Data[3]);
+
+	__m128 a = _mm_movelh_ps(row0, row1);
+	__m128 b = _mm_movehl_ps(row1, row0);
+	__m128 c = _mm_movelh_ps(row2, row3);
+	__m128 d = _mm_movehl_ps(row3, row2);
+
+	// determinants of a, b, c and d
+	__m128 subDeterminants = _mm_sub_ps(
+		_mm_mul_ps(_mm_shuffle_ps(row0, row2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(row1, row3, _MM_SHUFFLE(3, 1, 3, 1))),
+		_mm_mul_ps(_mm_shuffle_ps(row0, row2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(row1, row3, _MM_SHUFFLE(2, 0, 2, 0)))
+	);
+
+	__m128 determinantA = _mm_shuffle_ps(subDeterminants, subDeterminants, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 determinantB = _mm_shuffle_ps(subDeterminants, subDeterminants, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 determinantC = _mm_shuffle_ps(subDeterminants, subDeterminants, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 determinantD = _mm_shuffle_ps(subDeterminants, subDeterminants, _MM_SHUFFLE(3, 3, 3, 3));
+
+	__m128 adjugateDC = AdjugateMultiply2x2(d, c);
+	__m128 adjugateAB = AdjugateMultiply2x2(a, b);
+
+	__m128 x = _mm_sub_ps(_mm_mul_ps(determinantD, a), Multiply2x2(b, adjugateDC));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(determinantA, d), Multiply2x2(c, adjugateAB));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(determinantB, c), MultiplyAdjugate2x2(d, adjugateAB));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(determinantC, b), MultiplyAdjugate2x2(a, adjugateDC));
+
+	// |m| = |a||d| + |b||c| - tr(adj(a) b adj(d) c)
+	__m128 trace = _mm_mul_ps(adjugateAB, _mm_shuffle_ps(adjugateDC, adjugateDC, _MM_SHUFFLE(3, 1, 2, 0)));
+
+	trace = _mm_add_ps(trace, _mm_movehl_ps(trace, trace));
+	trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(1, 1, 1, 1)));
+	trace = _mm_shuffle_ps(trace, trace, 0);
+
+	__m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(determinantA, determinantD), _mm_mul_ps(determinantB, determinantC)), trace);
+	__m128 inverseDeterminant = _mm_div_ps(_mm_setr_ps(1, -1, -1, 1), determinant);
+
+	x = _mm_mul_ps(x, inverseDeterminant);
+	y = _mm_mul_ps(y, inverseDeterminant);
+	z = _mm_mul_ps(z, inverseDeterminant);
+	w = _mm_mul_ps(w, inverseDeterminant);
+
+	// the adjugate shuffle folded into the store
+	_mm_storeu_ps(Data[0], _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(Data[1], _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+	_mm_storeu_ps(Data[2], _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(Data[3], _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+
+	return *this;
+}
+#endif
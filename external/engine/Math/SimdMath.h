@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Matrix4.h"
+#include "Vector3S.h"
+
+class Quaternion;
+
+// batch kernels for the float math types. every call goes through a table that is filled with the
+// widest instruction set the cpu supports the first time it's used, the scalar kernels are the reference
+namespace SimdMath
+{
+	enum class InstructionSet
+	{
+		Scalar,
+		SSE,
+		AVX
+	};
+
+	InstructionSet GetInstructionSet();
+	InstructionSet GetSupportedInstructionSet();
+	const char* GetInstructionSetName(InstructionSet set);
+
+	// for comparing kernels against each other, anything wider than the cpu supports gets clamped
+	void SetInstructionSet(InstructionSet set);
+
+	// results[i] = left[i] * right[i]
+	void Multiply(const Matrix4F* left, const Matrix4F* right, Matrix4F* results, size_t count);
+
+	// results[i] = left * right[i], e.g. a parent transform applied to all its children
+	void Multiply(const Matrix4F& left, const Matrix4F* right, Matrix4F* results, size_t count);
+
+	// points get w = 1, normals get w = 0. pass the inverse transpose for normals if there's non uniform scale
+	void TransformPoints(const Matrix4F& matrix, const Vector3F* points, Vector3F* results, size_t count);
+	void TransformPoints(const Matrix4F& matrix, const Vector3SF* points, Vector3SF* results, size_t count);
+	void TransformNormals(const Matrix4F& matrix, const Vector3F* normals, Vector3F* results, size_t count);
+	void TransformNormals(const Matrix4F& matrix, const Vector3SF* normals, Vector3SF* results, size_t count);
+
+	// Slerp is a polynomial fit that stays within ~1e-6 of Quaternion::Slerp without any trig calls
+	void Nlerp(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count);
+	void Slerp(const Quaternion* from, const Quaternion* to, const float* t, Quaternion* results, size_t count);
+
+	// same as Quaternion::MatrixF with zero translation, doesn't require unit quaternions
+	void ToMatrices(const Quaternion* quaternions, Matrix4F* results, size_t count);
+}
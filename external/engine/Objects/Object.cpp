@@ -1,6 +1,8 @@
 #include "Object.h"
 
 #include <iostream>
+#include <mutex>
+#include <atomic>
 
 #include <Engine/IdentifierHeap.h>
 #include <Engine/Reflection/MetaData.h>
@@ -10,12 +12,21 @@ namespace Engine
 	IDHeap ObjectIDs;
 	std::vector<Object::ObjectHandleData> ObjectHandles;
 
+	// objects get made from loader threads too, the id heap and handle table are shared between all of them
+	std::mutex ObjectIDsLock;
+
 	std::shared_ptr<Object> Null = nullptr;
 
+	std::atomic<int> DeferredTickDepth = 0;
+	std::mutex DeferredTicksLock;
+	std::vector<std::weak_ptr<Object>> DeferredTicks;
+
 	unsigned long long Object::ObjectsCreated = 0;
 
 	void Object::Initialize()
 	{
+		std::lock_guard<std::mutex> lock(ObjectIDsLock);
+
 		ObjectID = ObjectIDs.Allocate(ObjectHandles, ObjectHandleData{ this, This, ++ObjectsCreated });
 		OriginalID = ObjectID;
 		CreationOrderId = ObjectsCreated;
@@ -23,6 +34,8 @@ namespace Engine
 
 	bool Object::IsAlive(int objectId, unsigned long long creationOrderId)
 	{
+		std::lock_guard<std::mutex> lock(ObjectIDsLock);
+
 		return ObjectIDs.NodeAllocated(objectId) && ObjectHandles[objectId].CreationOrderId == creationOrderId;
 	}
 
@@ -34,22 +47,13 @@ namespace Engine
 	bool Object::IsA(const std::string& className, bool inherited) const
 	{
 		const Meta::ReflectedType* data = GetMetaData();
-		
-		if (data->Name == className) return true;
-
-		if (inherited)
-			for (int i = (int)data->Inherits.size() - 2; i >= 0; --i)
-				if (data->Inherits[i]->Name == className)
-					return true;
 
-		return false;
+		return data != nullptr && data->IsA(className, inherited);
 	}
 
 	bool Object::IsA(const Meta::ReflectedType* metadata, bool inherited) const
 	{
-		const Meta::ReflectedType* data = GetMetaData();
-
-		return data == metadata || data->InheritsType(metadata);
+		return MetaMatches(GetMetaData(), metadata, inherited);
 	}
 
 	void Object::SetObjectID(size_t id)
@@ -91,6 +95,8 @@ namespace Engine
 		if (parent != nullptr)
 			parent->RemoveChild(This.lock());
 
+		ChildTypes.clear();
+
 		while (GetChildren() > 0)
 		{
 			if (Children.back() != nullptr)
@@ -99,6 +105,11 @@ namespace Engine
 			Children.pop_back();
 		}
 
+		if (ObjectID == (size_t)-1)
+			return;
+
+		std::lock_guard<std::mutex> lock(ObjectIDsLock);
+
 		ObjectIDs.Release(ObjectID);
 
 		if (!ObjectHandles.empty())
@@ -125,22 +136,51 @@ namespace Engine
 
 	std::shared_ptr<Object> Object::Get(const std::string& className, bool inherited)
 	{
-		for (int i = 0; i < int(Children.size()); ++i)
-			if (Children[i]->IsA(className, inherited))
-				return Children[i];
-
-		return nullptr;
+		return static_cast<const Object*>(this)->Get(className, inherited);
 	}
 
 	std::shared_ptr<Object> Object::Get(const std::string& className, bool inherited) const
 	{
-		for (int i = 0; i < int(Children.size()); ++i)
-			if (Children[i]->IsA(className, inherited))
-				return Children[i];
+		const Meta::ReflectedType::MetaVector* types = Meta::ReflectedType::FindTypes(className);
+
+		if (types == nullptr)
+			return nullptr;
+
+		for (const Meta::ReflectedType* type : *types)
+		{
+			std::shared_ptr<Object> child = Get(type, inherited);
+
+			if (child != nullptr)
+				return child;
+		}
 
 		return nullptr;
 	}
 
+	// an exact type match wins over a derived one, otherwise the first matching type that was added
+	std::shared_ptr<Object> Object::Get(const Meta::ReflectedType* type, bool inherited) const
+	{
+		const ChildTypeEntry* match = nullptr;
+
+		for (const ChildTypeEntry& entry : ChildTypes)
+		{
+			if (entry.Type == type)
+			{
+				match = &entry;
+
+				break;
+			}
+
+			if (match == nullptr && inherited && MetaMatches(entry.Type, type, true))
+				match = &entry;
+		}
+
+		if (match == nullptr)
+			return nullptr;
+
+		return match->Objects.front()->This.lock();
+	}
+
 	std::shared_ptr<Object> Object::Get(int index)
 	{
 		if (index < 0 || index >= int(Children.size()))
@@ -175,28 +215,17 @@ namespace Engine
 
 	std::shared_ptr<Object> Object::GetComponent(const std::string& className, bool inherited) const
 	{
-		auto parent = Parent;
-
-		if (parent != nullptr)
-		{
-			if (ParentComponent && parent->IsA(className, inherited))
-				return parent->This.lock();
+		const Meta::ReflectedType::MetaVector* types = Meta::ReflectedType::FindTypes(className);
 
-			if (AncestorComponents)
-			{
-				Object* ancestor = Parent;
+		if (types == nullptr)
+			return nullptr;
 
-				for (int height = 0; (SuperComponentHeight == -1 || height < SuperComponentHeight) && ancestor != nullptr; ++height)
-				{
-					if (AncestorComponents && ancestor->IsA(className, inherited))
-						return ancestor->This.lock();
+		for (const Meta::ReflectedType* type : *types)
+		{
+			std::shared_ptr<Object> component = GetComponent(type, inherited);
 
-					if (ancestor->Parent != nullptr)
-						ancestor = ancestor->Parent;
-					else
-						ancestor = nullptr;
-				}
-			}
+			if (component != nullptr)
+				return component;
 		}
 
 		return nullptr;
@@ -233,14 +262,7 @@ namespace Engine
 
 	bool Object::HasA(const std::string& className, bool inherited) const
 	{
-		if (IsA(className))
-			return true;
-
-		for (int i = 0; i < int(Children.size()); ++i)
-			if (Children[i]->IsA(className, inherited))
-				return true;
-
-		return false;
+		return IsA(className) || Get(className, inherited) != nullptr;
 	}
 
 	void Object::AddChild(const std::shared_ptr<Object>& child)
@@ -255,6 +277,8 @@ namespace Engine
 		}
 
 		Children.push_back(child);
+
+		IndexChild(child.get());
 	}
 
 	void Object::Remove()
@@ -278,6 +302,8 @@ namespace Engine
 
 		if (index < int(Children.size()))
 		{
+			UnindexChild(child.get());
+
 			if (index < int(Children.size()) - 1)
 				Children[index] = Children[Children.size() - 1];
 
@@ -336,11 +362,52 @@ namespace Engine
 
 	void Object::SetTicks(bool ticks)
 	{
+		bool changed = Ticks != ticks;
+
 		Ticks = ticks;
 
+		if (!changed && TickedBefore == DoesTick())
+			return;
+
+		if (DeferredTickDepth.load(std::memory_order_acquire) > 0)
+		{
+			std::lock_guard<std::mutex> lock(DeferredTicksLock);
+
+			DeferredTicks.push_back(This);
+
+			return;
+		}
+
 		UpdateTickingState();
 	}
 
+	void Object::BeginDeferredTicks()
+	{
+		DeferredTickDepth.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	void Object::EndDeferredTicks()
+	{
+		if (DeferredTickDepth.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+
+		std::vector<std::weak_ptr<Object>> deferred;
+
+		{
+			std::lock_guard<std::mutex> lock(DeferredTicksLock);
+
+			deferred.swap(DeferredTicks);
+		}
+
+		for (const std::weak_ptr<Object>& handle : deferred)
+		{
+			std::shared_ptr<Object> object = handle.lock();
+
+			if (object != nullptr)
+				object->UpdateTickingState();
+		}
+	}
+
 	bool Object::DoesObjectTick() const
 	{
 		return Ticks;
@@ -370,13 +437,60 @@ namespace Engine
 		TickedBefore = ticksNow;
 	}
 
+	void Object::IndexChild(Object* child)
+	{
+		const Meta::ReflectedType* type = child->GetMetaData();
+
+		for (ChildTypeEntry& entry : ChildTypes)
+		{
+			if (entry.Type == type)
+			{
+				entry.Objects.push_back(child);
+
+				return;
+			}
+		}
+
+		ChildTypes.push_back(ChildTypeEntry{ type, { child } });
+	}
+
+	void Object::UnindexChild(Object* child)
+	{
+		const Meta::ReflectedType* type = child->GetMetaData();
+
+		for (int i = 0; i < int(ChildTypes.size()); ++i)
+		{
+			std::vector<Object*>& objects = ChildTypes[i].Objects;
+
+			if (ChildTypes[i].Type != type)
+				continue;
+
+			for (int j = 0; j < int(objects.size()); ++j)
+			{
+				if (objects[j] == child)
+				{
+					objects.erase(objects.begin() + j);
+
+					break;
+				}
+			}
+
+			if (objects.empty())
+				ChildTypes.erase(ChildTypes.begin() + i);
+
+			return;
+		}
+	}
+
 	bool Object::MetaMatches(const Meta::ReflectedType* type, const Meta::ReflectedType* target, bool inherited)
 	{
-		return type == target || (inherited && type->InheritsType(target));
+		return type == target || (inherited && type != nullptr && target != nullptr && type->InheritsType(target));
 	}
 
-	const std::weak_ptr<Object>& Object::GetHandle(int id)
+	std::weak_ptr<Object> Object::GetHandle(int id)
 	{
+		std::lock_guard<std::mutex> lock(ObjectIDsLock);
+
 		return ObjectHandles[id].SmartPointer;
 	}
 }
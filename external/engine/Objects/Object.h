@@ -64,6 +64,7 @@ namespace Engine
 		std::shared_ptr<Object> Get(const std::string &className, bool inherited = true);
 		std::shared_ptr<Object> Get(const std::string &className, bool inherited = true) const;
 		std::shared_ptr<Object> Get(int index);
+		std::shared_ptr<Object> Get(const Meta::ReflectedType *type, bool inherited = true) const;
 		std::shared_ptr<Object> GetByName(const std::string &name);
 		std::shared_ptr<Object> GetAncestor(const std::string &className, bool inherited = true);
 		bool HasA(const std::string &className, bool inherited = true) const;
@@ -82,6 +83,11 @@ namespace Engine
 		bool DoesTick() const;
 		bool DoesObjectTick() const;
 
+		// siblings share the ticking counts of their ancestors, so while a parallel tick runs SetTicks only
+		// flips the flag and the counts get fixed up when the outermost EndDeferredTicks comes in
+		static void BeginDeferredTicks();
+		static void EndDeferredTicks();
+
 		bool HasChildren() const { return !Children.empty(); }
 
 		template <typename T>
@@ -119,7 +125,13 @@ namespace Engine
 			if (ObjectMetaData != nullptr)
 				return;
 
+			if (Parent != nullptr)
+				Parent->UnindexChild(this);
+
 			ObjectMetaData = meta;
+
+			if (Parent != nullptr)
+				Parent->IndexChild(this);
 		}
 
 		bool operator==(const std::shared_ptr<Object> &object) const { return this == object.get(); }
@@ -155,12 +167,23 @@ namespace Engine
 		std::vector<MessageListener> Listeners;
 		std::vector<MessageListener> ListeningTo;
 
+		// children grouped by their exact type so lookups only look at one entry per distinct type
+		struct ChildTypeEntry
+		{
+			const Meta::ReflectedType *Type = nullptr;
+			std::vector<Object *> Objects;
+		};
+
+		std::vector<ChildTypeEntry> ChildTypes;
+
 		std::shared_ptr<Object> GetComponent(const Meta::ReflectedType *data, bool inherited) const;
 		void UpdateTickingState();
+		void IndexChild(Object *child);
+		void UnindexChild(Object *child);
 
 		static bool MetaMatches(const Meta::ReflectedType *type, const Meta::ReflectedType *target, bool inherited);
 
-		static const std::weak_ptr<Object> &GetHandle(int id);
+		static std::weak_ptr<Object> GetHandle(int id);
 	};
 
 	template <typename T>
@@ -192,11 +215,12 @@ namespace Engine
 	template <typename T>
 	std::shared_ptr<T> Object::Get(bool inherited)
 	{
-		for (int i = 0; i < GetChildren(); ++i)
-			if (MetaMatches(Get(i)->GetMetaData(), GetMeta<T>(), inherited))
-				return Get(i)->Cast<T>();
+		std::shared_ptr<Object> child = Get(GetMeta<T>(), inherited);
 
-		return nullptr;
+		if (child == nullptr)
+			return nullptr;
+
+		return child->Cast<T>();
 	}
 
 	template <typename T>
@@ -219,7 +243,7 @@ namespace Engine
 		while (ancestor != nullptr)
 		{
 			if (MetaMatches(ancestor->GetMetaData(), GetMeta<T>(), inherited))
-				return ancestor;
+				return ancestor->Cast<T>();
 
 			ancestor = ancestor->Parent;
 		}
@@ -271,7 +295,7 @@ namespace Engine
 	template <typename T>
 	bool Object::HasA(bool inherited)
 	{
-		return HasA(T::GetClassMetaData()->Name, inherited);
+		return IsA<T>(inherited) || Get(GetMeta<T>(), inherited) != nullptr;
 	}
 
 	template <typename T>
@@ -2,13 +2,89 @@
 
 #include "Transform.h"
 
+#include <Engine/JobSystem.h>
+
+#include <algorithm>
+
 namespace Engine
 {
+	namespace
+	{
+		struct DeferredTicksScope
+		{
+			DeferredTicksScope() { Object::BeginDeferredTicks(); }
+			~DeferredTicksScope() { Object::EndDeferredTicks(); }
+		};
+	}
+
 	Simulation::~Simulation()
 	{
 		ClearTransforms();
 	}
 
+	// the direct children are independent subtrees, so they tick in parallel with each subtree staying parent first.
+	// children can't be added to or removed from the simulation itself while this runs, transforms can
+	void Simulation::Update(Float delta)
+	{
+		std::vector<std::shared_ptr<Object>> subtrees;
+
+		subtrees.reserve(GetChildren());
+
+		for (int i = 0; i < GetChildren(); ++i)
+			subtrees.push_back(Get(i));
+
+		{
+			DeferredTicksScope deferredTicks;
+
+			Ticking = true;
+
+			try
+			{
+				JobSystem::ParallelFor(subtrees.size(), 1, [&subtrees, delta](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; ++i)
+					{
+						if (subtrees[i] == nullptr)
+							throw "bad child detected";
+
+						subtrees[i]->Update(delta);
+					}
+				});
+			}
+			catch (...)
+			{
+				Ticking = false;
+				ApplyPendingChanges();
+
+				throw;
+			}
+
+			Ticking = false;
+		}
+
+		ApplyPendingChanges();
+		UpdateTransforms();
+	}
+
+	void Simulation::ApplyPendingChanges()
+	{
+		std::vector<Transform*> adds;
+		std::vector<std::pair<size_t, Transform*>> removes;
+
+		{
+			std::lock_guard<std::mutex> lock(PendingLock);
+
+			adds.swap(PendingAdds);
+			removes.swap(PendingRemoves);
+		}
+
+		for (const auto& removed : removes)
+			ReleaseTransform(removed.first, removed.second);
+
+		for (Transform* transform : adds)
+			InsertTransform(transform);
+	}
+
 	void Simulation::ClearTransforms()
 	{
 		for (size_t i = 0; i < Transforms.size(); ++i)
@@ -20,22 +96,222 @@ namespace Engine
 				TransformIds.Release(i);
 			}
 		}
+
+		UpdateOrder.clear();
+		LevelStarts.clear();
+		HierarchyDirty = true;
 	}
 
 	void Simulation::AddTransform(Transform* transform)
+	{
+		if (Ticking)
+		{
+			std::lock_guard<std::mutex> lock(PendingLock);
+
+			PendingAdds.push_back(transform);
+
+			return;
+		}
+
+		InsertTransform(transform);
+	}
+
+	void Simulation::InsertTransform(Transform* transform)
 	{
 		size_t index = TransformIds.Allocate(Transforms, transform);
 
+		if (LocalTransforms.size() < Transforms.size())
+		{
+			LocalTransforms.resize(Transforms.size());
+			WorldTransforms.resize(Transforms.size());
+			ParentIndices.resize(Transforms.size(), NoParent);
+			ExternalParents.resize(Transforms.size(), nullptr);
+			DirtyFlags.resize(Transforms.size(), 0);
+		}
+
+		LocalTransforms[index] = transform->GetTransformation();
+		DirtyFlags[index] = 1;
+		HierarchyDirty = true;
+		++Moves;
+
 		transform->AddToSimulation(this, index);
 	}
 
 	void Simulation::RemoveTransform(Transform* transform)
 	{
+		// the transform stops reporting to us right away, its slot is only given back once nothing is ticking
 		size_t index = transform->RemoveFromSimulation(this);
 
+		if (Ticking)
+		{
+			std::lock_guard<std::mutex> lock(PendingLock);
+
+			if (index == (size_t)-1)
+				PendingAdds.erase(std::remove(PendingAdds.begin(), PendingAdds.end(), transform), PendingAdds.end());
+			else
+				PendingRemoves.push_back({index, transform});
+
+			return;
+		}
+
 		if (index == (size_t)-1) return;
 
+		ReleaseTransform(index, transform);
+	}
+
+	void Simulation::ReleaseTransform(size_t index, Transform* transform)
+	{
 		TransformIds.Release(index);
 		Transforms[index] = nullptr;
+		DirtyFlags[index] = 0;
+		HierarchyDirty = true;
+
+		TransformRemoved(transform);
+	}
+
+	void Simulation::MarkTransformDirty(size_t index, const Matrix4& localTransformation)
+	{
+		bool firstChange = !DirtyFlags[index];
+
+		LocalTransforms[index] = localTransformation;
+		DirtyFlags[index] = 1;
+		++Moves;
+
+		TransformChanged(Transforms[index], firstChange);
+	}
+
+	void Simulation::MarkHierarchyChanged()
+	{
+		HierarchyDirty = true;
+		++Moves;
+	}
+
+	void Simulation::UpdateTransforms()
+	{
+		// whatever moves while this runs is picked up next time
+		size_t moves = Moves;
+
+		if (HierarchyDirty)
+			RebuildUpdateOrder();
+
+		// a level only reads the one above it, so each level is one parallel pass and a dirty flag reaches the whole subtree
+		for (size_t level = 0; level + 1 < LevelStarts.size(); ++level)
+		{
+			size_t levelStart = LevelStarts[level];
+
+			JobSystem::ParallelFor(LevelStarts[level + 1] - levelStart, TransformBatchSize, [this, levelStart](size_t begin, size_t end)
+			{
+				for (size_t i = levelStart + begin; i < levelStart + end; ++i)
+					UpdateWorldTransformation(UpdateOrder[i]);
+			});
+		}
+
+		DeferredTicksScope deferredTicks;
+
+		JobSystem::ParallelFor(UpdateOrder.size(), TransformBatchSize, [this](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				size_t index = UpdateOrder[i];
+
+				if (!DirtyFlags[index])
+					continue;
+
+				Transforms[index]->ApplyWorldTransformation(ParentIndices[index] != NoParent || ExternalParents[index] != nullptr);
+
+				DirtyFlags[index] = 0;
+			}
+		});
+
+		UpdatedMoves = moves;
+	}
+
+	void Simulation::UpdateWorldTransformation(size_t index)
+	{
+		size_t parent = ParentIndices[index];
+
+		if (parent != NoParent)
+		{
+			if (DirtyFlags[parent])
+				DirtyFlags[index] = 1;
+
+			if (DirtyFlags[index])
+				WorldTransforms[index] = WorldTransforms[parent] * LocalTransforms[index];
+		}
+		else if (ExternalParents[index] != nullptr)
+		{
+			// nothing tells us when a parent outside the simulation moves, so always follow it
+			DirtyFlags[index] = 1;
+			WorldTransforms[index] = ExternalParents[index]->GetWorldTransformation() * LocalTransforms[index];
+		}
+		else if (DirtyFlags[index])
+			WorldTransforms[index] = LocalTransforms[index];
+	}
+
+	void Simulation::RebuildUpdateOrder()
+	{
+		std::vector<size_t> depths(Transforms.size(), 0);
+		size_t maxDepth = 0;
+
+		for (size_t index = 0; index < Transforms.size(); ++index)
+		{
+			ParentIndices[index] = NoParent;
+			ExternalParents[index] = nullptr;
+
+			if (Transforms[index] == nullptr || !Transforms[index]->InheritsTransformation())
+				continue;
+
+			std::shared_ptr<Transform> parent = Transforms[index]->GetComponent<Transform>(true);
+
+			if (parent == nullptr)
+				continue;
+
+			size_t parentIndex = parent->GetSimulationIndex(this);
+
+			if (parentIndex == (size_t)-1)
+				ExternalParents[index] = parent.get();
+			else
+				ParentIndices[index] = parentIndex;
+		}
+
+		for (size_t index = 0; index < Transforms.size(); ++index)
+		{
+			if (Transforms[index] == nullptr)
+				continue;
+
+			size_t depth = 0;
+
+			for (size_t parent = ParentIndices[index]; parent != NoParent && depth <= Transforms.size(); parent = ParentIndices[parent])
+				++depth;
+
+			depths[index] = depth;
+			maxDepth = std::max(maxDepth, depth);
+		}
+
+		// counting sort by depth keeps siblings in id order
+		std::vector<size_t> depthStarts(maxDepth + 2, 0);
+
+		for (size_t index = 0; index < Transforms.size(); ++index)
+			if (Transforms[index] != nullptr)
+				++depthStarts[depths[index] + 1];
+
+		for (size_t depth = 1; depth < depthStarts.size(); ++depth)
+			depthStarts[depth] += depthStarts[depth - 1];
+
+		UpdateOrder.resize(depthStarts.back());
+		LevelStarts = depthStarts;
+
+		for (size_t index = 0; index < Transforms.size(); ++index)
+		{
+			if (Transforms[index] == nullptr)
+				continue;
+
+			UpdateOrder[depthStarts[depths[index]]++] = index;
+
+			// a new parent means a new world matrix even if nothing local changed
+			DirtyFlags[index] = 1;
+		}
+
+		HierarchyDirty = false;
 	}
-}
\ No newline at end of file
+}
@@ -1,26 +1,82 @@
+#pragma once
+
 #include "Object.h"
 
 #include <Engine/IdentifierHeap.h>
+#include <Engine/Math/Matrix4.h>
+
+#include <atomic>
+#include <mutex>
 
 namespace Engine
 {
 	class Transform;
 
+	// Update ticks the direct children on the job system. while they tick, transforms added or removed from any worker
+	// are queued and only join or leave the arrays once every child is done, so a transform queued that way has to
+	// outlive the tick. the hooks follow the same split: TransformChanged runs on whichever thread moved the transform,
+	// which can be several workers at once for different transforms, and TransformRemoved always runs on the thread
+	// that called Update or RemoveTransform. nothing else may touch the simulation from other threads
 	class Simulation : public Object
 	{
 	public:
 		~Simulation();
 
+		void Update(Float delta) override;
+
 		void AddTransform(Transform* transform);
 		void RemoveTransform(Transform* transform);
 		void ClearTransforms();
 
+		// recomputes the world matrices of everything that moved since the last call, parents before children
+		void UpdateTransforms();
+		void MarkTransformDirty(size_t index, const Matrix4& localTransformation);
+		void MarkHierarchyChanged();
+
+		size_t GetTransformCount() const { return TransformIds.AllocatedIDs(); }
+
+		// as of the last UpdateTransforms. Transform::GetWorldTransformation also sees moves made since then
+		const Matrix4& GetWorldTransformation(size_t index) const { return WorldTransforms[index]; }
+
 		virtual void TransformChanged(Transform* transform, bool firstChange) {}
 		virtual void TransformStaticChanged(Transform* transform, bool isNowStatic) {}
 		virtual void TransformRemoved(Transform* transform) {}
 
 	private:
+		friend class Transform;
+
+		static const size_t NoParent = (size_t)-1;
+
 		std::vector<Transform*> Transforms;
 		IDHeap TransformIds;
+
+		// transforms per job when a level of the hierarchy gets split across the job system
+		static const size_t TransformBatchSize = 256;
+
+		// everything below is indexed by transform id, UpdateOrder holds the ids sorted by depth
+		std::vector<Matrix4> LocalTransforms;
+		std::vector<Matrix4> WorldTransforms;
+		std::vector<size_t> ParentIndices;
+		std::vector<const Transform*> ExternalParents;
+		std::vector<unsigned char> DirtyFlags;
+		std::vector<size_t> UpdateOrder;
+		std::vector<size_t> LevelStarts;
+		std::atomic<bool> HierarchyDirty = true;
+
+		// counts every change that can move a world matrix. while it's ahead of UpdatedMoves the array may be stale
+		std::atomic<size_t> Moves = 0;
+		size_t UpdatedMoves = 0;
+
+		// structural changes that came in while the children were ticking
+		std::atomic<bool> Ticking = false;
+		std::mutex PendingLock;
+		std::vector<Transform*> PendingAdds;
+		std::vector<std::pair<size_t, Transform*>> PendingRemoves;
+
+		void InsertTransform(Transform* transform);
+		void ReleaseTransform(size_t index, Transform* transform);
+		void ApplyPendingChanges();
+		void RebuildUpdateOrder();
+		void UpdateWorldTransformation(size_t index);
 	};
-}
\ No newline at end of file
+}
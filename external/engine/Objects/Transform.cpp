@@ -1,13 +1,18 @@
 #include "Transform.h"
+#include "Simulation.h"
 #include <glm/gtc/quaternion.hpp>
 
+#include <thread>
+
 namespace Engine
 {
 	void Transform::Update(Float delta)
 	{
 		Object::Update(delta);
 
-		Recompute(true);
+		// transforms owned by a simulation get their world matrices from its batched pass
+		if (Simulations.empty())
+			Recompute(true);
 
 		// if (Moved)
 		//	TransformMoved.Fire(this);
@@ -37,9 +42,7 @@ namespace Engine
 		else
 			WorldTransformation = inherited->GetWorldTransformation() * Transformation;
 
-		WorldTransformationInverse.Invert(WorldTransformation);
-		WorldNormalTransformation = WorldTransformation.Inverted().Transpose();
-		WorldRotation = Matrix4(true).ExtractRotation(WorldTransformation);
+		Derived.store(DerivedStale, std::memory_order_release);
 
 		if (HadParent)
 			OldParentTransform = inherited->GetWorldTransformation();
@@ -47,6 +50,56 @@ namespace Engine
 		SetTicks(true);
 	}
 
+	// the world matrix itself stays in the simulation's array
+	void Transform::ApplyWorldTransformation(bool hasParent)
+	{
+		Derived.store(DerivedStale, std::memory_order_release);
+
+		HadParent = hasParent;
+		Moved = true;
+
+		SetTicks(true);
+	}
+
+	// the first reader after a change builds all three, readers on other threads wait for it instead of racing it
+	void Transform::UpdateDerived() const
+	{
+		const Matrix4 &world = GetWorldTransformation();
+
+		if (Derived.load(std::memory_order_acquire) == DerivedReady)
+			return;
+
+		unsigned char expected = DerivedStale;
+
+		if (Derived.compare_exchange_strong(expected, DerivedBuilding, std::memory_order_acq_rel))
+		{
+			WorldTransformationInverse.Invert(world);
+			WorldNormalTransformation = WorldTransformationInverse;
+			WorldNormalTransformation.Transpose();
+			WorldRotation = Matrix4(true).ExtractRotation(world);
+
+			Derived.store(DerivedReady, std::memory_order_release);
+
+			return;
+		}
+
+		while (Derived.load(std::memory_order_acquire) != DerivedReady)
+			std::this_thread::yield();
+	}
+
+	void Transform::MarkChanged()
+	{
+		Moved = true;
+
+		for (size_t i = 0; i < Simulations.size(); ++i)
+			Simulations[i].Listener->MarkTransformDirty(Simulations[i].Index, Transformation);
+	}
+
+	bool Transform::NeedsRecompute() const
+	{
+		return Simulations.empty() && (Moved || InheritTransformation);
+	}
+
 	bool Transform::HasMoved() const
 	{
 		if (Moved)
@@ -101,9 +154,10 @@ namespace Engine
 	{
 		Transformation = matrix;
 
-		Moved = true;
+		MarkChanged();
 
-		Recompute();
+		if (Simulations.empty())
+			Recompute();
 	}
 
 	const Matrix4 &Transform::GetTransformation()
@@ -115,7 +169,11 @@ namespace Engine
 	{
 		InheritTransformation = inherits;
 
-		Recompute();
+		for (size_t i = 0; i < Simulations.size(); ++i)
+			Simulations[i].Listener->MarkHierarchyChanged();
+
+		if (Simulations.empty())
+			Recompute();
 	}
 
 	bool Transform::InheritsTransformation() const
@@ -147,7 +205,7 @@ namespace Engine
 
 	Vector3 Transform::GetPosition()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
 		return Transformation.Translation();
@@ -156,16 +214,20 @@ namespace Engine
 	void Transform::SetPosition(const Vector3 &position)
 	{
 		Transformation.SetTranslation(position);
+
+		MarkChanged();
 	}
 
 	void Transform::Move(const Vector3 &offset)
 	{
 		Transformation.SetTranslation(Transformation.Translation() + offset);
+
+		MarkChanged();
 	}
 
 	Vector3 Transform::GetWorldPosition() const
 	{
-		return WorldTransformation.Translation();
+		return GetWorldTransformation().Translation();
 	}
 
 	Vector3 Transform::GetWorldPosition()
@@ -173,12 +235,38 @@ namespace Engine
 		// if (Moved || InheritTransformation)
 		//	Recompute();
 
-		return WorldTransformation.Translation();
+		return static_cast<const Transform *>(this)->GetWorldTransformation().Translation();
 	}
 
+	// a transform in a simulation reads the simulation's array. if anything moved through the simulation since its
+	// last batched pass, the matrix is worked out from the parents first, on the thread that asks. moves of parents
+	// outside the simulation are only seen by the pass
 	const Matrix4 &Transform::GetWorldTransformation() const
 	{
-		return WorldTransformation;
+		if (Simulations.empty())
+			return WorldTransformation;
+
+		Simulation *simulation = Simulations[0].Listener;
+		size_t index = Simulations[0].Index;
+		size_t moves = simulation->Moves.load(std::memory_order_acquire);
+
+		if (moves == simulation->UpdatedMoves || moves == FlushedMoves)
+			return simulation->WorldTransforms[index];
+
+		const Transform *inherited = nullptr;
+
+		if (InheritTransformation)
+			inherited = GetComponent<Transform>(true).get();
+
+		if (inherited == nullptr)
+			simulation->WorldTransforms[index] = Transformation;
+		else
+			simulation->WorldTransforms[index] = inherited->GetWorldTransformation() * Transformation;
+
+		FlushedMoves = moves;
+		Derived.store(DerivedStale, std::memory_order_release);
+
+		return simulation->WorldTransforms[index];
 	}
 
 	const Matrix4 &Transform::GetWorldTransformation()
@@ -186,58 +274,70 @@ namespace Engine
 		// if (Moved || InheritTransformation)
 		//	Recompute();
 
-		return WorldTransformation;
+		return static_cast<const Transform *>(this)->GetWorldTransformation();
 	}
 
 	const Matrix4 &Transform::GetWorldTransformationInverse() const
 	{
+		UpdateDerived();
+
 		return WorldTransformationInverse;
 	}
 
 	const Matrix4 &Transform::GetWorldTransformationInverse()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
+		UpdateDerived();
+
 		return WorldTransformationInverse;
 	}
 
 	const Matrix4 &Transform::GetWorldRotation() const
 	{
+		UpdateDerived();
+
 		return WorldRotation;
 	}
 
 	const Matrix4 &Transform::GetWorldRotation()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
+		UpdateDerived();
+
 		return WorldRotation;
 	}
 
 	Quaternion Transform::GetWorldOrientation() const
 	{
-		return Quaternion(WorldTransformation);
+		return Quaternion(GetWorldTransformation());
 	}
 
 	Quaternion Transform::GetWorldOrientation()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
-		return Quaternion(WorldTransformation);
+		return Quaternion(static_cast<const Transform *>(this)->GetWorldTransformation());
 	}
 
 	const Matrix4 &Transform::GetWorldNormalTransformation() const
 	{
+		UpdateDerived();
+
 		return WorldNormalTransformation;
 	}
 
 	const Matrix4 &Transform::GetWorldNormalTransformation()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
+		UpdateDerived();
+
 		return WorldNormalTransformation;
 	}
 
@@ -248,7 +348,7 @@ namespace Engine
 
 	Quaternion Transform::GetOrientation()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
 		return Quaternion(Transformation);
@@ -257,6 +357,8 @@ namespace Engine
 	void Transform::SetOrientation(const Quaternion &orientation)
 	{
 		Transformation = Matrix4(orientation).SetTranslation(Transformation.Translation());
+
+		MarkChanged();
 	}
 
 	void Transform::Rotate(const Quaternion &rotation)
@@ -266,6 +368,8 @@ namespace Engine
 		Transformation.SetTranslation(Vector3());
 
 		Transformation = (Matrix4(rotation) * Transformation).SetTranslation(translation);
+
+		MarkChanged();
 	}
 
 	void Transform::Rotate(const Vector3 &axis, float angle)
@@ -275,6 +379,8 @@ namespace Engine
 		Transformation.SetTranslation(Vector3());
 
 		Transformation = (Matrix4(true).RotateAxis(axis, angle) * Transformation).SetTranslation(translation);
+
+		MarkChanged();
 	}
 
 	Vector3 Transform::GetEulerAngles() const
@@ -284,7 +390,7 @@ namespace Engine
 
 	Vector3 Transform::GetEulerAngles()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
 		return Vector3();
@@ -293,11 +399,15 @@ namespace Engine
 	void Transform::SetEulerAngles(const Vector3 &angles)
 	{
 		Transformation = Matrix4::EulerAnglesRotation(angles.X, angles.Y, angles.Z).SetTranslation(Transformation.Translation());
+
+		MarkChanged();
 	}
 
 	void Transform::SetEulerAngles(float pitch, float roll, float yaw)
 	{
 		Transformation = Matrix4::EulerAnglesRotation(pitch, roll, yaw).SetTranslation(Transformation.Translation());
+
+		MarkChanged();
 	}
 
 	void Transform::Rotate(const Vector3 &angles)
@@ -307,6 +417,8 @@ namespace Engine
 		Transformation.SetTranslation(Vector3());
 
 		Transformation = (Matrix4::EulerAnglesRotation(angles.X, angles.Y, angles.Z) * Transformation).SetTranslation(translation);
+
+		MarkChanged();
 	}
 
 	void Transform::Rotate(float pitch, float roll, float yaw)
@@ -316,6 +428,8 @@ namespace Engine
 		Transformation.SetTranslation(Vector3());
 
 		Transformation = (Matrix4::EulerAnglesRotation(pitch, roll, yaw) * Transformation).SetTranslation(translation);
+
+		MarkChanged();
 	}
 
 	Vector3 Transform::GetEulerAnglesYaw() const
@@ -325,7 +439,7 @@ namespace Engine
 
 	Vector3 Transform::GetEulerAnglesYaw()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
 		return Vector3();
@@ -334,11 +448,15 @@ namespace Engine
 	void Transform::SetEulerAnglesYaw(float yaw, float pitch, float roll)
 	{
 		Transformation = Matrix4::EulerAnglesYawRotation(yaw, pitch, roll).SetTranslation(Transformation.Translation());
+
+		MarkChanged();
 	}
 
 	void Transform::SetEulerAnglesYaw(const Vector3 &angles)
 	{
 		Transformation = Matrix4::EulerAnglesYawRotation(angles.X, angles.Y, angles.Z).SetTranslation(Transformation.Translation());
+
+		MarkChanged();
 	}
 
 	void Transform::RotateYaw(const Vector3 &angles)
@@ -348,6 +466,8 @@ namespace Engine
 		Transformation.SetTranslation(Vector3());
 
 		Transformation = (Matrix4::EulerAnglesYawRotation(angles.X, angles.Y, angles.Z) * Transformation).SetTranslation(translation);
+
+		MarkChanged();
 	}
 
 	void Transform::RotateYaw(float yaw, float pitch, float roll)
@@ -357,6 +477,8 @@ namespace Engine
 		Transformation.SetTranslation(Vector3());
 
 		Transformation = (Matrix4::EulerAnglesYawRotation(yaw, pitch, roll) * Transformation).SetTranslation(translation);
+
+		MarkChanged();
 	}
 
 	Vector3 Transform::GetScale() const
@@ -366,7 +488,7 @@ namespace Engine
 
 	Vector3 Transform::GetScale()
 	{
-		if (Moved || InheritTransformation)
+		if (NeedsRecompute())
 			Recompute();
 
 		return Vector3(Transformation.RightVector().Length(), Transformation.UpVector().Length(), Transformation.FrontVector().Length());
@@ -377,6 +499,8 @@ namespace Engine
 		Transformation.SetRight(Transformation.RightVector().Normalize() * scale.X);
 		Transformation.SetUp(Transformation.UpVector().Normalize() * scale.Y);
 		Transformation.SetFront(Transformation.FrontVector().Normalize() * scale.Z);
+
+		MarkChanged();
 	}
 
 	void Transform::Rescale(const Vector3 &scale)
@@ -384,16 +508,22 @@ namespace Engine
 		Transformation.SetRight(Transformation.RightVector() * scale.X);
 		Transformation.SetUp(Transformation.UpVector() * scale.Y);
 		Transformation.SetFront(Transformation.FrontVector() * scale.Z);
+
+		MarkChanged();
 	}
 
 	void Transform::TransformBy(const Matrix4 &transformation)
 	{
 		Transformation = transformation * Transformation;
+
+		MarkChanged();
 	}
 
 	void Transform::TransformBy(const Quaternion &transformation, const Vector3 &point)
 	{
 		Transformation = Matrix4(transformation).SetTranslation(point) * Transformation;
+
+		MarkChanged();
 	}
 
 	void Transform::TransformByRelative(const Matrix4 &transformation)
@@ -403,6 +533,8 @@ namespace Engine
 		Transformation.SetTranslation(Vector3());
 
 		Transformation = (transformation * Transformation).SetTranslation(translation);
+
+		MarkChanged();
 	}
 
 	void Transform::TransformByRelative(const Quaternion &transformation, const Vector3 &point)
@@ -412,6 +544,8 @@ namespace Engine
 		Transformation.SetTranslation(Vector3());
 
 		Transformation = (Matrix4(transformation).SetTranslation(point) * Transformation).SetTranslation(translation);
+
+		MarkChanged();
 	}
 
 	void Transform::AddToSimulation(Simulation *simulation, size_t index)
@@ -435,16 +569,35 @@ namespace Engine
 		return translation * rotation * scaling;
 	}
 
+	size_t Transform::GetSimulationIndex(const Simulation *simulation) const
+	{
+		for (size_t i = 0; i < Simulations.size(); ++i)
+			if (Simulations[i].Listener == simulation)
+				return Simulations[i].Index;
+
+		return (size_t)-1;
+	}
+
+	void Transform::ParentChanged(std::shared_ptr<Object> newParent)
+	{
+		for (size_t i = 0; i < Simulations.size(); ++i)
+			Simulations[i].Listener->MarkHierarchyChanged();
+
+		Moved = true;
+	}
+
 	size_t Transform::RemoveFromSimulation(Simulation *simulation)
 	{
 		for (size_t i = 0; i < Simulations.size(); ++i)
 		{
 			if (Simulations[i].Listener == simulation)
 			{
+				size_t index = Simulations[i].Index;
+
 				Simulations[i] = Simulations.back();
 				Simulations.pop_back();
 
-				return i;
+				return index;
 			}
 		}
 
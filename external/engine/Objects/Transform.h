@@ -8,6 +8,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <atomic>
+
 namespace Engine
 {
 	class Simulation;
@@ -84,25 +86,50 @@ namespace Engine
 
 		void AddToSimulation(Simulation *simulation, size_t index);
 		size_t RemoveFromSimulation(Simulation *simulation);
+		size_t GetSimulationIndex(const Simulation *simulation) const;
+
+		void ParentChanged(std::shared_ptr<Object> newParent) override;
 
 		// Event<Transform*> TransformMoved;
 
 	private:
+		friend class Simulation;
+
 		struct SimulationEntry
 		{
 			Simulation *Listener = nullptr;
 			size_t Index = 0;
 		};
 
+		enum DerivedState : unsigned char
+		{
+			DerivedStale,
+			DerivedBuilding,
+			DerivedReady
+		};
+
 		Matrix4 Transformation;
+
+		// only used outside a simulation, the first simulation's world matrix array holds it otherwise
 		Matrix4 WorldTransformation;
-		Matrix4 WorldTransformationInverse;
-		Matrix4 WorldRotation;
-		Matrix4 WorldNormalTransformation;
+
+		// worked out from the world matrix the first time one of them is asked for after it changed
+		mutable Matrix4 WorldTransformationInverse;
+		mutable Matrix4 WorldRotation;
+		mutable Matrix4 WorldNormalTransformation;
+		mutable std::atomic<unsigned char> Derived = DerivedStale;
+
+		// the simulation's move count when the world matrix was last brought up to date outside its batched pass
+		mutable size_t FlushedMoves = (size_t)-1;
+
 		std::vector<SimulationEntry> Simulations;
 
 		bool HasChanged();
+		bool NeedsRecompute() const;
 		void Recompute(bool doUpdate = false);
+		void MarkChanged();
+		void ApplyWorldTransformation(bool hasParent);
+		void UpdateDerived() const;
 
 		bool IsStaticTransformation = true;
 		bool InheritTransformation = true;
@@ -0,0 +1,146 @@
+#include "PageAllocator.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#if ENGINE_TRACK_ALLOCATIONS
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+namespace
+{
+	std::string ReadableTypeName(const char* name)
+	{
+#if defined(__GNUC__)
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+
+		if (status == 0 && demangled != nullptr)
+		{
+			std::string result = demangled;
+
+			std::free(demangled);
+
+			return result;
+		}
+#endif
+
+		return name;
+	}
+}
+
+std::map<std::string, size_t> BaseAllocator::GetLiveSites() const
+{
+	std::map<std::string, size_t> sites;
+	std::lock_guard<std::mutex> guard(Lock);
+
+	for (const auto& site : LiveSites)
+		++sites[ReadableTypeName(site.second)];
+
+	return sites;
+}
+#endif
+
+std::vector<BaseAllocator*>& AllocatorRegistry::Allocators()
+{
+	// function local so it exists before the first static pool gets constructed
+	static std::vector<BaseAllocator*> allocators;
+
+	return allocators;
+}
+
+void AllocatorRegistry::Register(BaseAllocator* allocator)
+{
+	Allocators().push_back(allocator);
+}
+
+void AllocatorRegistry::Unregister(BaseAllocator* allocator)
+{
+	std::vector<BaseAllocator*>& allocators = Allocators();
+
+	auto index = std::find(allocators.begin(), allocators.end(), allocator);
+
+	if (index != allocators.end())
+		allocators.erase(index);
+}
+
+const std::vector<BaseAllocator*>& AllocatorRegistry::GetAllocators()
+{
+	return Allocators();
+}
+
+void AllocatorRegistry::SetEmptyPageLimit(int limit)
+{
+	for (BaseAllocator* allocator : Allocators())
+		allocator->SetEmptyPageLimit(limit);
+}
+
+AllocatorStats AllocatorRegistry::GetTotals()
+{
+	AllocatorStats totals;
+
+	for (BaseAllocator* allocator : Allocators())
+	{
+		AllocatorStats stats = allocator->GetStats();
+
+		totals.LiveBlocks += stats.LiveBlocks;
+		totals.PeakBlocks += stats.PeakBlocks;
+		totals.LiveBytes += stats.LiveBytes;
+		totals.PeakBytes += stats.PeakBytes;
+		totals.Pages += stats.Pages;
+		totals.PeakPages += stats.PeakPages;
+		totals.EmptyPages += stats.EmptyPages;
+		totals.ReleasedPages += stats.ReleasedPages;
+		totals.ReservedBytes += stats.ReservedBytes;
+	}
+
+	return totals;
+}
+
+void AllocatorRegistry::Report(std::ostream& out)
+{
+	out << "[Allocators] size class  live blocks  peak blocks  live bytes  pages  peak pages  empty  released  fragmentation" << std::endl;
+
+	for (BaseAllocator* allocator : Allocators())
+	{
+		AllocatorStats stats = allocator->GetStats();
+
+		out << "[Allocators] "
+			<< std::setw(10) << stats.BlockSize
+			<< std::setw(13) << stats.LiveBlocks
+			<< std::setw(13) << stats.PeakBlocks
+			<< std::setw(12) << stats.LiveBytes
+			<< std::setw(7) << stats.Pages
+			<< std::setw(12) << stats.PeakPages
+			<< std::setw(7) << stats.EmptyPages
+			<< std::setw(10) << stats.ReleasedPages
+			<< std::setw(14) << std::fixed << std::setprecision(1) << stats.Fragmentation() * 100 << "%" << std::endl;
+	}
+}
+
+void AllocatorRegistry::ReportLeaks(std::ostream& out)
+{
+	size_t leaked = 0;
+
+	for (BaseAllocator* allocator : Allocators())
+	{
+		AllocatorStats stats = allocator->GetStats();
+
+		if (stats.LiveBlocks == 0)
+			continue;
+
+		leaked += stats.LiveBlocks;
+
+		out << "[Allocators] " << stats.LiveBlocks << " blocks still alive in the " << stats.BlockSize << " byte pool" << std::endl;
+
+#if ENGINE_TRACK_ALLOCATIONS
+		for (const auto& site : allocator->GetLiveSites())
+			out << "[Allocators]     " << site.second << " x " << site.first << std::endl;
+#endif
+	}
+
+	if (leaked == 0)
+		out << "[Allocators] no leaked blocks" << std::endl;
+}
@@ -2,10 +2,47 @@
 
 #include <forward_list>
 #include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <typeinfo>
+#include <ostream>
 
 // Here be dragons! Abandon all hope ye who enter here!
 // this is all mostly book keeping shit
 
+// debug builds remember which type every live block was created for, so leaks can be pinned on someone
+#if !defined(NDEBUG) && !defined(ENGINE_TRACK_ALLOCATIONS)
+#define ENGINE_TRACK_ALLOCATIONS 1
+#endif
+
+struct AllocatorStats
+{
+	int BlockSize = 0;
+	int PageSize = 0;
+	int BlocksPerPage = 0;
+	size_t LiveBlocks = 0;
+	size_t PeakBlocks = 0;
+	size_t LiveBytes = 0;
+	size_t PeakBytes = 0;
+	size_t Pages = 0;
+	size_t PeakPages = 0;
+	size_t EmptyPages = 0;
+	size_t ReleasedPages = 0;
+	size_t ReservedBytes = 0;
+
+	// share of reserved blocks that aren't holding anything
+	float Fragmentation() const
+	{
+		size_t capacity = Pages * BlocksPerPage;
+
+		return capacity == 0 ? 0.0f : 1.0f - float(LiveBlocks) / float(capacity);
+	}
+};
+
+// the pools are shared by every thread that makes or frees engine objects, loader jobs included. Allocate, Free and the
+// bookkeeping all take the allocator's lock
 class BaseAllocator
 {
 public:
@@ -17,14 +54,51 @@ public:
 
 	virtual void* Allocate() = 0;
 	virtual void Free(void* data) = 0;
+	virtual AllocatorStats GetStats() const = 0;
+
+	// empty pages beyond this many are handed back to the system instead of being kept around
+	virtual void SetEmptyPageLimit(int limit) = 0;
+
+#if ENGINE_TRACK_ALLOCATIONS
+	std::unordered_map<const void*, const char*> LiveSites;
+
+	std::map<std::string, size_t> GetLiveSites() const;
+#endif
+
+protected:
+	mutable std::mutex Lock;
+};
+
+// every page allocator registers itself here so the pools can be inspected and leaks reported
+class AllocatorRegistry
+{
+public:
+	static void Register(BaseAllocator* allocator);
+	static void Unregister(BaseAllocator* allocator);
+	static const std::vector<BaseAllocator*>& GetAllocators();
+	static void SetEmptyPageLimit(int limit);
+	static AllocatorStats GetTotals();
+	static void Report(std::ostream& out);
+	static void ReportLeaks(std::ostream& out);
+
+private:
+	static std::vector<BaseAllocator*>& Allocators();
 };
 
 template<int blockSize = 128, int pageSize = 4096>
 class PageAllocator : public BaseAllocator
 {
 public:
+	PageAllocator();
+	~PageAllocator();
+
+	PageAllocator(const PageAllocator&) = delete;
+	PageAllocator& operator=(const PageAllocator&) = delete;
+
 	void* Allocate();
 	void Free(void* data);
+	AllocatorStats GetStats() const;
+	void SetEmptyPageLimit(int limit);
 
 private:
 
@@ -83,14 +157,38 @@ private:
 	int FullPageCount = 0;
 	int OpenBlocks = BlocksPerPage;
 	int UsedBlocks = 0;
+	int EmptyPageCount = 1;
+	int EmptyPageLimit = 2;
+	int PeakUsedBlocks = 0;
+	int PeakPageCount = 1;
+	size_t ReleasedPageCount = 0;
+
+	void ReleaseEmptyPage(Page* page);
 };
 
 template <typename T, int pageSize = 4096>
 using ClassAllocator = PageAllocator<sizeof(T), pageSize>;
 
+template<int blockSize, int pageSize>
+PageAllocator<blockSize, pageSize>::PageAllocator()
+{
+	AllocatorRegistry::Register(this);
+}
+
+template<int blockSize, int pageSize>
+PageAllocator<blockSize, pageSize>::~PageAllocator()
+{
+	AllocatorRegistry::Unregister(this);
+}
+
 template<int blockSize, int pageSize>
 void* PageAllocator<blockSize, pageSize>::Allocate()
 {
+	std::lock_guard<std::mutex> guard(Lock);
+
+	if (OpenPages->OpenBlocks == BlocksPerPage)
+		--EmptyPageCount;
+
 	Block* newBlock = OpenPages->Fetch();
 
 	if (!OpenPages->Open)
@@ -113,6 +211,10 @@ void* PageAllocator<blockSize, pageSize>::Allocate()
 
 			OpenPageCount = 1;
 			OpenBlocks += BlocksPerPage;
+			++EmptyPageCount;
+
+			if (OpenPageCount + FullPageCount > PeakPageCount)
+				PeakPageCount = OpenPageCount + FullPageCount;
 		}
 	}
 
@@ -121,6 +223,9 @@ void* PageAllocator<blockSize, pageSize>::Allocate()
 	--OpenBlocks;
 	++UsedBlocks;
 
+	if (UsedBlocks > PeakUsedBlocks)
+		PeakUsedBlocks = UsedBlocks;
+
 	return buffer;
 }
 
@@ -129,6 +234,8 @@ void PageAllocator<blockSize, pageSize>::Free(void* data)
 {
 	Block* block = reinterpret_cast<Block*>(reinterpret_cast<char*>(data) - sizeof(Block*));
 
+	std::lock_guard<std::mutex> guard(Lock);
+
 	if (block->Owner->Owner != this)
 		throw std::string("bad block free!"); // you pressed the bad free button. you shouldn't have done that
 
@@ -152,6 +259,65 @@ void PageAllocator<blockSize, pageSize>::Free(void* data)
 
 	++OpenBlocks;
 	--UsedBlocks;
+
+	if (page->OpenBlocks == BlocksPerPage)
+	{
+		++EmptyPageCount;
+
+		if (EmptyPageCount > EmptyPageLimit)
+			ReleaseEmptyPage(page);
+	}
+}
+
+template<int blockSize, int pageSize>
+void PageAllocator<blockSize, pageSize>::ReleaseEmptyPage(Page* page)
+{
+	// the first page lives inside the allocator, and there always has to be somewhere to allocate from
+	if (page == &FirstPage || OpenPageCount <= 1)
+		return;
+
+	if (page == OpenPages)
+		OpenPages = page->Next;
+
+	page->ClearConnections();
+
+	delete page;
+
+	--OpenPageCount;
+	--EmptyPageCount;
+	OpenBlocks -= BlocksPerPage;
+	++ReleasedPageCount;
+}
+
+template<int blockSize, int pageSize>
+AllocatorStats PageAllocator<blockSize, pageSize>::GetStats() const
+{
+	std::lock_guard<std::mutex> guard(Lock);
+
+	AllocatorStats stats;
+
+	stats.BlockSize = blockSize;
+	stats.PageSize = pageSize;
+	stats.BlocksPerPage = BlocksPerPage;
+	stats.LiveBlocks = UsedBlocks;
+	stats.PeakBlocks = PeakUsedBlocks;
+	stats.LiveBytes = size_t(UsedBlocks) * blockSize;
+	stats.PeakBytes = size_t(PeakUsedBlocks) * blockSize;
+	stats.Pages = OpenPageCount + FullPageCount;
+	stats.PeakPages = PeakPageCount;
+	stats.EmptyPages = EmptyPageCount;
+	stats.ReleasedPages = ReleasedPageCount;
+	stats.ReservedBytes = stats.Pages * sizeof(Page);
+
+	return stats;
+}
+
+template<int blockSize, int pageSize>
+void PageAllocator<blockSize, pageSize>::SetEmptyPageLimit(int limit)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+
+	EmptyPageLimit = limit < 0 ? 0 : limit;
 }
 
 template<int blockSize, int pageSize>
@@ -187,12 +353,28 @@ PageAllocator<blockSize, pageSize>::Page::Page(PageAllocator* owner, Page* previ
 template<typename T, typename ...Args>
 T* BaseAllocator::Create(Args&&... args)
 {
-	return ::new (Allocate()) T(std::forward<Args>(args)...);
+	T* object = ::new (Allocate()) T(std::forward<Args>(args)...);
+
+#if ENGINE_TRACK_ALLOCATIONS
+	std::lock_guard<std::mutex> guard(Lock);
+
+	LiveSites[object] = typeid(T).name();
+#endif
+
+	return object;
 }
 
 template<typename T>
 void BaseAllocator::Destroy(T* object)
 {
+#if ENGINE_TRACK_ALLOCATIONS
+	{
+		std::lock_guard<std::mutex> guard(Lock);
+
+		LiveSites.erase(object);
+	}
+#endif
+
 	object->~T();
 
 	Free(object);
@@ -8,6 +8,15 @@ constexpr unsigned char operator ""_b(unsigned long long int x) { return (unsign
 
 const bool TransposedMatrices = true;
 
+// x64 always has SSE2, wider kernels are picked at runtime in Math/SimdMath.cpp
+#ifndef ENGINE_SIMD_MATH
+#if defined(_M_X64) || defined(__x86_64__)
+#define ENGINE_SIMD_MATH 1
+#else
+#define ENGINE_SIMD_MATH 0
+#endif
+#endif
+
 #ifdef min
 #undef min
 #endif
@@ -1,11 +1,32 @@
 #include "MetaData.h"
 
 #include <iostream>
+#include <atomic>
+#include <mutex>
 
 namespace Engine
 {
 	namespace Meta
 	{
+		namespace
+		{
+			struct TypeRegistry
+			{
+				std::mutex Lock;
+				std::atomic<bool> Changed = true;
+				ReflectedType::MetaVector Types;
+				std::unordered_map<std::string, ReflectedType::MetaVector> Names;
+			};
+
+			// function local so it exists before the first Reflected<T>::Meta gets made
+			TypeRegistry& GetRegistry()
+			{
+				static TypeRegistry registry;
+
+				return registry;
+			}
+		}
+
 		bool ReflectedType::CanAllow(const ReflectedType* type) const
 		{
 			if (type->Inherits.size() >= Inherits.size() && type->Inherits[Inherits.size() - 1] == this)
@@ -20,7 +41,145 @@ namespace Engine
 
 		bool ReflectedType::InheritsType(const ReflectedType* type) const
 		{
-			return Inherits.size() > 0 && Inherits.size() >= type->Inherits.size() && Inherits[type->Inherits.size() - 1] == type;
+			UpdateInheritanceRanges();
+
+			return type->InheritanceBegin <= InheritanceBegin && InheritanceBegin < type->InheritanceEnd;
+		}
+
+		bool ReflectedType::IsA(const ReflectedType* type, bool inherited) const
+		{
+			return type == this || (inherited && type != nullptr && InheritsType(type));
+		}
+
+		bool ReflectedType::IsA(const std::string& name, bool inherited) const
+		{
+			const MetaVector* types = FindTypes(name);
+
+			if (types == nullptr)
+				return false;
+
+			for (const ReflectedType* type : *types)
+				if (IsA(type, inherited))
+					return true;
+
+			return false;
+		}
+
+		void ReflectedType::AddType(ReflectedType* type)
+		{
+			TypeRegistry& registry = GetRegistry();
+
+			std::lock_guard<std::mutex> lock(registry.Lock);
+
+			type->TypeId = int(registry.Types.size());
+			registry.Types.push_back(type);
+			registry.Changed.store(true, std::memory_order_release);
+		}
+
+		void ReflectedType::MarkHierarchyChanged()
+		{
+			GetRegistry().Changed.store(true, std::memory_order_release);
+		}
+
+		int ReflectedType::GetTypeCount()
+		{
+			TypeRegistry& registry = GetRegistry();
+
+			std::lock_guard<std::mutex> lock(registry.Lock);
+
+			return int(registry.Types.size());
+		}
+
+		const ReflectedType* ReflectedType::GetType(int typeId)
+		{
+			TypeRegistry& registry = GetRegistry();
+
+			std::lock_guard<std::mutex> lock(registry.Lock);
+
+			if (typeId < 0 || typeId >= int(registry.Types.size()))
+				return nullptr;
+
+			return registry.Types[typeId];
+		}
+
+		const ReflectedType::MetaVector* ReflectedType::FindTypes(const std::string& name)
+		{
+			UpdateInheritanceRanges();
+
+			TypeRegistry& registry = GetRegistry();
+
+			auto types = registry.Names.find(name);
+
+			if (types == registry.Names.end())
+				return nullptr;
+
+			return &types->second;
+		}
+
+		// types only get made and linked up during static initialization, so after the first query this is a flag check
+		void ReflectedType::UpdateInheritanceRanges()
+		{
+			TypeRegistry& registry = GetRegistry();
+
+			if (!registry.Changed.load(std::memory_order_acquire))
+				return;
+
+			std::lock_guard<std::mutex> lock(registry.Lock);
+
+			if (!registry.Changed.load(std::memory_order_relaxed))
+				return;
+
+			std::vector<std::vector<int>> children(registry.Types.size());
+			std::vector<int> roots;
+
+			for (const ReflectedType* type : registry.Types)
+			{
+				if (type->Parent != nullptr && type->Parent != type && type->Parent->TypeId >= 0)
+					children[type->Parent->TypeId].push_back(type->TypeId);
+				else
+					roots.push_back(type->TypeId);
+			}
+
+			int next = 0;
+			std::vector<std::pair<int, size_t>> stack;
+
+			for (int root : roots)
+			{
+				registry.Types[root]->InheritanceBegin = next++;
+
+				stack.push_back(std::make_pair(root, 0));
+
+				while (!stack.empty())
+				{
+					int typeId = stack.back().first;
+					size_t child = stack.back().second;
+
+					if (child < children[typeId].size())
+					{
+						int childId = children[typeId][child];
+
+						++stack.back().second;
+
+						registry.Types[childId]->InheritanceBegin = next++;
+
+						stack.push_back(std::make_pair(childId, 0));
+					}
+					else
+					{
+						registry.Types[typeId]->InheritanceEnd = next;
+
+						stack.pop_back();
+					}
+				}
+			}
+
+			registry.Names.clear();
+
+			for (const ReflectedType* type : registry.Types)
+				if (type->Name != nullptr)
+					registry.Names[type->Name].push_back(type);
+
+			registry.Changed.store(false, std::memory_order_release);
 		}
 
 		std::pair<int, MemberType> ReflectedType::GetRegisteredMember(const std::string& name) const
@@ -125,6 +125,11 @@ namespace Engine
 			typedef std::vector<const ReflectedType*> MetaVector;
 			typedef std::unordered_map<std::string, std::pair<int, MemberType>> MemberDictionary;
 
+			// TypeId is dense and handed out when the type is made. the inheritance range is a preorder
+			// interval over the type tree, a type inherits another when its begin falls inside the other's range
+			int TypeId = -1;
+			mutable int InheritanceBegin = 0;
+			mutable int InheritanceEnd = 0;
 			bool IsComponent = false;
 			bool IsFundamental = false;
 			bool IsEnum = false;
@@ -151,6 +156,8 @@ namespace Engine
 
 			bool CanAllow(const ReflectedType* type) const;
 			bool InheritsType(const ReflectedType* type) const;
+			bool IsA(const ReflectedType* type, bool inherited = true) const;
+			bool IsA(const std::string& name, bool inherited = true) const;
 
 			std::pair<int, MemberType> GetRegisteredMember(const std::string& name) const;
 			const Member* GetMember(const std::string& name) const;
@@ -165,6 +172,17 @@ namespace Engine
 			void AddMember(const Function& member);
 			void AddValue(const EnumItem& item);
 			void CopyMembers(const ReflectedType* parent);
+
+			static void AddType(ReflectedType* type);
+			static void MarkHierarchyChanged();
+			static int GetTypeCount();
+			static const ReflectedType* GetType(int typeId);
+
+			// every type with that name regardless of namespace, nullptr if there are none
+			static const MetaVector* FindTypes(const std::string& name);
+
+		private:
+			static void UpdateInheritanceRanges();
 		};
 
 		struct ReflectedTypes
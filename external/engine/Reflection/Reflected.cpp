@@ -9,18 +9,26 @@ namespace Engine
 	{
 		ReflectedType* MakeMeta()
 		{
-			return new ReflectedType();
+			ReflectedType* meta = new ReflectedType();
+
+			ReflectedType::AddType(meta);
+
+			return meta;
 		}
 
 		void InheritReflected(ReflectedType* type, const ReflectedType* parent)
 		{
 			type->Parent = parent;
 			type->CopyMembers(parent);
+
+			ReflectedType::MarkHierarchyChanged();
 		}
 
 		void Register(const ReflectedType* meta)
 		{
 			ReflectedTypes::RegisterType(meta);
+
+			ReflectedType::MarkHierarchyChanged();
 		}
 	}
 }
\ No newline at end of file
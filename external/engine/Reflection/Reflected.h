@@ -89,7 +89,10 @@ namespace Engine
 		template <typename Type>
 		void Reflected<Type>::SetMeta(const ReflectedType& meta)
 		{
+			int typeId = Meta->TypeId;
+
 			*Meta = meta;
+			Meta->TypeId = typeId;
 			Meta->Inherits.push_back(Meta);
 
 			Register(Meta);
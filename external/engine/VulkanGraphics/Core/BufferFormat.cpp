@@ -124,59 +124,72 @@ namespace Engine
 			BufferSize += item.GetSize();
 		}
 
+		unsigned long long BufferFormat::GetHash(const std::string& hashString)
+		{
+			unsigned long long hash = 0xcbf29ce484222325ull;
+
+			for (size_t i = 0; i < hashString.size(); ++i)
+			{
+				hash ^= (unsigned char)hashString[i];
+				hash *= 0x100000001b3ull;
+			}
+
+			return hash;
+		}
+
 		std::shared_ptr<BufferFormat> BufferFormat::GetFormat(const std::vector<BufferItem>& attributes)
 		{
 			std::string hashString;
 
 			BufferItem::GetHashString(hashString, attributes);
 
-			std::shared_ptr<BufferFormat> bufferFormat = GetCachedFormat(hashString);
+			unsigned long long hash = GetHash(hashString);
+
+			auto matches = [&hashString](const BufferFormat& cached) { return cached.CachedKey == hashString; };
 
-			if (bufferFormat == nullptr)
+			std::shared_ptr<BufferFormat> bufferFormat = Cache.Find(hash, matches);
+
+			if (bufferFormat != nullptr)
+				return bufferFormat;
+
+			return Cache.Intern(hash, matches, [&attributes, &hashString](int index)
 			{
-				bufferFormat = Engine::Create<BufferFormat>();
+				std::shared_ptr<BufferFormat> format = Engine::Create<BufferFormat>();
 
 				for (size_t i = 0; i < attributes.size(); ++i)
-					bufferFormat->AddBufferItem(attributes[i]);
+					format->AddBufferItem(attributes[i]);
 
-				CacheFormat(hashString, bufferFormat);
-			}
+				format->CachedIndex = index;
+				format->CachedKey = hashString;
 
-			return bufferFormat;
+				return format;
+			});
 		}
 
 		std::shared_ptr<BufferFormat> BufferFormat::GetCachedFormat(const std::string& hashString)
 		{
-			auto entry = Cache.find(hashString);
-
-			if (entry != Cache.end())
-				return entry->second;
-
-			return nullptr;
+			return Cache.Find(GetHash(hashString), [&hashString](const BufferFormat& cached) { return cached.CachedKey == hashString; });
 		}
 
 		std::shared_ptr<BufferFormat> BufferFormat::GetCachedFormat(int index)
 		{
-			if (index < 0 || index >= CacheVector.size())
-				return nullptr;
-
-			return CacheVector[index];
+			return Cache.At(index);
 		}
 
-		void BufferFormat::CacheFormat(const std::string& hashString, const std::shared_ptr<BufferFormat>& format)
+		std::shared_ptr<BufferFormat> BufferFormat::CacheFormat(const std::string& hashString, const std::shared_ptr<BufferFormat>& format)
 		{
-			format->CachedIndex = (int)CacheVector.size();
+			return Cache.Intern(GetHash(hashString), [&hashString](const BufferFormat& cached) { return cached.CachedKey == hashString; }, [&format, &hashString](int index)
+			{
+				format->CachedIndex = index;
+				format->CachedKey = hashString;
 
-			Cache[hashString] = format;
-			CacheVector.push_back(format);
+				return format;
+			});
 		}
 
-		void BufferFormat::CacheFormat(const std::shared_ptr<BufferFormat>& format)
+		std::shared_ptr<BufferFormat> BufferFormat::CacheFormat(const std::shared_ptr<BufferFormat>& format)
 		{
-			std::string hash = format->GetHashString();
-
-			if (GetCachedFormat(hash) == nullptr)
-				CacheFormat(hash, format);
+			return CacheFormat(format->GetHashString(), format);
 		}
 	}
 }
\ No newline at end of file
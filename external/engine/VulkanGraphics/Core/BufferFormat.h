@@ -3,6 +3,7 @@
 #include <map>
 
 #include <Objects/Object.h>
+#include <ConcurrentInternTable.h>
 
 namespace Engine
 {
@@ -62,24 +63,24 @@ namespace Engine
 			std::string GetHashString(size_t arrayLength = 0) const;
 			int GetCachedIndex() const { return CachedIndex; }
 
+			static unsigned long long GetHash(const std::string &hashString);
 			static std::shared_ptr<BufferFormat> GetFormat(const std::vector<BufferItem> &attributes);
 			static std::shared_ptr<BufferFormat> GetCachedFormat(const std::string &hashString);
 			static std::shared_ptr<BufferFormat> GetCachedFormat(int index);
-			static void CacheFormat(const std::string &hashString, const std::shared_ptr<BufferFormat> &format);
-			static void CacheFormat(const std::shared_ptr<BufferFormat> &format);
+			static std::shared_ptr<BufferFormat> CacheFormat(const std::string &hashString, const std::shared_ptr<BufferFormat> &format);
+			static std::shared_ptr<BufferFormat> CacheFormat(const std::shared_ptr<BufferFormat> &format);
 
 		private:
-			typedef std::map<std::string, std::shared_ptr<BufferFormat>> BufferFormatMap;
-			typedef std::vector<std::shared_ptr<BufferFormat>> BufferFormatVector;
+			typedef ConcurrentInternTable<BufferFormat> BufferFormatTable;
 
 			int CachedIndex = -1;
+			std::string CachedKey; // the hash string it was interned under, told apart from other formats with the same hash
 			size_t BufferArrayLength = 1;
 			size_t BufferSize = 0;
 			std::vector<BufferItem> BufferItems;
 			std::map<std::string, size_t> IndexMap;
 
-			static inline BufferFormatMap Cache = BufferFormatMap();
-			static inline BufferFormatVector CacheVector = BufferFormatVector();
+			static inline BufferFormatTable Cache;
 		};
 	}
 }
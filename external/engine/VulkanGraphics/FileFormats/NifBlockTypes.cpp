@@ -1,5 +1,26 @@
 #include "NifBlockTypes.h"
 
+namespace
+{
+	thread_local std::pmr::memory_resource* BlockArena = nullptr;
+}
+
+std::pmr::memory_resource* GetBlockArena()
+{
+	return BlockArena != nullptr ? BlockArena : std::pmr::get_default_resource();
+}
+
+// documents nest on a thread when a parse starts another one, the outer arena comes back with the inner one's death
+NifDocument::NifDocument() : PreviousBlockArena(BlockArena)
+{
+	BlockArena = &Arena;
+}
+
+NifDocument::~NifDocument()
+{
+	BlockArena = PreviousBlockArena;
+}
+
 BlockData* NiDataBlock::Get()
 {
 	return &Document->Blocks[BlockIndex];
@@ -29,21 +50,21 @@ const BlockData* NifDocument::FetchRef(std::string_view& stream)
 	return FetchRef(Endian.read<unsigned int>(stream));
 }
 
-const std::string& NifDocument::FetchString(unsigned int ref)
+const std::pmr::string& NifDocument::FetchString(unsigned int ref)
 {
-	static const std::string emptyString;
+	static const std::pmr::string emptyString;
 
 	if (ref == 0xFFFFFFFFu) return emptyString;
 
 	return Strings[ref];
 }
 
-const std::string& NifDocument::FetchString(std::string_view& stream)
+const std::pmr::string& NifDocument::FetchString(std::string_view& stream)
 {
 	return FetchString(Endian.read<unsigned int>(stream));
 }
 
-void NifDocument::ReadBlockRefs(std::string_view& stream, BlockData& block, std::vector<const BlockData*>& refs)
+void NifDocument::ReadBlockRefs(std::string_view& stream, BlockData& block, BlockVector<const BlockData*>& refs)
 {
 	unsigned int count = Endian.read<unsigned int>(stream);
 
@@ -53,25 +74,24 @@ void NifDocument::ReadBlockRefs(std::string_view& stream, BlockData& block, std:
 		refs[i] = &Blocks[Endian.read<unsigned int>(stream)];
 }
 
+// built by the first parser to get here, parsers on other threads wait for it
 std::shared_ptr<Engine::Graphics::MeshFormat> GetNiMeshFormat()
 {
-	static std::shared_ptr<Engine::Graphics::MeshFormat> format = nullptr;
-
-	if (format != nullptr)
-		return format;
-
-	using Engine::Graphics::VertexAttributeFormat;
+	static const std::shared_ptr<Engine::Graphics::MeshFormat> format = []()
+	{
+		using Engine::Graphics::VertexAttributeFormat;
 
-	std::vector<Engine::Graphics::VertexAttributeFormat> attributes;
+		std::vector<Engine::Graphics::VertexAttributeFormat> attributes;
 
-	attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "position", 0 });
-	attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "normal", 1 });
-	attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 2, "texcoord", 1 });
-	attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "binormal", 1 });
-	attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "tangent", 1 });
-	attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "morphpos", 2 });
+		attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "position", 0 });
+		attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "normal", 1 });
+		attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 2, "texcoord", 1 });
+		attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "binormal", 1 });
+		attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "tangent", 1 });
+		attributes.push_back(VertexAttributeFormat{ Enum::AttributeDataType::Float32, 3, "morphpos", 2 });
 
-	format = Engine::Graphics::MeshFormat::GetFormat(attributes);
+		return Engine::Graphics::MeshFormat::GetFormat(attributes);
+	}();
 
 	return format;
 }
\ No newline at end of file
@@ -4,7 +4,11 @@
 #include <string>
 #include <memory>
 #include <limits>
+#include <memory_resource>
+#include <span>
+#include <string_view>
 
+#include <Engine/ArenaAllocator.h>
 #include <Engine/Assets/ParserUtils.h>
 #include <Engine/Math/Vector2S.h>
 #include <Engine/Math/Vector3S.h>
@@ -19,6 +23,14 @@
 struct BlockData;
 struct NifDocument;
 
+// the arena of the document this thread is parsing, the default resource outside of one. the per-block containers take
+// it in their member initializers, so they land in the document's scratch without every block type forwarding the arena
+// through a constructor
+std::pmr::memory_resource* GetBlockArena();
+
+template <typename T>
+using BlockVector = std::pmr::vector<T>;
+
 struct NiDataBlock
 {
 	unsigned int BlockIndex = 0;
@@ -43,28 +55,16 @@ struct NiDataBlock
 
 struct BlockData
 {
-	std::string BlockType;
+	std::string_view BlockType;
 	std::string BlockName;
 	NifDocument* Document = nullptr;
 	unsigned int BlockIndex = 0;
 	unsigned int BlockSize = 0;
-	std::unique_ptr<NiDataBlock> Data = nullptr;
+	ArenaPointer<NiDataBlock> Data = nullptr;
 	unsigned int BlockStart = 0;
 
 	template <typename T, typename... Arguments>
-	T* AddData(const Arguments&... arguments)
-	{
-		std::unique_ptr<T> data = std::make_unique<T>(arguments...);
-	
-		data->BlockIndex = BlockIndex;
-		data->Document = Document;
-	
-		T* pointer = data.get();
-	
-		Data = std::move(data);
-		
-		return pointer;
-	}
+	T* AddData(const Arguments&... arguments);
 
 	template <typename T, typename... Arguments>
 	T* MakeType(const Arguments&... arguments)
@@ -243,11 +243,11 @@ struct NiTransform
 
 struct NiNodeType : public NiDataBlock
 {
-	std::vector<const BlockData*> ExtraData;
+	BlockVector<const BlockData*> ExtraData{ GetBlockArena() };
 	const BlockData* Controller = nullptr;
 	unsigned short Flags = 0;
 	NiTransform Transformation;
-	std::vector<const BlockData*> Properties;
+	BlockVector<const BlockData*> Properties{ GetBlockArena() };
 	const BlockData* CollisionObject = nullptr;
 };
 
@@ -255,8 +255,8 @@ struct NiNode : public NiNodeType
 {
 	static inline const std::string BlockTypeName = "NiNode";
 
-	std::vector<const BlockData*> Children;
-	std::vector<const BlockData*> Effects;
+	BlockVector<const BlockData*> Children{ GetBlockArena() };
+	BlockVector<const BlockData*> Effects{ GetBlockArena() };
 };
 
 struct NiBounds
@@ -279,20 +279,20 @@ struct NiMesh : public NiNodeType
 	{
 		const BlockData* Stream = nullptr;
 		bool IsPerInstance = false;
-		std::vector<unsigned short> SubmeshToRegionMap;
-		std::vector<Semantics> ComponentSemantics;
+		BlockVector<unsigned short> SubmeshToRegionMap{ GetBlockArena() };
+		BlockVector<Semantics> ComponentSemantics{ GetBlockArena() };
 	};
 
-	std::vector<std::string> Materials;
-	std::vector<const BlockData*> MaterialExtraData;
+	BlockVector<std::string> Materials{ GetBlockArena() };
+	BlockVector<const BlockData*> MaterialExtraData{ GetBlockArena() };
 	unsigned int ActiveMaterial = 0;
 	bool MaterialNeedsUpdate = false;
 	MeshPrimitiveType PrimitiveType;
 	unsigned short NumSubmeshes = 0;
 	bool InstancingEnabled = false;
 	NiBounds Bounds;
-	std::vector<DataStreams> Streams;
-	std::vector<const BlockData*> Modifiers;
+	BlockVector<DataStreams> Streams{ GetBlockArena() };
+	BlockVector<const BlockData*> Modifiers{ GetBlockArena() };
 };
 
 struct NiMorphMeshModifier : public NiDataBlock
@@ -305,11 +305,11 @@ struct NiMorphMeshModifier : public NiDataBlock
 		unsigned int NormalizeFlag = 0;
 	};
 
-	std::vector<unsigned short> SubmitPoints;
-	std::vector<unsigned short> CompletePoints;
+	BlockVector<unsigned short> SubmitPoints{ GetBlockArena() };
+	BlockVector<unsigned short> CompletePoints{ GetBlockArena() };
 	unsigned char Flags = 0;
 	unsigned short NumTargets = 0;
-	std::vector<ElementData> Elements;
+	BlockVector<ElementData> Elements{ GetBlockArena() };
 };
 
 struct NiMorphWeightsController : public NiDataBlock
@@ -324,8 +324,8 @@ struct NiMorphWeightsController : public NiDataBlock
 	float StopTime = 1e-5f;
 	const BlockData* Target = nullptr;
 	unsigned int Count = 0;
-	std::vector<const BlockData*> Interpolators;
-	std::vector<std::string> TargetNames;
+	BlockVector<const BlockData*> Interpolators{ GetBlockArena() };
+	BlockVector<std::string> TargetNames{ GetBlockArena() };
 };
 
 struct NiSkinningMeshModifier : public NiDataBlock
@@ -338,14 +338,14 @@ struct NiSkinningMeshModifier : public NiDataBlock
 		unsigned int NormalizeFlag = 0;
 	};
 
-	std::vector<unsigned short> SubmitPoints;
-	std::vector<unsigned short> CompletePoints;
+	BlockVector<unsigned short> SubmitPoints{ GetBlockArena() };
+	BlockVector<unsigned short> CompletePoints{ GetBlockArena() };
 	unsigned short Flags = 0;
 	const BlockData* SkeletonRoot = nullptr;
 	NiTransform SkeletonTransformation;
-	std::vector<const BlockData*> Bones;
-	std::vector<NiTransform> BoneTransforms;
-	std::vector<NiBounds> BoneBounds;
+	BlockVector<const BlockData*> Bones{ GetBlockArena() };
+	BlockVector<NiTransform> BoneTransforms{ GetBlockArena() };
+	BlockVector<NiBounds> BoneBounds{ GetBlockArena() };
 };
 
 struct NiFloatInterpolator : public NiDataBlock
@@ -368,14 +368,14 @@ struct NiFloatData : public NiDataBlock
 
 	unsigned int Interpolation = 0;
 
-	std::vector<Key> Keys;
+	BlockVector<Key> Keys{ GetBlockArena() };
 };
 
 struct NiMaterialProperty : public NiDataBlock
 {
 	static inline const std::string BlockTypeName = "NiMaterialProperty";
 
-	std::vector<const BlockData*> ExtraData;
+	BlockVector<const BlockData*> ExtraData{ GetBlockArena() };
 	const BlockData* Controller = nullptr;
 	Color3 AmbientColor = Color3(0.7f, 0.7f, 0.7f);
 	Color3 DiffuseColor = Color3(0.7f, 0.7f, 0.7f);
@@ -411,7 +411,7 @@ struct NiTexturingProperty : public NiDataBlock
 		unsigned int MapId = 0;
 	};
 
-	std::vector<const BlockData*> ExtraData;
+	BlockVector<const BlockData*> ExtraData{ GetBlockArena() };
 	const BlockData* Controller = nullptr;
 	unsigned short Flags = 0;
 	unsigned int TextureCount = 0;
@@ -428,14 +428,14 @@ struct NiTexturingProperty : public NiDataBlock
 	TextureData NormalTexture;
 	TextureData ParallaxTexture;
 	TextureData Decal0Texture;
-	std::vector<ShaderTextureData> ShaderTextures;
+	BlockVector<ShaderTextureData> ShaderTextures{ GetBlockArena() };
 };
 
 struct NiSourceTexture : public NiDataBlock
 {
 	static inline const std::string BlockTypeName = "NiSourceTexture";
 
-	std::vector<const BlockData*> ExtraData;
+	BlockVector<const BlockData*> ExtraData{ GetBlockArena() };
 	const BlockData* Controller = nullptr;
 	unsigned char UseExternal = 1;
 	std::string FileName;
@@ -482,7 +482,7 @@ struct NiIntegerExtraData : public NiExtraDataImpl<unsigned int>
 
 struct NiProperty : public NiDataBlock
 {
-	std::vector<const BlockData*> ExtraData;
+	BlockVector<const BlockData*> ExtraData{ GetBlockArena() };
 	const BlockData* Controller = nullptr;
 	unsigned short Flags = 0;
 };
@@ -534,12 +534,12 @@ struct NiDataStream : public NiDataBlock
 
 	unsigned int StreamSize = 0;
 	CloningBehavior CloningBehavior;
-	std::vector<Region> Regions;
-	std::vector<ComponentFormat> ComponentFormats;
-	std::vector<char> StreamData;
+	BlockVector<Region> Regions{ GetBlockArena() };
+	BlockVector<ComponentFormat> ComponentFormats{ GetBlockArena() };
+	std::span<char> StreamData; // lives in the document arena
 	StreamUsage Usage;
 	bool Streamable = false;
-	std::vector<Engine::Graphics::VertexAttributeFormat> Attributes;
+	BlockVector<Engine::Graphics::VertexAttributeFormat> Attributes{ GetBlockArena() };
 };
 
 struct NiPhysXPropDesc;
@@ -548,12 +548,12 @@ struct NiPhysXProp : public NiDataBlock
 {
 	static inline const std::string BlockTypeName = "NiPhysXProp";
 
-	std::vector<NiRef<NiExtraData>> ExtraData; // NiExtraData
+	BlockVector<NiRef<NiExtraData>> ExtraData{ GetBlockArena() }; // NiExtraData
 	const BlockData* Controller = nullptr; // NiTimeController
 	float PhysXToWorldScale = 1;
-	std::vector<const BlockData*> Sources; // NiPhysXSrc
-	std::vector<const BlockData*> Dests; // NiPhysXDest
-	std::vector<NiRef<NiMesh>> ModifiedMeshes; // NiMesh
+	BlockVector<const BlockData*> Sources{ GetBlockArena() }; // NiPhysXSrc
+	BlockVector<const BlockData*> Dests{ GetBlockArena() }; // NiPhysXDest
+	BlockVector<NiRef<NiMesh>> ModifiedMeshes{ GetBlockArena() }; // NiMesh
 	bool KeepMeshes = false;
 	NiRef<NiPhysXPropDesc> Snapshot; // NiPhysXPropDesc
 };
@@ -572,14 +572,14 @@ struct NiPhysXPropDesc : public NiDataBlock
 
 	struct State
 	{
-		std::vector<StateString> Strings;
+		BlockVector<StateString> Strings{ GetBlockArena() };
 	};
 
-	std::vector<NiRef<NiPhysXActorDesc>> Actors; // NiPhysXActorDesc
-	std::vector<const BlockData*> Joints; // NiPhysXJointDesc
-	std::vector<const BlockData*> Clothes; // NiPhysXClothDesc
+	BlockVector<NiRef<NiPhysXActorDesc>> Actors{ GetBlockArena() }; // NiPhysXActorDesc
+	BlockVector<const BlockData*> Joints{ GetBlockArena() }; // NiPhysXJointDesc
+	BlockVector<const BlockData*> Clothes{ GetBlockArena() }; // NiPhysXClothDesc
 	std::unordered_map<unsigned short, const BlockData*> Materials;
-	std::vector<State> StateNames;
+	BlockVector<State> StateNames{ GetBlockArena() };
 	unsigned char Flags = 0;
 };
 
@@ -607,7 +607,7 @@ struct NiPhysXActorDesc : public NiDataBlock
 	static inline const std::string BlockTypeName = "NiPhysXActorDesc";
 
 	std::string ActorName;
-	std::vector<Matrix4F> Poses;
+	BlockVector<Matrix4F> Poses{ GetBlockArena() };
 	const BlockData* BodyDesc = nullptr; //NiPhysXBodyDesc
 	float Density = 1;
 	NxActorFlag ActorFlags = NxActorFlag::None;
@@ -615,7 +615,7 @@ struct NiPhysXActorDesc : public NiDataBlock
 	unsigned short DominanceGroup = 0;
 	unsigned int ContactReportFlags = 0;
 	unsigned short ForceFieldMaterial = 0;
-	std::vector<NiRef<NiPhysXShapeDesc>> ShapeDescriptions;
+	BlockVector<NiRef<NiPhysXShapeDesc>> ShapeDescriptions{ GetBlockArena() };
 	NiRef<NiPhysXActorDesc> ActorParent;
 	const BlockData* Source = nullptr; // NiPhysXRigidBodySrc
 	const BlockData* Dest = nullptr; // NiPhysXRigidBodyDest
@@ -754,8 +754,8 @@ struct NxsFace
 struct NxsMesh
 {
 	NxsMeshType Type = NxsMeshType::None;
-	std::vector<Vector3SF> Vertices;
-	std::vector<NxsFace> Faces;
+	BlockVector<Vector3SF> Vertices{ GetBlockArena() };
+	BlockVector<NxsFace> Faces{ GetBlockArena() };
 };
 
 struct NiPhysXMeshDesc : public NiDataBlock
@@ -763,7 +763,7 @@ struct NiPhysXMeshDesc : public NiDataBlock
 	static inline const std::string BlockTypeName = "NiPhysXMeshDesc";
 
 	std::string MeshName;
-	std::vector<unsigned char> MeshData;
+	std::span<unsigned char> MeshData; // lives in the document arena
 	NxsMesh Mesh;
 	NxMeshShapeFlags MeshFlags = NxMeshShapeFlags::None;
 	NxPagingMode PagingMode = NxPagingMode::Manual;
@@ -805,7 +805,7 @@ struct NiSequenceData : public NiDataBlock
 {
 	static inline const std::string BlockTypeName = "NiSequenceData";
 
-	std::vector<const BlockData*> Evaluators;
+	BlockVector<const BlockData*> Evaluators{ GetBlockArena() };
 	const BlockData* TextKeys = nullptr;
 	float Duration = 0;
 	CycleType CycleType;
@@ -882,8 +882,8 @@ struct NiBSplineData : public NiDataBlock
 {
 	static inline const std::string BlockTypeName = "NiBSpineData";
 
-	std::vector<float> FloatControlPoints;
-	std::vector<short> CompactControlPoints;
+	BlockVector<float> FloatControlPoints{ GetBlockArena() };
+	BlockVector<short> CompactControlPoints{ GetBlockArena() };
 };
 
 struct NiBSplineBasisData : public NiDataBlock
@@ -972,7 +972,7 @@ template <typename KeyType>
 struct Keys
 {
 	RotationType Interpolation;
-	std::vector<KeyType> KeysValues;
+	BlockVector<KeyType> KeysValues{ GetBlockArena() };
 
 	void Parse(NifDocument* document, std::string_view& stream);
 };
@@ -984,9 +984,9 @@ struct AnyKeysNoRotate
 
 	RotationType Interpolation;
 	size_t KeyCount = 0;
-	std::vector<LinearKey<KeyType>> LinearKeys;
-	std::vector<QuadraticKey<KeyType>> QuadraticKeys;
-	std::vector<TbcKey<KeyType>> TbcKeys;
+	BlockVector<LinearKey<KeyType>> LinearKeys{ GetBlockArena() };
+	BlockVector<QuadraticKey<KeyType>> QuadraticKeys{ GetBlockArena() };
+	BlockVector<TbcKey<KeyType>> TbcKeys{ GetBlockArena() };
 
 	template <typename KeyContainer>
 	void ParseKeyVector(NifDocument* document, std::string_view& stream, KeyContainer& container, unsigned int keys);
@@ -1018,10 +1018,10 @@ struct AnyKeys
 
 	RotationType Interpolation = RotationType::None;
 	size_t KeyCount = 0;
-	std::vector<LinearKey<KeyType>> LinearKeys;
-	std::vector<QuadraticKey<KeyType>> QuadraticKeys;
-	std::vector<TbcKey<KeyType>> TbcKeys;
-	std::vector<XyzKeys> XyzKeys;
+	BlockVector<LinearKey<KeyType>> LinearKeys{ GetBlockArena() };
+	BlockVector<QuadraticKey<KeyType>> QuadraticKeys{ GetBlockArena() };
+	BlockVector<TbcKey<KeyType>> TbcKeys{ GetBlockArena() };
+	BlockVector<XyzKeys> XyzKeys{ GetBlockArena() };
 
 	template <typename KeyContainer>
 	void ParseKeyVector(NifDocument* document, std::string_view& stream, KeyContainer& container, unsigned int keys);
@@ -1047,7 +1047,7 @@ struct NiTextKeyExtraData : public NiDataBlock
 {
 	static inline const std::string BlockTypeName = "NiTextKeyExtraData";
 
-	std::vector<TextKey> TextKeys;
+	BlockVector<TextKey> TextKeys{ GetBlockArena() };
 };
 
 struct NifDocument
@@ -1055,14 +1055,26 @@ struct NifDocument
 	typedef void (NifDocument::* BlockParseFunction)(std::string_view& stream, BlockData& block);
 	typedef void (NifDocument::* BlockWriteFunction)(std::ostream& stream, BlockData& block);
 
-	std::vector<std::string> BlockTypes;
-	std::vector<unsigned short> BlockTypeIndices;
-	std::vector<unsigned int> BlockSizes;
-	std::vector<std::string> Strings;
-	std::vector<BlockData> Blocks;
-	std::map<unsigned short, BlockData> BlockMap;
+	// scratch for everything below, released in one go when the document dies.
+	// has to stay the first member so it outlives the blocks that point into it
+	ArenaAllocator Arena;
+
+	std::pmr::vector<std::pmr::string> BlockTypes{ &Arena };
+	std::pmr::vector<unsigned short> BlockTypeIndices{ &Arena };
+	std::pmr::vector<unsigned int> BlockSizes{ &Arena };
+	std::pmr::vector<std::pmr::string> Strings{ &Arena };
+	std::pmr::vector<BlockData> Blocks{ &Arena };
 	Endian Endian;
 
+	// makes Arena this thread's block arena until the document dies
+	NifDocument();
+	~NifDocument();
+
+	NifDocument(const NifDocument&) = delete;
+	NifDocument& operator=(const NifDocument&) = delete;
+
+	std::pmr::memory_resource* PreviousBlockArena = nullptr;
+
 	void ParserNoOp(std::string_view& stream, BlockData& block);
 	void ParseStream(std::string_view& stream, BlockData& block);
 	void ParseSourceTexture(std::string_view& stream, BlockData& block);
@@ -1142,12 +1154,12 @@ struct NifDocument
 	BlockData& InitializeBlock(unsigned int blockIndex);
 	const BlockData* FetchRef(unsigned int ref);
 	const BlockData* FetchRef(std::string_view& stream);
-	const std::string& FetchString(unsigned int ref);
-	const std::string& FetchString(std::string_view& stream);
-	void ReadBlockRefs(std::string_view& stream, BlockData& block, std::vector<const BlockData*>& refs);
+	const std::pmr::string& FetchString(unsigned int ref);
+	const std::pmr::string& FetchString(std::string_view& stream);
+	void ReadBlockRefs(std::string_view& stream, BlockData& block, BlockVector<const BlockData*>& refs);
 
 	template <typename T>
-	void ReadBlockRefs(std::string_view& stream, BlockData& block, std::vector<NiRef<T>>& refs)
+	void ReadBlockRefs(std::string_view& stream, BlockData& block, BlockVector<NiRef<T>>& refs)
 	{
 		unsigned int count = Endian.read<unsigned int>(stream);
 
@@ -1160,6 +1172,19 @@ struct NifDocument
 
 std::shared_ptr<Engine::Graphics::MeshFormat> GetNiMeshFormat();
 
+template <typename T, typename... Arguments>
+T* BlockData::AddData(const Arguments&... arguments)
+{
+	T* data = Document->Arena.template Create<T>(arguments...);
+
+	data->BlockIndex = BlockIndex;
+	data->Document = Document;
+
+	Data = ArenaPointer<NiDataBlock>(data);
+
+	return data;
+}
+
 template <typename KeyType>
 void LinearKey<KeyType>::Parse(NifDocument* document, std::string_view& stream)
 {
@@ -4,6 +4,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <memory_resource>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
@@ -363,7 +364,7 @@ void NifDocument::ParseStream(std::string_view &stream, BlockData &block)
 		}
 	}
 
-	data->StreamData.resize(data->StreamSize);
+	data->StreamData = Arena.AllocateArray<char>(data->StreamSize);
 
 	size_t amount = std::min((size_t)data->StreamSize, stream.size());
 
@@ -962,7 +963,7 @@ void NifDocument::ParsePhysXMeshDesc(std::string_view &stream, BlockData &block)
 
 	unsigned int meshSize = Endian.read<unsigned int>(stream);
 
-	data->MeshData.resize(meshSize);
+	data->MeshData = Arena.AllocateArray<unsigned char>(meshSize);
 
 	std::memcpy(data->MeshData.data(), stream.data(), meshSize);
 
@@ -1056,6 +1057,11 @@ std::unordered_map<std::string, std::string> attributeAliases = {
 
 using namespace Engine::Graphics;
 
+Matrix4F MakeTransformation(const NiTransform &transform)
+{
+	return Matrix4F(transform.Translation) * transform.Rotation * Matrix4F::NewScale(transform.Scale, transform.Scale, transform.Scale);
+}
+
 std::ostream &operator<<(std::ostream &out, const BlockData *block)
 {
 	return out << "[" << block->BlockIndex << "] " << block->BlockType << " \"" << block->BlockName << "\"";
@@ -1081,6 +1087,9 @@ void NifParser::Parse(std::string_view stream)
 
 	NifDocument document;
 
+	// the stream copies dominate the scratch, so one chunk about the size of the file usually covers the whole parse
+	document.Arena.Reserve(stream.size() + stream.size() / 2);
+
 	std::string headerString;
 
 	size_t index = 0;
@@ -1188,7 +1197,7 @@ void NifParser::Parse(std::string_view stream)
 		for (truncateIndex; truncateIndex < block.BlockType.size() && block.BlockType[truncateIndex] > 1; ++truncateIndex)
 			;
 
-		std::string typeName = block.BlockType.substr(0, truncateIndex);
+		std::string typeName(block.BlockType.substr(0, truncateIndex));
 
 		if (block.BlockSize > 0)
 		{
@@ -1232,12 +1241,12 @@ void NifParser::Parse(std::string_view stream)
 		}
 	}
 
-	std::unordered_map<unsigned int, BlockData *> parents;
-	std::unordered_map<unsigned int, size_t> parentEntries;
-	std::unordered_map<unsigned int, size_t> parentLinkTypes;
-	std::unordered_map<unsigned int, size_t> materials;
-	std::unordered_map<unsigned int, size_t> nodeIndices;
-	std::unordered_map<size_t, size_t> boneIndices;
+	std::pmr::unordered_map<unsigned int, BlockData *> parents(&document.Arena);
+	std::pmr::unordered_map<unsigned int, size_t> parentEntries(&document.Arena);
+	std::pmr::unordered_map<unsigned int, size_t> parentLinkTypes(&document.Arena);
+	std::pmr::unordered_map<unsigned int, size_t> materials(&document.Arena);
+	std::pmr::unordered_map<unsigned int, size_t> nodeIndices(&document.Arena);
+	std::pmr::unordered_map<size_t, size_t> boneIndices(&document.Arena);
 
 	std::vector<Engine::Graphics::VertexAttributeFormat> physXMeshAttributes = {
 		{.Type = VertexAttributeFormat::AttributeDataType::Float32,
@@ -1414,6 +1423,9 @@ void NifParser::Parse(std::string_view stream)
 							{
 								NiAlphaProperty *propertyData = propertyBlock->Data->Cast<NiAlphaProperty>();
 
+								material.HasAlphaProperty = true;
+								material.BlendEnabled = (propertyData->Flags & 1) != 0;
+								material.AlphaTestEnabled = ((propertyData->Flags >> 9) & 1) != 0;
 								material.SourceBlendMode = (propertyData->Flags >> 1) & 0xF;
 								material.DestBlendMode = (propertyData->Flags >> 5) & 0xF;
 								material.AlphaTestMode = (propertyData->Flags >> 9) & 0xF;
@@ -1549,8 +1561,11 @@ void NifParser::Parse(std::string_view stream)
 
 					auto index = attributeAliases.find(semantic);
 
-					if (!SemanticsFound.contains(semantic))
+					{
+						std::lock_guard<std::mutex> lock(SemanticsLock);
+
 						SemanticsFound.insert(semantic);
+					}
 
 					if (index == attributeAliases.end())
 						stream->Attributes[j].Name = semantic;
@@ -1589,7 +1604,7 @@ void NifParser::Parse(std::string_view stream)
 
 			format->Copy(dataBuffers.data(), mesh->GetData(), format, vertexCount);
 
-			Matrix4F transformation = Matrix4F(nodeTransform.Translation) * nodeTransform.Rotation * Matrix4F::NewScale(nodeTransform.Scale, nodeTransform.Scale, nodeTransform.Scale);
+			Matrix4F transformation = MakeTransformation(nodeTransform);
 
 			transform->SetTransformation(transformation);
 			glm::mat4 glmTransform = glm::mat4(1.0f);
@@ -1712,7 +1727,8 @@ void NifParser::Parse(std::string_view stream)
 							mesh.MaterialIndex = physXMaterialIndex;
 							mesh.Format = physXMeshFormat;
 							mesh.Mesh = meshData;
-							mesh.Transform;
+							mesh.Transform = transform;
+							mesh.CollisionEnabled = !physicsDisabled;
 
 							Package->Nodes.push_back(ModelPackageNode{"ModelPhysXMesh", 0, physXMaterialIndex, blockIndex, true, false, false, false, physXMeshFormat, meshData, transform});
 						}
@@ -1922,7 +1938,7 @@ void NifParser::Parse(std::string_view stream)
 							{
 								for (unsigned int i = 0; i < splineBasisData->NumControlPoints; ++i)
 								{
-									float *data = splineData->FloatControlPoints.data() + (4 * i);
+									float *data = splineData->FloatControlPoints.data() + handle + (4 * i);
 									spline.ControlPoints[i] = Quaternion(data[0], data[1], data[2], data[3]);
 								}
 							}
@@ -1995,6 +2011,9 @@ void NifParser::Parse(std::string_view stream)
 					NiSkinningMeshModifier *skinData = skinBlock->Data->Cast<NiSkinningMeshModifier>();
 					size_t skinRootIndex = nodeIndices[skinData->SkeletonRoot->BlockIndex];
 
+					node.SkeletonRoot = skinRootIndex;
+					node.SkinTransform = MakeTransformation(skinData->SkeletonTransformation);
+
 					for (size_t j = 0; j < skinData->Bones.size(); ++j)
 					{
 						const BlockData *boneData = skinData->Bones[j];
@@ -2003,6 +2022,7 @@ void NifParser::Parse(std::string_view stream)
 						MarkBone(boneIndex, boneIndices);
 
 						node.Bones.push_back(boneIndices[boneIndex]);
+						node.BoneOffsets.push_back(MakeTransformation(skinData->BoneTransforms[j]));
 					}
 				}
 			}
@@ -2024,7 +2044,7 @@ void NifParser::Parse(std::string_view stream)
 			Package->Nodes[i].Transform->SetParent(Package->Nodes[Package->Nodes[i].AttachedTo].Transform);
 }
 
-void NifParser::MarkBone(size_t index, std::unordered_map<size_t, size_t> &boneIndices)
+void NifParser::MarkBone(size_t index, std::pmr::unordered_map<size_t, size_t> &boneIndices)
 {
 	if (Package->Nodes[index].IsInBoneList)
 		return;
@@ -2040,4 +2060,5 @@ void NifParser::MarkBone(size_t index, std::unordered_map<size_t, size_t> &boneI
 	}
 }
 
-std::unordered_set<std::string> NifParser::SemanticsFound = {};
\ No newline at end of file
+std::mutex NifParser::SemanticsLock;
+std::unordered_set<std::string> NifParser::SemanticsFound = {};
@@ -4,6 +4,8 @@
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
+#include <memory_resource>
+#include <mutex>
 
 #include "ModelParser.h"
 #include "PackageNodes.h"
@@ -13,10 +15,13 @@ class NifParser : public ModelParser
 public:
 	std::string Name;
 
+	// any number of parsers can run at once on different threads
 	void Parse(std::string_view stream);
 
 private:
+	// every stream semantic any parser has seen, for debugging
+	static std::mutex SemanticsLock;
 	static std::unordered_set<std::string> SemanticsFound;
 
-	void MarkBone(size_t index, std::unordered_map<size_t, size_t>& boneIndices);
+	void MarkBone(size_t index, std::pmr::unordered_map<size_t, size_t>& boneIndices);
 };
\ No newline at end of file
@@ -38,6 +38,12 @@ namespace Engine
 			std::shared_ptr<Engine::Transform> Transform;
 			glm::mat4 LocalTransformGLM = glm::mat4(1.0f);
 			std::vector<size_t> Bones;
+
+			// skinned meshes only. BoneOffsets maps skin space into the space of each entry in Bones,
+			// SkinTransform maps the space of the skeleton root's parent into skin space
+			std::vector<Matrix4F> BoneOffsets;
+			Matrix4F SkinTransform;
+			size_t SkeletonRoot = (size_t)-1;
 		};
 
 		struct ModelPackageTextureTransform
@@ -96,6 +102,9 @@ namespace Engine
 			float FresnelExponent = 5;
 			float ColorBoost = 1;
 			// NiAlphaProperty
+			bool HasAlphaProperty = false;
+			bool BlendEnabled = false; // bit 0
+			bool AlphaTestEnabled = false; // bit 9
 			unsigned char SourceBlendMode = 6;
 			unsigned char DestBlendMode = 7;
 			/*
@@ -276,6 +285,7 @@ namespace Engine
 			std::shared_ptr<Engine::Graphics::MeshFormat> Format;
 			std::shared_ptr<Engine::Graphics::MeshData> Mesh;
 			std::shared_ptr<Engine::Transform> Transform;
+			bool CollisionEnabled = true;
 		};
 
 		struct ModelPhysXActor
@@ -0,0 +1,591 @@
+#include "AnimationSampler.h"
+
+#include <Engine/JobSystem.h>
+#include <Engine/Math/SimdMath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if ENGINE_SIMD_MATH
+#include <immintrin.h>
+#endif
+
+namespace Engine
+{
+	namespace Graphics
+	{
+		namespace
+		{
+			// how far a cursor walks forward before falling back to a binary search
+			const unsigned int MaxCursorSteps = 4;
+
+			// rotations that need a slerp are collected per call and interpolated together
+			struct RotationBatch
+			{
+				std::vector<Quaternion> From;
+				std::vector<Quaternion> To;
+				std::vector<float> T;
+				std::vector<Quaternion> Results;
+				std::vector<size_t> Nodes;
+
+				void Clear()
+				{
+					From.clear();
+					To.clear();
+					T.clear();
+					Nodes.clear();
+				}
+			};
+
+			thread_local RotationBatch Rotations;
+
+			template <typename Float4>
+			void Store(const Vector3SF &value, Float4 &result)
+			{
+				result.Values[0] = value.X;
+				result.Values[1] = value.Y;
+				result.Values[2] = value.Z;
+				result.Values[3] = 0;
+			}
+
+			template <typename Float4>
+			void Store(const Quaternion &value, Float4 &result)
+			{
+				result.Values[0] = value.X;
+				result.Values[1] = value.Y;
+				result.Values[2] = value.Z;
+				result.Values[3] = value.W;
+			}
+
+			template <typename Float4>
+			void Store(float value, Float4 &result)
+			{
+				result.Values[0] = value;
+				result.Values[1] = 0;
+				result.Values[2] = 0;
+				result.Values[3] = 0;
+			}
+
+			template <typename Key>
+			void StoreQuadraticTangents(const ModelPackageAnimationVectorKeyframe &keyframe, Key &key)
+			{
+				Store(keyframe.Params, key.Out);
+				Store(keyframe.Backward, key.In);
+			}
+
+			template <typename Key>
+			void StoreQuadraticTangents(const ModelPackageAnimationFloatKeyframe &keyframe, Key &key)
+			{
+				Store(keyframe.Params.X, key.Out);
+				Store(keyframe.Params.Y, key.In);
+			}
+
+			template <typename Key>
+			void StoreQuadraticTangents(const ModelPackageAnimationQuaternionKeyframe &, Key &)
+			{
+			}
+
+			// kochanek-bartels tangents, the end keys reuse the one difference they have
+			template <typename Key, typename Keyframe>
+			void ComputeTensionBiasContinuity(Key *keys, const std::vector<Keyframe> &keyframes)
+			{
+				size_t count = keyframes.size();
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					float tension = keyframes[i].Params.X;
+					float bias = keyframes[i].Params.Y;
+					float continuity = keyframes[i].Params.Z;
+
+					float outgoingPrevious = 0.5f * (1 - tension) * (1 + bias) * (1 + continuity);
+					float outgoingNext = 0.5f * (1 - tension) * (1 - bias) * (1 - continuity);
+					float incomingPrevious = 0.5f * (1 - tension) * (1 + bias) * (1 - continuity);
+					float incomingNext = 0.5f * (1 - tension) * (1 - bias) * (1 + continuity);
+
+					for (int j = 0; j < 4; ++j)
+					{
+						float previous = i > 0 ? keys[i].Value.Values[j] - keys[i - 1].Value.Values[j] : 0;
+						float next = i + 1 < count ? keys[i + 1].Value.Values[j] - keys[i].Value.Values[j] : 0;
+
+						if (i == 0)
+							previous = next;
+						else if (i + 1 == count)
+							next = previous;
+
+						keys[i].Out.Values[j] = outgoingPrevious * previous + outgoingNext * next;
+						keys[i].In.Values[j] = incomingPrevious * previous + incomingNext * next;
+					}
+				}
+			}
+
+			// result = sum of points[i] * weights[i]
+			template <typename Float4>
+			void Blend(const Float4 *const points[4], const float weights[4], Float4 &result)
+			{
+#if ENGINE_SIMD_MATH
+				__m128 sum = _mm_mul_ps(_mm_load_ps(points[0]->Values), _mm_set1_ps(weights[0]));
+
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(points[1]->Values), _mm_set1_ps(weights[1])));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(points[2]->Values), _mm_set1_ps(weights[2])));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(points[3]->Values), _mm_set1_ps(weights[3])));
+
+				_mm_store_ps(result.Values, sum);
+#else
+				for (int i = 0; i < 4; ++i)
+					result.Values[i] = points[0]->Values[i] * weights[0] + points[1]->Values[i] * weights[1] + points[2]->Values[i] * weights[2] + points[3]->Values[i] * weights[3];
+#endif
+			}
+
+			template <typename Float4>
+			Vector3SF ToVector(const Float4 &value)
+			{
+				return Vector3SF(value.Values[0], value.Values[1], value.Values[2]);
+			}
+
+			template <typename Float4>
+			Quaternion ToQuaternion(const Float4 &value)
+			{
+				return Quaternion(value.Values[3], value.Values[0], value.Values[1], value.Values[2]);
+			}
+		}
+
+		AnimationSampler::AnimationSampler(const ModelPackageAnimation &animation)
+		{
+			Name = animation.Name;
+			Duration = animation.Duration;
+			PlaybackSpeed = animation.PlaybackSpeed;
+			CycleType = animation.CycleType;
+
+			Nodes.resize(animation.Nodes.size());
+
+			for (size_t i = 0; i < animation.Nodes.size(); ++i)
+			{
+				const ModelPackageAnimationNode &source = animation.Nodes[i];
+				Node &node = Nodes[i];
+
+				node.Name = source.NodeName;
+
+				NodeIndices[node.Name] = i;
+
+				if (source.IsSpline)
+				{
+					node.Translation = AddSplineTrack(source.TranslationSpline);
+					node.Rotation = AddSplineTrack(source.RotationSpline);
+					node.Scale = AddSplineTrack(source.ScaleSpline);
+
+					continue;
+				}
+
+				node.Translation = AddKeyTrack(source.Translation);
+				node.Scale = AddKeyTrack(source.Scale);
+
+				if (source.Rotation.Type != AnimationInterpolationType::XyzRotation)
+				{
+					node.Rotation = AddKeyTrack(source.Rotation);
+
+					continue;
+				}
+
+				node.Rotation.Source = ChannelSource::EulerKeys;
+				node.Rotation.Tracks[0] = AddKeyTrack(source.EulerRotation.X).Tracks[0];
+				node.Rotation.Tracks[1] = AddKeyTrack(source.EulerRotation.Y).Tracks[0];
+				node.Rotation.Tracks[2] = AddKeyTrack(source.EulerRotation.Z).Tracks[0];
+			}
+		}
+
+		size_t AnimationSampler::GetNodeIndex(const std::string &name) const
+		{
+			auto index = NodeIndices.find(name);
+
+			if (index == NodeIndices.end())
+				return (size_t)-1;
+
+			return index->second;
+		}
+
+		float AnimationSampler::GetClipTime(float time) const
+		{
+			return GetClipTime(time, Duration, PlaybackSpeed, CycleType);
+		}
+
+		float AnimationSampler::GetClipTime(float time, float duration, float playbackSpeed, AnimationCycleType cycleType)
+		{
+			time *= playbackSpeed;
+
+			if (duration <= 0)
+				return 0;
+
+			switch (cycleType)
+			{
+			case AnimationCycleType::Loop:
+				time = std::fmod(time, duration);
+
+				return time < 0 ? time + duration : time;
+			case AnimationCycleType::Reverse:
+			{
+				float period = 2 * duration;
+
+				time = std::fmod(time, period);
+
+				if (time < 0)
+					time += period;
+
+				return time > duration ? period - time : time;
+			}
+			default:
+				return std::min(std::max(time, 0.f), duration);
+			}
+		}
+
+		Quaternion AnimationSampler::GetEulerRotation(float x, float y, float z)
+		{
+			Quaternion rotationX(std::cos(0.5f * x), std::sin(0.5f * x), 0, 0);
+			Quaternion rotationY(std::cos(0.5f * y), 0, std::sin(0.5f * y), 0);
+			Quaternion rotationZ(std::cos(0.5f * z), 0, 0, std::sin(0.5f * z));
+
+			return rotationX * rotationY * rotationZ;
+		}
+
+		unsigned int AnimationSampler::GetSplineWeights(unsigned int pointCount, float start, float end, float time, float weights[4])
+		{
+			int count = int(pointCount);
+			int degree = std::min(3, count - 1);
+			int spans = count - degree;
+			float length = end - start;
+			float t = length > 0 ? std::min(std::max((time - start) / length, 0.f), 1.f) : 0;
+			float u = t * float(spans);
+			int span = std::min(int(u), spans - 1);
+			int knot = span + degree;
+
+			// knot j of the clamped vector is j - degree limited to [0, spans]
+			auto knotValue = [degree, spans](int j)
+			{
+				return float(std::min(std::max(j - degree, 0), spans));
+			};
+
+			float left[4] = {};
+			float right[4] = {};
+
+			weights[0] = 1;
+			weights[1] = weights[2] = weights[3] = 0;
+
+			for (int j = 1; j <= degree; ++j)
+			{
+				left[j] = u - knotValue(knot + 1 - j);
+				right[j] = knotValue(knot + j) - u;
+
+				float saved = 0;
+
+				for (int r = 0; r < j; ++r)
+				{
+					float denominator = right[r + 1] + left[j - r];
+					float temp = denominator != 0 ? weights[r] / denominator : 0;
+
+					weights[r] = saved + right[r + 1] * temp;
+					saved = left[j - r] * temp;
+				}
+
+				weights[j] = saved;
+			}
+
+			return unsigned(span);
+		}
+
+		void AnimationSampler::ResetCursors(std::vector<unsigned int> &cursors) const
+		{
+			cursors.assign(KeyTracks.size(), 0);
+		}
+
+		void AnimationSampler::Sample(float time, AnimationPose *poses, std::vector<unsigned int> &cursors) const
+		{
+			if (cursors.size() != KeyTracks.size())
+				ResetCursors(cursors);
+
+			float clipTime = GetClipTime(time);
+			RotationBatch &rotations = Rotations;
+			Float4 value;
+
+			rotations.Clear();
+
+			for (size_t i = 0; i < Nodes.size(); ++i)
+			{
+				const Node &node = Nodes[i];
+				AnimationPose &pose = poses[i];
+
+				if (node.Translation.Source == ChannelSource::Keys)
+				{
+					Interpolate(KeyTracks[node.Translation.Tracks[0]], Locate(node.Translation.Tracks[0], clipTime, cursors), value);
+
+					pose.Translation = ToVector(value);
+				}
+				else if (node.Translation.Source == ChannelSource::Spline)
+				{
+					SampleSpline(node.Translation.Tracks[0], clipTime, value);
+
+					pose.Translation = ToVector(value);
+				}
+
+				if (node.Scale.Source == ChannelSource::Keys)
+				{
+					Interpolate(KeyTracks[node.Scale.Tracks[0]], Locate(node.Scale.Tracks[0], clipTime, cursors), value);
+
+					pose.Scale = value.Values[0];
+				}
+				else if (node.Scale.Source == ChannelSource::Spline)
+				{
+					SampleSpline(node.Scale.Tracks[0], clipTime, value);
+
+					pose.Scale = value.Values[0];
+				}
+
+				if (node.Rotation.Source == ChannelSource::Keys)
+				{
+					const KeyTrack &track = KeyTracks[node.Rotation.Tracks[0]];
+					Segment segment = Locate(node.Rotation.Tracks[0], clipTime, cursors);
+
+					if (segment.From == segment.To || track.Type == AnimationInterpolationType::Const)
+					{
+						pose.Rotation = ToQuaternion(Keys[track.FirstKey + segment.From].Value);
+
+						continue;
+					}
+
+					rotations.From.push_back(ToQuaternion(Keys[track.FirstKey + segment.From].Value));
+					rotations.To.push_back(ToQuaternion(Keys[track.FirstKey + segment.To].Value));
+					rotations.T.push_back(segment.T);
+					rotations.Nodes.push_back(i);
+				}
+				else if (node.Rotation.Source == ChannelSource::EulerKeys)
+				{
+					float angles[3] = {};
+
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						unsigned int trackIndex = node.Rotation.Tracks[axis];
+
+						if (KeyTracks[trackIndex].KeyCount == 0)
+							continue;
+
+						Interpolate(KeyTracks[trackIndex], Locate(trackIndex, clipTime, cursors), value);
+
+						angles[axis] = value.Values[0];
+					}
+
+					pose.Rotation = GetEulerRotation(angles[0], angles[1], angles[2]);
+				}
+				else if (node.Rotation.Source == ChannelSource::Spline)
+				{
+					SampleSpline(node.Rotation.Tracks[0], clipTime, value);
+
+					pose.Rotation = ToQuaternion(value).Normalize();
+				}
+			}
+
+			size_t count = rotations.Nodes.size();
+
+			if (count == 0)
+				return;
+
+			rotations.Results.resize(count);
+
+			SimdMath::Slerp(rotations.From.data(), rotations.To.data(), rotations.T.data(), rotations.Results.data(), count);
+
+			for (size_t i = 0; i < count; ++i)
+				poses[rotations.Nodes[i]].Rotation = rotations.Results[i];
+		}
+
+		void AnimationSampler::Sample(Instance *instances, size_t count)
+		{
+			JobSystem::ParallelFor(count, 32, [instances](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					Instance &instance = instances[i];
+
+					if (instance.Sampler != nullptr && instance.Poses != nullptr)
+						instance.Sampler->Sample(instance.Time, instance.Poses, instance.Cursors);
+				}
+			});
+		}
+
+		template <typename KeyframeNode>
+		AnimationSampler::Channel AnimationSampler::AddKeyTrack(const KeyframeNode &node)
+		{
+			Channel channel;
+			KeyTrack track;
+
+			track.Type = node.Type;
+			track.FirstKey = (unsigned int)Keys.size();
+			track.KeyCount = (unsigned int)node.Keyframes.size();
+
+			for (const auto &keyframe : node.Keyframes)
+			{
+				Key key;
+
+				Store(keyframe.Value, key.Value);
+
+				if (track.Type == AnimationInterpolationType::Quadratic)
+					StoreQuadraticTangents(keyframe, key);
+
+				KeyTimes.push_back(keyframe.Time);
+				Keys.push_back(key);
+			}
+
+			// quaternion tbc keys get a plain slerp
+			if constexpr (!std::is_same_v<KeyframeNode, ModelPackageAnimationQuaternionNode>)
+			{
+				if (track.Type == AnimationInterpolationType::TensionBiasContinuity)
+					ComputeTensionBiasContinuity(Keys.data() + track.FirstKey, node.Keyframes);
+			}
+
+			channel.Tracks[0] = (unsigned int)KeyTracks.size();
+
+			if (track.KeyCount > 0)
+				channel.Source = ChannelSource::Keys;
+
+			KeyTracks.push_back(track);
+
+			return channel;
+		}
+
+		template <typename PointType>
+		AnimationSampler::Channel AnimationSampler::AddSplineTrack(const ModelPackageSpline<PointType> &spline)
+		{
+			Channel channel;
+
+			if (spline.ControlPoints.empty())
+				return channel;
+
+			SplineTrack track;
+
+			track.FirstPoint = (unsigned int)ControlPoints.size();
+			track.PointCount = (unsigned int)spline.ControlPoints.size();
+			track.Start = spline.Start;
+			track.End = spline.End;
+
+			for (const PointType &point : spline.ControlPoints)
+			{
+				ControlPoints.push_back({});
+
+				Store(point, ControlPoints.back());
+			}
+
+			channel.Source = ChannelSource::Spline;
+			channel.Tracks[0] = (unsigned int)SplineTracks.size();
+
+			SplineTracks.push_back(track);
+
+			return channel;
+		}
+
+		AnimationSampler::Segment AnimationSampler::Locate(unsigned int trackIndex, float time, std::vector<unsigned int> &cursors) const
+		{
+			const KeyTrack &track = KeyTracks[trackIndex];
+			const float *times = KeyTimes.data() + track.FirstKey;
+			unsigned int count = track.KeyCount;
+			unsigned int cursor = cursors[trackIndex];
+			Segment segment;
+
+			if (count < 2 || time <= times[0])
+			{
+				cursors[trackIndex] = 0;
+
+				return segment;
+			}
+
+			if (time >= times[count - 1])
+			{
+				cursors[trackIndex] = count - 1;
+				segment.From = segment.To = count - 1;
+
+				return segment;
+			}
+
+			// times[0] < time < times[count - 1] from here on, so the key that starts the segment always exists.
+			// playing forward almost always stays on the same key or moves to the next one
+			bool found = false;
+
+			if (cursor < count - 1 && times[cursor] <= time)
+			{
+				for (unsigned int step = 0; step < MaxCursorSteps && !found; ++step)
+				{
+					if (time < times[cursor + 1])
+						found = true;
+					else
+						++cursor;
+				}
+			}
+			else if (cursor > 0 && cursor < count && times[cursor - 1] <= time)
+			{
+				--cursor;
+				found = true;
+			}
+
+			if (!found)
+				cursor = (unsigned int)(std::upper_bound(times, times + count, time) - times) - 1;
+
+			cursors[trackIndex] = cursor;
+
+			float length = times[cursor + 1] - times[cursor];
+
+			segment.From = cursor;
+			segment.To = cursor + 1;
+			segment.T = length > 0 ? (time - times[cursor]) / length : 0;
+
+			return segment;
+		}
+
+		void AnimationSampler::Interpolate(const KeyTrack &track, const Segment &segment, Float4 &result) const
+		{
+			if (track.KeyCount == 0)
+			{
+				result = Float4();
+
+				return;
+			}
+
+			const Key &from = Keys[track.FirstKey + segment.From];
+			const Key &to = Keys[track.FirstKey + segment.To];
+
+			if (segment.From == segment.To || track.Type == AnimationInterpolationType::Const)
+			{
+				result = from.Value;
+
+				return;
+			}
+
+			float t = segment.T;
+
+			if (track.Type == AnimationInterpolationType::Quadratic || track.Type == AnimationInterpolationType::TensionBiasContinuity)
+			{
+				float t2 = t * t;
+				float t3 = t2 * t;
+				const Float4 *points[4] = { &from.Value, &from.Out, &to.Value, &to.In };
+				const float weights[4] = { 2 * t3 - 3 * t2 + 1, t3 - 2 * t2 + t, 3 * t2 - 2 * t3, t3 - t2 };
+
+				Blend(points, weights, result);
+
+				return;
+			}
+
+			const Float4 *points[4] = { &from.Value, &to.Value, &to.Value, &to.Value };
+			const float weights[4] = { 1 - t, t, 0, 0 };
+
+			Blend(points, weights, result);
+		}
+
+		void AnimationSampler::SampleSpline(unsigned int trackIndex, float time, Float4 &result) const
+		{
+			const SplineTrack &track = SplineTracks[trackIndex];
+			float weights[4];
+			unsigned int span = GetSplineWeights(track.PointCount, track.Start, track.End, time, weights);
+			const Float4 *points[4];
+
+			for (unsigned int i = 0; i < 4; ++i)
+				points[i] = ControlPoints.data() + track.FirstPoint + std::min(span + i, track.PointCount - 1);
+
+			Blend(points, weights, result);
+		}
+	}
+}
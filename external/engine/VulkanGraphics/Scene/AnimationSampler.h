@@ -0,0 +1,147 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <VulkanGraphics/FileFormats/PackageNodes.h>
+
+namespace Engine
+{
+	namespace Graphics
+	{
+		struct AnimationPose
+		{
+			Vector3SF Translation;
+			Quaternion Rotation = Quaternion(1, 0, 0, 0);
+			float Scale = 1;
+		};
+
+		// flattens every track of a clip into contiguous arrays so a whole clip can be sampled into a pose buffer at once.
+		// the sampler itself is immutable after construction and can be shared by any number of threads, the
+		// per instance state is the cursor list that remembers which key every track was at last time
+		class AnimationSampler
+		{
+		public:
+			struct Instance
+			{
+				const AnimationSampler *Sampler = nullptr;
+				float Time = 0;
+				AnimationPose *Poses = nullptr;
+				std::vector<unsigned int> Cursors;
+			};
+
+			AnimationSampler(const ModelPackageAnimation &animation);
+
+			const std::string &GetName() const { return Name; }
+			float GetDuration() const { return Duration; }
+			AnimationCycleType GetCycleType() const { return CycleType; }
+			size_t GetNodeCount() const { return Nodes.size(); }
+			const std::string &GetNodeName(size_t node) const { return Nodes[node].Name; }
+			size_t GetNodeIndex(const std::string &name) const;
+
+			// applies the playback speed and the cycle type to an unbounded playback time
+			float GetClipTime(float time) const;
+
+			void ResetCursors(std::vector<unsigned int> &cursors) const;
+
+			// writes GetNodeCount() poses, nodes without a channel keep the value that was in the buffer
+			void Sample(float time, AnimationPose *poses, std::vector<unsigned int> &cursors) const;
+
+			// samples every instance, split across the job system
+			static void Sample(Instance *instances, size_t count);
+
+			// shared with the compressed clips so both play back the same way
+			static float GetClipTime(float time, float duration, float playbackSpeed, AnimationCycleType cycleType);
+			static Quaternion GetEulerRotation(float x, float y, float z);
+
+			// weights of the clamped uniform b-spline over [start, end], cubic when there are enough points.
+			// returns the first of the four control points the weights apply to, clamped to the last point
+			static unsigned int GetSplineWeights(unsigned int pointCount, float start, float end, float time, float weights[4]);
+
+		private:
+			friend class CompressedAnimationClip;
+
+			struct alignas(16) Float4
+			{
+				float Values[4] = {};
+			};
+
+			// In is the tangent arriving at the key, Out the one leaving it, both per segment
+			struct Key
+			{
+				Float4 Value;
+				Float4 In;
+				Float4 Out;
+			};
+
+			struct KeyTrack
+			{
+				AnimationInterpolationType Type = AnimationInterpolationType::None;
+				unsigned int FirstKey = 0;
+				unsigned int KeyCount = 0;
+			};
+
+			struct SplineTrack
+			{
+				unsigned int FirstPoint = 0;
+				unsigned int PointCount = 0;
+				float Start = 0;
+				float End = 0;
+			};
+
+			// the keys a time falls between, From == To outside of the keys and for constant tracks
+			struct Segment
+			{
+				unsigned int From = 0;
+				unsigned int To = 0;
+				float T = 0;
+			};
+
+			enum class ChannelSource : unsigned char
+			{
+				None,
+				Keys,
+				EulerKeys,
+				Spline
+			};
+
+			// Tracks holds one track index, three for euler rotations (x, y, z)
+			struct Channel
+			{
+				ChannelSource Source = ChannelSource::None;
+				unsigned int Tracks[3] = {};
+			};
+
+			struct Node
+			{
+				std::string Name;
+				Channel Translation;
+				Channel Rotation;
+				Channel Scale;
+			};
+
+			std::string Name;
+			float Duration = 0;
+			float PlaybackSpeed = 1;
+			AnimationCycleType CycleType = AnimationCycleType::Clamp;
+			std::vector<Node> Nodes;
+			std::unordered_map<std::string, size_t> NodeIndices;
+			std::vector<KeyTrack> KeyTracks;
+			std::vector<float> KeyTimes;
+			std::vector<Key> Keys;
+			std::vector<SplineTrack> SplineTracks;
+			std::vector<Float4> ControlPoints;
+
+			template <typename KeyframeNode>
+			Channel AddKeyTrack(const KeyframeNode &node);
+
+			template <typename PointType>
+			Channel AddSplineTrack(const ModelPackageSpline<PointType> &spline);
+
+			Segment Locate(unsigned int trackIndex, float time, std::vector<unsigned int> &cursors) const;
+			void Interpolate(const KeyTrack &track, const Segment &segment, Float4 &result) const;
+			void SampleSpline(unsigned int trackIndex, float time, Float4 &result) const;
+		};
+	}
+}
@@ -0,0 +1,786 @@
+#include "CompressedAnimation.h"
+
+#include <Engine/JobSystem.h>
+#include <Engine/Math/SimdMath.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Engine
+{
+	namespace Graphics
+	{
+		namespace
+		{
+			const unsigned int MaxCursorSteps = 4;
+			const float QuantizedMaximum = 65535;
+
+			// the three smallest components of a unit quaternion lie within +-1/sqrt(2)
+			const float SmallestThreeRange = 0.70710678f;
+			const float SmallestThreeMaximum = 32767;
+
+			// values closer than this count as the same when looking for constant tracks
+			const float ConstantTolerance = 1e-6f;
+
+			struct RotationBatch
+			{
+				std::vector<Quaternion> From;
+				std::vector<Quaternion> To;
+				std::vector<float> T;
+				std::vector<Quaternion> Results;
+				std::vector<size_t> Nodes;
+
+				void Clear()
+				{
+					From.clear();
+					To.clear();
+					T.clear();
+					Nodes.clear();
+				}
+			};
+
+			thread_local RotationBatch Rotations;
+
+			unsigned short Quantize(float value, float minimum, float step)
+			{
+				if (step <= 0)
+					return 0;
+
+				return (unsigned short)std::lround(std::min(std::max((value - minimum) / step, 0.f), QuantizedMaximum));
+			}
+
+			void Normalize(float *quaternion)
+			{
+				float length = std::sqrt(quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1] + quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]);
+
+				if (length <= 0)
+				{
+					quaternion[0] = quaternion[1] = quaternion[2] = 0;
+					quaternion[3] = 1;
+
+					return;
+				}
+
+				for (int i = 0; i < 4; ++i)
+					quaternion[i] /= length;
+			}
+
+			// 2 bits for the dropped component, 15 bits for each of the others. the dropped one is the largest and is
+			// made positive so it can be rebuilt from the other three
+			void PackRotation(const float *quaternion, unsigned short *words)
+			{
+				int largest = 0;
+
+				for (int i = 1; i < 4; ++i)
+					if (std::abs(quaternion[i]) > std::abs(quaternion[largest]))
+						largest = i;
+
+				float sign = quaternion[largest] < 0 ? -1.f : 1.f;
+				unsigned long long bits = (unsigned long long)largest;
+				int slot = 0;
+
+				for (int i = 0; i < 4; ++i)
+				{
+					if (i == largest)
+						continue;
+
+					float value = std::min(std::max(sign * quaternion[i] / SmallestThreeRange, -1.f), 1.f);
+					unsigned long long quantized = (unsigned long long)std::lround((value * 0.5f + 0.5f) * SmallestThreeMaximum);
+
+					bits |= quantized << (2 + 15 * slot++);
+				}
+
+				words[0] = (unsigned short)(bits & 0xFFFF);
+				words[1] = (unsigned short)((bits >> 16) & 0xFFFF);
+				words[2] = (unsigned short)((bits >> 32) & 0xFFFF);
+			}
+
+			void UnpackRotation(const unsigned short *words, float *quaternion)
+			{
+				unsigned long long bits = (unsigned long long)words[0] | ((unsigned long long)words[1] << 16) | ((unsigned long long)words[2] << 32);
+				int largest = int(bits & 3);
+				int slot = 0;
+				float sum = 0;
+
+				for (int i = 0; i < 4; ++i)
+				{
+					if (i == largest)
+						continue;
+
+					float quantized = float((bits >> (2 + 15 * slot++)) & 0x7FFF);
+					float value = (quantized / SmallestThreeMaximum * 2 - 1) * SmallestThreeRange;
+
+					quaternion[i] = value;
+					sum += value * value;
+				}
+
+				quaternion[largest] = std::sqrt(std::max(1 - sum, 0.f));
+			}
+
+			bool IsSameRotation(const float *a, const float *b)
+			{
+				float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+
+				return 1 - std::abs(dot) <= ConstantTolerance;
+			}
+
+			bool IsSameValue(const float *a, const float *b, int components)
+			{
+				for (int i = 0; i < components; ++i)
+					if (std::abs(a[i] - b[i]) > ConstantTolerance * std::max(1.f, std::abs(a[i])))
+						return false;
+
+				return true;
+			}
+
+			void Extend(const float *value, int components, float *minimum, float *maximum)
+			{
+				for (int i = 0; i < components; ++i)
+				{
+					minimum[i] = std::min(minimum[i], value[i]);
+					maximum[i] = std::max(maximum[i], value[i]);
+				}
+			}
+
+			void SetStep(const float *minimum, const float *maximum, int components, float *step)
+			{
+				for (int i = 0; i < components; ++i)
+					step[i] = (maximum[i] - minimum[i]) / QuantizedMaximum;
+			}
+
+			Quaternion ToQuaternion(const float *value)
+			{
+				return Quaternion(value[3], value[0], value[1], value[2]);
+			}
+		}
+
+		CompressedAnimationClip::CompressedAnimationClip(const ModelPackageAnimation &animation)
+		{
+			Compile(AnimationSampler(animation));
+		}
+
+		CompressedAnimationClip::CompressedAnimationClip(const AnimationSampler &sampler)
+		{
+			Compile(sampler);
+		}
+
+		size_t CompressedAnimationClip::GetNodeIndex(const std::string &name) const
+		{
+			auto index = NodeIndices.find(name);
+
+			if (index == NodeIndices.end())
+				return (size_t)-1;
+
+			return index->second;
+		}
+
+		size_t CompressedAnimationClip::GetSize() const
+		{
+			size_t size = sizeof(*this) + Name.capacity() + Tracks.capacity() * sizeof(Track) + Data.capacity() * sizeof(unsigned short);
+
+			for (const Node &node : Nodes)
+				size += sizeof(Node) + node.Name.capacity();
+
+			return size;
+		}
+
+		float CompressedAnimationClip::GetClipTime(float time) const
+		{
+			return AnimationSampler::GetClipTime(time, Duration, PlaybackSpeed, CycleType);
+		}
+
+		void CompressedAnimationClip::ResetCursors(std::vector<unsigned int> &cursors) const
+		{
+			cursors.assign(Tracks.size(), 0);
+		}
+
+		void CompressedAnimationClip::Sample(float time, AnimationPose *poses, std::vector<unsigned int> &cursors) const
+		{
+			if (cursors.size() != Tracks.size())
+				ResetCursors(cursors);
+
+			float clipTime = GetClipTime(time);
+			RotationBatch &rotations = Rotations;
+			float value[4];
+
+			rotations.Clear();
+
+			for (size_t i = 0; i < Nodes.size(); ++i)
+			{
+				const Node &node = Nodes[i];
+				AnimationPose &pose = poses[i];
+
+				if (node.Translation != NoTrack)
+				{
+					SampleTrack(node.Translation, clipTime, cursors, value);
+
+					pose.Translation = Vector3SF(value[0], value[1], value[2]);
+				}
+
+				if (node.Scale != NoTrack)
+				{
+					SampleTrack(node.Scale, clipTime, cursors, value);
+
+					pose.Scale = value[0];
+				}
+
+				if (node.EulerRotation)
+				{
+					float angles[3] = {};
+
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						if (node.Euler[axis] == NoTrack)
+							continue;
+
+						SampleTrack(node.Euler[axis], clipTime, cursors, value);
+
+						angles[axis] = value[0];
+					}
+
+					pose.Rotation = AnimationSampler::GetEulerRotation(angles[0], angles[1], angles[2]);
+
+					continue;
+				}
+
+				if (node.Rotation == NoTrack)
+					continue;
+
+				const Track &track = Tracks[node.Rotation];
+
+				if (track.Encoding != TrackEncoding::Keys)
+				{
+					SampleTrack(node.Rotation, clipTime, cursors, value);
+
+					pose.Rotation = ToQuaternion(value);
+
+					continue;
+				}
+
+				Segment segment = Locate(node.Rotation, clipTime, cursors);
+
+				Decode(track, segment.From, value);
+
+				if (segment.From == segment.To || track.Type == AnimationInterpolationType::Const)
+				{
+					pose.Rotation = ToQuaternion(value);
+
+					continue;
+				}
+
+				rotations.From.push_back(ToQuaternion(value));
+
+				Decode(track, segment.To, value);
+
+				rotations.To.push_back(ToQuaternion(value));
+				rotations.T.push_back(segment.T);
+				rotations.Nodes.push_back(i);
+			}
+
+			size_t count = rotations.Nodes.size();
+
+			if (count == 0)
+				return;
+
+			rotations.Results.resize(count);
+
+			SimdMath::Slerp(rotations.From.data(), rotations.To.data(), rotations.T.data(), rotations.Results.data(), count);
+
+			for (size_t i = 0; i < count; ++i)
+				poses[rotations.Nodes[i]].Rotation = rotations.Results[i];
+		}
+
+		void CompressedAnimationClip::Sample(Instance *instances, size_t count)
+		{
+			JobSystem::ParallelFor(count, 32, [instances](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					Instance &instance = instances[i];
+
+					if (instance.Clip != nullptr && instance.Poses != nullptr)
+						instance.Clip->Sample(instance.Time, instance.Poses, instance.Cursors);
+				}
+			});
+		}
+
+		CompressedAnimationClip::Report CompressedAnimationClip::Measure(const ModelPackageAnimation &source, float sampleRate) const
+		{
+			Report report;
+			AnimationSampler reference(source);
+
+			report.Tracks = Tracks.size();
+			report.SourceBytes = GetSourceSize(source);
+			report.CompressedBytes = GetSize();
+
+			for (const Track &track : Tracks)
+			{
+				if (track.Encoding == TrackEncoding::Constant)
+					++report.ConstantTracks;
+				else
+					report.Keys += track.KeyCount;
+			}
+
+			size_t nodeCount = Nodes.size();
+			std::vector<AnimationPose> expected(nodeCount);
+			std::vector<AnimationPose> actual(nodeCount);
+			std::vector<unsigned int> expectedCursors;
+			std::vector<unsigned int> actualCursors;
+
+			// sample the clip once from start to end whatever the playback speed is
+			float speed = PlaybackSpeed != 0 ? PlaybackSpeed : 1;
+			size_t samples = std::max<size_t>(1, size_t(std::ceil(Duration * std::max(sampleRate, 1.f))));
+
+			for (size_t i = 0; i <= samples; ++i)
+			{
+				float time = Duration * float(i) / float(samples) / speed;
+
+				reference.Sample(time, expected.data(), expectedCursors);
+				Sample(time, actual.data(), actualCursors);
+
+				for (size_t node = 0; node < nodeCount; ++node)
+				{
+					const AnimationPose &a = expected[node];
+					const AnimationPose &b = actual[node];
+
+					float x = a.Translation.X - b.Translation.X;
+					float y = a.Translation.Y - b.Translation.Y;
+					float z = a.Translation.Z - b.Translation.Z;
+
+					// the angle between the rotations from the chord between them, acos loses too much near 1
+					float sign = a.Rotation.X * b.Rotation.X + a.Rotation.Y * b.Rotation.Y + a.Rotation.Z * b.Rotation.Z + a.Rotation.W * b.Rotation.W < 0 ? -1.f : 1.f;
+					float chordX = a.Rotation.X - sign * b.Rotation.X;
+					float chordY = a.Rotation.Y - sign * b.Rotation.Y;
+					float chordZ = a.Rotation.Z - sign * b.Rotation.Z;
+					float chordW = a.Rotation.W - sign * b.Rotation.W;
+					float chord = std::sqrt(chordX * chordX + chordY * chordY + chordZ * chordZ + chordW * chordW);
+
+					report.MaxTranslationError = std::max(report.MaxTranslationError, std::sqrt(x * x + y * y + z * z));
+					report.MaxRotationError = std::max(report.MaxRotationError, 4 * std::asin(std::min(0.5f * chord, 1.f)));
+					report.MaxScaleError = std::max(report.MaxScaleError, std::abs(a.Scale - b.Scale));
+				}
+			}
+
+			return report;
+		}
+
+		size_t CompressedAnimationClip::GetSourceSize(const ModelPackageAnimation &animation)
+		{
+			size_t size = sizeof(ModelPackageAnimation) + animation.Name.capacity() + animation.RootName.capacity();
+
+			for (const ModelPackageAnimationNode &node : animation.Nodes)
+			{
+				size += sizeof(ModelPackageAnimationNode) + node.NodeName.capacity();
+				size += node.Translation.Keyframes.capacity() * sizeof(ModelPackageAnimationVectorKeyframe);
+				size += node.Rotation.Keyframes.capacity() * sizeof(ModelPackageAnimationQuaternionKeyframe);
+				size += node.Scale.Keyframes.capacity() * sizeof(ModelPackageAnimationFloatKeyframe);
+				size += node.EulerRotation.X.Keyframes.capacity() * sizeof(ModelPackageAnimationFloatKeyframe);
+				size += node.EulerRotation.Y.Keyframes.capacity() * sizeof(ModelPackageAnimationFloatKeyframe);
+				size += node.EulerRotation.Z.Keyframes.capacity() * sizeof(ModelPackageAnimationFloatKeyframe);
+				size += node.TranslationSpline.ControlPoints.capacity() * sizeof(Vector3SF);
+				size += node.RotationSpline.ControlPoints.capacity() * sizeof(Quaternion);
+				size += node.ScaleSpline.ControlPoints.capacity() * sizeof(float);
+			}
+
+			return size;
+		}
+
+		void CompressedAnimationClip::Compile(const AnimationSampler &sampler)
+		{
+			typedef AnimationSampler::ChannelSource ChannelSource;
+
+			Name = sampler.Name;
+			Duration = sampler.Duration;
+			PlaybackSpeed = sampler.PlaybackSpeed;
+			CycleType = sampler.CycleType;
+			NodeIndices = sampler.NodeIndices;
+
+			Nodes.resize(sampler.Nodes.size());
+
+			auto addChannel = [this, &sampler](const AnimationSampler::Channel &channel, TrackKind kind)
+			{
+				if (channel.Source == ChannelSource::Keys)
+					return AddKeyTrack(sampler, channel.Tracks[0], kind);
+
+				if (channel.Source == ChannelSource::Spline)
+					return AddSplineTrack(sampler, channel.Tracks[0], kind);
+
+				return NoTrack;
+			};
+
+			for (size_t i = 0; i < Nodes.size(); ++i)
+			{
+				const AnimationSampler::Node &source = sampler.Nodes[i];
+				Node &node = Nodes[i];
+
+				node.Name = source.Name;
+				node.Translation = addChannel(source.Translation, TrackKind::Vector);
+				node.Scale = addChannel(source.Scale, TrackKind::Float);
+
+				if (source.Rotation.Source != ChannelSource::EulerKeys)
+				{
+					node.Rotation = addChannel(source.Rotation, TrackKind::Rotation);
+
+					continue;
+				}
+
+				node.EulerRotation = true;
+
+				for (int axis = 0; axis < 3; ++axis)
+					node.Euler[axis] = AddKeyTrack(sampler, source.Rotation.Tracks[axis], TrackKind::Float);
+			}
+
+			Tracks.shrink_to_fit();
+			Data.shrink_to_fit();
+		}
+
+		unsigned int CompressedAnimationClip::AddKeyTrack(const AnimationSampler &sampler, unsigned int trackIndex, TrackKind kind)
+		{
+			const AnimationSampler::KeyTrack &source = sampler.KeyTracks[trackIndex];
+
+			if (source.KeyCount == 0)
+				return NoTrack;
+
+			const AnimationSampler::Key *keys = sampler.Keys.data() + source.FirstKey;
+			const float *times = sampler.KeyTimes.data() + source.FirstKey;
+			unsigned int count = source.KeyCount;
+			int components = kind == TrackKind::Float ? 1 : 3;
+			Track track;
+
+			track.Kind = kind;
+			track.Type = source.Type;
+			track.HasTangents = kind != TrackKind::Rotation && (source.Type == AnimationInterpolationType::Quadratic || source.Type == AnimationInterpolationType::TensionBiasContinuity);
+
+			// rotations are compared and packed as unit quaternions
+			std::vector<AnimationSampler::Float4> values(count);
+
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				values[i] = keys[i].Value;
+
+				if (kind == TrackKind::Rotation)
+					Normalize(values[i].Values);
+			}
+
+			bool constant = true;
+
+			for (unsigned int i = 1; i < count && constant; ++i)
+			{
+				if (kind == TrackKind::Rotation)
+					constant = IsSameRotation(values[0].Values, values[i].Values);
+				else
+					constant = IsSameValue(values[0].Values, values[i].Values, components);
+			}
+
+			const float zero[4] = {};
+
+			for (unsigned int i = 0; i < count && constant && track.HasTangents; ++i)
+				constant = IsSameValue(keys[i].In.Values, zero, components) && IsSameValue(keys[i].Out.Values, zero, components);
+
+			unsigned int index = (unsigned int)Tracks.size();
+
+			if (constant)
+			{
+				std::copy(values[0].Values, values[0].Values + 4, track.Minimum);
+
+				Tracks.push_back(track);
+
+				return index;
+			}
+
+			track.Encoding = TrackEncoding::Keys;
+			track.KeyCount = count;
+			track.Offset = (unsigned int)Data.size();
+			track.Start = times[0];
+			track.End = times[count - 1];
+
+			float length = track.End - track.Start;
+
+			for (unsigned int i = 0; i < count; ++i)
+				Data.push_back(length > 0 ? Quantize((times[i] - track.Start) / length, 0, 1 / QuantizedMaximum) : 0);
+
+			if (kind == TrackKind::Rotation)
+			{
+				unsigned short words[3];
+
+				for (unsigned int i = 0; i < count; ++i)
+				{
+					PackRotation(values[i].Values, words);
+
+					Data.insert(Data.end(), words, words + 3);
+				}
+
+				Tracks.push_back(track);
+
+				return index;
+			}
+
+			float maximum[4];
+
+			std::copy(values[0].Values, values[0].Values + 4, track.Minimum);
+			std::copy(values[0].Values, values[0].Values + 4, maximum);
+
+			for (unsigned int i = 1; i < count; ++i)
+				Extend(values[i].Values, components, track.Minimum, maximum);
+
+			SetStep(track.Minimum, maximum, components, track.Step);
+
+			for (unsigned int i = 0; i < count; ++i)
+				for (int j = 0; j < components; ++j)
+					Data.push_back(Quantize(values[i].Values[j], track.Minimum[j], track.Step[j]));
+
+			if (track.HasTangents)
+			{
+				std::copy(keys[0].In.Values, keys[0].In.Values + 4, track.TangentMinimum);
+				std::copy(keys[0].In.Values, keys[0].In.Values + 4, maximum);
+
+				for (unsigned int i = 0; i < count; ++i)
+				{
+					Extend(keys[i].In.Values, components, track.TangentMinimum, maximum);
+					Extend(keys[i].Out.Values, components, track.TangentMinimum, maximum);
+				}
+
+				SetStep(track.TangentMinimum, maximum, components, track.TangentStep);
+
+				for (unsigned int i = 0; i < count; ++i)
+					for (int j = 0; j < components; ++j)
+						Data.push_back(Quantize(keys[i].In.Values[j], track.TangentMinimum[j], track.TangentStep[j]));
+
+				for (unsigned int i = 0; i < count; ++i)
+					for (int j = 0; j < components; ++j)
+						Data.push_back(Quantize(keys[i].Out.Values[j], track.TangentMinimum[j], track.TangentStep[j]));
+			}
+
+			Tracks.push_back(track);
+
+			return index;
+		}
+
+		unsigned int CompressedAnimationClip::AddSplineTrack(const AnimationSampler &sampler, unsigned int trackIndex, TrackKind kind)
+		{
+			const AnimationSampler::SplineTrack &source = sampler.SplineTracks[trackIndex];
+
+			if (source.PointCount == 0)
+				return NoTrack;
+
+			const AnimationSampler::Float4 *points = sampler.ControlPoints.data() + source.FirstPoint;
+			int components = kind == TrackKind::Float ? 1 : kind == TrackKind::Vector ? 3 : 4;
+			unsigned int index = (unsigned int)Tracks.size();
+			Track track;
+			float maximum[4];
+
+			track.Kind = kind;
+			track.Start = source.Start;
+			track.End = source.End;
+
+			std::copy(points[0].Values, points[0].Values + 4, track.Minimum);
+			std::copy(points[0].Values, points[0].Values + 4, maximum);
+
+			bool constant = true;
+
+			for (unsigned int i = 1; i < source.PointCount; ++i)
+			{
+				constant = constant && IsSameValue(points[0].Values, points[i].Values, components);
+
+				Extend(points[i].Values, components, track.Minimum, maximum);
+			}
+
+			// the blend of equal points is that point, rotations only need the normalize the sampler does after it
+			if (constant)
+			{
+				std::copy(points[0].Values, points[0].Values + 4, track.Minimum);
+
+				if (kind == TrackKind::Rotation)
+					Normalize(track.Minimum);
+
+				Tracks.push_back(track);
+
+				return index;
+			}
+
+			track.Encoding = TrackEncoding::Spline;
+			track.KeyCount = source.PointCount;
+			track.Offset = (unsigned int)Data.size();
+
+			SetStep(track.Minimum, maximum, components, track.Step);
+
+			for (unsigned int i = 0; i < source.PointCount; ++i)
+				for (int j = 0; j < components; ++j)
+					Data.push_back(Quantize(points[i].Values[j], track.Minimum[j], track.Step[j]));
+
+			Tracks.push_back(track);
+
+			return index;
+		}
+
+		// same walk as AnimationSampler::Locate, on key times quantized over the track
+		CompressedAnimationClip::Segment CompressedAnimationClip::Locate(unsigned int trackIndex, float time, std::vector<unsigned int> &cursors) const
+		{
+			const Track &track = Tracks[trackIndex];
+			const unsigned short *times = Data.data() + track.Offset;
+			unsigned int count = track.KeyCount;
+			unsigned int cursor = cursors[trackIndex];
+			float length = track.End - track.Start;
+			float position = length > 0 ? (time - track.Start) / length * QuantizedMaximum : 0;
+			Segment segment;
+
+			if (count < 2 || position <= float(times[0]))
+			{
+				cursors[trackIndex] = 0;
+
+				return segment;
+			}
+
+			if (position >= float(times[count - 1]))
+			{
+				cursors[trackIndex] = count - 1;
+				segment.From = segment.To = count - 1;
+
+				return segment;
+			}
+
+			bool found = false;
+
+			if (cursor < count - 1 && float(times[cursor]) <= position)
+			{
+				for (unsigned int step = 0; step < MaxCursorSteps && !found; ++step)
+				{
+					if (position < float(times[cursor + 1]))
+						found = true;
+					else
+						++cursor;
+				}
+			}
+			else if (cursor > 0 && cursor < count && float(times[cursor - 1]) <= position)
+			{
+				--cursor;
+				found = true;
+			}
+
+			if (!found)
+			{
+				cursor = (unsigned int)(std::upper_bound(times, times + count, position, [](float value, unsigned short key)
+				{
+					return value < float(key);
+				}) - times) - 1;
+			}
+
+			cursors[trackIndex] = cursor;
+
+			float span = float(times[cursor + 1]) - float(times[cursor]);
+
+			segment.From = cursor;
+			segment.To = cursor + 1;
+			segment.T = span > 0 ? (position - float(times[cursor])) / span : 0;
+
+			return segment;
+		}
+
+		void CompressedAnimationClip::Decode(const Track &track, unsigned int key, float *result) const
+		{
+			const unsigned short *values = Data.data() + track.Offset + track.KeyCount;
+
+			if (track.Kind == TrackKind::Rotation)
+			{
+				UnpackRotation(values + 3 * key, result);
+
+				return;
+			}
+
+			int components = track.Kind == TrackKind::Float ? 1 : 3;
+
+			values += components * key;
+
+			for (int i = 0; i < 4; ++i)
+				result[i] = i < components ? track.Minimum[i] + float(values[i]) * track.Step[i] : 0;
+		}
+
+		void CompressedAnimationClip::DecodeTangent(const Track &track, unsigned int key, bool outgoing, float *result) const
+		{
+			int components = track.Kind == TrackKind::Float ? 1 : 3;
+			const unsigned short *tangents = Data.data() + track.Offset + track.KeyCount + (outgoing ? 2 : 1) * components * track.KeyCount;
+
+			tangents += components * key;
+
+			for (int i = 0; i < 4; ++i)
+				result[i] = i < components ? track.TangentMinimum[i] + float(tangents[i]) * track.TangentStep[i] : 0;
+		}
+
+		void CompressedAnimationClip::SampleTrack(unsigned int trackIndex, float time, std::vector<unsigned int> &cursors, float *result) const
+		{
+			const Track &track = Tracks[trackIndex];
+
+			if (track.Encoding == TrackEncoding::Constant)
+			{
+				std::copy(track.Minimum, track.Minimum + 4, result);
+
+				return;
+			}
+
+			if (track.Encoding == TrackEncoding::Spline)
+			{
+				SampleSpline(track, time, result);
+
+				return;
+			}
+
+			Segment segment = Locate(trackIndex, time, cursors);
+
+			Decode(track, segment.From, result);
+
+			if (segment.From == segment.To || track.Type == AnimationInterpolationType::Const)
+				return;
+
+			float from[4];
+			float to[4];
+			float t = segment.T;
+
+			std::copy(result, result + 4, from);
+
+			Decode(track, segment.To, to);
+
+			if (!track.HasTangents)
+			{
+				for (int i = 0; i < 4; ++i)
+					result[i] = from[i] * (1 - t) + to[i] * t;
+
+				return;
+			}
+
+			float outgoing[4];
+			float incoming[4];
+			float t2 = t * t;
+			float t3 = t2 * t;
+			const float weights[4] = { 2 * t3 - 3 * t2 + 1, t3 - 2 * t2 + t, 3 * t2 - 2 * t3, t3 - t2 };
+
+			DecodeTangent(track, segment.From, true, outgoing);
+			DecodeTangent(track, segment.To, false, incoming);
+
+			for (int i = 0; i < 4; ++i)
+				result[i] = from[i] * weights[0] + outgoing[i] * weights[1] + to[i] * weights[2] + incoming[i] * weights[3];
+		}
+
+		void CompressedAnimationClip::SampleSpline(const Track &track, float time, float *result) const
+		{
+			int components = track.Kind == TrackKind::Float ? 1 : track.Kind == TrackKind::Vector ? 3 : 4;
+			float weights[4];
+			unsigned int span = AnimationSampler::GetSplineWeights(track.KeyCount, track.Start, track.End, time, weights);
+			const unsigned short *points = Data.data() + track.Offset;
+
+			// the weights add up to 1, so the range offset can be added once
+			for (int j = 0; j < 4; ++j)
+				result[j] = j < components ? track.Minimum[j] : 0;
+
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				const unsigned short *point = points + components * std::min(span + i, track.KeyCount - 1);
+
+				for (int j = 0; j < components; ++j)
+					result[j] += weights[i] * float(point[j]) * track.Step[j];
+			}
+
+			if (track.Kind == TrackKind::Rotation)
+				Normalize(result);
+		}
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <VulkanGraphics/Scene/AnimationSampler.h>
+
+namespace Engine
+{
+	namespace Graphics
+	{
+		// a clip compiled for playback. rotation keys are smallest-three quaternions packed in 48 bits, every other key
+		// and every spline control point is a 16 bit fraction of its track's range, and tracks that never change keep
+		// one full precision value. the keys of all tracks share one allocation and are decoded as they're sampled
+		class CompressedAnimationClip
+		{
+		public:
+			struct Instance
+			{
+				const CompressedAnimationClip *Clip = nullptr;
+				float Time = 0;
+				AnimationPose *Poses = nullptr;
+				std::vector<unsigned int> Cursors;
+			};
+
+			// errors are the largest seen over the clip, the rotation error is an angle in radians
+			struct Report
+			{
+				size_t Tracks = 0;
+				size_t ConstantTracks = 0;
+				size_t Keys = 0;
+				size_t SourceBytes = 0;
+				size_t CompressedBytes = 0;
+				float MaxTranslationError = 0;
+				float MaxRotationError = 0;
+				float MaxScaleError = 0;
+			};
+
+			CompressedAnimationClip(const ModelPackageAnimation &animation);
+			CompressedAnimationClip(const AnimationSampler &sampler);
+
+			const std::string &GetName() const { return Name; }
+			float GetDuration() const { return Duration; }
+			AnimationCycleType GetCycleType() const { return CycleType; }
+			size_t GetNodeCount() const { return Nodes.size(); }
+			const std::string &GetNodeName(size_t node) const { return Nodes[node].Name; }
+			size_t GetNodeIndex(const std::string &name) const;
+
+			// bytes held by the clip, names included
+			size_t GetSize() const;
+
+			float GetClipTime(float time) const;
+
+			void ResetCursors(std::vector<unsigned int> &cursors) const;
+
+			// same contract as AnimationSampler::Sample
+			void Sample(float time, AnimationPose *poses, std::vector<unsigned int> &cursors) const;
+
+			static void Sample(Instance *instances, size_t count);
+
+			// plays the clip next to the uncompressed keys, sampleRate times per second
+			Report Measure(const ModelPackageAnimation &source, float sampleRate = 60) const;
+
+			static size_t GetSourceSize(const ModelPackageAnimation &animation);
+
+		private:
+			static const unsigned int NoTrack = (unsigned int)-1;
+
+			enum class TrackKind : unsigned char
+			{
+				Float,
+				Vector,
+				Rotation
+			};
+
+			enum class TrackEncoding : unsigned char
+			{
+				Constant,
+				Keys,
+				Spline
+			};
+
+			// Offset is in 16 bit words. keys store KeyCount times over [Start, End], then the values, then the in and
+			// out tangents if there are any. splines store KeyCount control points over [Start, End].
+			// constant tracks keep their value in Minimum
+			struct Track
+			{
+				TrackKind Kind = TrackKind::Float;
+				TrackEncoding Encoding = TrackEncoding::Constant;
+				AnimationInterpolationType Type = AnimationInterpolationType::None;
+				bool HasTangents = false;
+				unsigned int KeyCount = 0;
+				unsigned int Offset = 0;
+				float Start = 0;
+				float End = 0;
+				float Minimum[4] = {};
+				float Step[4] = {};
+				float TangentMinimum[4] = {};
+				float TangentStep[4] = {};
+			};
+
+			// Euler holds the x, y and z angle tracks when the rotation is split into axes, axes without keys stay at 0
+			struct Node
+			{
+				std::string Name;
+				bool EulerRotation = false;
+				unsigned int Translation = NoTrack;
+				unsigned int Rotation = NoTrack;
+				unsigned int Scale = NoTrack;
+				unsigned int Euler[3] = { NoTrack, NoTrack, NoTrack };
+			};
+
+			struct Segment
+			{
+				unsigned int From = 0;
+				unsigned int To = 0;
+				float T = 0;
+			};
+
+			std::string Name;
+			float Duration = 0;
+			float PlaybackSpeed = 1;
+			AnimationCycleType CycleType = AnimationCycleType::Clamp;
+			std::vector<Node> Nodes;
+			std::unordered_map<std::string, size_t> NodeIndices;
+			std::vector<Track> Tracks;
+			std::vector<unsigned short> Data;
+
+			void Compile(const AnimationSampler &sampler);
+			unsigned int AddKeyTrack(const AnimationSampler &sampler, unsigned int trackIndex, TrackKind kind);
+			unsigned int AddSplineTrack(const AnimationSampler &sampler, unsigned int trackIndex, TrackKind kind);
+
+			Segment Locate(unsigned int trackIndex, float time, std::vector<unsigned int> &cursors) const;
+			void Decode(const Track &track, unsigned int key, float *result) const;
+			void DecodeTangent(const Track &track, unsigned int key, bool outgoing, float *result) const;
+			void SampleTrack(unsigned int trackIndex, float time, std::vector<unsigned int> &cursors, float *result) const;
+			void SampleSpline(const Track &track, float time, float *result) const;
+		};
+	}
+}
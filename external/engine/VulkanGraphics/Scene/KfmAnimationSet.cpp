@@ -0,0 +1,161 @@
+#include "KfmAnimationSet.h"
+
+#include <iostream>
+
+#include <VulkanGraphics/FileFormats/NifParser.h>
+
+namespace Engine
+{
+	namespace Graphics
+	{
+		KfmAnimationSet::KfmAnimationSet(const KfmDocument &document, const FileReader &reader) : Document(document), Reader(reader)
+		{
+			for (size_t i = 0; i < Document.Animations.size(); ++i)
+				AnimationIndices[Document.Animations[i].Id] = i;
+		}
+
+		const KfmAnimation *KfmAnimationSet::GetAnimation(unsigned int id) const
+		{
+			auto index = AnimationIndices.find(id);
+
+			if (index == AnimationIndices.end())
+				return nullptr;
+
+			return &Document.Animations[index->second];
+		}
+
+		KfmAnimationSet::ClipHandle KfmAnimationSet::GetSequence(unsigned int id)
+		{
+			const KfmAnimation *animation = GetAnimation(id);
+
+			if (animation == nullptr)
+				return nullptr;
+
+			{
+				std::lock_guard<std::mutex> guard(Lock);
+
+				auto loaded = Loaded.find(id);
+
+				if (loaded != Loaded.end())
+					return loaded->second;
+
+				if (Failed.count(id) != 0)
+					return nullptr;
+			}
+
+			// parsing happens outside the lock, if two threads race for the same sequence the first one in wins
+			ClipHandle clip = LoadSequence(*animation);
+
+			std::lock_guard<std::mutex> guard(Lock);
+
+			if (clip == nullptr)
+			{
+				Failed.insert(id);
+
+				return nullptr;
+			}
+
+			return Loaded.emplace(id, clip).first->second;
+		}
+
+		const KfmMapTransition *KfmAnimationSet::BeginTransition(unsigned int fromId, unsigned int toId)
+		{
+			const KfmAnimation *animation = GetAnimation(fromId);
+
+			if (animation == nullptr)
+				return nullptr;
+
+			for (const KfmMapTransition &transition : animation->MapTransitions)
+			{
+				if (transition.TargetSequenceId != toId)
+					continue;
+
+				GetSequence(fromId);
+				GetSequence(toId);
+
+				for (const ChainInfo &chain : transition.ChainInfos)
+					GetSequence(chain.SequenceId);
+
+				return &transition;
+			}
+
+			return nullptr;
+		}
+
+		bool KfmAnimationSet::IsLoaded(unsigned int id) const
+		{
+			std::lock_guard<std::mutex> guard(Lock);
+
+			return Loaded.count(id) != 0;
+		}
+
+		size_t KfmAnimationSet::GetLoadedCount() const
+		{
+			std::lock_guard<std::mutex> guard(Lock);
+
+			return Loaded.size();
+		}
+
+		size_t KfmAnimationSet::GetMemoryUsage() const
+		{
+			std::lock_guard<std::mutex> guard(Lock);
+
+			size_t size = 0;
+
+			for (const auto &loaded : Loaded)
+				size += loaded.second->GetSize();
+
+			return size;
+		}
+
+		// the parsed package only lives long enough to be compressed
+		KfmAnimationSet::ClipHandle KfmAnimationSet::LoadSequence(const KfmAnimation &animation) const
+		{
+			std::string contents;
+
+			if (!Reader(animation.Path, contents))
+			{
+				std::cout << "failed to read kf file " << animation.Path << std::endl;
+
+				return nullptr;
+			}
+
+			ModelPackage package;
+			NifParser parser;
+
+			parser.Package = &package;
+
+			try
+			{
+				parser.Parse(std::string_view(contents));
+			}
+			catch (...)
+			{
+				std::cout << "failed to parse kf file " << animation.Path << std::endl;
+
+				return nullptr;
+			}
+
+			if (package.Animations.empty())
+			{
+				std::cout << "kf file " << animation.Path << " has no sequences" << std::endl;
+
+				return nullptr;
+			}
+
+			const ModelPackageAnimation *sequence = &package.Animations[0];
+
+			for (const ModelPackageAnimation &candidate : package.Animations)
+			{
+				if (candidate.Name == animation.Name)
+				{
+					sequence = &candidate;
+
+					break;
+				}
+			}
+
+			return std::make_shared<const CompressedAnimationClip>(*sequence);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <VulkanGraphics/FileFormats/KfmParser.h>
+#include <VulkanGraphics/Scene/CompressedAnimation.h>
+
+namespace Engine
+{
+	namespace Graphics
+	{
+		// the sequences a kfm refers to. each .kf is read, parsed and compressed the first time something plays it or
+		// transitions into it, after that only the compressed clip is kept.
+		// the viewer doesn't use it yet: it places models from their nifs alone and plays the animation embedded there
+		class KfmAnimationSet
+		{
+		public:
+			// reads a path as written in the kfm, returns false if it can't
+			typedef std::function<bool(const std::string &path, std::string &contents)> FileReader;
+			typedef std::shared_ptr<const CompressedAnimationClip> ClipHandle;
+
+			KfmAnimationSet(const KfmDocument &document, const FileReader &reader);
+
+			const KfmDocument &GetDocument() const { return Document; }
+			const KfmAnimation *GetAnimation(unsigned int id) const;
+
+			// null if there's no such sequence or its file didn't load, failures aren't retried
+			ClipHandle GetSequence(unsigned int id);
+
+			// loads the target and every sequence a chain passes through. null if the kfm has no such transition
+			const KfmMapTransition *BeginTransition(unsigned int fromId, unsigned int toId);
+
+			bool IsLoaded(unsigned int id) const;
+			size_t GetLoadedCount() const;
+			size_t GetMemoryUsage() const;
+
+		private:
+			KfmDocument Document;
+			FileReader Reader;
+			std::unordered_map<unsigned int, size_t> AnimationIndices;
+
+			mutable std::mutex Lock;
+			std::unordered_map<unsigned int, ClipHandle> Loaded;
+			std::unordered_set<unsigned int> Failed;
+
+			ClipHandle LoadSequence(const KfmAnimation &animation) const;
+		};
+	}
+}
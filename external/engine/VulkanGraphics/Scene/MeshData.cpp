@@ -221,42 +221,45 @@ namespace Engine
 				WriteAttribute(source, destination, index->second, element);
 		}
 
-		std::shared_ptr<MeshFormat> MeshFormat::GetCachedFormat(unsigned int hash)
+		// the interned format's own attributes against the ones asked for, hashes of different lists can collide
+		static bool SameAttributes(const std::vector<VertexAttributeFormat>& cached, const std::vector<VertexAttributeFormat>& attributes)
 		{
-			auto entry = Cache.find(hash);
+			if (cached.size() != attributes.size())
+				return false;
 
-			if (entry != Cache.end())
-				return entry->second;
+			for (size_t i = 0; i < cached.size(); ++i)
+				if (cached[i].Type != attributes[i].Type || cached[i].ElementCount != attributes[i].ElementCount || cached[i].Binding != attributes[i].Binding || cached[i].Name != attributes[i].Name)
+					return false;
 
-			return nullptr;
+			return true;
 		}
 
-		std::shared_ptr<MeshFormat> MeshFormat::GetCachedFormat(int index)
+		std::shared_ptr<MeshFormat> MeshFormat::GetCachedFormat(unsigned long long hash)
 		{
-			if (index < 0 || index >= CacheVector.size())
-				return nullptr;
+			return Cache.Find(hash);
+		}
 
-			return CacheVector[index];
+		std::shared_ptr<MeshFormat> MeshFormat::GetCachedFormat(int index)
+		{
+			return Cache.At(index);
 		}
 
-		void MeshFormat::CacheFormat(unsigned int& hash, const std::shared_ptr<MeshFormat>& format)
+		std::shared_ptr<MeshFormat> MeshFormat::CacheFormat(unsigned long long hash, const std::shared_ptr<MeshFormat>& format)
 		{
-			Cache[hash] = format;
-			CacheVector.push_back(format);
+			return Cache.Intern(hash, [&format](const MeshFormat& cached) { return SameAttributes(cached.Attributes, format->Attributes); }, [&format](int index)
+			{
+				format->CachedIndex = index;
 
-			format->CachedIndex = CachedFormats;
-			++CachedFormats;
+				return format;
+			});
 		}
 
-		void MeshFormat::CacheFormat(const std::shared_ptr<MeshFormat>& format)
+		std::shared_ptr<MeshFormat> MeshFormat::CacheFormat(const std::shared_ptr<MeshFormat>& format)
 		{
-			unsigned int hash = format->GetHash();
-
-			if (GetCachedFormat(hash) == nullptr)
-				CacheFormat(hash, format);
+			return CacheFormat(format->GetHash(), format);
 		}
 
-		unsigned int MeshFormat::GetHash() const
+		unsigned long long MeshFormat::GetHash() const
 		{
 			const unsigned int offsetBasis = 0x811c9dc5;
 
@@ -264,7 +267,7 @@ namespace Engine
 
 			VertexAttributeFormat::GetHash(hash, Attributes);
 
-			return (unsigned int)hash;
+			return hash;
 		}
 
 		const VertexAttributeFormat* MeshFormat::GetAttribute(const std::string& name) const
@@ -287,25 +290,30 @@ namespace Engine
 
 		std::shared_ptr<MeshFormat> MeshFormat::GetFormat(const std::vector<VertexAttributeFormat>& attributes)
 		{
-			unsigned long long hashLong;
+			const unsigned int offsetBasis = 0x811c9dc5;
+
+			unsigned long long hash = offsetBasis;
+
+			VertexAttributeFormat::GetHash(hash, attributes);
 
-			VertexAttributeFormat::GetHash(hashLong, attributes);
+			auto matches = [&attributes](const MeshFormat& cached) { return SameAttributes(cached.Attributes, attributes); };
 
-			unsigned int hash = (unsigned int)hashLong;
+			std::shared_ptr<MeshFormat> meshFormat = Cache.Find(hash, matches);
 
-			std::shared_ptr<MeshFormat> meshFormat = GetCachedFormat(hash);
+			if (meshFormat != nullptr)
+				return meshFormat;
 
-			if (meshFormat == nullptr)
+			return Cache.Intern(hash, matches, [&attributes](int index)
 			{
-				meshFormat = Engine::Create<MeshFormat>();
+				std::shared_ptr<MeshFormat> format = Engine::Create<MeshFormat>();
 
 				for (size_t i = 0; i < attributes.size(); ++i)
-					meshFormat->Push(attributes[i]);
+					format->Push(attributes[i]);
 
-				CacheFormat(hash, meshFormat);
-			}
+				format->CachedIndex = index;
 
-			return meshFormat;
+				return format;
+			});
 		}
 
 		void MeshData::SetFormat(const std::shared_ptr<MeshFormat>& format)
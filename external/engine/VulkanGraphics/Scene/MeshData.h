@@ -8,6 +8,7 @@
 #include <stdexcept>
 
 #include <Objects/Object.h>
+#include <ConcurrentInternTable.h>
 #include <VulkanGraphics/Core/BufferFormat.h>
 
 namespace Engine
@@ -44,7 +45,7 @@ namespace Engine
 			void Copy(const void *const *source, void **destination, const std::shared_ptr<MeshFormat> &destinationFormat, size_t vertices, size_t offsetCount = 0) const;
 			void WriteAttribute(const void *const *source, void *destination, size_t attribute, size_t element) const;
 			void WriteAttribute(const void *const *source, void *destination, const std::string &attribute, size_t element) const;
-			unsigned int GetHash() const;
+			unsigned long long GetHash() const;
 			int GetCachedIndex() const { return CachedIndex; }
 
 			const std::vector<VertexAttributeFormat> &GetAttributes() const { return Attributes; }
@@ -61,21 +62,18 @@ namespace Engine
 			void ForEach(const void *const *source, size_t attributeIndex, size_t vertices, const std::function<void(const T &)> &callback) const;
 
 			static std::shared_ptr<MeshFormat> GetFormat(const std::vector<VertexAttributeFormat> &attributes);
-			static std::shared_ptr<MeshFormat> GetCachedFormat(unsigned int hash);
+			static std::shared_ptr<MeshFormat> GetCachedFormat(unsigned long long hash);
 			static std::shared_ptr<MeshFormat> GetCachedFormat(int index);
-			static void CacheFormat(unsigned int &hashString, const std::shared_ptr<MeshFormat> &format);
-			static void CacheFormat(const std::shared_ptr<MeshFormat> &format);
+			static std::shared_ptr<MeshFormat> CacheFormat(unsigned long long hash, const std::shared_ptr<MeshFormat> &format);
+			static std::shared_ptr<MeshFormat> CacheFormat(const std::shared_ptr<MeshFormat> &format);
 
 		private:
-			typedef std::map<unsigned int, std::shared_ptr<MeshFormat>> MeshFormatMap;
-			typedef std::vector<std::shared_ptr<MeshFormat>> MeshFormatVector;
+			typedef ConcurrentInternTable<MeshFormat> MeshFormatTable;
 
 			std::vector<VertexAttributeFormat> Attributes;
 			std::map<std::string, size_t> IndexMap;
 
-			static inline MeshFormatMap Cache = MeshFormatMap();
-			static inline MeshFormatVector CacheVector = MeshFormatVector();
-			static inline int CachedFormats = 0;
+			static inline MeshFormatTable Cache;
 
 			size_t Bindings = 0;
 			std::vector<size_t> VertexSizes;
@@ -4,10 +4,12 @@ in vec2 TexCoord;
 in vec3 Normal;
 in vec3 FragPos;
 in vec4 VertexColor;
+flat in float Layer;
 
 out vec4 FragColor;
 
-uniform sampler2D texture1;
+uniform sampler2DArray texture1;
+uniform float alphaThreshold = -1.0; // alpha tested materials drop what's at or below it
 uniform vec3 lightDir = normalize(vec3(1.0, -2.0, 1.0));
 uniform vec3 lightColor = vec3(1.0);
 uniform vec3 ambientColor = vec3(1.0);
@@ -20,7 +22,10 @@ void main()
     vec3 ambient = ambientColor;
 
     vec3 lighting = ambient + diffuse;
-    vec4 texColor = texture(texture1, TexCoord);
+    vec4 texColor = texture(texture1, vec3(TexCoord, Layer));
+
+    if (texColor.a <= alphaThreshold)
+        discard;
 
     FragColor = vec4(texColor.rgb * lighting, texColor.a) * VertexColor;
 }
@@ -4,23 +4,48 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 layout (location = 2) in vec3 aNormal;
 layout (location = 3) in vec4 aColor;
+layout (location = 7) in vec4 aBlendIndices;
+layout (location = 8) in vec4 aBlendWeight;
+layout (location = 9) in float aLayer;
+
+// has to match SkinningSystem::MaxBones
+const int MAX_BONES = 128;
+
+layout (std140) uniform BonePalette
+{
+    mat4 bones[MAX_BONES];
+};
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool skinned = false;
+uniform float layer = 0.0; // merged meshes carry their layers per vertex instead
 
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 FragPos;
 out vec4 VertexColor;
+flat out float Layer;
 
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    mat4 skin = mat4(1.0);
+
+    if (skinned)
+    {
+        skin = aBlendWeight.x * bones[int(aBlendIndices.x)] +
+               aBlendWeight.y * bones[int(aBlendIndices.y)] +
+               aBlendWeight.z * bones[int(aBlendIndices.z)] +
+               aBlendWeight.w * bones[int(aBlendIndices.w)];
+    }
+
+    vec4 worldPos = model * skin * vec4(aPos, 1.0);
     FragPos = worldPos.xyz;
 
     TexCoord = aTexCoord;
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Layer = aLayer + layer;
+    Normal = mat3(transpose(inverse(model * skin))) * aNormal;
 
     VertexColor = aColor / 255.0; // Convert from u8vec4-style to normalized vec4
 
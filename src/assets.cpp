@@ -0,0 +1,915 @@
+#include "assets.h"
+
+#include "collision.h"
+#include "mesh.h"
+#include "meshloader.h"
+#include "simplify.h"
+#include "textureloader.h"
+#include "vfs.h"
+
+#include <Engine/JobSystem.h>
+#include <VulkanGraphics/FileFormats/NifParser.h>
+#include <VulkanGraphics/Scene/MeshData.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Mesh::Draw refuses anything bigger
+static const size_t MaxIndexCount = 10000;
+
+// every level has about half the triangles of the one before, the full mesh included there are at most this many
+static const size_t MaxLodCount = 4;
+static const size_t MinLodIndexCount = 3 * 16;
+
+static const std::string LodCacheDirectory = "resources/lods";
+static const char LodCacheMagic[4] = {'L', 'O', 'D', 'S'};
+static const uint32_t LodCacheVersion = 1;
+
+// the vertices and indices of every package node, empty for nodes with nothing to draw. the indices of a node's lods
+// follow its full mesh
+struct Geometry
+{
+    std::vector<std::vector<Mesh::Vertex>> vertices;
+    std::vector<std::vector<unsigned int>> indices;
+    std::vector<std::vector<Mesh::Lod>> lods;
+};
+
+// what a job reads off the GL thread, its log is printed once FinishLoads takes it
+struct AssetCache::Load
+{
+    Engine::JobCounter counter;
+    bool texture = false;
+    std::ostringstream log;
+
+    std::unique_ptr<Engine::Graphics::ModelPackage> package;
+    Geometry geometry;
+    std::vector<glm::vec3> collisionVertices;
+    ClipHandle clip;
+    Engine::Graphics::CompressedAnimationClip::Report clipReport;
+    size_t fileSize = 0;
+    size_t scratchBytes = 0; // what the load added to the cache's scratchBytes
+
+    DDSImage image;
+    bool loaded = false;
+};
+
+static std::unique_ptr<Engine::Graphics::ModelPackage> ParseModel(const std::string &path, std::ostream &log, size_t &fileSize)
+{
+    // stored archive entries are parsed where they're mapped, everything else is read into buffer
+    std::string buffer;
+    std::string_view view;
+
+    if (!FileSystem::View(path, view))
+    {
+        if (!FileSystem::Read(path, buffer))
+        {
+            log << "[WARN] Could not open NIF: " << path << "\n";
+            return nullptr;
+        }
+
+        view = buffer;
+    }
+
+    if (view.empty())
+    {
+        log << "[ERROR] NIF file is zero-length or unreadable: " << path << "\n";
+        return nullptr;
+    }
+    else if (view.size() < 64)
+    {
+        log << "[WARN] NIF file is suspiciously small (" << view.size() << " bytes): " << path << "\n";
+    }
+
+    const std::string expectedMagic = "Gamebryo File Format";
+    if (view.size() < expectedMagic.size() || view.substr(0, expectedMagic.size()) != expectedMagic)
+    {
+        log << "[ERROR] Invalid NIF magic header: " << path << "\n";
+        return nullptr;
+    }
+
+    auto package = std::make_unique<Engine::Graphics::ModelPackage>();
+    NifParser parser;
+    parser.Package = package.get();
+
+    // try-catch block to not die from 1 bad nif. packages are made and freed on any thread, the object pools they live
+    // in take their own lock
+    try
+    {
+        parser.Parse(view);
+    }
+    catch (const std::exception &e)
+    {
+        log << "[ERROR] Exception while parsing NIF: " << path << "\n";
+        log << "Reason: " << e.what() << "\n";
+        return nullptr;
+    }
+
+    fileSize = view.size();
+
+    return package;
+}
+
+static bool IsDrawable(const Engine::Graphics::ModelPackageNode &node)
+{
+    return node.Mesh && node.Mesh->GetVertices() > 0 && node.Mesh->GetFormat()->GetAttribute("texcoord");
+}
+
+static size_t GetMeshSize(const Mesh &mesh)
+{
+    return mesh.vertexCount * sizeof(Mesh::Vertex) + mesh.GetBufferIndexCount() * sizeof(unsigned int);
+}
+
+static void BuildGeometry(const Engine::Graphics::ModelPackage &package, const std::string &path, Geometry &geometry, std::ostream &log)
+{
+    const auto &nodes = package.Nodes;
+    geometry.vertices.assign(nodes.size(), {});
+    geometry.indices.assign(nodes.size(), {});
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        if (!nodes[i].Mesh || nodes[i].Mesh->GetVertices() == 0)
+            continue;
+
+        if (!IsDrawable(nodes[i]))
+        {
+            log << "[WARN] Skipping mesh without texcoord: " << path << "\n";
+            continue;
+        }
+
+        std::vector<unsigned int> &indices = geometry.indices[i];
+
+        if (!MeshLoader::BuildVertices(nodes[i], geometry.vertices[i], indices, log) || indices.size() > MaxIndexCount || indices.empty())
+        {
+            log << "[ERROR] Invalid mesh indexCount: " << indices.size() << " in " << path << "\n";
+            geometry.vertices[i].clear();
+            indices.clear();
+        }
+    }
+}
+
+template <typename T>
+static size_t GetVectorBytes(const std::vector<T> &values)
+{
+    return values.size() * sizeof(T);
+}
+
+static size_t GetMeshDataBytes(const std::shared_ptr<Engine::Graphics::MeshData> &mesh)
+{
+    if (!mesh)
+        return 0;
+
+    size_t bytes = mesh->GetIndices() * sizeof(int);
+
+    for (size_t binding = 0; binding < mesh->GetBindingCount(); ++binding)
+        bytes += mesh->GetTotalSize(binding);
+
+    return bytes;
+}
+
+// an estimate, names and transforms aren't counted and mesh data two nodes share is counted twice
+static size_t GetPackageBytes(const Engine::Graphics::ModelPackage &package)
+{
+    size_t bytes = sizeof(package) + GetVectorBytes(package.Bones) + GetVectorBytes(package.Nodes) + GetVectorBytes(package.Materials) +
+                   GetVectorBytes(package.Animations);
+
+    for (const auto &node : package.Nodes)
+        bytes += GetVectorBytes(node.Bones) + GetVectorBytes(node.BoneOffsets) + GetMeshDataBytes(node.Mesh);
+
+    for (const auto &animation : package.Animations)
+    {
+        bytes += GetVectorBytes(animation.Nodes) + GetVectorBytes(animation.Events);
+
+        for (const auto &node : animation.Nodes)
+            bytes += GetVectorBytes(node.Rotation.Keyframes) + GetVectorBytes(node.Translation.Keyframes) + GetVectorBytes(node.Scale.Keyframes) +
+                     GetVectorBytes(node.EulerRotation.X.Keyframes) + GetVectorBytes(node.EulerRotation.Y.Keyframes) +
+                     GetVectorBytes(node.EulerRotation.Z.Keyframes) + GetVectorBytes(node.TranslationSpline.ControlPoints) +
+                     GetVectorBytes(node.RotationSpline.ControlPoints) + GetVectorBytes(node.ScaleSpline.ControlPoints);
+    }
+
+    for (const auto &prop : package.PhysXProps)
+        for (const auto &actor : prop.Actors)
+            for (const auto &mesh : actor.Meshes)
+                bytes += sizeof(mesh) + GetMeshDataBytes(mesh.Mesh);
+
+    return bytes;
+}
+
+static size_t GetGeometryBytes(const Geometry &geometry)
+{
+    size_t bytes = 0;
+
+    for (size_t node = 0; node < geometry.indices.size(); ++node)
+    {
+        bytes += GetVectorBytes(geometry.vertices[node]) + GetVectorBytes(geometry.indices[node]);
+
+        if (node < geometry.lods.size())
+            bytes += GetVectorBytes(geometry.lods[node]);
+    }
+
+    return bytes;
+}
+
+// skinning only plays the first animation of skinned models. it's compiled once per model, the skeletons of every
+// entity placing the model share it
+static void CompileClip(const Engine::Graphics::ModelPackage &package, AssetCache::ClipHandle &clip,
+                        Engine::Graphics::CompressedAnimationClip::Report &report)
+{
+    bool skinned = std::any_of(package.Nodes.begin(), package.Nodes.end(), [](const auto &node) { return !node.Bones.empty(); });
+
+    if (!skinned || package.Animations.empty())
+    {
+        clip.reset();
+        report = {};
+
+        return;
+    }
+
+    auto compiled = std::make_shared<Engine::Graphics::CompressedAnimationClip>(package.Animations[0]);
+
+    report = compiled->Measure(package.Animations[0]);
+    clip = std::move(compiled);
+}
+
+// once the meshes and the clip are built from the package, keeps what placing objects needs: the node tree, skins and
+// materials for every node. the collision triangles are taken out before the PhysX data goes. returns the bytes freed
+static size_t CompactPackage(Engine::Graphics::ModelPackage &package, std::vector<glm::vec3> &collisionVertices)
+{
+    size_t before = GetPackageBytes(package);
+
+    collisionVertices = CollisionWorld::GetLocalTriangles(package);
+
+    for (auto &node : package.Nodes)
+    {
+        node.Mesh.reset();
+        node.Format.reset();
+    }
+
+    for (auto &material : package.Materials)
+    {
+        material.DiffuseTexture.reset();
+        material.NormalTexture.reset();
+        material.SpecularTexture.reset();
+        material.OverrideColorTexture.reset();
+        material.GlowTexture.reset();
+        material.DecalTexture.reset();
+        material.AnisotropicTexture.reset();
+        material.Material.reset();
+        material.ShaderGroup.reset();
+    }
+
+    // clear() would keep the capacity around
+    std::vector<Engine::Graphics::ModelPhysXProp>().swap(package.PhysXProps);
+    std::vector<Engine::Graphics::ModelPackageAnimation>().swap(package.Animations);
+
+    return before - std::min(before, GetPackageBytes(package));
+}
+
+// what stays on the CPU after the upload
+static size_t GetModelCpuBytes(const AssetCache::Model &model)
+{
+    size_t bytes = (model.package ? GetPackageBytes(*model.package) : 0) + GetVectorBytes(model.collisionVertices) +
+                   (model.clip ? model.clip->GetSize() : 0);
+
+    for (const Mesh *mesh : model.meshes)
+        if (mesh)
+            bytes += GetVectorBytes(mesh->occluderPositions) + GetVectorBytes(mesh->occluderIndices);
+
+    return bytes;
+}
+
+// each level is simplified from the one before, so their errors add up
+static void AddLods(const std::vector<Mesh::Vertex> &vertices, std::vector<unsigned int> &indices, std::vector<Mesh::Lod> &lods)
+{
+    lods.assign(1, {0, indices.size(), 0.0f});
+
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+
+    for (const Mesh::Vertex &vertex : vertices)
+        positions.push_back(vertex.position);
+
+    std::vector<unsigned int> level(indices);
+    float error = 0.0f;
+
+    while (lods.size() < MaxLodCount && level.size() / 2 >= MinLodIndexCount)
+    {
+        float levelError = 0.0f;
+        std::vector<unsigned int> simplified = SimplifyIndices(positions, level, level.size() / 6 * 3, levelError);
+
+        // a level that hardly shrank isn't worth drawing
+        if (simplified.empty() || simplified.size() > level.size() * 3 / 4)
+            break;
+
+        error += levelError;
+        lods.push_back({indices.size(), simplified.size(), error});
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        level = std::move(simplified);
+    }
+}
+
+static std::string GetLodCachePath(const std::string &path)
+{
+    // FNV-1a, the same model gives the same file name in every build
+    uint64_t hash = 14695981039346656037ull;
+
+    for (char character : path)
+    {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= 1099511628211ull;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.lod", static_cast<unsigned long long>(hash));
+
+    return LodCacheDirectory + "/" + name;
+}
+
+// what the nif looked like when its lods were made, files inside archives only have their size
+static int64_t GetFileTime(const std::string &path)
+{
+    std::error_code error;
+    fs::file_time_type time = fs::last_write_time(path, error);
+
+    return error ? 0 : time.time_since_epoch().count();
+}
+
+static bool ReadLodCache(const std::string &path, size_t fileSize, Geometry &geometry)
+{
+    std::ifstream file(GetLodCachePath(path), std::ios::binary);
+    if (!file)
+        return false;
+
+    char magic[4] = {};
+    uint32_t version = 0;
+    uint64_t size = 0;
+    int64_t time = 0;
+    uint32_t nodeCount = 0;
+
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    file.read(reinterpret_cast<char *>(&size), sizeof(size));
+    file.read(reinterpret_cast<char *>(&time), sizeof(time));
+    file.read(reinterpret_cast<char *>(&nodeCount), sizeof(nodeCount));
+
+    if (!file || memcmp(magic, LodCacheMagic, 4) != 0 || version != LodCacheVersion || size != fileSize || time != GetFileTime(path) ||
+        nodeCount != geometry.indices.size())
+        return false;
+
+    std::vector<std::vector<unsigned int>> indices = geometry.indices;
+    std::vector<std::vector<Mesh::Lod>> lods(nodeCount);
+
+    for (uint32_t node = 0; node < nodeCount; ++node)
+    {
+        uint32_t vertexCount = 0;
+        uint32_t lodCount = 0;
+
+        file.read(reinterpret_cast<char *>(&vertexCount), sizeof(vertexCount));
+        file.read(reinterpret_cast<char *>(&lodCount), sizeof(lodCount));
+
+        if (!file || vertexCount != geometry.vertices[node].size() || lodCount > MaxLodCount)
+            return false;
+
+        if (indices[node].empty())
+            continue;
+
+        lods[node].push_back({0, indices[node].size(), 0.0f});
+
+        for (uint32_t lod = 1; lod < lodCount; ++lod)
+        {
+            float error = 0.0f;
+            uint32_t indexCount = 0;
+
+            file.read(reinterpret_cast<char *>(&error), sizeof(error));
+            file.read(reinterpret_cast<char *>(&indexCount), sizeof(indexCount));
+
+            if (!file || indexCount > geometry.indices[node].size())
+                return false;
+
+            size_t first = indices[node].size();
+            indices[node].resize(first + indexCount);
+            file.read(reinterpret_cast<char *>(indices[node].data() + first), indexCount * sizeof(unsigned int));
+
+            if (!file || std::any_of(indices[node].begin() + first, indices[node].end(), [vertexCount](unsigned int index)
+                                     { return index >= vertexCount; }))
+                return false;
+
+            lods[node].push_back({first, indexCount, error});
+        }
+    }
+
+    geometry.indices = std::move(indices);
+    geometry.lods = std::move(lods);
+
+    return true;
+}
+
+static void WriteLodCache(const std::string &path, size_t fileSize, const Geometry &geometry)
+{
+    std::error_code error;
+    fs::create_directories(LodCacheDirectory, error);
+
+    // a cache that can't be written only means the lods are made again next time
+    std::ofstream file(GetLodCachePath(path), std::ios::binary | std::ios::trunc);
+    if (!file)
+        return;
+
+    uint64_t size = fileSize;
+    int64_t time = GetFileTime(path);
+    uint32_t nodeCount = static_cast<uint32_t>(geometry.indices.size());
+
+    file.write(LodCacheMagic, 4);
+    file.write(reinterpret_cast<const char *>(&LodCacheVersion), sizeof(LodCacheVersion));
+    file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char *>(&time), sizeof(time));
+    file.write(reinterpret_cast<const char *>(&nodeCount), sizeof(nodeCount));
+
+    for (uint32_t node = 0; node < nodeCount; ++node)
+    {
+        uint32_t vertexCount = static_cast<uint32_t>(geometry.vertices[node].size());
+        uint32_t lodCount = static_cast<uint32_t>(geometry.lods[node].size());
+
+        file.write(reinterpret_cast<const char *>(&vertexCount), sizeof(vertexCount));
+        file.write(reinterpret_cast<const char *>(&lodCount), sizeof(lodCount));
+
+        for (uint32_t lod = 1; lod < lodCount; ++lod)
+        {
+            const Mesh::Lod &level = geometry.lods[node][lod];
+            uint32_t indexCount = static_cast<uint32_t>(level.indexCount);
+
+            file.write(reinterpret_cast<const char *>(&level.error), sizeof(level.error));
+            file.write(reinterpret_cast<const char *>(&indexCount), sizeof(indexCount));
+            file.write(reinterpret_cast<const char *>(geometry.indices[node].data() + level.firstIndex), indexCount * sizeof(unsigned int));
+        }
+    }
+}
+
+// off the GL thread, after BuildGeometry
+static void BuildLods(Geometry &geometry, const std::string &path, size_t fileSize)
+{
+    if (ReadLodCache(path, fileSize, geometry))
+        return;
+
+    geometry.lods.assign(geometry.indices.size(), {});
+
+    for (size_t node = 0; node < geometry.indices.size(); ++node)
+        if (!geometry.indices[node].empty())
+            AddLods(geometry.vertices[node], geometry.indices[node], geometry.lods[node]);
+
+    WriteLodCache(path, fileSize, geometry);
+}
+
+// on the GL thread
+static void CreateMeshes(AssetCache::Model &model, const Geometry &geometry)
+{
+    model.meshes.assign(model.package->Nodes.size(), nullptr);
+    model.gpuBytes = 0;
+
+    for (size_t i = 0; i < model.meshes.size() && i < geometry.indices.size(); ++i)
+    {
+        if (geometry.indices[i].empty())
+            continue;
+
+        model.meshes[i] = new Mesh(geometry.vertices[i], geometry.indices[i], i < geometry.lods.size() ? geometry.lods[i] : std::vector<Mesh::Lod>());
+        model.gpuBytes += GetMeshSize(*model.meshes[i]);
+    }
+}
+
+// the loads are only complete in here
+AssetCache::AssetCache() = default;
+
+AssetCache::~AssetCache()
+{
+    // the jobs write into the loads, none of them can be left running
+    for (auto &load : loads)
+        Engine::JobSystem::Wait(load.second->counter);
+}
+
+void AssetCache::AcquireModel(const std::string &path)
+{
+    std::string key = GetKey(path);
+    auto cached = models.find(key);
+
+    if (cached == models.end())
+    {
+        cached = models.emplace(key, Model()).first;
+        cached->second.loading = true;
+
+        StartLoad(key, false);
+    }
+
+    ++cached->second.references;
+}
+
+void AssetCache::ReleaseModel(const std::string &path)
+{
+    auto cached = models.find(GetKey(path));
+
+    if (cached != models.end() && cached->second.references > 0)
+        --cached->second.references;
+}
+
+void AssetCache::AcquireTexture(const std::string &path)
+{
+    std::string key = GetKey(path);
+    auto cached = textures.find(key);
+
+    if (cached == textures.end())
+    {
+        cached = textures.emplace(key, Texture()).first;
+        cached->second.loading = true;
+
+        StartLoad(key, true);
+    }
+
+    ++cached->second.references;
+}
+
+void AssetCache::ReleaseTexture(const std::string &path)
+{
+    auto cached = textures.find(GetKey(path));
+
+    if (cached != textures.end() && cached->second.references > 0)
+        --cached->second.references;
+}
+
+bool AssetCache::IsLoading(const std::string &path) const
+{
+    return loads.count(GetKey(path)) > 0;
+}
+
+const AssetCache::Model *AssetCache::FindModel(const std::string &path) const
+{
+    auto cached = models.find(GetKey(path));
+
+    if (cached == models.end() || cached->second.loading || !cached->second.package)
+        return nullptr;
+
+    return &cached->second;
+}
+
+TextureLayer AssetCache::FindTexture(const std::string &path) const
+{
+    auto cached = textures.find(GetKey(path));
+
+    return cached == textures.end() || cached->second.loading ? TextureLayer() : cached->second.layer;
+}
+
+// the jobs only read files and parse them, meshes and textures are made here on the GL thread
+size_t AssetCache::FinishLoads()
+{
+    size_t finished = 0;
+
+    for (auto load = loads.begin(); load != loads.end();)
+    {
+        Load &done = *load->second;
+
+        if (!done.counter.IsDone())
+        {
+            ++load;
+            continue;
+        }
+
+        std::string log = done.log.str();
+        if (!log.empty())
+            std::cerr << log;
+
+        if (done.texture)
+        {
+            Texture &texture = textures[load->first];
+
+            if (done.loaded)
+                texture.layer = texturePool.Add(done.image);
+
+            if (texture.layer.array == 0)
+                std::cerr << "[WARN] Failed to load texture: " << load->first << "\n";
+
+            texture.loading = false;
+        }
+        else
+        {
+            Model &model = models[load->first];
+
+            scratchBytes -= done.scratchBytes;
+
+            if (done.package)
+            {
+                model.package = std::move(done.package);
+                model.collisionVertices = std::move(done.collisionVertices);
+                model.clip = std::move(done.clip);
+                model.clipReport = done.clipReport;
+                CreateMeshes(model, done.geometry);
+                model.cpuBytes = GetModelCpuBytes(model);
+
+                cpuBytes += model.cpuBytes;
+                gpuBytes += model.gpuBytes;
+            }
+
+            model.loading = false;
+        }
+
+        load = loads.erase(load);
+        ++finished;
+    }
+
+    return finished;
+}
+
+size_t AssetCache::Trim()
+{
+    size_t freed = 0;
+
+    for (auto model = models.begin(); model != models.end();)
+    {
+        if (model->second.references > 0 || model->second.loading)
+        {
+            ++model;
+            continue;
+        }
+
+        FreeModel(model->second);
+        model = models.erase(model);
+        ++freed;
+    }
+
+    for (auto texture = textures.begin(); texture != textures.end();)
+    {
+        if (texture->second.references > 0 || texture->second.loading)
+        {
+            ++texture;
+            continue;
+        }
+
+        texturePool.Remove(texture->second.layer);
+        texture = textures.erase(texture);
+        ++freed;
+    }
+
+    freedCount += freed;
+
+    return freed;
+}
+
+size_t AssetCache::Reload(const std::vector<std::string> &paths)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t reloaded = 0;
+
+    for (const std::string &path : paths)
+    {
+        std::string key = GetKey(path);
+
+        // a load that's still running might have read the old file, but there's nothing to put the new one into yet
+        if (loads.count(key) > 0)
+            continue;
+
+        auto model = models.find(key);
+        if (model != models.end())
+        {
+            reloaded += ReloadModel(key, model->second);
+            continue;
+        }
+
+        auto texture = textures.find(key);
+        DDSImage image;
+
+        if (texture == textures.end() || !ReadDDSFile(key, image))
+            continue;
+
+        // a texture that failed before or changed its format or size gets another layer, the world picks it up by the
+        // reload count
+        TextureLayer &layer = texture->second.layer;
+
+        if (layer.array == 0)
+            layer = texturePool.Add(image);
+        else
+            texturePool.Replace(layer, image);
+
+        reloaded += layer.array != 0;
+    }
+
+    reloadCount += reloaded;
+
+    if (reloaded > 0)
+    {
+        float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[Assets] Reloaded " << reloaded << " of " << paths.size() << " changed files in " << milliseconds << " ms\n";
+    }
+
+    return reloaded;
+}
+
+void AssetCache::Release()
+{
+    for (auto &load : loads)
+        Engine::JobSystem::Wait(load.second->counter);
+
+    loads.clear();
+    scratchBytes = 0;
+
+    for (auto &model : models)
+        FreeModel(model.second);
+
+    texturePool.Release();
+
+    models.clear();
+    textures.clear();
+
+    cpuBytes = 0;
+    gpuBytes = 0;
+}
+
+void AssetCache::StartLoad(const std::string &key, bool texture)
+{
+    Load *load = new Load();
+    load->texture = texture;
+    loads[key].reset(load);
+
+    Engine::JobSystem::Schedule([this, load, key]()
+                                {
+        if (load->texture)
+        {
+            load->loaded = ReadDDSFile(key, load->image, load->log);
+            return;
+        }
+
+        load->package = ParseModel(key, load->log, load->fileSize);
+
+        if (!load->package)
+            return;
+
+        load->scratchBytes = GetPackageBytes(*load->package);
+        scratchBytes += load->scratchBytes;
+
+        BuildGeometry(*load->package, key, load->geometry, load->log);
+        BuildLods(load->geometry, key, load->fileSize);
+        CompileClip(*load->package, load->clip, load->clipReport);
+
+        // the geometry waits for the upload, most of the package isn't needed anymore. it's freed right here on the
+        // worker, the object pools lock and everything else it drops is reference counted
+        size_t geometryBytes = GetGeometryBytes(load->geometry);
+        size_t dropped = CompactPackage(*load->package, load->collisionVertices);
+
+        load->scratchBytes = load->scratchBytes + geometryBytes - dropped;
+        scratchBytes += geometryBytes;
+        scratchBytes -= dropped;
+        droppedBytes += dropped; },
+                                load->counter);
+}
+
+void AssetCache::FreeModel(Model &model)
+{
+    for (Mesh *mesh : model.meshes)
+        delete mesh;
+
+    cpuBytes -= model.cpuBytes;
+    gpuBytes -= model.gpuBytes;
+
+    model.meshes.clear();
+    model.package.reset();
+    model.clip.reset();
+    std::vector<glm::vec3>().swap(model.collisionVertices);
+    model.cpuBytes = 0;
+    model.gpuBytes = 0;
+}
+
+// the new data goes into the meshes that exist, nodes are matched by index. a model that gained meshes needs its cells
+// loaded again for objects to be placed for them
+bool AssetCache::ReloadModel(const std::string &path, Model &model)
+{
+    size_t fileSize = 0;
+    std::unique_ptr<Engine::Graphics::ModelPackage> package = ParseModel(path, std::cerr, fileSize);
+
+    if (!package)
+        return false;
+
+    // it didn't parse the first time, nothing uses it yet
+    if (!model.package)
+    {
+        Geometry geometry;
+        BuildGeometry(*package, path, geometry, std::cerr);
+        BuildLods(geometry, path, fileSize);
+        CompileClip(*package, model.clip, model.clipReport);
+
+        droppedBytes += CompactPackage(*package, model.collisionVertices);
+        model.package = std::move(package);
+        CreateMeshes(model, geometry);
+        model.cpuBytes = GetModelCpuBytes(model);
+
+        cpuBytes += model.cpuBytes;
+        gpuBytes += model.gpuBytes;
+
+        std::cout << "[Assets] Loaded " << path << ", it shows up once the cells using it load again\n";
+
+        return true;
+    }
+
+    const auto &nodes = package->Nodes;
+    std::vector<Mesh::Vertex> vertices;
+    std::vector<unsigned int> indices;
+    size_t updated = 0;
+    size_t added = 0;
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        Mesh *mesh = i < model.meshes.size() ? model.meshes[i] : nullptr;
+
+        if (!IsDrawable(nodes[i]))
+            continue;
+
+        // the old package has no mesh data left to tell, a drawable node without a mesh counts as new
+        if (!mesh)
+        {
+            ++added;
+            continue;
+        }
+
+        // a mesh that doesn't load anymore keeps what it had
+        if (!MeshLoader::BuildVertices(nodes[i], vertices, indices) || indices.empty() || indices.size() > MaxIndexCount)
+        {
+            std::cerr << "[Assets] Keeping the old " << nodes[i].Name << " of " << path << ", the new one didn't load\n";
+            continue;
+        }
+
+        std::vector<Mesh::Lod> lods;
+        AddLods(vertices, indices, lods);
+
+        mesh->Upload(vertices, indices, lods);
+        ++updated;
+    }
+
+    gpuBytes -= model.gpuBytes;
+    model.gpuBytes = 0;
+
+    for (Mesh *mesh : model.meshes)
+        if (mesh)
+            model.gpuBytes += GetMeshSize(*mesh);
+
+    gpuBytes += model.gpuBytes;
+
+    if (added > 0 || nodes.size() != model.meshes.size())
+        std::cerr << "[Assets] " << path << " changed its node layout, its cells have to load again to show all of it\n";
+
+    if (model.meshes.size() < nodes.size())
+        model.meshes.resize(nodes.size(), nullptr);
+
+    // skeletons made before keep playing the old clip until their cells load again
+    cpuBytes -= model.cpuBytes;
+    CompileClip(*package, model.clip, model.clipReport);
+    droppedBytes += CompactPackage(*package, model.collisionVertices);
+    model.package = std::move(package);
+    model.cpuBytes = GetModelCpuBytes(model);
+    cpuBytes += model.cpuBytes;
+
+    std::cout << "[Assets] Reloaded " << path << ", " << updated << " meshes updated\n";
+
+    return true;
+}
+
+AssetCache::MemoryStats AssetCache::GetMemoryStats() const
+{
+    MemoryStats stats;
+
+    stats.parserScratch = scratchBytes;
+    stats.cpuMeshes = cpuBytes;
+    stats.gpuBuffers = gpuBytes;
+    stats.textures = texturePool.GetAllocatedBytes();
+    stats.dropped = droppedBytes;
+
+    return stats;
+}
+
+Engine::Graphics::CompressedAnimationClip::Report AssetCache::GetClipReport() const
+{
+    Engine::Graphics::CompressedAnimationClip::Report total;
+
+    for (const auto &model : models)
+    {
+        if (!model.second.clip)
+            continue;
+
+        const auto &report = model.second.clipReport;
+
+        total.Tracks += report.Tracks;
+        total.ConstantTracks += report.ConstantTracks;
+        total.Keys += report.Keys;
+        total.SourceBytes += report.SourceBytes;
+        total.CompressedBytes += report.CompressedBytes;
+        total.MaxTranslationError = std::max(total.MaxTranslationError, report.MaxTranslationError);
+        total.MaxRotationError = std::max(total.MaxRotationError, report.MaxRotationError);
+        total.MaxScaleError = std::max(total.MaxScaleError, report.MaxScaleError);
+    }
+
+    return total;
+}
+
+std::string AssetCache::GetKey(const std::string &path)
+{
+    return fs::absolute(path).lexically_normal().generic_string();
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <VulkanGraphics/FileFormats/PackageNodes.h>
+#include <VulkanGraphics/Scene/CompressedAnimation.h>
+
+#include "texturepool.h"
+
+class Mesh;
+
+// Meshes and textures shared by every scene object that uses them. Each nif is parsed once and each texture uploaded
+// once. Reloading a file puts its new data into the GL objects that are already there, so every object drawing them
+// changes without the scene being touched.
+//
+// Files are read and parsed on the job system, FinishLoads uploads what's done on the GL thread. Everything is counted
+// by who acquired it, Trim frees what nobody holds anymore. Textures are layers of a TexturePool's arrays.
+//
+// A parsed nif is only kept whole until its meshes, collision triangles and animation clip are built. After that the
+// package is cut down to the node tree, skins and materials, the vertex data lives on the GPU.
+class AssetCache
+{
+public:
+    typedef std::shared_ptr<const Engine::Graphics::CompressedAnimationClip> ClipHandle;
+
+    struct Model
+    {
+        std::unique_ptr<Engine::Graphics::ModelPackage> package; // without mesh data, PhysX data or animations
+        std::vector<Mesh *> meshes;                             // per package node, null for nodes with nothing to draw
+        std::vector<glm::vec3> collisionVertices;               // CollisionWorld::GetLocalTriangles of the full package
+        ClipHandle clip;                                        // the first animation of skinned models, what skinning plays
+        Engine::Graphics::CompressedAnimationClip::Report clipReport; // measured against the source keys before they went
+        size_t cpuBytes = 0;                                    // the package, collision triangles, clip and occluder copies
+        size_t gpuBytes = 0;
+        int references = 0;
+        bool loading = false;
+    };
+
+    // bytes by where they are and what they're for
+    struct MemoryStats
+    {
+        size_t parserScratch = 0; // parsed and not uploaded yet
+        size_t cpuMeshes = 0;     // what the models keep on the CPU after the upload
+        size_t gpuBuffers = 0;    // mesh vertices and indices
+        size_t textures = 0;      // every array the pool allocated, free layers included
+        size_t dropped = 0;       // parser data freed once the meshes were built, since start
+    };
+
+    AssetCache();
+    ~AssetCache();
+
+    AssetCache(const AssetCache &) = delete;
+    AssetCache &operator=(const AssetCache &) = delete;
+
+    // starts loading the file if it isn't there yet
+    void AcquireModel(const std::string &path);
+    void ReleaseModel(const std::string &path);
+    void AcquireTexture(const std::string &path);
+    void ReleaseTexture(const std::string &path);
+
+    // a model or texture that isn't loading anymore is either there or failed, failures are remembered until the file
+    // changes
+    bool IsLoading(const std::string &path) const;
+
+    // null and no array while loading or if the file can't be read
+    const Model *FindModel(const std::string &path) const;
+    TextureLayer FindTexture(const std::string &path) const;
+
+    // uploads the background loads that are done, returns how many that was
+    size_t FinishLoads();
+
+    // frees the models and textures nothing holds anymore, returns how many that was
+    size_t Trim();
+
+    // reloads the files among paths that are in the cache, returns how many that was
+    size_t Reload(const std::vector<std::string> &paths);
+
+    // deletes the GL objects, call it while the context is still alive
+    void Release();
+
+    size_t GetModelCount() const { return models.size(); }
+    size_t GetTextureCount() const { return textures.size(); }
+    size_t GetLoadingCount() const { return loads.size(); }
+    size_t GetReloadCount() const { return reloadCount; }
+    size_t GetFreedCount() const { return freedCount; }
+    size_t GetCpuBytes() const { return cpuBytes; }
+    size_t GetGpuBytes() const { return gpuBytes + texturePool.GetAllocatedBytes(); }
+    const TexturePool &GetTexturePool() const { return texturePool; }
+    MemoryStats GetMemoryStats() const;
+
+    // the clips of every loaded model added up, errors are the worst of any clip
+    Engine::Graphics::CompressedAnimationClip::Report GetClipReport() const;
+
+private:
+    struct Texture
+    {
+        TextureLayer layer;
+        int references = 0;
+        bool loading = false;
+    };
+
+    struct Load;
+
+    std::unordered_map<std::string, Model> models;
+    std::unordered_map<std::string, Texture> textures;
+    std::unordered_map<std::string, std::unique_ptr<Load>> loads;
+    TexturePool texturePool;
+    size_t reloadCount = 0;
+    size_t freedCount = 0;
+    size_t cpuBytes = 0;
+    size_t gpuBytes = 0; // of the meshes, the pool counts the textures
+
+    // the jobs add to these while they parse
+    std::atomic<size_t> scratchBytes{0};
+    std::atomic<size_t> droppedBytes{0};
+
+    void StartLoad(const std::string &key, bool texture);
+    void FreeModel(Model &model);
+    bool ReloadModel(const std::string &path, Model &model);
+    static std::string GetKey(const std::string &path);
+};
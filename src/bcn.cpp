@@ -0,0 +1,336 @@
+#include "bcn.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BCN_SSE2
+#endif
+
+// the AVX2 kernels are compiled for their own target and only picked when the cpu has it, same as SimdMath's
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define BCN_AVX2
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_KERNEL
+#else
+#define AVX2_KERNEL __attribute__((target("avx2")))
+#endif
+#endif
+
+static uint32_t Pack(unsigned int r, unsigned int g, unsigned int b, unsigned int a)
+{
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// the 16 colors of a BC1 block, the color half of BC2 and BC3 blocks always has four colors
+static void DecodeColors(const unsigned char *block, bool fourColors, uint32_t *pixels)
+{
+    unsigned int c0 = block[0] | (block[1] << 8);
+    unsigned int c1 = block[2] | (block[3] << 8);
+
+    unsigned int r0 = ((c0 >> 11) & 31) * 255 / 31, g0 = ((c0 >> 5) & 63) * 255 / 63, b0 = (c0 & 31) * 255 / 31;
+    unsigned int r1 = ((c1 >> 11) & 31) * 255 / 31, g1 = ((c1 >> 5) & 63) * 255 / 63, b1 = (c1 & 31) * 255 / 31;
+
+    uint32_t palette[4];
+    palette[0] = Pack(r0, g0, b0, 255);
+    palette[1] = Pack(r1, g1, b1, 255);
+
+    if (c0 > c1 || fourColors)
+    {
+        palette[2] = Pack((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 255);
+        palette[3] = Pack((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3, 255);
+    }
+    else
+    {
+        palette[2] = Pack((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, 255);
+        palette[3] = 0; // transparent black
+    }
+
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+
+#ifdef BCN_SSE2
+    // a row's four 2 bit indices are compared against every palette entry at once, the matching entry is kept
+    const __m128i fields = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+
+    for (int row = 0; row < 4; ++row)
+    {
+        __m128i bits = _mm_and_si128(_mm_set1_epi32((indices >> (row * 8)) & 0xFF), fields);
+        __m128i result = _mm_setzero_si128();
+
+        for (int entry = 0; entry < 4; ++entry)
+        {
+            __m128i match = _mm_cmpeq_epi32(bits, _mm_setr_epi32(entry, entry << 2, entry << 4, entry << 6));
+            result = _mm_or_si128(result, _mm_and_si128(match, _mm_set1_epi32(static_cast<int>(palette[entry]))));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + row * 4), result);
+    }
+#else
+    for (int i = 0; i < 16; ++i)
+        pixels[i] = palette[(indices >> (i * 2)) & 3];
+#endif
+}
+
+// the eight values a BC3 alpha block or a BC4 and BC5 channel picks from
+static void DecodeValuePalette(const unsigned char *block, unsigned char *palette)
+{
+    unsigned int a0 = block[0];
+    unsigned int a1 = block[1];
+
+    palette[0] = static_cast<unsigned char>(a0);
+    palette[1] = static_cast<unsigned char>(a1);
+
+    if (a0 > a1)
+    {
+        for (unsigned int i = 1; i < 7; ++i)
+            palette[i + 1] = static_cast<unsigned char>(((7 - i) * a0 + i * a1 + 3) / 7);
+    }
+    else
+    {
+        for (unsigned int i = 1; i < 5; ++i)
+            palette[i + 1] = static_cast<unsigned char>(((5 - i) * a0 + i * a1 + 2) / 5);
+
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// the 16 values of a BC3 alpha block, BC4 and BC5 channels are the same
+static void DecodeValues(const unsigned char *block, unsigned char *values)
+{
+    unsigned char palette[8];
+
+    DecodeValuePalette(block, palette);
+
+    uint64_t indices = 0;
+
+    for (int i = 0; i < 6; ++i)
+        indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+
+    for (int i = 0; i < 16; ++i)
+        values[i] = palette[(indices >> (i * 3)) & 7];
+}
+
+static void DecodeBlock(BlockFormat format, const unsigned char *block, uint32_t *pixels)
+{
+    unsigned char values[16];
+    unsigned char second[16];
+
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        DecodeColors(block, false, pixels);
+        break;
+    case BlockFormat::BC2:
+        DecodeColors(block + 8, true, pixels);
+
+        // 4 bits of alpha per pixel
+        for (int i = 0; i < 16; ++i)
+            pixels[i] = (pixels[i] & 0x00FFFFFF) | (static_cast<uint32_t>(((block[i / 2] >> ((i & 1) * 4)) & 15) * 17) << 24);
+        break;
+    case BlockFormat::BC3:
+        DecodeColors(block + 8, true, pixels);
+        DecodeValues(block, values);
+
+        for (int i = 0; i < 16; ++i)
+            pixels[i] = (pixels[i] & 0x00FFFFFF) | (static_cast<uint32_t>(values[i]) << 24);
+        break;
+    case BlockFormat::BC4:
+        DecodeValues(block, values);
+
+        for (int i = 0; i < 16; ++i)
+            pixels[i] = Pack(values[i], values[i], values[i], 255);
+        break;
+    case BlockFormat::BC5:
+        DecodeValues(block, values);
+        DecodeValues(block + 8, second);
+
+        for (int i = 0; i < 16; ++i)
+            pixels[i] = Pack(values[i], second[i], 0, 255);
+        break;
+    }
+}
+
+#ifdef BCN_AVX2
+// the 3 bit indices of each half block are shifted into eight lanes at once, narrowed to bytes and looked up in the
+// palette with one byte shuffle
+AVX2_KERNEL static __m128i DecodeValuesAvx2(const unsigned char *block)
+{
+    alignas(16) unsigned char palette[16] = {};
+
+    DecodeValuePalette(block, palette);
+
+    uint32_t first = block[2] | (block[3] << 8) | (block[4] << 16);
+    uint32_t second = block[5] | (block[6] << 8) | (block[7] << 16);
+
+    const __m256i shifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i mask = _mm256_set1_epi32(7);
+
+    __m256i low = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(first)), shifts), mask);
+    __m256i high = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(second)), shifts), mask);
+
+    // packing works within 128 bit lanes, the permute puts pixels 0-7 in the low half and 8-15 in the high one
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i indices = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+
+    return _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(palette)), indices);
+}
+
+// eight values of a row pair widened to one pixel each
+AVX2_KERNEL static __m256i Widen(__m128i values, int half)
+{
+    return _mm256_cvtepu8_epi32(half == 0 ? values : _mm_srli_si128(values, 8));
+}
+
+// BC1 and BC2 have no value blocks and go through the baseline decoder
+AVX2_KERNEL static void DecodeBlockAvx2(BlockFormat format, const unsigned char *block, uint32_t *pixels)
+{
+    const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+    switch (format)
+    {
+    case BlockFormat::BC3:
+    {
+        DecodeColors(block + 8, true, pixels);
+
+        __m128i values = DecodeValuesAvx2(block);
+        const __m256i colorMask = _mm256_set1_epi32(0x00FFFFFF);
+
+        for (int half = 0; half < 2; ++half)
+        {
+            __m256i *target = reinterpret_cast<__m256i *>(pixels + half * 8);
+            __m256i colors = _mm256_and_si256(_mm256_loadu_si256(target), colorMask);
+
+            _mm256_storeu_si256(target, _mm256_or_si256(colors, _mm256_slli_epi32(Widen(values, half), 24)));
+        }
+        break;
+    }
+    case BlockFormat::BC4:
+    {
+        __m128i values = DecodeValuesAvx2(block);
+        const __m256i grey = _mm256_set1_epi32(0x00010101);
+
+        for (int half = 0; half < 2; ++half)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + half * 8), _mm256_or_si256(_mm256_mullo_epi32(Widen(values, half), grey), opaque));
+        break;
+    }
+    case BlockFormat::BC5:
+    {
+        __m128i red = DecodeValuesAvx2(block);
+        __m128i green = DecodeValuesAvx2(block + 8);
+
+        for (int half = 0; half < 2; ++half)
+        {
+            __m256i pixel = _mm256_or_si256(Widen(red, half), _mm256_slli_epi32(Widen(green, half), 8));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + half * 8), _mm256_or_si256(pixel, opaque));
+        }
+        break;
+    }
+    default:
+        DecodeBlock(format, block, pixels);
+        break;
+    }
+}
+
+static bool CpuSupportsAvx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 1);
+
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+    __cpuid(info, 0);
+
+    if (info[0] < 7 || !osSavesYmm)
+        return false;
+
+    __cpuidex(info, 7, 0);
+
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+typedef void (*BlockDecoder)(BlockFormat format, const unsigned char *block, uint32_t *pixels);
+
+static std::atomic<bool> wideDecoding = true;
+
+static BlockDecoder GetBlockDecoder()
+{
+#ifdef BCN_AVX2
+    static const bool avx2 = CpuSupportsAvx2();
+
+    if (avx2 && wideDecoding)
+        return DecodeBlockAvx2;
+#endif
+
+    return DecodeBlock;
+}
+
+const char *GetBlockDecoderName()
+{
+    if (GetBlockDecoder() != DecodeBlock)
+        return "AVX2";
+
+#ifdef BCN_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void SetWideBlockDecoding(bool enabled)
+{
+    wideDecoding = enabled;
+}
+
+size_t GetBlockSize(BlockFormat format)
+{
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+size_t GetLevelSize(BlockFormat format, unsigned int width, unsigned int height)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
+
+bool DecodeBlocks(BlockFormat format, const unsigned char *data, size_t size, unsigned int width, unsigned int height, unsigned char *rgba)
+{
+    if (size < GetLevelSize(format, width, height))
+        return false;
+
+    size_t blockSize = GetBlockSize(format);
+    unsigned int blocksX = (width + 3) / 4;
+    unsigned int blocksY = (height + 3) / 4;
+    BlockDecoder decode = GetBlockDecoder();
+    uint32_t pixels[16];
+
+    for (unsigned int blockY = 0; blockY < blocksY; ++blockY)
+    {
+        unsigned int rows = std::min(4u, height - blockY * 4);
+
+        for (unsigned int blockX = 0; blockX < blocksX; ++blockX)
+        {
+            decode(format, data + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize, pixels);
+
+            // blocks at the right and bottom edge can stick out of the level
+            unsigned int columns = std::min(4u, width - blockX * 4);
+
+            for (unsigned int row = 0; row < rows; ++row)
+                memcpy(rgba + ((static_cast<size_t>(blockY) * 4 + row) * width + blockX * 4) * 4, pixels + row * 4, columns * 4);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+// The block compressed formats the CPU decoder knows. BC1 to BC3 are DXT1, DXT3 and DXT5, BC4 and BC5 the one and two
+// channel formats (ATI1, ATI2).
+enum class BlockFormat
+{
+    BC1,
+    BC2,
+    BC3,
+    BC4,
+    BC5
+};
+
+// bytes per 4x4 block
+size_t GetBlockSize(BlockFormat format);
+
+// bytes of a width x height level
+size_t GetLevelSize(BlockFormat format, unsigned int width, unsigned int height);
+
+// Decodes a level to tightly packed RGBA8, rgba needs width * height * 4 bytes. BC4 comes out grey, BC5 as red and green
+// with blue 0, both opaque. Returns false if data is shorter than the level.
+bool DecodeBlocks(BlockFormat format, const unsigned char *data, size_t size, unsigned int width, unsigned int height, unsigned char *rgba);
+
+// BC3, BC4 and BC5 use AVX2 kernels when the cpu has them. the name is for showing which decoder runs, and the wide
+// kernels can be turned off to compare them against the baseline one
+const char *GetBlockDecoderName();
+void SetWideBlockDecoding(bool enabled);
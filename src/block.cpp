@@ -1,13 +1,15 @@
 #include "block.h"
 #include "tinyxml2.h"
+#include "vfs.h"
 #include <iostream>
 
 Block LoadFirstBlockFromXBlock(const std::string &filepath)
 {
     Block block;
 
+    std::string text;
     tinyxml2::XMLDocument doc;
-    if (doc.LoadFile(filepath.c_str()) != tinyxml2::XML_SUCCESS)
+    if (!FileSystem::Read(filepath, text) || doc.Parse(text.data(), text.size()) != tinyxml2::XML_SUCCESS)
     {
         std::cerr << "Failed to load .xblock: " << filepath << std::endl;
         return block;
@@ -0,0 +1,466 @@
+#include "catalog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+static const char IndexMagic[4] = {'M', 'C', 'A', 'T'};
+static const uint32_t IndexVersion = 1;
+
+// what a refresh job hands back, the catalog swaps it in on the main thread
+struct MapCatalog::Refresh
+{
+    Engine::JobCounter counter;
+    Index index;
+    size_t scanned = 0;
+    float milliseconds = 0.0f;
+    bool changed = false;
+};
+
+static std::string ToLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+// the value of name="..." inside [begin, end), empty if it isn't there
+static std::string_view FindValue(std::string_view text, size_t begin, size_t end, std::string_view name)
+{
+    size_t position = begin;
+
+    while ((position = text.find(name, position)) != std::string_view::npos && position < end)
+    {
+        size_t quote = position + name.size();
+
+        // matching the end of a longer attribute's name doesn't count
+        bool whole = position > 0 && (text[position - 1] == ' ' || text[position - 1] == '\t' || text[position - 1] == '\n' || text[position - 1] == '\r');
+
+        if (whole && quote + 1 < end && text[quote] == '=' && text[quote + 1] == '"')
+        {
+            size_t valueEnd = text.find('"', quote + 2);
+
+            if (valueEnd == std::string_view::npos || valueEnd > end)
+                return {};
+
+            return text.substr(quote + 2, valueEnd - quote - 2);
+        }
+
+        position = quote;
+    }
+
+    return {};
+}
+
+// only the entitySet's entities are looked at: their model name and the value of their Position property
+static bool ScanMap(const std::string &path, MapCatalog::Map &map, std::vector<std::string> &models)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string_view text(buffer);
+
+    bool anyPosition = false;
+    size_t position = 0;
+
+    map.entityCount = 0;
+
+    while ((position = text.find("<entity", position)) != std::string_view::npos)
+    {
+        size_t tagEnd = text.find('>', position);
+        if (tagEnd == std::string_view::npos)
+            break;
+
+        char next = text[position + 7];
+
+        // <entitySet>
+        if (next != ' ' && next != '\t' && next != '\n' && next != '\r' && next != '/' && next != '>')
+        {
+            position = tagEnd;
+            continue;
+        }
+
+        ++map.entityCount;
+
+        std::string_view modelName = FindValue(text, position, tagEnd, "modelName");
+
+        if (!modelName.empty() && modelName.back() == '_')
+            modelName.remove_suffix(1);
+
+        if (!modelName.empty())
+            models.emplace_back(modelName);
+
+        // a self closing entity has no properties
+        if (text[tagEnd - 1] == '/')
+        {
+            position = tagEnd;
+            continue;
+        }
+
+        size_t entityEnd = text.find("</entity>", tagEnd);
+        if (entityEnd == std::string_view::npos)
+            entityEnd = text.size();
+
+        size_t property = text.find("\"Position\"", tagEnd);
+
+        if (property < entityEnd)
+        {
+            size_t propertyEnd = std::min(text.find("</property>", property), entityEnd);
+            std::string_view value = FindValue(text, property, propertyEnd, "value");
+            glm::vec3 point(0.0f);
+
+            if (sscanf(std::string(value).c_str(), "%f, %f, %f", &point.x, &point.y, &point.z) == 3)
+            {
+                map.min = anyPosition ? glm::min(map.min, point) : point;
+                map.max = anyPosition ? glm::max(map.max, point) : point;
+                anyPosition = true;
+            }
+        }
+
+        position = entityEnd;
+    }
+
+    std::sort(models.begin(), models.end());
+    models.erase(std::unique(models.begin(), models.end()), models.end());
+
+    return true;
+}
+
+template <typename Type>
+static void WriteValue(std::ostream &stream, const Type &value)
+{
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void WriteString(std::ostream &stream, const std::string &text)
+{
+    WriteValue(stream, static_cast<uint32_t>(text.size()));
+    stream.write(text.data(), text.size());
+}
+
+template <typename Type>
+static bool ReadValue(std::istream &stream, Type &value)
+{
+    return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+static bool ReadString(std::istream &stream, std::string &text)
+{
+    uint32_t length = 0;
+
+    if (!ReadValue(stream, length) || length > (1u << 16))
+        return false;
+
+    text.resize(length);
+
+    return static_cast<bool>(stream.read(&text[0], length));
+}
+
+MapCatalog::MapCatalog(const std::string &root, const std::string &indexPath) : root(root), indexPath(indexPath)
+{
+    if (Load())
+        std::cout << "[Catalog] " << index.maps.size() << " maps and " << index.modelNames.size() << " models in " << indexPath << "\n";
+}
+
+MapCatalog::~MapCatalog()
+{
+    if (refresh)
+        Engine::JobSystem::Wait(refresh->counter);
+}
+
+void MapCatalog::StartRefresh()
+{
+    if (refresh)
+        return;
+
+    refresh = std::make_unique<Refresh>();
+
+    Refresh *started = refresh.get();
+    std::string directory = root;
+
+    // index isn't touched until FinishRefresh, the job can read it meanwhile
+    Engine::JobSystem::Schedule([this, started, directory]()
+                                { Scan(directory, index, *started); },
+                                started->counter);
+}
+
+bool MapCatalog::FinishRefresh()
+{
+    if (!refresh || !refresh->counter.IsDone())
+        return false;
+
+    std::unique_ptr<Refresh> done = std::move(refresh);
+
+    scannedCount = done->scanned;
+
+    if (!done->changed)
+        return false;
+
+    index = std::move(done->index);
+
+    std::cout << "[Catalog] " << index.maps.size() << " maps, " << scannedCount << " read in " << done->milliseconds << " ms\n";
+
+    if (!Save())
+        std::cerr << "[Catalog] Couldn't write " << indexPath << "\n";
+
+    return true;
+}
+
+void MapCatalog::Search(const std::string &query, std::vector<uint32_t> &results, size_t limit) const
+{
+    static const std::string ModelPrefix = "model:";
+
+    std::string text = ToLower(query);
+
+    results.clear();
+
+    if (text.compare(0, ModelPrefix.size(), ModelPrefix) != 0)
+    {
+        for (uint32_t map = 0; map < index.maps.size() && results.size() < limit; ++map)
+            if (index.lowerIds[map].find(text) != std::string::npos)
+                results.push_back(map);
+
+        return;
+    }
+
+    text.erase(0, text.find_first_not_of(' ', ModelPrefix.size()));
+
+    // marking keeps the maps in id order without sorting the union
+    std::vector<uint8_t> matched(index.maps.size(), 0);
+
+    for (size_t model = 0; model < index.lowerModelNames.size(); ++model)
+    {
+        if (index.lowerModelNames[model].find(text) == std::string::npos)
+            continue;
+
+        for (uint32_t map : index.modelMaps[model])
+            matched[map] = 1;
+    }
+
+    for (uint32_t map = 0; map < matched.size() && results.size() < limit; ++map)
+        if (matched[map])
+            results.push_back(map);
+}
+
+bool MapCatalog::Load()
+{
+    std::ifstream file(indexPath, std::ios::binary);
+    if (!file)
+        return false;
+
+    char magic[4] = {};
+    uint32_t version = 0;
+    uint32_t modelCount = 0;
+    uint32_t mapCount = 0;
+    Index loaded;
+
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, IndexMagic, sizeof(magic)) != 0 || !ReadValue(file, version) || version != IndexVersion)
+    {
+        std::cerr << "[Catalog] " << indexPath << " isn't an index this version can read, every map is read again\n";
+        return false;
+    }
+
+    bool valid = ReadValue(file, modelCount);
+
+    for (uint32_t i = 0; valid && i < modelCount; ++i)
+    {
+        loaded.modelNames.emplace_back();
+        valid = ReadString(file, loaded.modelNames.back());
+    }
+
+    valid = valid && ReadValue(file, mapCount);
+
+    for (uint32_t i = 0; valid && i < mapCount; ++i)
+    {
+        Map map;
+        uint32_t usedCount = 0;
+
+        valid = ReadString(file, map.path) && ReadValue(file, map.time) && ReadValue(file, map.size) && ReadValue(file, map.entityCount) &&
+                ReadValue(file, map.min) && ReadValue(file, map.max) && ReadValue(file, usedCount) && usedCount <= modelCount;
+
+        if (!valid)
+            break;
+
+        map.models.resize(usedCount);
+        valid = file.read(reinterpret_cast<char *>(map.models.data()), usedCount * sizeof(uint32_t)) &&
+                std::all_of(map.models.begin(), map.models.end(), [modelCount](uint32_t model)
+                            { return model < modelCount; });
+
+        map.id = fs::path(map.path).stem().string();
+        loaded.maps.push_back(std::move(map));
+    }
+
+    if (!valid)
+    {
+        std::cerr << "[Catalog] " << indexPath << " is cut short, every map is read again\n";
+        return false;
+    }
+
+    BuildLookups(loaded);
+    index = std::move(loaded);
+
+    return true;
+}
+
+// written next to the index and renamed over it, a crash leaves the old one
+bool MapCatalog::Save() const
+{
+    std::string temporary = indexPath + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        file.write(IndexMagic, sizeof(IndexMagic));
+        WriteValue(file, IndexVersion);
+        WriteValue(file, static_cast<uint32_t>(index.modelNames.size()));
+
+        for (const std::string &name : index.modelNames)
+            WriteString(file, name);
+
+        WriteValue(file, static_cast<uint32_t>(index.maps.size()));
+
+        for (const Map &map : index.maps)
+        {
+            WriteString(file, map.path);
+            WriteValue(file, map.time);
+            WriteValue(file, map.size);
+            WriteValue(file, map.entityCount);
+            WriteValue(file, map.min);
+            WriteValue(file, map.max);
+            WriteValue(file, static_cast<uint32_t>(map.models.size()));
+            file.write(reinterpret_cast<const char *>(map.models.data()), map.models.size() * sizeof(uint32_t));
+        }
+
+        if (!file)
+            return false;
+    }
+
+    std::error_code error;
+    fs::rename(temporary, indexPath, error);
+
+    return !error;
+}
+
+// runs as a job. maps whose file looks the same as before are carried over, the rest are read in parallel
+void MapCatalog::Scan(const std::string &root, const Index &previous, Refresh &refresh)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::unordered_map<std::string, uint32_t> known;
+
+    for (uint32_t i = 0; i < previous.maps.size(); ++i)
+        known[previous.maps[i].path] = i;
+
+    std::vector<Map> maps;
+    std::vector<std::vector<std::string>> mapModels;
+    std::vector<size_t> changed;
+    std::error_code error;
+
+    for (fs::recursive_directory_iterator entry(root, fs::directory_options::skip_permission_denied, error), end; entry != end; entry.increment(error))
+    {
+        if (error)
+            break;
+
+        if (!entry->is_regular_file(error) || ToLower(entry->path().extension().string()) != ".xblock")
+            continue;
+
+        Map map;
+        map.path = entry->path().generic_string();
+        map.id = entry->path().stem().string();
+        map.time = entry->last_write_time(error).time_since_epoch().count();
+        map.size = entry->file_size(error);
+
+        auto found = known.find(map.path);
+
+        if (found != known.end() && previous.maps[found->second].time == map.time && previous.maps[found->second].size == map.size)
+        {
+            const Map &old = previous.maps[found->second];
+
+            map.entityCount = old.entityCount;
+            map.min = old.min;
+            map.max = old.max;
+            mapModels.emplace_back();
+
+            for (uint32_t model : old.models)
+                mapModels.back().push_back(previous.modelNames[model]);
+        }
+        else
+        {
+            changed.push_back(maps.size());
+            mapModels.emplace_back();
+        }
+
+        maps.push_back(std::move(map));
+    }
+
+    std::vector<uint8_t> failed(maps.size(), 0);
+
+    Engine::JobSystem::ParallelFor(changed.size(), 4, [&](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+            failed[changed[i]] = !ScanMap(maps[changed[i]].path, maps[changed[i]], mapModels[changed[i]]); });
+
+    // the model names are numbered again from scratch, names no map uses anymore drop out
+    Index &index = refresh.index;
+    std::unordered_map<std::string, uint32_t> modelIds;
+    std::vector<size_t> order;
+
+    for (size_t i = 0; i < maps.size(); ++i)
+        if (!failed[i])
+            order.push_back(i);
+
+    std::sort(order.begin(), order.end(), [&maps](size_t a, size_t b)
+              { return maps[a].id != maps[b].id ? maps[a].id < maps[b].id : maps[a].path < maps[b].path; });
+
+    for (size_t i : order)
+    {
+        Map &map = maps[i];
+
+        for (const std::string &name : mapModels[i])
+        {
+            auto inserted = modelIds.emplace(name, static_cast<uint32_t>(index.modelNames.size()));
+
+            if (inserted.second)
+                index.modelNames.push_back(name);
+
+            map.models.push_back(inserted.first->second);
+        }
+
+        std::sort(map.models.begin(), map.models.end());
+        index.maps.push_back(std::move(map));
+    }
+
+    BuildLookups(index);
+
+    // files that couldn't be read aren't counted and drop out of the index
+    refresh.scanned = changed.size() - std::count(failed.begin(), failed.end(), 1);
+    refresh.changed = !changed.empty() || index.maps.size() != previous.maps.size();
+    refresh.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MapCatalog::BuildLookups(Index &index)
+{
+    index.lowerIds.clear();
+    index.lowerModelNames.clear();
+    index.modelMaps.assign(index.modelNames.size(), {});
+
+    for (const std::string &name : index.modelNames)
+        index.lowerModelNames.push_back(ToLower(name));
+
+    for (uint32_t map = 0; map < index.maps.size(); ++map)
+    {
+        index.lowerIds.push_back(ToLower(index.maps[map].id));
+
+        for (uint32_t model : index.maps[map].models)
+            index.modelMaps[model].push_back(map);
+    }
+}
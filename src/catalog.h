@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <Engine/JobSystem.h>
+
+// Every .xblock under a directory with what the map browser shows about it. Files are skimmed for their entities'
+// model names and positions without building a document, many at once on the job system, and the result is kept in a
+// small binary index next to them. Refreshing only reads the files whose size or modification time changed since.
+//
+// Searches run on what's in memory: a query matches map ids containing it, "model:" followed by text matches the
+// maps using a model whose name contains the text.
+class MapCatalog
+{
+public:
+    struct Map
+    {
+        std::string path;
+        std::string id; // the file name without its extension
+        int64_t time = 0;
+        uint64_t size = 0;
+        uint32_t entityCount = 0;
+        glm::vec3 min = glm::vec3(0.0f); // entity positions in the .xblock's coordinates
+        glm::vec3 max = glm::vec3(0.0f);
+        std::vector<uint32_t> models; // sorted indices into the model names
+    };
+
+    MapCatalog(const std::string &root, const std::string &indexPath);
+    ~MapCatalog();
+
+    MapCatalog(const MapCatalog &) = delete;
+    MapCatalog &operator=(const MapCatalog &) = delete;
+
+    // looks for new and changed files in the background, the catalog stays searchable meanwhile
+    void StartRefresh();
+
+    // takes in a finished refresh and saves the index if anything changed. returns true when that happened
+    bool FinishRefresh();
+    bool IsRefreshing() const { return refresh != nullptr; }
+
+    // map indices sorted by id, at most limit of them
+    void Search(const std::string &query, std::vector<uint32_t> &results, size_t limit = SIZE_MAX) const;
+
+    size_t GetMapCount() const { return index.maps.size(); }
+    const Map &GetMap(uint32_t map) const { return index.maps[map]; }
+    size_t GetModelCount() const { return index.modelNames.size(); }
+    const std::string &GetModelName(uint32_t model) const { return index.modelNames[model]; }
+
+    // how many files the last refresh had to read
+    size_t GetScannedCount() const { return scannedCount; }
+
+private:
+    struct Index
+    {
+        std::vector<Map> maps; // sorted by id
+        std::vector<std::string> modelNames;
+        std::vector<std::string> lowerIds;
+        std::vector<std::string> lowerModelNames;
+        std::vector<std::vector<uint32_t>> modelMaps; // per model, the maps using it, sorted
+    };
+
+    struct Refresh;
+
+    std::string root;
+    std::string indexPath;
+    Index index;
+    std::unique_ptr<Refresh> refresh;
+    size_t scannedCount = 0;
+
+    bool Load();
+    bool Save() const;
+
+    static void Scan(const std::string &root, const Index &previous, Refresh &refresh);
+    static void BuildLookups(Index &index);
+};
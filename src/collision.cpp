@@ -0,0 +1,816 @@
+#include "collision.h"
+
+#include <Engine/JobSystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+static const uint32_t NoNode = 0xFFFFFFFF;
+static const uint32_t MaxLeafTriangles = 4;
+static const int BinCount = 12;
+
+// past this depth nodes are split by count, which keeps the traversal stack bounded
+static const uint32_t MaxBuildDepth = 48;
+static const int TraversalStackSize = 128;
+
+// subtrees with more triangles than this are built as a job of their own
+static const uint32_t ParallelBuildSize = 4096;
+
+// refitting may make the tree this much more expensive to traverse before it's built again
+static const float RebuildRatio = 1.5f;
+
+static const size_t QueryBatchSize = 64;
+
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void Grow(const glm::vec3 &point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Grow(const Bounds &bounds)
+    {
+        min = glm::min(min, bounds.min);
+        max = glm::max(max, bounds.max);
+    }
+
+    float Area() const
+    {
+        glm::vec3 extent = max - min;
+
+        if (extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f)
+            return 0.0f;
+
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+};
+
+struct CollisionWorld::BuildState
+{
+    std::vector<Bounds> bounds;
+    std::vector<glm::vec3> centroids;
+    std::atomic<uint32_t> nodeCount = 1;
+    Engine::JobCounter counter;
+};
+
+// axes the direction doesn't move along get a huge factor instead of an infinite one, so the slab test never sees 0 * inf
+static glm::vec3 GetInverseDirection(const glm::vec3 &direction)
+{
+    glm::vec3 inverse;
+
+    for (int i = 0; i < 3; ++i)
+        inverse[i] = std::abs(direction[i]) > 1e-20f ? 1.0f / direction[i] : std::copysign(1e20f, direction[i]);
+
+    return inverse;
+}
+
+static bool IntersectBounds(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &origin, const glm::vec3 &inverseDirection, float maxDistance, float &entry)
+{
+    glm::vec3 t0 = (min - origin) * inverseDirection;
+    glm::vec3 t1 = (max - origin) * inverseDirection;
+    glm::vec3 entries = glm::min(t0, t1);
+    glm::vec3 exits = glm::max(t0, t1);
+
+    entry = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+
+    return entry <= std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+}
+
+// double sided moller-trumbore
+static bool IntersectTriangle(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 *vertices, float &distance)
+{
+    glm::vec3 edge1 = vertices[1] - vertices[0];
+    glm::vec3 edge2 = vertices[2] - vertices[0];
+    glm::vec3 p = glm::cross(direction, edge2);
+    float determinant = glm::dot(edge1, p);
+
+    if (determinant == 0.0f)
+        return false;
+
+    float inverse = 1.0f / determinant;
+    glm::vec3 s = origin - vertices[0];
+    float u = glm::dot(s, p) * inverse;
+
+    if (u < 0.0f || u > 1.0f)
+        return false;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) * inverse;
+
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+    distance = glm::dot(edge2, q) * inverse;
+
+    return distance >= 0.0f;
+}
+
+static bool IsInsideTriangle(const glm::vec3 &point, const glm::vec3 *vertices)
+{
+    glm::vec3 edge0 = vertices[1] - vertices[0];
+    glm::vec3 edge1 = vertices[2] - vertices[0];
+    glm::vec3 offset = point - vertices[0];
+    float d00 = glm::dot(edge0, edge0);
+    float d01 = glm::dot(edge0, edge1);
+    float d11 = glm::dot(edge1, edge1);
+    float d20 = glm::dot(offset, edge0);
+    float d21 = glm::dot(offset, edge1);
+    float denominator = d00 * d11 - d01 * d01;
+
+    if (denominator == 0.0f)
+        return false;
+
+    float v = (d11 * d20 - d01 * d21) / denominator;
+    float w = (d00 * d21 - d01 * d20) / denominator;
+
+    return v >= -1e-5f && w >= -1e-5f && v + w <= 1.0f + 1e-5f;
+}
+
+// a sphere that starts inside counts as touching at 0
+static bool IntersectSphere(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 &center, float radius, float &distance)
+{
+    glm::vec3 offset = origin - center;
+    float b = glm::dot(offset, direction);
+    float c = glm::dot(offset, offset) - radius * radius;
+
+    if (c <= 0.0f)
+    {
+        distance = 0.0f;
+        return true;
+    }
+
+    float discriminant = b * b - c;
+
+    if (b > 0.0f || discriminant < 0.0f)
+        return false;
+
+    distance = -b - std::sqrt(discriminant);
+
+    return true;
+}
+
+// the side of the capsule around an edge, the ends are the vertex spheres
+static bool IntersectEdge(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 &start, const glm::vec3 &end, float radius, float &distance, glm::vec3 &contact)
+{
+    glm::vec3 edge = end - start;
+    float edgeLength2 = glm::dot(edge, edge);
+
+    if (edgeLength2 == 0.0f)
+        return false;
+
+    glm::vec3 offset = origin - start;
+    float offsetAlong = glm::dot(offset, edge);
+    float directionAlong = glm::dot(direction, edge);
+    glm::vec3 offsetAcross = offset - edge * (offsetAlong / edgeLength2);
+    glm::vec3 directionAcross = direction - edge * (directionAlong / edgeLength2);
+
+    float a = glm::dot(directionAcross, directionAcross);
+    float b = glm::dot(offsetAcross, directionAcross);
+    float c = glm::dot(offsetAcross, offsetAcross) - radius * radius;
+    float t = 0.0f;
+
+    if (c > 0.0f)
+    {
+        float discriminant = b * b - a * c;
+
+        if (a == 0.0f || b > 0.0f || discriminant < 0.0f)
+            return false;
+
+        t = (-b - std::sqrt(discriminant)) / a;
+    }
+
+    float along = (offsetAlong + t * directionAlong) / edgeLength2;
+
+    if (along < 0.0f || along > 1.0f)
+        return false;
+
+    distance = t;
+    contact = start + edge * along;
+
+    return true;
+}
+
+// lowers distance to where a sphere moving from origin first touches the triangle, if that's sooner
+static bool SweepTriangle(const glm::vec3 &origin, const glm::vec3 &direction, float radius, const glm::vec3 *vertices, float &distance, glm::vec3 &contact)
+{
+    glm::vec3 normal = glm::cross(vertices[1] - vertices[0], vertices[2] - vertices[0]);
+    float length = glm::length(normal);
+
+    if (length == 0.0f)
+        return false;
+
+    normal /= length;
+
+    float side = glm::dot(origin - vertices[0], normal);
+
+    if (side < 0.0f)
+    {
+        normal = -normal;
+        side = -side;
+    }
+
+    float approach = -glm::dot(direction, normal);
+
+    // touching the inside of the face is always the first contact
+    if (side <= radius)
+    {
+        glm::vec3 projected = origin - normal * side;
+
+        if (IsInsideTriangle(projected, vertices))
+        {
+            if (distance <= 0.0f)
+                return false;
+
+            distance = 0.0f;
+            contact = projected;
+
+            return true;
+        }
+    }
+    else if (approach > 0.0f)
+    {
+        float t = (side - radius) / approach;
+        glm::vec3 point = origin + direction * t - normal * radius;
+
+        if (IsInsideTriangle(point, vertices))
+        {
+            if (t >= distance)
+                return false;
+
+            distance = t;
+            contact = point;
+
+            return true;
+        }
+    }
+
+    bool found = false;
+    float t = 0.0f;
+    glm::vec3 point;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if (IntersectSphere(origin, direction, vertices[i], radius, t) && t < distance)
+        {
+            distance = t;
+            contact = vertices[i];
+            found = true;
+        }
+
+        if (IntersectEdge(origin, direction, vertices[i], vertices[(i + 1) % 3], radius, t, point) && t < distance)
+        {
+            distance = t;
+            contact = point;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+template <typename NodeList, typename TestTriangle>
+static void Traverse(const NodeList &nodes, const std::vector<uint32_t> &order, const glm::vec3 &origin, const glm::vec3 &inverseDirection,
+                     float padding, const float &maxDistance, TestTriangle &&test)
+{
+    uint32_t stack[TraversalStackSize];
+    int top = 0;
+    float entry = 0.0f;
+    glm::vec3 pad(padding);
+
+    if (nodes.empty())
+        return;
+
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const auto &node = nodes[stack[--top]];
+
+        // a hit found since the node was pushed can rule it out
+        if (!IntersectBounds(node.min - pad, node.max + pad, origin, inverseDirection, maxDistance, entry))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.start; i < node.start + node.count; ++i)
+                test(order[i]);
+
+            continue;
+        }
+
+        uint32_t left = node.start;
+        uint32_t right = node.start + 1;
+        float leftEntry = 0.0f;
+        float rightEntry = 0.0f;
+        bool hitLeft = IntersectBounds(nodes[left].min - pad, nodes[left].max + pad, origin, inverseDirection, maxDistance, leftEntry);
+        bool hitRight = IntersectBounds(nodes[right].min - pad, nodes[right].max + pad, origin, inverseDirection, maxDistance, rightEntry);
+
+        if (top + 2 > TraversalStackSize)
+            continue;
+
+        // the nearer child goes on top
+        if (hitLeft && hitRight && leftEntry < rightEntry)
+        {
+            stack[top++] = right;
+            stack[top++] = left;
+        }
+        else
+        {
+            if (hitLeft)
+                stack[top++] = left;
+
+            if (hitRight)
+                stack[top++] = right;
+        }
+    }
+}
+
+int CollisionWorld::AddEntity(const std::vector<glm::vec3> &localVertices, const glm::mat4 &transform)
+{
+    if (localVertices.empty())
+        return -1;
+
+    Entity entity;
+
+    entity.transform = transform;
+    entity.localVertices = localVertices;
+
+    int index = static_cast<int>(entities.size());
+
+    if (!freeEntities.empty())
+    {
+        index = freeEntities.back();
+        freeEntities.pop_back();
+    }
+
+    entity.firstTriangle = static_cast<uint32_t>(triangles.size());
+    entity.triangleCount = static_cast<uint32_t>(entity.localVertices.size() / 3);
+    entity.moved = true;
+
+    triangles.resize(triangles.size() + entity.triangleCount);
+
+    for (uint32_t i = 0; i < entity.triangleCount; ++i)
+        triangles[entity.firstTriangle + i].entity = index;
+
+    if (index == static_cast<int>(entities.size()))
+        entities.push_back(std::move(entity));
+    else
+        entities[index] = std::move(entity);
+
+    needsBuild = true;
+
+    return index;
+}
+
+void CollisionWorld::SetTransform(int entity, const glm::mat4 &transform)
+{
+    if (entity < 0 || entity >= static_cast<int>(entities.size()))
+        return;
+
+    entities[entity].transform = transform;
+    entities[entity].moved = true;
+
+    anyMoved = true;
+}
+
+void CollisionWorld::SetEnabled(int entity, bool enabled)
+{
+    if (entity < 0 || entity >= static_cast<int>(entities.size()))
+        return;
+
+    for (uint32_t i = 0; i < entities[entity].triangleCount; ++i)
+        triangles[entities[entity].firstTriangle + i].enabled = enabled;
+}
+
+// the triangles after the entity's move down to close the gap
+void CollisionWorld::RemoveEntity(int entity)
+{
+    if (entity < 0 || entity >= static_cast<int>(entities.size()) || entities[entity].localVertices.empty())
+        return;
+
+    uint32_t first = entities[entity].firstTriangle;
+    uint32_t count = entities[entity].triangleCount;
+
+    triangles.erase(triangles.begin() + first, triangles.begin() + first + count);
+
+    for (Entity &other : entities)
+        if (other.firstTriangle > first)
+            other.firstTriangle -= count;
+
+    entities[entity] = Entity();
+    freeEntities.push_back(entity);
+
+    needsBuild = true;
+}
+
+size_t CollisionWorld::GetEntitySize(int entity) const
+{
+    if (entity < 0 || entity >= static_cast<int>(entities.size()))
+        return 0;
+
+    return entities[entity].localVertices.capacity() * sizeof(glm::vec3) + entities[entity].triangleCount * (sizeof(Triangle) + 2 * sizeof(uint32_t));
+}
+
+void CollisionWorld::Update()
+{
+    if (!needsBuild && !anyMoved)
+        return;
+
+    std::vector<size_t> moved;
+
+    for (size_t i = 0; i < entities.size(); ++i)
+        if (entities[i].moved)
+            moved.push_back(i);
+
+    Engine::JobSystem::ParallelFor(moved.size(), 1, [this, &moved](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+            TransformEntity(entities[moved[i]]); });
+
+    if (needsBuild)
+    {
+        Build();
+    }
+    else
+    {
+        std::vector<uint32_t> leaves;
+
+        for (size_t entityIndex : moved)
+        {
+            const Entity &entity = entities[entityIndex];
+
+            for (uint32_t i = 0; i < entity.triangleCount; ++i)
+                leaves.push_back(triangleLeaves[entity.firstTriangle + i]);
+        }
+
+        std::sort(leaves.begin(), leaves.end());
+        leaves.erase(std::unique(leaves.begin(), leaves.end()), leaves.end());
+
+        for (uint32_t leaf : leaves)
+        {
+            FitLeaf(nodes[leaf]);
+
+            // parents stop changing as soon as one of them still covers its children
+            for (uint32_t node = parents[leaf]; node != NoNode; node = parents[node])
+            {
+                const Node &left = nodes[nodes[node].start];
+                const Node &right = nodes[nodes[node].start + 1];
+                glm::vec3 min = glm::min(left.min, right.min);
+                glm::vec3 max = glm::max(left.max, right.max);
+
+                if (min == nodes[node].min && max == nodes[node].max)
+                    break;
+
+                nodes[node].min = min;
+                nodes[node].max = max;
+            }
+        }
+
+        if (GetTreeCost() > builtCost * RebuildRatio)
+            Build();
+    }
+
+    for (size_t entityIndex : moved)
+        entities[entityIndex].moved = false;
+
+    needsBuild = false;
+    anyMoved = false;
+}
+
+CollisionWorld::Hit CollisionWorld::Raycast(const Ray &ray) const
+{
+    Hit result;
+    float length = glm::length(ray.direction);
+
+    if (length == 0.0f)
+        return result;
+
+    glm::vec3 direction = ray.direction / length;
+    float best = ray.maxDistance;
+    uint32_t bestTriangle = NoNode;
+
+    Traverse(nodes, order, ray.origin, GetInverseDirection(direction), 0.0f, best, [&](uint32_t triangle)
+             {
+        float distance = 0.0f;
+
+        if (triangles[triangle].enabled && triangles[triangle].entity != ray.ignoreEntity && IntersectTriangle(ray.origin, direction, triangles[triangle].vertices, distance) && distance < best)
+        {
+            best = distance;
+            bestTriangle = triangle;
+        } });
+
+    if (bestTriangle == NoNode)
+        return result;
+
+    const Triangle &triangle = triangles[bestTriangle];
+    glm::vec3 normal = glm::normalize(glm::cross(triangle.vertices[1] - triangle.vertices[0], triangle.vertices[2] - triangle.vertices[0]));
+
+    result.hit = true;
+    result.distance = best;
+    result.position = ray.origin + direction * best;
+    result.normal = glm::dot(normal, direction) > 0.0f ? -normal : normal;
+    result.entity = triangle.entity;
+
+    return result;
+}
+
+CollisionWorld::Hit CollisionWorld::SphereSweep(const Sweep &sweep) const
+{
+    Hit result;
+    float length = glm::length(sweep.direction);
+
+    if (length == 0.0f)
+        return result;
+
+    glm::vec3 direction = sweep.direction / length;
+    float best = sweep.maxDistance;
+    uint32_t bestTriangle = NoNode;
+    glm::vec3 contact(0.0f);
+
+    Traverse(nodes, order, sweep.origin, GetInverseDirection(direction), sweep.radius, best, [&](uint32_t triangle)
+             {
+        if (triangles[triangle].enabled && SweepTriangle(sweep.origin, direction, sweep.radius, triangles[triangle].vertices, best, contact))
+            bestTriangle = triangle; });
+
+    if (bestTriangle == NoNode)
+        return result;
+
+    const Triangle &triangle = triangles[bestTriangle];
+    glm::vec3 center = sweep.origin + direction * best;
+    glm::vec3 normal = center - contact;
+
+    // the centre can only sit on the triangle when the sweep started there
+    if (glm::dot(normal, normal) < 1e-12f)
+    {
+        normal = glm::cross(triangle.vertices[1] - triangle.vertices[0], triangle.vertices[2] - triangle.vertices[0]);
+        normal = glm::dot(normal, direction) > 0.0f ? -normal : normal;
+    }
+
+    result.hit = true;
+    result.distance = best;
+    result.position = contact;
+    result.normal = glm::normalize(normal);
+    result.entity = triangle.entity;
+
+    return result;
+}
+
+void CollisionWorld::Raycast(const Ray *rays, Hit *hits, size_t count) const
+{
+    Engine::JobSystem::ParallelFor(count, QueryBatchSize, [this, rays, hits](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+            hits[i] = Raycast(rays[i]); });
+}
+
+void CollisionWorld::SphereSweep(const Sweep *sweeps, Hit *hits, size_t count) const
+{
+    Engine::JobSystem::ParallelFor(count, QueryBatchSize, [this, sweeps, hits](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+            hits[i] = SphereSweep(sweeps[i]); });
+}
+
+void CollisionWorld::SnapToGround(const glm::vec3 *points, Hit *hits, size_t count, float searchHeight, float maxDrop, const int *ignoreEntities) const
+{
+    Engine::JobSystem::ParallelFor(count, QueryBatchSize, [this, points, hits, searchHeight, maxDrop, ignoreEntities](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+        {
+            Ray ray;
+
+            ray.origin = points[i] + glm::vec3(0.0f, searchHeight, 0.0f);
+            ray.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+            ray.maxDistance = searchHeight + maxDrop;
+            ray.ignoreEntity = ignoreEntities ? ignoreEntities[i] : -1;
+
+            hits[i] = Raycast(ray);
+        } });
+}
+
+void CollisionWorld::TransformEntity(Entity &entity)
+{
+    for (uint32_t i = 0; i < entity.triangleCount; ++i)
+    {
+        Triangle &triangle = triangles[entity.firstTriangle + i];
+
+        for (int j = 0; j < 3; ++j)
+            triangle.vertices[j] = glm::vec3(entity.transform * glm::vec4(entity.localVertices[3 * i + j], 1.0f));
+    }
+}
+
+void CollisionWorld::Build()
+{
+    uint32_t count = static_cast<uint32_t>(triangles.size());
+
+    ++rebuildCount;
+
+    nodes.clear();
+    parents.clear();
+    order.resize(count);
+    triangleLeaves.assign(count, NoNode);
+    builtCost = 0.0f;
+
+    if (count == 0)
+        return;
+
+    BuildState state;
+
+    state.bounds.resize(count);
+    state.centroids.resize(count);
+
+    Engine::JobSystem::ParallelFor(count, 1024, [this, &state](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+        {
+            Bounds bounds;
+
+            for (const glm::vec3 &vertex : triangles[i].vertices)
+                bounds.Grow(vertex);
+
+            state.bounds[i] = bounds;
+            state.centroids[i] = 0.5f * (bounds.min + bounds.max);
+            order[i] = static_cast<uint32_t>(i);
+        } });
+
+    // a binary tree over n leaves never has more than 2n - 1 nodes, sizing up front keeps node references stable
+    nodes.resize(2 * count);
+    parents.assign(2 * count, NoNode);
+
+    BuildNode(state, 0, 0, count);
+
+    Engine::JobSystem::Wait(state.counter);
+
+    nodes.resize(state.nodeCount);
+    parents.resize(state.nodeCount);
+
+    builtCost = GetTreeCost();
+}
+
+// binned surface area heuristic, the triangles of the node are order[begin, end)
+void CollisionWorld::BuildNode(BuildState &state, uint32_t nodeIndex, uint32_t begin, uint32_t end)
+{
+    Node &node = nodes[nodeIndex];
+    Bounds bounds;
+    Bounds centroidBounds;
+    uint32_t count = end - begin;
+    uint32_t depth = 0;
+
+    for (uint32_t parent = parents[nodeIndex]; parent != NoNode; parent = parents[parent])
+        ++depth;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        bounds.Grow(state.bounds[order[i]]);
+        centroidBounds.Grow(state.centroids[order[i]]);
+    }
+
+    node.min = bounds.min;
+    node.max = bounds.max;
+
+    if (count <= MaxLeafTriangles)
+    {
+        node.start = begin;
+        node.count = count;
+
+        for (uint32_t i = begin; i < end; ++i)
+            triangleLeaves[order[i]] = nodeIndex;
+
+        return;
+    }
+
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = FLT_MAX;
+
+    for (int axis = 0; axis < 3 && depth < MaxBuildDepth; ++axis)
+    {
+        float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+
+        if (extent <= 0.0f)
+            continue;
+
+        Bounds binBounds[BinCount];
+        uint32_t binCounts[BinCount] = {};
+        float scale = BinCount / extent;
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            int bin = std::min(BinCount - 1, static_cast<int>((state.centroids[order[i]][axis] - centroidBounds.min[axis]) * scale));
+
+            ++binCounts[bin];
+            binBounds[bin].Grow(state.bounds[order[i]]);
+        }
+
+        float leftAreas[BinCount - 1];
+        uint32_t leftCounts[BinCount - 1];
+        Bounds left;
+        uint32_t leftCount = 0;
+
+        for (int i = 0; i < BinCount - 1; ++i)
+        {
+            left.Grow(binBounds[i]);
+            leftCount += binCounts[i];
+            leftAreas[i] = left.Area();
+            leftCounts[i] = leftCount;
+        }
+
+        Bounds right;
+        uint32_t rightCount = 0;
+
+        // split k puts bins [0, k) on the left
+        for (int split = BinCount - 1; split > 0; --split)
+        {
+            right.Grow(binBounds[split]);
+            rightCount += binCounts[split];
+
+            float cost = leftCounts[split - 1] * leftAreas[split - 1] + rightCount * right.Area();
+
+            if (leftCounts[split - 1] > 0 && rightCount > 0 && cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    uint32_t middle = begin;
+
+    if (bestAxis >= 0)
+    {
+        float minimum = centroidBounds.min[bestAxis];
+        float scale = BinCount / (centroidBounds.max[bestAxis] - minimum);
+
+        middle = static_cast<uint32_t>(std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t triangle)
+                                                      { return std::min(BinCount - 1, static_cast<int>((state.centroids[triangle][bestAxis] - minimum) * scale)) < bestSplit; }) -
+                                       order.begin());
+    }
+
+    // every centroid in one spot or the tree got too deep, split by count instead
+    if (middle == begin || middle == end)
+    {
+        glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        middle = begin + count / 2;
+
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&](uint32_t a, uint32_t b)
+                         { return state.centroids[a][axis] < state.centroids[b][axis]; });
+    }
+
+    uint32_t left = state.nodeCount.fetch_add(2);
+
+    node.start = left;
+    node.count = 0;
+    parents[left] = nodeIndex;
+    parents[left + 1] = nodeIndex;
+
+    if (count > ParallelBuildSize)
+    {
+        Engine::JobSystem::Schedule([this, &state, left, begin, middle]()
+                                    { BuildNode(state, left, begin, middle); },
+                                    state.counter);
+    }
+    else
+    {
+        BuildNode(state, left, begin, middle);
+    }
+
+    BuildNode(state, left + 1, middle, end);
+}
+
+void CollisionWorld::FitLeaf(Node &node) const
+{
+    Bounds bounds;
+
+    for (uint32_t i = node.start; i < node.start + node.count; ++i)
+        for (const glm::vec3 &vertex : triangles[order[i]].vertices)
+            bounds.Grow(vertex);
+
+    node.min = bounds.min;
+    node.max = bounds.max;
+}
+
+float CollisionWorld::GetTreeCost() const
+{
+    float cost = 0.0f;
+
+    for (const Node &node : nodes)
+    {
+        Bounds bounds;
+
+        bounds.min = node.min;
+        bounds.max = node.max;
+
+        cost += bounds.Area() * (node.count > 0 ? node.count : 1);
+    }
+
+    return cost;
+}
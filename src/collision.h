@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <VulkanGraphics/FileFormats/PackageNodes.h>
+
+// Static collision for the whole map, built from the PhysX meshes the nifs carry. Every entity's collision triangles
+// are moved into world space and kept in one bounding volume hierarchy. Moving an entity only refits the nodes above
+// its triangles, the tree is built again once refitting has loosened it too much.
+class CollisionWorld
+{
+public:
+    // ignoreEntity lets an entity look past its own collision
+    struct Ray
+    {
+        glm::vec3 origin = glm::vec3(0.0f);
+        glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        float maxDistance = 1e9f;
+        int ignoreEntity = -1;
+    };
+
+    // a sphere of radius moving from origin along direction
+    struct Sweep
+    {
+        glm::vec3 origin = glm::vec3(0.0f);
+        glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        float radius = 1.0f;
+        float maxDistance = 1e9f;
+    };
+
+    // distance is along the normalized direction. sweeps report the contact point and the sphere's centre is at
+    // origin + direction * distance
+    struct Hit
+    {
+        bool hit = false;
+        float distance = 0.0f;
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 normal = glm::vec3(0.0f);
+        int entity = -1;
+    };
+
+    // the triangles of a nif's enabled collision meshes in nif space, three vertices each. made once per model, every
+    // entity of it adds the same ones
+    static std::vector<glm::vec3> GetLocalTriangles(const Engine::Graphics::ModelPackage &package);
+
+    // transform places the triangles in the world. returns -1 if there are none
+    int AddEntity(const std::vector<glm::vec3> &localVertices, const glm::mat4 &transform);
+    void SetTransform(int entity, const glm::mat4 &transform);
+
+    // disabled entities stay in the tree but queries pass through them
+    void SetEnabled(int entity, bool enabled);
+
+    // drops the entity's triangles, the tree is built again on the next update. its index is handed out again later
+    void RemoveEntity(int entity);
+
+    // bytes held for the entity's triangles, in nif space and in world space
+    size_t GetEntitySize(int entity) const;
+
+    // builds the tree after entities were added, refits it after entities moved
+    void Update();
+
+    Hit Raycast(const Ray &ray) const;
+    Hit SphereSweep(const Sweep &sweep) const;
+
+    // the batched versions split the queries across the job system
+    void Raycast(const Ray *rays, Hit *hits, size_t count) const;
+    void SphereSweep(const Sweep *sweeps, Hit *hits, size_t count) const;
+
+    // looks for ground straight below each point, starting searchHeight above it so points that sank in still snap up.
+    // ignoreEntities is optional, one entity per point
+    void SnapToGround(const glm::vec3 *points, Hit *hits, size_t count, float searchHeight, float maxDrop, const int *ignoreEntities = nullptr) const;
+
+    size_t GetEntityCount() const { return entities.size() - freeEntities.size(); }
+    size_t GetTriangleCount() const { return triangles.size(); }
+    size_t GetNodeCount() const { return nodes.size(); }
+    size_t GetRebuildCount() const { return rebuildCount; }
+
+private:
+    // triangles of an entity are contiguous, localVertices keeps them in nif space, three per triangle
+    struct Entity
+    {
+        glm::mat4 transform = glm::mat4(1.0f);
+        std::vector<glm::vec3> localVertices;
+        uint32_t firstTriangle = 0;
+        uint32_t triangleCount = 0;
+        bool moved = false;
+    };
+
+    struct Triangle
+    {
+        glm::vec3 vertices[3];
+        int entity = -1;
+        bool enabled = true;
+    };
+
+    // leaves have count > 0 and cover order[start, start + count), inner nodes have their children at start, start + 1
+    struct Node
+    {
+        glm::vec3 min = glm::vec3(0.0f);
+        uint32_t start = 0;
+        glm::vec3 max = glm::vec3(0.0f);
+        uint32_t count = 0;
+    };
+
+    struct BuildState;
+
+    std::vector<Entity> entities;
+    std::vector<int> freeEntities;
+    std::vector<Triangle> triangles;
+    std::vector<uint32_t> order;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> triangleLeaves;
+
+    bool needsBuild = false;
+    bool anyMoved = false;
+    float builtCost = 0.0f;
+    size_t rebuildCount = 0;
+
+    void TransformEntity(Entity &entity);
+    void Build();
+    void BuildNode(BuildState &state, uint32_t node, uint32_t begin, uint32_t end);
+    void Refit();
+    void FitLeaf(Node &node) const;
+    float GetTreeCost() const;
+};
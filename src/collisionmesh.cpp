@@ -0,0 +1,48 @@
+#include "collision.h"
+
+#include <Engine/Math/Vector3S.h>
+#include <Objects/Transform.h>
+#include <VulkanGraphics/Scene/MeshData.h>
+
+// kept apart from the tree so the collision queries don't depend on the scene graph
+
+std::vector<glm::vec3> CollisionWorld::GetLocalTriangles(const Engine::Graphics::ModelPackage &package)
+{
+    std::vector<glm::vec3> localVertices;
+
+    for (const auto &prop : package.PhysXProps)
+    {
+        for (const auto &actor : prop.Actors)
+        {
+            for (const auto &mesh : actor.Meshes)
+            {
+                if (!mesh.CollisionEnabled || !mesh.Mesh || !mesh.Mesh->GetFormat() || !mesh.Mesh->GetFormat()->GetAttribute("position"))
+                    continue;
+
+                glm::mat4 meshTransform = mesh.Transform ? mesh.Transform->LocalTransformGLM() : glm::mat4(1.0f);
+                std::vector<glm::vec3> positions;
+
+                mesh.Mesh->ForEach<Vector3SF>(mesh.Mesh->GetFormat()->GetAttributeIndex("position"), [&](const Vector3SF &p)
+                                              { positions.push_back(glm::vec3(meshTransform * glm::vec4(p.X, p.Y, p.Z, 1.0f))); });
+
+                const std::vector<int> &indices = mesh.Mesh->GetIndexBuffer();
+
+                for (size_t i = 0; i + 2 < indices.size(); i += 3)
+                {
+                    bool valid = true;
+
+                    for (size_t j = 0; j < 3; ++j)
+                        valid = valid && indices[i + j] >= 0 && static_cast<size_t>(indices[i + j]) < positions.size();
+
+                    if (!valid)
+                        continue;
+
+                    for (size_t j = 0; j < 3; ++j)
+                        localVertices.push_back(positions[indices[i + j]]);
+                }
+            }
+        }
+    }
+
+    return localVertices;
+}
@@ -0,0 +1,247 @@
+#include "filewatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// a steady stream of changes is still let out this often
+static const std::chrono::milliseconds MaxDelay(2000);
+static const std::chrono::milliseconds PollInterval(500);
+static const std::chrono::milliseconds SleepStep(50);
+
+FileWatcher::FileWatcher(const std::vector<std::string> &roots, const std::vector<std::string> &extensions, std::chrono::milliseconds debounce)
+    : roots(roots), extensions(extensions), debounce(debounce)
+{
+#ifdef __linux__
+    inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    native = inotify >= 0;
+
+    for (const std::string &root : roots)
+        native = native && AddWatches(root, false);
+
+    // running out of watches (fs.inotify.max_user_watches) leaves the trees half covered, polling sees all of them
+    if (!native && inotify >= 0)
+    {
+        std::cerr << "[FileWatcher] inotify couldn't watch every directory, polling instead\n";
+
+        close(inotify);
+        inotify = -1;
+        watches.clear();
+    }
+#endif
+
+    if (!native)
+        Scan(false);
+
+    running = true;
+    thread = std::thread(&FileWatcher::Run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    running = false;
+
+    if (thread.joinable())
+        thread.join();
+
+#ifdef __linux__
+    if (inotify >= 0)
+        close(inotify);
+#endif
+}
+
+std::vector<std::string> FileWatcher::TakeChanges()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (pending.empty())
+        return {};
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (now - lastChange < debounce && now - firstChange < MaxDelay)
+        return {};
+
+    std::vector<std::string> changes(pending.begin(), pending.end());
+    pending.clear();
+
+    std::sort(changes.begin(), changes.end());
+
+    return changes;
+}
+
+void FileWatcher::Run()
+{
+    while (running)
+    {
+#ifdef __linux__
+        if (native)
+        {
+            pollfd descriptor = {inotify, POLLIN, 0};
+
+            // the timeout only bounds how long shutting down waits
+            if (poll(&descriptor, 1, 100) > 0)
+                ReadEvents();
+
+            continue;
+        }
+#endif
+
+        for (auto waited = std::chrono::milliseconds(0); running && waited < PollInterval; waited += SleepStep)
+            std::this_thread::sleep_for(SleepStep);
+
+        if (running)
+            Scan(true);
+    }
+}
+
+void FileWatcher::Scan(bool report)
+{
+    std::error_code error;
+
+    for (const std::string &root : roots)
+    {
+        for (fs::recursive_directory_iterator entry(root, fs::directory_options::skip_permission_denied, error), end; entry != end; entry.increment(error))
+        {
+            if (error)
+                break;
+
+            if (!entry->is_regular_file(error) || !IsWatched(entry->path()))
+                continue;
+
+            fs::file_time_type time = entry->last_write_time(error);
+            if (error)
+                continue;
+
+            auto known = times.find(entry->path().string());
+
+            if (known != times.end() && known->second == time)
+                continue;
+
+            times[entry->path().string()] = time;
+
+            if (report)
+                AddChange(entry->path());
+        }
+    }
+}
+
+void FileWatcher::AddChange(const fs::path &path)
+{
+    if (!IsWatched(path))
+        return;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (pending.empty())
+        firstChange = now;
+
+    lastChange = now;
+    pending.insert(path.lexically_normal().generic_string());
+}
+
+bool FileWatcher::IsWatched(const fs::path &path) const
+{
+    if (extensions.empty())
+        return true;
+
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+}
+
+#ifdef __linux__
+// inotify isn't recursive, every directory needs a watch of its own
+bool FileWatcher::AddWatches(const fs::path &directory, bool reportFiles)
+{
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+    std::error_code error;
+    std::vector<fs::path> directories = {directory};
+
+    for (fs::recursive_directory_iterator entry(directory, fs::directory_options::skip_permission_denied, error), end; entry != end; entry.increment(error))
+    {
+        if (error)
+            break;
+
+        if (entry->is_directory(error))
+            directories.push_back(entry->path());
+        else if (reportFiles)
+            AddChange(entry->path());
+    }
+
+    for (const fs::path &path : directories)
+    {
+        int watch = inotify_add_watch(inotify, path.c_str(), mask);
+
+        if (watch < 0)
+            return false;
+
+        watches[watch] = path.string();
+    }
+
+    return true;
+}
+
+void FileWatcher::ReadEvents()
+{
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    for (;;)
+    {
+        ssize_t length = read(inotify, buffer, sizeof(buffer));
+
+        if (length <= 0)
+            return;
+
+        for (char *position = buffer; position < buffer + length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(position);
+            position += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                std::cerr << "[FileWatcher] Too many changes at once, some of them were missed\n";
+                continue;
+            }
+
+            auto watch = watches.find(event->wd);
+            if (watch == watches.end())
+                continue;
+
+            if (event->mask & IN_IGNORED)
+            {
+                watches.erase(watch);
+                continue;
+            }
+
+            if (event->len == 0)
+                continue;
+
+            fs::path path = fs::path(watch->second) / event->name;
+
+            // files can land in a new directory before its watch exists, they're reported while it's being added
+            if (event->mask & IN_ISDIR)
+            {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    AddWatches(path, true);
+
+                continue;
+            }
+
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                AddChange(path);
+        }
+    }
+}
+#endif
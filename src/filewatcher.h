@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Watches directory trees for changed files on a thread of its own. Linux gets inotify, everywhere else the trees are
+// polled for new modification times. Changes are held back until the watched files have been quiet for the debounce
+// time, so a whole folder being exported at once comes out as one batch with every file in it once.
+class FileWatcher
+{
+public:
+    // extensions are lowercase with their dot, an empty list watches every file
+    FileWatcher(const std::vector<std::string> &roots, const std::vector<std::string> &extensions,
+                std::chrono::milliseconds debounce = std::chrono::milliseconds(300));
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    // empty while nothing changed or changes are still coming in
+    std::vector<std::string> TakeChanges();
+
+    bool IsNative() const { return native; }
+
+private:
+    std::vector<std::string> roots;
+    std::vector<std::string> extensions;
+    std::chrono::milliseconds debounce;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+    bool native = false;
+
+    std::mutex lock;
+    std::unordered_set<std::string> pending;
+    std::chrono::steady_clock::time_point firstChange;
+    std::chrono::steady_clock::time_point lastChange;
+
+    // polling only, the last modification time seen for every file
+    std::unordered_map<std::string, std::filesystem::file_time_type> times;
+
+#ifdef __linux__
+    int inotify = -1;
+    std::unordered_map<int, std::string> watches;
+
+    bool AddWatches(const std::filesystem::path &directory, bool reportFiles);
+    void ReadEvents();
+#endif
+
+    void Run();
+    void Scan(bool report);
+    void AddChange(const std::filesystem::path &path);
+    bool IsWatched(const std::filesystem::path &path) const;
+};
@@ -0,0 +1,352 @@
+#include "history.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// payload of a Transforms command, one per entity
+struct TransformDelta
+{
+    int32_t entity;
+    glm::vec3 position;
+    glm::vec3 rotation;
+};
+
+EditHistory::EditHistory(size_t budget) : budget(budget)
+{
+}
+
+void EditHistory::RecordMove(const int *entities, size_t count, const glm::vec3 &positionDelta, const glm::vec3 &rotationDelta)
+{
+    if (count == 0)
+        return;
+
+    // a drag reports a small move every frame, they add up in the command the drag started
+    if (merging && position == commands.size() && !commands.empty())
+    {
+        Command &last = commands.back();
+
+        if (last.type == CommandType::Move && last.count == count)
+        {
+            std::vector<int32_t> lastEntities(count);
+            Read(last.offset + 2 * sizeof(glm::vec3), lastEntities.data(), count * sizeof(int32_t));
+
+            if (std::equal(lastEntities.begin(), lastEntities.end(), entities))
+            {
+                glm::vec3 deltas[2];
+                Read(last.offset, deltas, sizeof(deltas));
+
+                deltas[0] += positionDelta;
+                deltas[1] += rotationDelta;
+                Copy(last.offset, deltas, sizeof(deltas), true);
+
+                return;
+            }
+        }
+    }
+
+    if (!Push(CommandType::Move, count, 2 * sizeof(glm::vec3) + count * sizeof(int32_t)))
+        return;
+
+    Write(&positionDelta, sizeof(glm::vec3));
+    Write(&rotationDelta, sizeof(glm::vec3));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t entity = entities[i];
+        Write(&entity, sizeof(entity));
+    }
+
+    merging = true;
+}
+
+void EditHistory::RecordTransforms(const int *entities, const glm::vec3 *positionDeltas, const glm::vec3 *rotationDeltas, size_t count)
+{
+    merging = false;
+
+    if (count == 0 || !Push(CommandType::Transforms, count, count * sizeof(TransformDelta)))
+        return;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        TransformDelta delta = {entities[i], positionDeltas[i], rotationDeltas[i]};
+        Write(&delta, sizeof(delta));
+    }
+}
+
+void EditHistory::RecordAdd(const int *entities, size_t count)
+{
+    merging = false;
+
+    if (count == 0 || !Push(CommandType::Add, count, count * sizeof(int32_t)))
+        return;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t entity = entities[i];
+        Write(&entity, sizeof(entity));
+    }
+}
+
+void EditHistory::RecordRemove(const int *entities, size_t count)
+{
+    merging = false;
+
+    if (count == 0 || !Push(CommandType::Remove, count, count * sizeof(int32_t)))
+        return;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t entity = entities[i];
+        Write(&entity, sizeof(entity));
+    }
+}
+
+// the entity, then the name, old and new value each behind their length
+void EditHistory::RecordProperty(int entity, const std::string &name, const std::string &oldValue, const std::string &newValue)
+{
+    merging = false;
+
+    size_t size = sizeof(int32_t) + 3 * sizeof(uint32_t) + name.size() + oldValue.size() + newValue.size();
+
+    if (!Push(CommandType::Property, 1, size))
+        return;
+
+    int32_t index = entity;
+    Write(&index, sizeof(index));
+
+    for (const std::string *text : {&name, &oldValue, &newValue})
+    {
+        uint32_t length = static_cast<uint32_t>(text->size());
+        Write(&length, sizeof(length));
+        Write(text->data(), text->size());
+    }
+}
+
+bool EditHistory::Undo(Target &target)
+{
+    merging = false;
+
+    if (position == 0)
+        return false;
+
+    --position;
+    Apply(commands[position], target, false);
+
+    return true;
+}
+
+bool EditHistory::Redo(Target &target)
+{
+    merging = false;
+
+    if (position == commands.size())
+        return false;
+
+    Apply(commands[position], target, true);
+    ++position;
+
+    return true;
+}
+
+void EditHistory::Clear()
+{
+    commands.clear();
+    position = 0;
+    merging = false;
+    begin = end;
+
+    ReleaseChunks();
+}
+
+size_t EditHistory::GetUsedSize() const
+{
+    return static_cast<size_t>(end - begin) + commands.size() * sizeof(Command);
+}
+
+size_t EditHistory::GetMemoryUsage() const
+{
+    return (chunks.size() + (spare ? 1 : 0)) * ChunkSize + commands.size() * sizeof(Command);
+}
+
+// starts a command at the end of the stream, anything that could have been redone is gone after this
+bool EditHistory::Push(CommandType type, size_t count, size_t size)
+{
+    if (position < commands.size())
+    {
+        end = commands[position].offset;
+        commands.resize(position);
+
+        ReleaseChunks();
+    }
+
+    if (size + sizeof(Command) > budget)
+    {
+        std::cerr << "[History] An edit of " << size << " bytes doesn't fit the history, it can't be undone\n";
+
+        dropped += commands.size();
+        Clear();
+
+        return false;
+    }
+
+    while (!commands.empty() && GetUsedSize() + size + sizeof(Command) > budget)
+        DropOldest();
+
+    Command command;
+    command.offset = end;
+    command.size = static_cast<uint32_t>(size);
+    command.count = static_cast<uint32_t>(count);
+    command.type = type;
+
+    commands.push_back(command);
+    position = commands.size();
+
+    return true;
+}
+
+void EditHistory::DropOldest()
+{
+    commands.pop_front();
+
+    if (position > 0)
+        --position;
+
+    begin = commands.empty() ? end : commands.front().offset;
+    ++dropped;
+
+    ReleaseChunks();
+}
+
+// chunks entirely before begin or after end go back to the spare, one is kept so a ring that's full doesn't allocate
+void EditHistory::ReleaseChunks()
+{
+    while (!chunks.empty() && chunkBase + ChunkSize <= begin)
+    {
+        spare = std::move(chunks.front());
+        chunks.pop_front();
+        chunkBase += ChunkSize;
+    }
+
+    while (!chunks.empty() && chunkBase + (chunks.size() - 1) * ChunkSize >= end)
+    {
+        spare = std::move(chunks.back());
+        chunks.pop_back();
+    }
+
+    if (chunks.empty())
+        chunkBase = end - end % ChunkSize;
+}
+
+void EditHistory::Write(const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+    while (size > 0)
+    {
+        size_t chunk = static_cast<size_t>((end - chunkBase) / ChunkSize);
+        size_t offset = static_cast<size_t>((end - chunkBase) % ChunkSize);
+        size_t length = std::min(size, ChunkSize - offset);
+
+        if (chunk == chunks.size())
+            chunks.push_back(spare ? std::move(spare) : std::unique_ptr<uint8_t[]>(new uint8_t[ChunkSize]));
+
+        memcpy(chunks[chunk].get() + offset, bytes, length);
+
+        bytes += length;
+        size -= length;
+        end += length;
+    }
+}
+
+void EditHistory::Copy(uint64_t offset, void *data, size_t size, bool write)
+{
+    uint8_t *bytes = static_cast<uint8_t *>(data);
+
+    while (size > 0)
+    {
+        size_t chunk = static_cast<size_t>((offset - chunkBase) / ChunkSize);
+        size_t start = static_cast<size_t>((offset - chunkBase) % ChunkSize);
+        size_t length = std::min(size, ChunkSize - start);
+
+        if (write)
+            memcpy(chunks[chunk].get() + start, bytes, length);
+        else
+            memcpy(bytes, chunks[chunk].get() + start, length);
+
+        bytes += length;
+        size -= length;
+        offset += length;
+    }
+}
+
+void EditHistory::Apply(const Command &command, Target &target, bool redo)
+{
+    float sign = redo ? 1.0f : -1.0f;
+
+    switch (command.type)
+    {
+    case CommandType::Move:
+    {
+        glm::vec3 deltas[2];
+        std::vector<int32_t> entities(command.count);
+
+        Read(command.offset, deltas, sizeof(deltas));
+        Read(command.offset + sizeof(deltas), entities.data(), entities.size() * sizeof(int32_t));
+
+        for (int32_t entity : entities)
+            target.MoveEntity(entity, deltas[0] * sign, deltas[1] * sign);
+
+        break;
+    }
+    case CommandType::Transforms:
+    {
+        std::vector<TransformDelta> deltas(command.count);
+
+        Read(command.offset, deltas.data(), deltas.size() * sizeof(TransformDelta));
+
+        for (const TransformDelta &delta : deltas)
+            target.MoveEntity(delta.entity, delta.position * sign, delta.rotation * sign);
+
+        break;
+    }
+    case CommandType::Add:
+    case CommandType::Remove:
+    {
+        std::vector<int32_t> entities(command.count);
+        bool removed = (command.type == CommandType::Remove) == redo;
+
+        Read(command.offset, entities.data(), entities.size() * sizeof(int32_t));
+
+        for (int32_t entity : entities)
+            target.SetRemoved(entity, removed);
+
+        break;
+    }
+    case CommandType::Property:
+    {
+        int32_t entity = 0;
+        std::string texts[3];
+        uint64_t offset = command.offset;
+
+        Read(offset, &entity, sizeof(entity));
+        offset += sizeof(entity);
+
+        for (std::string &text : texts)
+        {
+            uint32_t length = 0;
+
+            Read(offset, &length, sizeof(length));
+            offset += sizeof(length);
+
+            text.resize(length);
+            Read(offset, &text[0], length);
+            offset += length;
+        }
+
+        target.SetProperty(entity, texts[0], redo ? texts[2] : texts[1]);
+
+        break;
+    }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Undo and redo for edits to the map. Each edit is a typed command whose payload is packed into one byte stream, so
+// moving thousands of entities by the same amount costs four bytes per entity. The stream is kept in fixed size
+// chunks that are recycled front to back like a ring, once the history goes over its budget the oldest commands are
+// dropped.
+class EditHistory
+{
+public:
+    // what undo and redo change. moves are relative, so replaying them doesn't need to know where things were
+    class Target
+    {
+    public:
+        virtual ~Target() = default;
+
+        virtual void MoveEntity(int entity, const glm::vec3 &positionDelta, const glm::vec3 &rotationDelta) = 0;
+        virtual void SetRemoved(int entity, bool removed) = 0;
+        virtual void SetProperty(int entity, const std::string &name, const std::string &value) = 0;
+    };
+
+    static const size_t ChunkSize = 64 * 1024;
+    static const size_t DefaultBudget = 4 * 1024 * 1024;
+
+    explicit EditHistory(size_t budget = DefaultBudget);
+
+    // every entity moves by the same amount. moves of the same entities keep merging into the last command until
+    // EndMerge, which turns a drag into a single step
+    void RecordMove(const int *entities, size_t count, const glm::vec3 &positionDelta, const glm::vec3 &rotationDelta);
+
+    // every entity moves by its own amount
+    void RecordTransforms(const int *entities, const glm::vec3 *positionDeltas, const glm::vec3 *rotationDeltas, size_t count);
+
+    void RecordAdd(const int *entities, size_t count);
+    void RecordRemove(const int *entities, size_t count);
+    void RecordProperty(int entity, const std::string &name, const std::string &oldValue, const std::string &newValue);
+
+    void EndMerge() { merging = false; }
+
+    bool Undo(Target &target);
+    bool Redo(Target &target);
+    void Clear();
+
+    bool CanUndo() const { return position > 0; }
+    bool CanRedo() const { return position < commands.size(); }
+    size_t GetCommandCount() const { return commands.size(); }
+    size_t GetUndoCount() const { return position; }
+    size_t GetDroppedCount() const { return dropped; }
+    size_t GetBudget() const { return budget; }
+
+    // bytes the stored commands count against the budget, and bytes actually held including unused chunk space
+    size_t GetUsedSize() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    enum class CommandType : uint8_t
+    {
+        Move,
+        Transforms,
+        Add,
+        Remove,
+        Property
+    };
+
+    // offset is where the payload starts in the stream. stream offsets only grow, chunks are addressed relative to
+    // chunkBase, the offset of the first one
+    struct Command
+    {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        uint32_t count = 0;
+        CommandType type = CommandType::Move;
+    };
+
+    size_t budget;
+    std::deque<Command> commands;
+    size_t position = 0;
+    size_t dropped = 0;
+    bool merging = false;
+
+    std::deque<std::unique_ptr<uint8_t[]>> chunks;
+    std::unique_ptr<uint8_t[]> spare;
+    uint64_t chunkBase = 0;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+
+    bool Push(CommandType type, size_t count, size_t size);
+    void DropOldest();
+    void ReleaseChunks();
+    void Write(const void *data, size_t size);
+    void Copy(uint64_t offset, void *data, size_t size, bool write);
+    void Read(uint64_t offset, void *data, size_t size) { Copy(offset, data, size, false); }
+    void Apply(const Command &command, Target &target, bool redo);
+};
@@ -1,6 +1,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define _CRT_SECURE_NO_WARNINGS
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -25,6 +26,7 @@ using namespace tinyxml2;
 #include "Math/Vector3.h"
 #include <Engine/Math/Vector3S.h>
 #include "Objects/Transform.h"
+#include "PageAllocator.h"
 
 #include "VulkanGraphics/FileFormats/NifParser.h"
 #include "VulkanGraphics/FileFormats/PackageNodes.h"
@@ -33,10 +35,22 @@ using namespace tinyxml2;
 #include "MeshLoader.h"
 #include "block.h"
 #include "camera.h"
+#include "assets.h"
+#include "bcn.h"
+#include "catalog.h"
+#include "collision.h"
+#include "filewatcher.h"
+#include "history.h"
 #include "mesh.h"
+#include "occlusion.h"
 #include "shader.h"
+#include "skinning.h"
+#include "xblock.h"
 #include "texture_manager.h"
+#include "thumbnails.h"
 #include "textureloader.h"
+#include "vfs.h"
+#include "world.h"
 
 class DualStreamBuf : public std::streambuf
 {
@@ -68,15 +82,16 @@ private:
     std::streambuf *m_buf2;
 };
 
+// one layer, the shader samples texture arrays
 GLuint CreateWhiteTexture()
 {
     GLuint texID;
     glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
     unsigned char whitePixel[4] = {255, 255, 255, 255};
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, whitePixel);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, whitePixel);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     return texID;
 }
 
@@ -226,270 +241,94 @@ void DrawWireCubeModern(const glm::vec3 &center, const glm::vec3 &halfSize, cons
     glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
 }
 
-struct SceneObject
-{
-    std::string name;
-    std::string modelPath;
-    glm::vec3 position;
-    glm::vec3 rotation;
-    Mesh *mesh = nullptr;
-    GLuint textureID = 0;
-    glm::mat4 modelMatrix = glm::mat4(1.0f);
-    bool printed = false;
-};
+const float CameraRadius = 20.0f;
+const float CameraSkin = 0.5f;
 
-std::vector<SceneObject> LoadXBlockScene(const std::string &xblockPath, const std::string &modelBasePath,
-                                         std::ostream &logStream)
+// stops the camera short of collision and slides it along whatever it ran into
+glm::vec3 ResolveCameraMove(const CollisionWorld &collision, const glm::vec3 &from, const glm::vec3 &to)
 {
-    auto PrintProgress = [](size_t current, size_t total)
-    {
-        const int barWidth = 50;
-        float progress = static_cast<float>(current) / total;
-        std::cout << "[";
-        int pos = static_cast<int>(barWidth * progress);
-        for (int i = 0; i < barWidth; ++i)
-            std::cout << (i < pos ? "=" : (i == pos ? ">" : " "));
-        std::cout << "] " << int(progress * 100.0) << "% (" << current << "/" << total << ")\r";
-        std::cout.flush();
-    };
-
-    std::vector<SceneObject> sceneObjects;
-
-    // Caching the .nif
-    std::unordered_map<std::string, std::string> nifLookup;
-    for (const auto &entry : fs::recursive_directory_iterator(modelBasePath))
-    {
-        if (!entry.is_regular_file())
-            continue;
-
-        if (entry.path().extension() != ".nif")
-            continue; // Skip .dds and others
+    glm::vec3 position = from;
+    glm::vec3 move = to - from;
 
-        std::string stem = entry.path().stem().string();
-        std::string lowered;
-        std::transform(stem.begin(), stem.end(), std::back_inserter(lowered), ::tolower);
-
-        nifLookup[lowered] = entry.path().string(); // overwrite is fine
-    }
-
-    XMLDocument doc;
-    if (doc.LoadFile(xblockPath.c_str()) != XML_SUCCESS)
+    for (int slide = 0; slide < 2; ++slide)
     {
-        std::cerr << "[ERROR] Failed to load XBlock file: " << xblockPath << "\n";
-        return sceneObjects;
-    }
-
-    XMLElement *game = doc.FirstChildElement("game");
-    if (!game)
-        return sceneObjects;
+        float distance = glm::length(move);
 
-    XMLElement *entitySet = game->FirstChildElement("entitySet");
-    if (!entitySet)
-        return sceneObjects;
+        if (distance <= 0.0f)
+            break;
 
-    size_t totalEntities = 0;
-    for (XMLElement *entity = entitySet->FirstChildElement("entity"); entity; entity = entity->NextSiblingElement("entity"))
-        ++totalEntities;
+        CollisionWorld::Sweep sweep;
+        sweep.origin = position;
+        sweep.direction = move / distance;
+        sweep.radius = CameraRadius;
+        sweep.maxDistance = distance + CameraSkin;
 
-    size_t processed = 0;
-    for (XMLElement *entity = entitySet->FirstChildElement("entity"); entity; entity = entity->NextSiblingElement("entity"))
-    {
-        ++processed;
-        PrintProgress(processed, totalEntities);
+        CollisionWorld::Hit hit = collision.SphereSweep(sweep);
 
-        const char *modelName = entity->Attribute("modelName");
-        const char *name = entity->Attribute("name");
-        if (!modelName || !name)
-            continue;
+        if (!hit.hit)
+            return position + move;
 
-        glm::vec3 position(0), rotation(0);
+        float allowed = std::max(std::min(hit.distance - CameraSkin, distance), 0.0f);
 
-        for (XMLElement *prop = entity->FirstChildElement("property"); prop; prop = prop->NextSiblingElement("property"))
-        {
-            const char *propName = prop->Attribute("name");
-            XMLElement *setElem = prop->FirstChildElement("set");
-            if (!propName || !setElem)
-                continue;
+        position += sweep.direction * allowed;
+        move -= sweep.direction * allowed;
 
-            const char *value = setElem->Attribute("value");
-            if (!value)
-                continue;
+        // only the part pushing into the surface is dropped, moving away stays possible
+        float into = glm::dot(move, hit.normal);
 
-            if (strcmp(propName, "Position") == 0)
-            {
-                sscanf(value, "%f, %f, %f", &position.x, &position.y, &position.z);
-            }
-            else if (strcmp(propName, "Rotation") == 0)
-            {
-                sscanf(value, "%f, %f, %f", &rotation.x, &rotation.y, &rotation.z);
-            }
-        }
-
-        // reposition orientation
-        position = glm::vec3(position.x, position.z, -position.y);
-
-        std::string cleanName = modelName;
-        if (!cleanName.empty() && cleanName.back() == '_')
-        {
-            cleanName.pop_back();
-        }
+        if (into < 0.0f)
+            move -= hit.normal * into;
+    }
 
-        std::string lookupName = cleanName;
-        std::transform(lookupName.begin(), lookupName.end(), lookupName.begin(), ::tolower);
+    return position;
+}
 
-        auto it = nifLookup.find(lookupName);
-        if (it == nifLookup.end())
-        {
-            std::cerr << "[WARN] Could not find NIF for: " << cleanName << "\n";
-            continue;
-        }
+// "path" or "path@x,y,z" with the offset in the map's own coordinates
+bool ParseMapArgument(const std::string &argument, std::string &path, glm::vec3 &offset)
+{
+    size_t at = argument.rfind('@');
 
-        std::string fullNifPath = it->second;
+    path = argument.substr(0, at);
+    offset = glm::vec3(0.0f);
 
-        std::ifstream nifFile(fullNifPath, std::ios::binary);
-        if (!nifFile)
-        {
-            std::cerr << "[WARN] Could not open NIF: " << fullNifPath << "\n";
-            continue;
-        }
+    return at == std::string::npos || sscanf(argument.c_str() + at + 1, "%f,%f,%f", &offset.x, &offset.y, &offset.z) == 3;
+}
 
-        // Check file size before reading
-        nifFile.seekg(0, std::ios::end);
-        std::streamsize fileSize = nifFile.tellg();
-        nifFile.seekg(0, std::ios::beg);
+// every .m2h and .m2d pair in directory is mounted in a folder named after it, Textures.m2d as resources/textures
+size_t MountArchives(const std::string &directory, const ArchiveCipher *cipher)
+{
+    size_t mounted = 0;
+    std::error_code error;
 
-        if (fileSize <= 0)
-        {
-            std::cerr << "[ERROR] NIF file is zero-length or unreadable: " << fullNifPath << "\n";
-            continue;
-        }
-        else if (fileSize < 64) // Minimum size threshold (adjust as needed)
-        {
-            std::cerr << "[WARN] NIF file is suspiciously small (" << fileSize << " bytes): " << fullNifPath << "\n";
-        }
+    for (fs::directory_iterator entry(directory, error), end; entry != end; entry.increment(error))
+    {
+        fs::path header = entry->path();
+        std::string extension = header.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
 
-        std::string buffer((std::istreambuf_iterator<char>(nifFile)), std::istreambuf_iterator<char>());
-        if (buffer.empty())
-        {
-            std::cerr << "[ERROR] NIF file is empty or failed to read: " << fullNifPath << "\n";
+        if (extension != ".m2h")
             continue;
-        }
 
-        // Validate magic header
-        const std::string expectedMagic = "Gamebryo File Format";
-        if (buffer.size() < expectedMagic.size() ||
-            std::string_view(buffer.data(), expectedMagic.size()) != expectedMagic)
-        {
-            std::cerr << "[ERROR] Invalid NIF magic header: " << fullNifPath << "\n";
-            continue;
-        }
+        std::unique_ptr<ArchiveSource> archive = std::make_unique<ArchiveSource>(cipher);
 
-        NifParser parser;
-        // Optional: Validate first 4 bytes if NIF has a known header/magic
-        if (buffer.size() < 4 || std::string_view(buffer.data(), 4) != "Game")
-        { // Replace "Game" with real NIF magic if known
-            std::cerr << "[ERROR] Invalid or unrecognized NIF file format: " << fullNifPath << "\n";
+        if (!archive->Open(header.string(), fs::path(header).replace_extension(".m2d").string()))
             continue;
-        }
-        // try-catch block to not die from 1 bad nif
-        try
-        {
-            parser.Parse(std::string_view(buffer.data(), buffer.size()));
-        }
-        catch (const std::exception &e)
-        {
-            std::cerr << "[ERROR] Exception while parsing NIF: " << fullNifPath << "\n";
-            std::cerr << "Reason: " << e.what() << "\n";
-            continue;
-        }
-        auto &package = parser.Package;
-
-        for (const auto &node : package->Nodes)
-        {
-            if (node.Mesh && node.Mesh->GetVertices() > 0)
-            {
-                if (!node.Mesh->GetFormat()->GetAttribute("texcoord"))
-                {
-                    std::cerr << "[WARN] Skipping mesh without texcoord: " << name << "\n";
-                    continue;
-                }
 
-                Mesh *mesh = MeshLoader::LoadFromNode(node);
+        std::string name = header.stem().string();
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
 
-                glm::mat4 modelMatrix = node.Transform ? node.Transform->LocalTransformGLM() : glm::mat4(1.0f);
-
-                std::string textureFileName = fs::path(fullNifPath).stem().string() + ".dds";
-                std::string parentFolder = "unknown";
-                fs::path nifPath = fs::path(fullNifPath).parent_path();
-                if (!nifPath.empty())
-                {
-                    parentFolder = nifPath.parent_path().filename().string();
-                }
-
-                std::string texturePath = "resources/textures/textures/" + parentFolder + "/" + textureFileName;
-                std::replace(texturePath.begin(), texturePath.end(), '\\', '/');
-
-                GLuint textureID = 0;
-
-                // First attempt: best guess path
-                if (fs::exists(texturePath))
-                {
-                    textureID = LoadDDSTexture(texturePath);
-                    if (textureID == 0)
-                        std::cerr << "[WARN] Failed to load texture: " << texturePath << "\n";
-                }
-                else
-                {
-                    // Fallback: full recursive scan in textures/textures/
-                    bool found = false;
-                    for (const auto &entry : fs::recursive_directory_iterator("resources/textures/textures"))
-                    {
-                        if (!entry.is_regular_file() || entry.path().extension() != ".dds")
-                            continue;
-
-                        std::string candidate = entry.path().filename().string();
-                        if (candidate == textureFileName)
-                        {
-                            texturePath = entry.path().string();
-                            std::replace(texturePath.begin(), texturePath.end(), '\\', '/');
-
-                            textureID = LoadDDSTexture(texturePath);
-                            if (textureID == 0)
-                                std::cerr << "[WARN] Failed to load fallback texture: " << texturePath << "\n";
-                            else
-                                std::cout << "[INFO] Fallback matched texture: " << texturePath << "\n";
-
-                            found = true;
-                            break;
-                        }
-                    }
-
-                    if (!found)
-                    {
-                        std::cerr << "[WARN] No texture found for " << name << ": " << textureFileName << "\n";
-                    }
-                }
-
-                if (!mesh || mesh->indexCount > 10000 || mesh->indexCount == 0)
-                {
-                    std::cerr << "[ERROR] Invalid mesh indexCount: "
-                              << (mesh ? mesh->indexCount : 0)
-                              << " for " << name << " (" << fullNifPath << ")\n";
-                    delete mesh;
-                    continue;
-                }
-                SceneObject obj{name, fullNifPath, position, rotation, mesh, textureID};
-                obj.modelMatrix = modelMatrix;
-                sceneObjects.push_back(obj);
-            }
-        }
+        FileSystem::Mount(directory + "/" + name, std::move(archive));
+        ++mounted;
     }
 
-    logStream << "[INFO] Finished loading " << sceneObjects.size() << " SceneObjects from " << xblockPath << "\n";
-    return sceneObjects;
+    // loose files, saved maps among them, win over what's in the archives
+    if (mounted > 0)
+        FileSystem::Mount(directory, std::make_unique<DirectorySource>(directory));
+
+    return mounted;
 }
 
-int main()
+int main(int argc, char **argv)
 {
     if (!glfwInit())
         return -1;
@@ -540,12 +379,83 @@ int main()
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
     shader = new Shader("shaders/vertex.glsl", "shaders/fragment.glsl");
+    shader->bindUniformBlock("BonePalette", SkinningSystem::PaletteBinding);
+
+    // the client's archive keys aren't part of MapWoader, without a cipher only extracted files are found
+    const ArchiveCipher *archiveCipher = nullptr;
+    MountArchives("resources", archiveCipher);
 
-    std::vector<SceneObject> sceneObjects = LoadXBlockScene(
-        "resources/map.xblock",
-        "resources/textures/", logStream);
+    SkinningSystem skinning;
+    CollisionWorld collision;
+    AssetCache assets;
+    World world(skinning, collision, assets, "resources/textures/", World::Settings());
 
-    SceneObject *selectedObject = nullptr;
+    // every argument is a map to open next to the others, a field's neighbours go at their offset
+    std::vector<std::string> mapArguments(argv + 1, argv + argc);
+
+    if (mapArguments.empty())
+        mapArguments.push_back("resources/map.xblock");
+
+    for (const std::string &argument : mapArguments)
+    {
+        std::string mapPath;
+        glm::vec3 offset;
+
+        if (!ParseMapArgument(argument, mapPath, offset))
+            std::cerr << "[World] Expected path@x,y,z, got " << argument << "\n";
+        else
+            world.AddMap(mapPath, offset);
+    }
+
+    // artists re-export into resources/textures while the editor runs, changed files are swapped in place
+    FileWatcher watcher({"resources/textures"}, {".nif", ".dds"});
+
+    std::cout << "[World] " << world.GetMapCount() << " maps, " << world.GetEntityCount() << " entities in " << world.GetCells().size()
+              << " cells, watching for changes " << (watcher.IsNative() ? "with inotify" : "by polling") << "\n";
+
+    // every map of the client, searched from the Maps header. the index is read again only where files changed
+    MapCatalog catalog("resources", "resources/catalog.idx");
+    catalog.StartRefresh();
+
+    // the selected entity's texture, decoded on the CPU
+    ThumbnailCache thumbnails("resources/thumbnails", 128);
+    ThumbnailCache::Thumbnail thumbnail;
+    std::string thumbnailPath;
+    GLuint thumbnailTexture = 0;
+
+    char mapQuery[128] = "";
+    std::vector<uint32_t> mapResults;
+    bool searchMaps = true;
+    float searchTime = 0.0f;
+    int selectedMap = -1;
+
+    bool cameraCollision = false;
+
+    // far objects draw simplified meshes whose error stays under a pixel or so
+    bool useLods = true;
+    float lodPixelError = 1.0f;
+    size_t drawnTriangles = 0;
+    size_t fullTriangles = 0;
+
+    // the static objects of a cell that share a texture are drawn together
+    bool useBatches = true;
+    size_t drawCalls = 0;
+    size_t textureBinds = 0;
+
+    // objects behind the biggest ones on screen aren't drawn, worked out on the CPU
+    OcclusionCuller culler;
+    bool useOcclusion = true;
+    size_t culledDraws = 0;
+    float cullTime = 0.0f;
+
+    // blocks walled in by opaque cubes are never drawn
+    bool interiorCulling = true;
+
+    EditHistory history;
+
+    // selectedEntity is the entity that was clicked, selectedEntities everything the edits apply to
+    int selectedEntity = -1;
+    std::vector<int> selectedEntities;
     static GLuint fallbackTex = CreateWhiteTexture();
     bool mouseCaptured = false;
     bool leftMousePressedLastFrame = false;
@@ -562,20 +472,151 @@ int main()
         lastFrame = currentFrame;
         std::cout << "[DEBUG] deltaTime: " << deltaTime << "\n";
 
+        glm::vec3 previousCameraPosition = camera.Position;
+
         processInput(window, camera);
 
+        std::vector<std::string> changedFiles = watcher.TakeChanges();
+        if (!changedFiles.empty())
+            assets.Reload(changedFiles);
+
+        if (catalog.FinishRefresh())
+        {
+            searchMaps = true;
+            selectedMap = -1;
+        }
+
+        world.Update(camera.Position);
+        collision.Update();
+
+        if (cameraCollision)
+            camera.Position = ResolveCameraMove(collision, previousCameraPosition, camera.Position);
+
         glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         int drawCount = 0;
         int maxDrawLog = 10;
 
-        for (SceneObject &obj : sceneObjects)
+        skinning.Update(deltaTime);
+
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+        float pixelsPerUnit = std::max(fbHeight, 1) / (2.0f * std::tan(glm::radians(camera.Zoom) * 0.5f));
+        world.SelectLods(camera.Position, pixelsPerUnit, lodPixelError);
+
+        view = camera.GetViewMatrix();
+        aspect = static_cast<float>(fbWidth) / std::max(fbHeight, 1);
+        projection = glm::perspective(glm::radians(camera.Zoom), aspect, 1.0f, 10000.0f);
+
+        if (useOcclusion)
         {
+            double start = glfwGetTime();
+            world.CullOccluded(culler, projection * view, camera.Position, pixelsPerUnit);
+            cullTime = static_cast<float>((glfwGetTime() - start) * 1000.0);
+        }
+
+        drawnTriangles = 0;
+        fullTriangles = 0;
+        drawCalls = 0;
+        textureBinds = 0;
+        culledDraws = 0;
+
+        // only a change of array needs a bind, the layer is a uniform or in the vertices
+        GLuint boundArray = 0;
+
+        if (useBatches)
+        {
+            shader->use();
+            shader->setMat4("model", glm::mat4(1.0f));
+            shader->setMat4("view", view);
+            shader->setMat4("projection", projection);
+            shader->setInt("skinned", 0);
+            shader->setInt("texture1", 0);
+            glActiveTexture(GL_TEXTURE0);
+
+            shader->setFloat("layer", 0.0f);
+
+            std::vector<const World::Batch *> batches;
+
+            for (const World::Cell &cell : world.GetCells())
+                for (const World::Batch &batch : cell.batches)
+                {
+                    if (useOcclusion && batch.occluded)
+                        ++culledDraws;
+                    else
+                        batches.push_back(&batch);
+                }
+
+            std::sort(batches.begin(), batches.end(), [](const World::Batch *a, const World::Batch *b)
+                      { return a->material.texture.array < b->material.texture.array; });
+
+            for (const World::Batch *batch : batches)
+            {
+                size_t lod = useLods ? batch->lod : 0;
+                GLuint array = batch->material.texture.array ? batch->material.texture.array : fallbackTex;
+
+                if (array != boundArray)
+                {
+                    glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+                    boundArray = array;
+                    ++textureBinds;
+                }
+
+                batch->mesh->Draw(lod);
+                drawnTriangles += batch->mesh->lods[lod].indexCount / 3;
+                fullTriangles += batch->mesh->indexCount / 3;
+                ++drawCalls;
+            }
+        }
+
+        // opaque objects by material so the ones sharing an array are drawn together, then the blended ones back to front
+        std::vector<const SceneObject *> drawList;
+
+        for (const World::Cell &cell : world.GetCells())
+            for (const SceneObject &obj : cell.objects)
+            {
+                if (obj.removed || obj.hidden || (useBatches && obj.batch >= 0))
+                    continue;
+
+                if (useOcclusion && obj.occluded)
+                {
+                    ++culledDraws;
+                    continue;
+                }
+
+                drawList.push_back(&obj);
+            }
+
+        auto firstBlended = std::stable_partition(drawList.begin(), drawList.end(), [](const SceneObject *obj)
+                                                  { return !obj->material.blended; });
+
+        std::sort(drawList.begin(), firstBlended, [](const SceneObject *a, const SceneObject *b)
+                  { return a->material.GetSortKey() < b->material.GetSortKey(); });
+
+        auto cameraDistance = [&camera](const SceneObject *obj)
+        {
+            return glm::length(glm::vec3(World::GetObjectMatrix(*obj)[3]) - camera.Position);
+        };
+
+        std::sort(firstBlended, drawList.end(), [&cameraDistance](const SceneObject *a, const SceneObject *b)
+                  { return cameraDistance(a) > cameraDistance(b); });
+
+        shader->use();
+        shader->setMat4("view", view);
+        shader->setMat4("projection", projection);
+        shader->setInt("texture1", 0);
+        glActiveTexture(GL_TEXTURE0);
+
+        bool blending = false;
+
+        for (const SceneObject *objPtr : drawList)
+        {
+            const SceneObject &obj = *objPtr;
+
             if (drawCount < maxDrawLog)
             {
                 std::cout << "[DEBUG] Drawing object: " << obj.name << "\n";
-                std::cout << "         Texture ID: " << obj.textureID << "\n";
+                std::cout << "         Texture: " << obj.material.texture.array << ", layer " << obj.material.texture.layer << "\n";
                 if (obj.mesh)
                     std::cout << "         Indices: " << obj.mesh->indexCount << "\n";
                 else
@@ -583,15 +624,58 @@ int main()
             }
             drawCount++;
 
-            shader->use();
-
-            glm::mat4 model = obj.modelMatrix;
+            // blended objects still test against the depth of everything opaque, but don't hide each other
+            if (obj.material.blended && !blending)
+            {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glDepthMask(GL_FALSE);
+                blending = true;
+            }
 
             // Apply object's own rotation *after* adjusting world up-axis
-            model = glm::rotate(model, glm::radians(obj.rotation.z), glm::vec3(0, 0, 1));
-            model = glm::rotate(model, glm::radians(obj.rotation.y), glm::vec3(0, 1, 0));
-            model = glm::rotate(model, glm::radians(obj.rotation.x), glm::vec3(1, 0, 0));
+            glm::mat4 model = World::GetObjectMatrix(obj);
+
+            shader->setMat4("model", model);
+            shader->setInt("skinned", obj.skinIndex >= 0);
+            skinning.Bind(obj.skinIndex);
+
+            GLuint array = obj.material.texture.array ? obj.material.texture.array : fallbackTex;
+
+            if (array != boundArray)
+            {
+                glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+                boundArray = array;
+                ++textureBinds;
+            }
+
+            shader->setFloat("layer", obj.material.texture.array ? static_cast<float>(obj.material.texture.layer) : 0.0f);
+            shader->setFloat("alphaThreshold", obj.material.alphaTested ? obj.material.alphaThreshold : -1.0f);
 
+            if (obj.mesh)
+            {
+                size_t lod = useLods ? std::min(obj.lod, obj.mesh->lods.size() - 1) : 0;
+
+                obj.mesh->Draw(lod);
+                drawnTriangles += obj.mesh->lods[lod].indexCount / 3;
+                fullTriangles += obj.mesh->indexCount / 3;
+                ++drawCalls;
+            }
+        }
+
+        if (blending)
+        {
+            glDisable(GL_BLEND);
+            glDepthMask(GL_TRUE);
+        }
+
+        shader->setInt("skinned", 0);
+        shader->setFloat("layer", 0.0f);
+        shader->setFloat("alphaThreshold", -1.0f);
+
+        // 🔲 Draw outline for selected object
+        if (selectedEntity >= 0)
+        {
             view = camera.GetViewMatrix();
             glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
             if (fbHeight == 0)
@@ -599,101 +683,415 @@ int main()
             aspect = static_cast<float>(fbWidth) / fbHeight;
             projection = glm::perspective(glm::radians(camera.Zoom), aspect, 1.0f, 10000.0f);
 
-            shader->setMat4("model", model);
-            shader->setMat4("view", view);
-            shader->setMat4("projection", projection);
+            glm::vec3 center = world.GetEntity(selectedEntity).position;
+            glm::vec3 halfSize(75.0f); // adjust if needed
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, obj.textureID ? obj.textureID : fallbackTex);
-            shader->setInt("texture1", 0);
+            DrawWireCubeModern(center, halfSize, view, projection, shader);
 
-            if (obj.mesh)
+            for (int entity : selectedEntities)
             {
-                obj.mesh->Draw();
+                if (entity != selectedEntity)
+                    DrawWireCubeModern(world.GetEntity(entity).position, halfSize, view, projection, shader);
             }
+        }
+
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
 
-            // 🔲 Draw outline for selected object
-            if (selectedObject && selectedObject->mesh)
+        ImGui::SetNextWindowSize(ImVec2(300, 150), ImGuiCond_Once);
+        ImGui::SetNextWindowSizeConstraints(ImVec2(300, 100), ImVec2(FLT_MAX, FLT_MAX));
+
+        ImGui::Begin("Debug Info");
+        ImGui::Text("FPS: %.1f (%.3f ms)", ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
+        ImGui::Text("Camera: (%.1f, %.1f, %.1f)", camera.Position.x, camera.Position.y, camera.Position.z);
+        if (selectedEntity >= 0)
+        {
+            const World::Entity &selected = world.GetEntity(selectedEntity);
+
+            ImGui::Separator();
+            ImGui::Text("Selected:");
+            ImGui::Text("Name: %s", selected.name.c_str());
+            ImGui::Text("Model: %s", selected.modelPath.c_str());
+            ImGui::Text("Map: %s", world.GetMapPath(selected.map).c_str());
+            ImGui::Text("Pos: (%.1f, %.1f, %.1f)", selected.position.x, selected.position.y, selected.position.z);
+
+            if (selected.texturePath != thumbnailPath)
             {
-                view = camera.GetViewMatrix();
-                glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
-                if (fbHeight == 0)
-                    fbHeight = 1;
-                aspect = static_cast<float>(fbWidth) / fbHeight;
-                projection = glm::perspective(glm::radians(camera.Zoom), aspect, 1.0f, 10000.0f);
+                thumbnailPath = selected.texturePath;
+
+                if (thumbnailPath.empty() || !thumbnails.Get(thumbnailPath, thumbnail))
+                    thumbnail = ThumbnailCache::Thumbnail();
 
-                glm::vec3 center = selectedObject->position;
-                glm::vec3 halfSize(75.0f); // adjust if needed
+                if (thumbnailTexture == 0)
+                    glGenTextures(1, &thumbnailTexture);
 
-                DrawWireCubeModern(center, halfSize, view, projection, shader);
+                glBindTexture(GL_TEXTURE_2D, thumbnailTexture);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, thumbnail.width, thumbnail.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, thumbnail.pixels.data());
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glBindTexture(GL_TEXTURE_2D, 0);
             }
 
-            ImGui_ImplOpenGL3_NewFrame();
-            ImGui_ImplGlfw_NewFrame();
-            ImGui::NewFrame();
+            if (thumbnail.width > 0)
+                ImGui::Image(static_cast<ImTextureID>(thumbnailTexture), ImVec2(static_cast<float>(thumbnail.width), static_cast<float>(thumbnail.height)));
 
-            ImGui::SetNextWindowSize(ImVec2(300, 150), ImGuiCond_Once);
-            ImGui::SetNextWindowSizeConstraints(ImVec2(300, 100), ImVec2(FLT_MAX, FLT_MAX));
+            if (selectedEntities.size() > 1)
+                ImGui::Text("%zu entities selected", selectedEntities.size());
+        }
 
-            ImGui::Begin("Debug Info");
-            ImGui::Text("FPS: %.1f (%.3f ms)", ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
-            ImGui::Text("Camera: (%.1f, %.1f, %.1f)", camera.Position.x, camera.Position.y, camera.Position.z);
-            if (selectedObject)
+        if (selectedEntity >= 0 && !selectedEntities.empty())
+        {
+            if (ImGui::Button("Snap to ground"))
             {
-                ImGui::Separator();
-                ImGui::Text("Selected:");
-                ImGui::Text("Name: %s", selectedObject->name.c_str());
-                ImGui::Text("Model: %s", selectedObject->modelPath.c_str());
-                ImGui::Text("Pos: (%.1f, %.1f, %.1f)", selectedObject->position.x, selectedObject->position.y, selectedObject->position.z);
+                // every entity drops by its own amount, the whole selection is still one step to undo
+                std::vector<glm::vec3> points;
+                std::vector<int> ignoreEntities;
+
+                for (int entity : selectedEntities)
+                {
+                    points.push_back(world.GetEntity(entity).position);
+                    ignoreEntities.push_back(world.GetEntity(entity).collisionIndex);
+                }
+
+                std::vector<CollisionWorld::Hit> grounds(points.size());
+                collision.SnapToGround(points.data(), grounds.data(), points.size(), 200.0f, 5000.0f, ignoreEntities.data());
+
+                std::vector<int> snapped;
+                std::vector<glm::vec3> positionDeltas;
+
+                for (size_t i = 0; i < grounds.size(); ++i)
+                {
+                    if (!grounds[i].hit)
+                        continue;
+
+                    glm::vec3 delta(0.0f, grounds[i].position.y - points[i].y, 0.0f);
+
+                    world.MoveEntity(selectedEntities[i], delta, glm::vec3(0.0f));
+                    snapped.push_back(selectedEntities[i]);
+                    positionDeltas.push_back(delta);
+                }
+
+                std::vector<glm::vec3> rotationDeltas(snapped.size(), glm::vec3(0.0f));
+                history.RecordTransforms(snapped.data(), positionDeltas.data(), rotationDeltas.data(), snapped.size());
+
+                std::cout << "[Collision] Snapped " << snapped.size() << " of " << selectedEntities.size() << " entities to the ground\n";
             }
 
-            ImGui::End();
+            ImGui::SameLine();
 
-            ImGui::Render();
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            if (ImGui::Button("Select same model"))
+            {
+                // cells that aren't loaded count too, the edits reach them all the same
+                std::string modelPath = world.GetEntity(selectedEntity).modelPath;
 
-            glfwSwapBuffers(window);
-            glfwPollEvents();
+                selectedEntities.clear();
 
-            // Ray picking
-            ImVec2 mouse = ImGui::GetMousePos();
+                for (size_t entity = 0; entity < world.GetEntityCount(); ++entity)
+                {
+                    const World::Entity &candidate = world.GetEntity(static_cast<int>(entity));
 
-            glfwGetFramebufferSize(window, &fbWidth, &fbHeight); // use framebuffer size!
-            if (fbHeight == 0)
-                fbHeight = 1;
-            aspect = static_cast<float>(fbWidth) / fbHeight;
-            projection = glm::perspective(glm::radians(camera.Zoom), aspect, 1.0f, 10000.0f);
-            view = camera.GetViewMatrix();
+                    if (!candidate.removed && candidate.modelPath == modelPath)
+                        selectedEntities.push_back(static_cast<int>(entity));
+                }
+            }
 
-            float x = (2.0f * mouse.x) / fbWidth - 1.0f;
-            float y = 1.0f - (2.0f * mouse.y) / fbHeight;
-            glm::vec4 rayClip = glm::vec4(x, y, -1.0f, 1.0f);
+            // the drags edit the selected object, the rest of the selection moves along by the same amount
+            glm::vec3 position = world.GetXBlockPosition(selectedEntity);
+            glm::vec3 rotation = world.GetEntity(selectedEntity).rotation;
+            glm::vec3 oldPosition = position;
+            glm::vec3 oldRotation = rotation;
 
-            if (fbHeight == 0)
-                fbHeight = 1;
-            aspect = static_cast<float>(fbWidth) / fbHeight;
-            projection = glm::perspective(glm::radians(camera.Zoom), aspect, 1.0f, 10000.0f);
-            view = camera.GetViewMatrix();
+            bool changed = ImGui::DragFloat3("Position", &position.x, 10.0f);
+            if (ImGui::IsItemDeactivated())
+                history.EndMerge();
+
+            changed |= ImGui::DragFloat3("Rotation", &rotation.x, 1.0f);
+            if (ImGui::IsItemDeactivated())
+                history.EndMerge();
+
+            if (changed)
+            {
+                glm::vec3 delta = position - oldPosition;
+                glm::vec3 positionDelta(delta.x, delta.z, -delta.y);
+                glm::vec3 rotationDelta = rotation - oldRotation;
+
+                for (int entity : selectedEntities)
+                    world.MoveEntity(entity, positionDelta, rotationDelta);
+
+                history.RecordMove(selectedEntities.data(), selectedEntities.size(), positionDelta, rotationDelta);
+            }
+
+            if (ImGui::Button("Duplicate"))
+            {
+                // copies land one block over
+                std::vector<int> duplicates;
+
+                for (int entity : selectedEntities)
+                {
+                    int duplicate = world.Duplicate(entity);
+
+                    world.MoveEntity(duplicate, glm::vec3(150.0f, 0.0f, 0.0f), glm::vec3(0.0f));
+                    duplicates.push_back(duplicate);
+                }
+
+                history.RecordAdd(duplicates.data(), duplicates.size());
+
+                selectedEntities = duplicates;
+                selectedEntity = duplicates.front();
+
+                std::cout << "[XBlock] Duplicated " << duplicates.size() << " entities\n";
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Delete"))
+            {
+                for (int entity : selectedEntities)
+                    world.SetRemoved(entity, true);
+
+                history.RecordRemove(selectedEntities.data(), selectedEntities.size());
+
+                std::cout << "[XBlock] Deleted " << selectedEntities.size() << " entities\n";
+
+                selectedEntities.clear();
+                selectedEntity = -1;
+            }
+        }
+
+        ImGui::Separator();
+
+        bool saveShortcut = ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_S, false);
+        bool undoShortcut = ImGui::GetIO().KeyCtrl && !ImGui::GetIO().KeyShift && ImGui::IsKeyPressed(ImGuiKey_Z, false);
+        bool redoShortcut = ImGui::GetIO().KeyCtrl && (ImGui::IsKeyPressed(ImGuiKey_Y, false) || (ImGui::GetIO().KeyShift && ImGui::IsKeyPressed(ImGuiKey_Z, false)));
+
+        bool undone = (ImGui::Button("Undo") || undoShortcut) && history.Undo(world);
+        ImGui::SameLine();
+        bool redone = (ImGui::Button("Redo") || redoShortcut) && history.Redo(world);
+
+        if (undone || redone)
+        {
+            // undo can take away entities that were selected
+            selectedEntities.erase(std::remove_if(selectedEntities.begin(), selectedEntities.end(), [&world](int entity)
+                                                  { return world.GetEntity(entity).removed; }),
+                                   selectedEntities.end());
+
+            if (selectedEntity >= 0 && world.GetEntity(selectedEntity).removed)
+                selectedEntity = selectedEntities.empty() ? -1 : selectedEntities.front();
+        }
+
+        ImGui::Text("Unsaved entities: %zu", world.GetPendingCount());
+
+        if ((ImGui::Button("Save maps") || saveShortcut) && world.GetPendingCount() > 0)
+            world.Save();
+
+        if (ImGui::CollapsingHeader("History"))
+        {
+            ImGui::Text("%zu commands, %zu to undo, %zu dropped", history.GetCommandCount(), history.GetUndoCount(), history.GetDroppedCount());
+            ImGui::Text("Used: %.1f of %.1f KB (%.1f KB allocated)", history.GetUsedSize() / 1024.0f, history.GetBudget() / 1024.0f,
+                        history.GetMemoryUsage() / 1024.0f);
+        }
+
+        if (ImGui::CollapsingHeader("Collision"))
+        {
+            ImGui::Text("%zu entities, %zu triangles, %zu nodes, %zu builds", collision.GetEntityCount(), collision.GetTriangleCount(),
+                        collision.GetNodeCount(), collision.GetRebuildCount());
+            ImGui::Checkbox("Camera collision", &cameraCollision);
+
+            CollisionWorld::Hit ground;
+            collision.SnapToGround(&camera.Position, &ground, 1, 0.0f, 100000.0f);
+
+            if (ground.hit)
+                ImGui::Text("Ground: %.1f below, %.0f deg slope", ground.distance, glm::degrees(std::acos(std::min(std::abs(ground.normal.y), 1.0f))));
+            else
+                ImGui::Text("Ground: none below");
+        }
+
+        if (ImGui::CollapsingHeader("Assets"))
+        {
+            ImGui::Text("%zu models, %zu textures, %zu loading", assets.GetModelCount(), assets.GetTextureCount(), assets.GetLoadingCount());
+            ImGui::Text("%zu files reloaded, watching %s", assets.GetReloadCount(), watcher.IsNative() ? "with inotify" : "by polling");
+            ImGui::Text("Thumbnails: %zu decoded, %zu from the cache", thumbnails.GetDecodedCount(), thumbnails.GetCachedCount());
+
+            ImGui::Text("BCn: %s decoder", GetBlockDecoderName());
+        }
+
+        if (ImGui::CollapsingHeader("World"))
+        {
+            const World::Settings &settings = world.GetSettings();
+
+            ImGui::Text("%zu maps, %zu entities", world.GetMapCount(), world.GetEntityCount());
+            ImGui::Text("Cells: %zu loaded, %zu loading of %zu", world.GetCellCount(World::CellState::Loaded),
+                        world.GetCellCount(World::CellState::Loading), world.GetCells().size());
+            ImGui::Text("CPU: %.1f of %.1f MB", world.GetCpuBytes() / 1048576.0f, settings.cpuBudget / 1048576.0f);
+            ImGui::Text("GPU: %.1f of %.1f MB", world.GetGpuBytes() / 1048576.0f, settings.gpuBudget / 1048576.0f);
+            ImGui::Text("%zu cells dropped for the budget, %zu assets freed", world.GetEvictionCount(), assets.GetFreedCount());
+            ImGui::Text("Triangles: %zu drawn of %zu", drawnTriangles, fullTriangles);
+            ImGui::Checkbox("Mesh LODs", &useLods);
+            ImGui::SliderFloat("LOD pixel error", &lodPixelError, 0.25f, 8.0f, "%.2f");
+            ImGui::Text("Draw calls: %zu, %zu batches", drawCalls, world.GetBatchCount());
+            ImGui::Text("Texture binds: %zu, %zu arrays, %zu layers", textureBinds, assets.GetTexturePool().GetArrayCount(),
+                        assets.GetTexturePool().GetLayerCount());
+            ImGui::Checkbox("Batch static objects", &useBatches);
+            ImGui::Text("Occlusion: %zu draws culled, %zu occluders, %zu triangles, %.2f ms", culledDraws, culler.GetOccluderCount(),
+                        culler.GetTriangleCount(), cullTime);
+            ImGui::Checkbox("Occlusion culling", &useOcclusion);
+            ImGui::Text("Interior blocks hidden: %zu", world.GetHiddenCount());
+
+            if (ImGui::Checkbox("Hide interior blocks", &interiorCulling))
+                world.SetInteriorCulling(interiorCulling);
+        }
 
-            glm::vec4 rayEye = glm::inverse(projection) * rayClip;
-            rayEye = glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f);
+        if (ImGui::CollapsingHeader("Memory"))
+        {
+            AssetCache::MemoryStats memory = assets.GetMemoryStats();
+
+            ImGui::Text("Parser scratch: %.1f MB, %.1f MB freed after parsing", memory.parserScratch / 1048576.0f, memory.dropped / 1048576.0f);
+            ImGui::Text("CPU meshes: %.1f MB", memory.cpuMeshes / 1048576.0f);
+            ImGui::Text("Objects and collision: %.1f MB", world.GetObjectBytes() / 1048576.0f);
+            ImGui::Text("GPU buffers: %.1f MB, %.1f MB of it batches", (memory.gpuBuffers + world.GetBatchBytes()) / 1048576.0f,
+                        world.GetBatchBytes() / 1048576.0f);
+            ImGui::Text("Textures: %.1f MB in %zu arrays", memory.textures / 1048576.0f, assets.GetTexturePool().GetArrayCount());
+        }
 
-            glm::vec3 rayWorld = glm::normalize(glm::vec3(glm::inverse(view) * rayEye));
+        if (ImGui::CollapsingHeader("Animation"))
+        {
+            auto clips = assets.GetClipReport();
 
-            static bool leftMousePressedLastFrame = false;
-            bool leftMousePressedNow = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+            ImGui::Text("%zu skeletons, %zu skinned meshes", skinning.GetSkeletonCount(), skinning.GetMeshCount());
+            ImGui::Text("Tracks: %zu, %zu constant, %zu keys", clips.Tracks, clips.ConstantTracks, clips.Keys);
+            ImGui::Text("Clips: %.1f KB compressed from %.1f KB", clips.CompressedBytes / 1024.0f, clips.SourceBytes / 1024.0f);
+            ImGui::Text("Worst error: %.4f translation, %.3f deg rotation, %.4f scale", clips.MaxTranslationError,
+                        glm::degrees(clips.MaxRotationError), clips.MaxScaleError);
+        }
 
-            if (!mouseCaptured && leftMousePressedNow && !leftMousePressedLastFrame)
+        if (ImGui::CollapsingHeader("Maps"))
+        {
+            if (ImGui::InputTextWithHint("##MapQuery", "name, or model:name", mapQuery, sizeof(mapQuery)))
+                searchMaps = true;
+
+            if (searchMaps)
             {
-                std::cout << "[DEBUG] Mouse click detected, performing ray test...\n";
-                std::cout << "[DEBUG] Ray origin: " << camera.Position.x << ", " << camera.Position.y << ", " << camera.Position.z << "\n";
-                std::cout << "[DEBUG] Ray dir: " << rayWorld.x << ", " << rayWorld.y << ", " << rayWorld.z << "\n";
+                double start = glfwGetTime();
+                catalog.Search(mapQuery, mapResults);
+                searchTime = static_cast<float>((glfwGetTime() - start) * 1000.0);
+                searchMaps = false;
+            }
 
-                float closestHit = 1e9f;
-                selectedObject = nullptr; // <- important: use global one
+            ImGui::Text("%zu of %zu maps in %.3f ms%s", mapResults.size(), catalog.GetMapCount(), searchTime,
+                        catalog.IsRefreshing() ? ", refreshing" : "");
 
-                for (SceneObject &obj : sceneObjects)
+            ImGui::BeginChild("MapResults", ImVec2(0, 150), true);
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(mapResults.size()));
+
+            while (clipper.Step())
+            {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
                 {
+                    const MapCatalog::Map &map = catalog.GetMap(mapResults[i]);
+                    std::string label = map.id + " (" + std::to_string(map.entityCount) + ")##" + map.path;
+
+                    if (ImGui::Selectable(label.c_str(), selectedMap == static_cast<int>(mapResults[i])))
+                        selectedMap = static_cast<int>(mapResults[i]);
+                }
+            }
+
+            ImGui::EndChild();
+
+            if (selectedMap >= 0)
+            {
+                const MapCatalog::Map &map = catalog.GetMap(selectedMap);
+
+                ImGui::TextWrapped("%s", map.path.c_str());
+                ImGui::Text("%u entities, %zu models", map.entityCount, map.models.size());
+                ImGui::Text("Min: (%.0f, %.0f, %.0f)", map.min.x, map.min.y, map.min.z);
+                ImGui::Text("Max: (%.0f, %.0f, %.0f)", map.max.x, map.max.y, map.max.z);
+
+                if (ImGui::TreeNode("Models"))
+                {
+                    for (uint32_t model : map.models)
+                        ImGui::TextUnformatted(catalog.GetModelName(model).c_str());
+
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::Button("Add to world"))
+                    world.AddMap(map.path, glm::vec3(0.0f));
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Object Pools"))
+        {
+            AllocatorStats totals = AllocatorRegistry::GetTotals();
+
+            ImGui::Text("Live: %zu blocks, %.1f KB (peak %.1f KB)", totals.LiveBlocks, totals.LiveBytes / 1024.0f, totals.PeakBytes / 1024.0f);
+            ImGui::Text("Pages: %zu (peak %zu), %zu empty, %zu released", totals.Pages, totals.PeakPages, totals.EmptyPages, totals.ReleasedPages);
+            ImGui::Text("Reserved: %.1f KB", totals.ReservedBytes / 1024.0f);
+
+            for (BaseAllocator *allocator : AllocatorRegistry::GetAllocators())
+            {
+                AllocatorStats stats = allocator->GetStats();
+
+                if (stats.PeakBlocks == 0)
+                    continue;
+
+                ImGui::Text("%5d B: %zu live, %zu peak, %zu pages, %.0f%% unused", stats.BlockSize, stats.LiveBlocks, stats.PeakBlocks, stats.Pages, stats.Fragmentation() * 100.0f);
+            }
+        }
+
+        ImGui::End();
+
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+
+        // Ray picking
+        ImVec2 mouse = ImGui::GetMousePos();
+
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight); // use framebuffer size!
+        if (fbHeight == 0)
+            fbHeight = 1;
+        aspect = static_cast<float>(fbWidth) / fbHeight;
+        projection = glm::perspective(glm::radians(camera.Zoom), aspect, 1.0f, 10000.0f);
+        view = camera.GetViewMatrix();
+
+        float x = (2.0f * mouse.x) / fbWidth - 1.0f;
+        float y = 1.0f - (2.0f * mouse.y) / fbHeight;
+        glm::vec4 rayClip = glm::vec4(x, y, -1.0f, 1.0f);
+
+        if (fbHeight == 0)
+            fbHeight = 1;
+        aspect = static_cast<float>(fbWidth) / fbHeight;
+        projection = glm::perspective(glm::radians(camera.Zoom), aspect, 1.0f, 10000.0f);
+        view = camera.GetViewMatrix();
+
+        glm::vec4 rayEye = glm::inverse(projection) * rayClip;
+        rayEye = glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f);
+
+        glm::vec3 rayWorld = glm::normalize(glm::vec3(glm::inverse(view) * rayEye));
+
+        static bool leftMousePressedLastFrame = false;
+        bool leftMousePressedNow = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+
+        if (!mouseCaptured && !ImGui::GetIO().WantCaptureMouse && leftMousePressedNow && !leftMousePressedLastFrame)
+        {
+            std::cout << "[DEBUG] Mouse click detected, performing ray test...\n";
+            std::cout << "[DEBUG] Ray origin: " << camera.Position.x << ", " << camera.Position.y << ", " << camera.Position.z << "\n";
+            std::cout << "[DEBUG] Ray dir: " << rayWorld.x << ", " << rayWorld.y << ", " << rayWorld.z << "\n";
+
+            float closestHit = 1e9f;
+            const SceneObject *hitObject = nullptr;
+
+            for (const World::Cell &cell : world.GetCells())
+                for (const SceneObject &obj : cell.objects)
+                {
+                    if (obj.removed)
+                        continue;
+
                     glm::vec3 center = obj.position;
                     glm::vec3 halfSize(75.0f); // <- help wtf do i do
 
@@ -706,47 +1104,83 @@ int main()
                         if (t > 0.0f && t < closestHit)
                         {
                             closestHit = t;
-                            selectedObject = &obj;
+                            hitObject = &obj;
                         }
                     }
                 }
 
-                if (selectedObject)
-                    std::cout << "[DEBUG] Selected object: " << selectedObject->name << "\n";
-            }
-
-            leftMousePressedLastFrame = leftMousePressedNow;
+            // shift adds to the selection or takes back out what's already in it
+            bool addToSelection = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
 
-            // Camera control toggle
-            static bool altHeldLastFrame = false;
-
-            bool altPressed = glfwGetKey(window, GLFW_KEY_LEFT_ALT) == GLFW_PRESS;
+            if (!addToSelection)
+            {
+                selectedEntity = -1;
+                selectedEntities.clear();
+            }
 
-            if (altPressed && !altHeldLastFrame)
+            if (hitObject)
             {
-                mouseCaptured = !mouseCaptured;
+                auto selected = std::find(selectedEntities.begin(), selectedEntities.end(), hitObject->entityIndex);
 
-                if (mouseCaptured)
+                if (selected == selectedEntities.end())
                 {
-                    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-                    camera.EnableRotation = true;
+                    selectedEntities.push_back(hitObject->entityIndex);
+                    selectedEntity = hitObject->entityIndex;
                 }
-                else
+                else if (addToSelection)
                 {
-                    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-                    camera.EnableRotation = false;
+                    selectedEntities.erase(selected);
+
+                    if (selectedEntity == hitObject->entityIndex)
+                        selectedEntity = selectedEntities.empty() ? -1 : selectedEntities.front();
                 }
             }
 
-            altHeldLastFrame = altPressed;
+            if (selectedEntity >= 0)
+                std::cout << "[DEBUG] Selected object: " << world.GetEntity(selectedEntity).name << "\n";
         }
 
-        ImGui_ImplOpenGL3_Shutdown();
-        ImGui_ImplGlfw_Shutdown();
-        ImGui::DestroyContext();
-        glfwTerminate();
+        leftMousePressedLastFrame = leftMousePressedNow;
+
+        // Camera control toggle
+        static bool altHeldLastFrame = false;
 
-        delete shader;
-        return 0;
+        bool altPressed = glfwGetKey(window, GLFW_KEY_LEFT_ALT) == GLFW_PRESS;
+
+        if (altPressed && !altHeldLastFrame)
+        {
+            mouseCaptured = !mouseCaptured;
+
+            if (mouseCaptured)
+            {
+                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+                camera.EnableRotation = true;
+            }
+            else
+            {
+                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+                camera.EnableRotation = false;
+            }
+        }
+
+        altHeldLastFrame = altPressed;
     }
+
+    if (thumbnailTexture != 0)
+        glDeleteTextures(1, &thumbnailTexture);
+
+    world.Release();
+    skinning.Release();
+    assets.Release();
+
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+    glfwTerminate();
+
+    delete shader;
+
+    AllocatorRegistry::ReportLeaks(std::cout);
+
+    return 0;
 }
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+#include "texturepool.h"
+
+// How an object is drawn, made from its nif node's material once the textures are loaded. Draws go in the order of
+// their sort keys: opaque before alpha tested before blended, and within those by texture array, so the arrays are bound
+// once each.
+struct Material
+{
+    TextureLayer texture;
+    bool alphaTested = false;
+    float alphaThreshold = 0.0f; // 0 to 1
+    bool blended = false;        // drawn after everything else, back to front and without writing depth
+
+    uint64_t GetSortKey() const
+    {
+        return (static_cast<uint64_t>(blended) << 63) | (static_cast<uint64_t>(alphaTested) << 62) |
+               (static_cast<uint64_t>(texture.array & 0x3FFFFFFF) << 32) | static_cast<uint32_t>(texture.layer);
+    }
+};
@@ -2,6 +2,7 @@
 #pragma once
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <algorithm>
 #include <vector>
 #include <iostream>
 
@@ -19,26 +20,41 @@ public:
         glm::vec3 morphpos = glm::vec3(0.0f);
         glm::u8vec4 blendIndices = glm::u8vec4(0);
         glm::vec4 blendWeight = glm::vec4(0.0f);
+        float layer = 0.0f; // in the texture array, added to the draw's layer
     };
 
-    unsigned int VAO, VBO, EBO;
-    size_t indexCount;
-
-    Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+    // a simplified version of the mesh, its indices follow the full mesh's in the same buffer and use the same vertices
+    struct Lod
     {
-        indexCount = indices.size();
+        size_t firstIndex = 0;
+        size_t indexCount = 0;
+        float error = 0.0f; // how far the surface moved at most, in the mesh's units
+    };
 
+    unsigned int VAO, VBO, EBO;
+    size_t vertexCount;
+    size_t indexCount;     // of the full mesh
+    std::vector<Lod> lods; // lods[0] is the full mesh
+    size_t maxIndexCount = 10000; // Draw refuses more, merged meshes raise it
+    glm::vec3 min = glm::vec3(0.0f); // bounds of the positions
+    glm::vec3 max = glm::vec3(0.0f);
+
+    // small meshes keep the full mesh's positions and indices, the occlusion culler draws them on the CPU
+    static const size_t MaxOccluderIndexCount = 768;
+    std::vector<glm::vec3> occluderPositions;
+    std::vector<unsigned int> occluderIndices;
+
+    // without lods, indices is the full mesh and nothing else
+    Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<Lod> &lods = {})
+    {
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        Upload(vertices, indices, lods);
 
+        glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
         glEnableVertexAttribArray(0);
@@ -67,19 +83,96 @@ public:
         glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, blendWeight));
         glEnableVertexAttribArray(8);
 
+        glVertexAttribPointer(9, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, layer));
+        glEnableVertexAttribArray(9);
+
         glBindVertexArray(0);
     }
 
-    void Draw()
+    // replaces the contents of the existing buffers, so everything drawing this mesh picks up the new data
+    void Upload(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<Lod> &lods = {})
     {
-        if (indexCount == 0 || indexCount > 10000)
+        this->lods = lods;
+
+        if (this->lods.empty())
+            this->lods.push_back({0, indices.size(), 0.0f});
+
+        vertexCount = vertices.size();
+        indexCount = this->lods[0].indexCount;
+
+        min = vertices.empty() ? glm::vec3(0.0f) : vertices[0].position;
+        max = min;
+
+        for (const Vertex &vertex : vertices)
+        {
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+        }
+
+        occluderPositions.clear();
+        occluderIndices.clear();
+
+        if (indexCount <= MaxOccluderIndexCount)
+        {
+            for (const Vertex &vertex : vertices)
+                occluderPositions.push_back(vertex.position);
+
+            occluderIndices.assign(indices.begin() + this->lods[0].firstIndex, indices.begin() + this->lods[0].firstIndex + indexCount);
+        }
+
+        glBindVertexArray(VAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+    }
+
+    // every index in the buffer, the full mesh and its lods
+    size_t GetBufferIndexCount() const
+    {
+        return lods.back().firstIndex + lods.back().indexCount;
+    }
+
+    // reads both buffers back, for building other meshes out of this one
+    void Download(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) const
+    {
+        vertices.resize(vertexCount);
+        indices.resize(GetBufferIndexCount());
+
+        // the copy target leaves the element buffer of whatever VAO is bound alone
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, indices.size() * sizeof(unsigned int), indices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    // points count indices from firstIndex at vertex 0, so the triangles there stop being drawn
+    void ClearIndices(size_t firstIndex, size_t count)
+    {
+        std::vector<unsigned int> zeros(count, 0);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(unsigned int), count * sizeof(unsigned int), zeros.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    void Draw(size_t level = 0)
+    {
+        if (indexCount == 0 || indexCount > maxIndexCount)
         {
             std::cerr << "[ERROR] Invalid indexCount: " << indexCount << std::endl;
             return;
         }
 
+        const Lod &lod = lods[std::min(level, lods.size() - 1)];
+
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount), GL_UNSIGNED_INT, (void *)(lod.firstIndex * sizeof(unsigned int)));
         glBindVertexArray(0);
     }
 
@@ -9,14 +9,38 @@
 
 #include <iostream>
 
-Mesh *MeshLoader::LoadFromNode(const Engine::Graphics::ModelPackageNode &node)
+// converts up to 4 elements of any attribute type to float, missing elements stay 0
+static void ReadAttribute(const Engine::Graphics::MeshData &mesh, const Engine::Graphics::VertexAttributeFormat &attribute, size_t vertex, float *values)
+{
+    float converted[16] = {};
+
+    if (attribute.ElementCount > 16)
+        return;
+
+    const char *buffer = reinterpret_cast<const char *>(mesh.GetData()[attribute.Binding]);
+    size_t stride = mesh.GetFormat()->GetVertexSize(attribute.Binding);
+
+    attribute.Copy(buffer + vertex * stride + attribute.Offset, converted, Engine::Graphics::VertexAttributeFormat::AttributeDataType::Float32);
+
+    for (size_t i = 0; i < 4 && i < attribute.ElementCount; ++i)
+        values[i] = converted[i];
+}
+
+glm::mat4 MeshLoader::GetOrientationFix()
+{
+    return glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0)) *
+           glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0, 1, 0));
+}
+
+bool MeshLoader::BuildVertices(const Engine::Graphics::ModelPackageNode &node, std::vector<Mesh::Vertex> &vertices,
+                               std::vector<unsigned int> &indices, std::ostream &log)
 {
     const auto mesh = node.Mesh;
     const auto format = mesh ? mesh->GetFormat() : nullptr;
     if (!mesh || !format)
     {
-        std::cerr << "[MeshLoader] No mesh or format.\n";
-        return nullptr;
+        log << "[MeshLoader] No mesh or format.\n";
+        return false;
     }
 
     const auto *posAttr = format->GetAttribute("position");
@@ -24,10 +48,10 @@ Mesh *MeshLoader::LoadFromNode(const Engine::Graphics::ModelPackageNode &node)
 
     if (!posAttr || !texAttr)
     {
-        std::cerr << "[MeshLoader] Required attribute(s) missing: "
+        log << "[MeshLoader] Required attribute(s) missing: "
                   << (!posAttr ? "'position' " : "")
                   << (!texAttr ? "'texcoord'" : "") << "\n";
-        return nullptr;
+        return false;
     }
 
     size_t posIndex = format->GetAttributeIndex("position");
@@ -50,15 +74,20 @@ Mesh *MeshLoader::LoadFromNode(const Engine::Graphics::ModelPackageNode &node)
 
     if (posData.size() != texData.size())
     {
-        std::cerr << "[MeshLoader] Mismatch between positions and texcoords.\n";
-        return nullptr;
+        log << "[MeshLoader] Mismatch between positions and texcoords.\n";
+        return false;
     }
 
-    std::vector<Mesh::Vertex> vertices;
+    vertices.clear();
+
+    // blend indices refer to the mesh's own bone list (ModelPackageNode::Bones)
+    const auto *blendIndexAttr = node.Bones.empty() ? nullptr : format->GetAttribute("blendindices");
+    const auto *blendWeightAttr = node.Bones.empty() ? nullptr : format->GetAttribute("blendweight");
 
-    glm::mat4 fixOrientation =
-        glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0)) *
-        glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0, 1, 0));
+    if (!node.Bones.empty() && (!blendIndexAttr || !blendWeightAttr))
+        log << "[MeshLoader] Skinned mesh without blend data: " << node.Name << "\n";
+
+    glm::mat4 fixOrientation = GetOrientationFix();
 
     glm::mat3 normalFix = glm::mat3(fixOrientation); // Extract 3x3 normal matrix
 
@@ -80,13 +109,51 @@ Mesh *MeshLoader::LoadFromNode(const Engine::Graphics::ModelPackageNode &node)
         v.normal = normal;
         v.color = glm::u8vec4(255); // white fallback
 
+        if (blendIndexAttr && blendWeightAttr)
+        {
+            float blendIndices[4] = {};
+            float blendWeights[4] = {};
+
+            ReadAttribute(*mesh, *blendIndexAttr, i, blendIndices);
+            ReadAttribute(*mesh, *blendWeightAttr, i, blendWeights);
+
+            // three weights leave the fourth implied
+            if (blendWeightAttr->ElementCount == 3)
+                blendWeights[3] = 1.0f - blendWeights[0] - blendWeights[1] - blendWeights[2];
+
+            for (int j = 0; j < 4; ++j)
+            {
+                int boneIndex = static_cast<int>(blendIndices[j]);
+
+                if (boneIndex < 0 || boneIndex >= static_cast<int>(node.Bones.size()))
+                {
+                    boneIndex = 0;
+                    blendWeights[j] = 0.0f;
+                }
+
+                v.blendIndices[j] = static_cast<unsigned char>(boneIndex);
+                v.blendWeight[j] = blendWeights[j];
+            }
+        }
+
         vertices.push_back(v);
     }
 
-    std::vector<unsigned int> indices;
+    indices.clear();
     for (int i : mesh->GetIndexBuffer())
         indices.push_back(static_cast<unsigned int>(i));
 
+    return true;
+}
+
+Mesh *MeshLoader::LoadFromNode(const Engine::Graphics::ModelPackageNode &node)
+{
+    std::vector<Mesh::Vertex> vertices;
+    std::vector<unsigned int> indices;
+
+    if (!BuildVertices(node, vertices, indices))
+        return nullptr;
+
     std::cout << "[MeshLoader] Loaded mesh: " << vertices.size() << " vertices, "
               << indices.size() << " indices\n";
 
@@ -15,4 +15,12 @@ class MeshLoader
 {
 public:
     static Mesh *LoadFromNode(const Engine::Graphics::ModelPackageNode &node); // ✅ confirmed correct
+
+    // the vertex and index data LoadFromNode uploads, for filling a mesh that already exists. doesn't touch GL, so it
+    // can run off the GL thread with its own log
+    static bool BuildVertices(const Engine::Graphics::ModelPackageNode &node, std::vector<Mesh::Vertex> &vertices,
+                              std::vector<unsigned int> &indices, std::ostream &log = std::cerr);
+
+    // vertices are rotated from nif space into the editor's space while loading
+    static glm::mat4 GetOrientationFix();
 };
@@ -0,0 +1,294 @@
+#include "occlusion.h"
+
+#include <Engine/JobSystem.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_SSE2
+#endif
+
+// every band of rows is one job, each looks at every triangle
+static const int BandHeight = 8;
+static const size_t OccluderBatchSize = 8;
+static const size_t QueryBatchSize = 64;
+
+// false for points in front of the near plane
+static bool ToScreen(const glm::vec4 &clip, glm::vec3 &screen)
+{
+    if (clip.w <= 0.0f || clip.z < -clip.w)
+        return false;
+
+    screen.x = (clip.x / clip.w * 0.5f + 0.5f) * OcclusionCuller::Width;
+    screen.y = (0.5f - clip.y / clip.w * 0.5f) * OcclusionCuller::Height;
+    screen.z = clip.z / clip.w;
+
+    return true;
+}
+
+OcclusionCuller::OcclusionCuller()
+{
+    int width = Width;
+    int height = Height;
+
+    while (true)
+    {
+        levels.emplace_back(static_cast<size_t>(width) * height, 1.0f);
+        levelWidths.push_back(width);
+        levelHeights.push_back(height);
+
+        if (width == 1 && height == 1)
+            break;
+
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+}
+
+void OcclusionCuller::Render(const glm::mat4 &viewProjection, const std::vector<Occluder> &occluders)
+{
+    this->viewProjection = viewProjection;
+    occluderCount = occluders.size();
+
+    std::vector<size_t> firstTriangles(occluders.size() + 1, 0);
+
+    for (size_t i = 0; i < occluders.size(); ++i)
+        firstTriangles[i + 1] = firstTriangles[i] + occluders[i].indices->size() / 3;
+
+    triangles.assign(firstTriangles.back(), Triangle());
+
+    Engine::JobSystem::ParallelFor(occluders.size(), OccluderBatchSize, [this, &occluders, &firstTriangles, &viewProjection](size_t begin, size_t end)
+                                   {
+        std::vector<glm::vec3> screen;
+        std::vector<char> inFront;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Occluder &occluder = occluders[i];
+            const std::vector<glm::vec3> &positions = *occluder.positions;
+            const std::vector<unsigned int> &indices = *occluder.indices;
+            glm::mat4 matrix = viewProjection * occluder.matrix;
+
+            screen.resize(positions.size());
+            inFront.resize(positions.size());
+
+            for (size_t vertex = 0; vertex < positions.size(); ++vertex)
+                inFront[vertex] = ToScreen(matrix * glm::vec4(positions[vertex], 1.0f), screen[vertex]);
+
+            for (size_t k = 0; k + 2 < indices.size(); k += 3)
+            {
+                Triangle &triangle = triangles[firstTriangles[i] + k / 3];
+                triangle.drawn = true;
+
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    unsigned int vertex = indices[k + corner];
+
+                    if (vertex >= positions.size() || !inFront[vertex])
+                    {
+                        triangle.drawn = false;
+                        break;
+                    }
+
+                    triangle.vertices[corner] = screen[vertex];
+                }
+            }
+        } });
+
+    // only what can cover pixels is kept
+    triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [](const Triangle &triangle)
+                                   {
+        if (!triangle.drawn)
+            return true;
+
+        const glm::vec3 *v = triangle.vertices;
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+
+        return std::fabs(area) < 1e-6f ||
+               std::max({v[0].x, v[1].x, v[2].x}) < 0.0f || std::min({v[0].x, v[1].x, v[2].x}) > Width ||
+               std::max({v[0].y, v[1].y, v[2].y}) < 0.0f || std::min({v[0].y, v[1].y, v[2].y}) > Height; }),
+                    triangles.end());
+
+    std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+
+    Engine::JobSystem::ParallelFor(Height / BandHeight, 1, [this](size_t begin, size_t end)
+                                   {
+        for (size_t band = begin; band < end; ++band)
+            RasterizeRows(static_cast<int>(band) * BandHeight, static_cast<int>(band + 1) * BandHeight); });
+
+    BuildPyramid();
+}
+
+// edge functions at pixel centres, a pixel is covered if its centre is inside all three edges
+void OcclusionCuller::RasterizeRows(int top, int bottom)
+{
+    std::vector<float> &depth = levels[0];
+
+    for (const Triangle &triangle : triangles)
+    {
+        const glm::vec3 *v = triangle.vertices;
+
+        int minY = std::max(top, static_cast<int>(std::floor(std::min({v[0].y, v[1].y, v[2].y}))));
+        int maxY = std::min(bottom - 1, static_cast<int>(std::ceil(std::max({v[0].y, v[1].y, v[2].y}))));
+
+        if (minY > maxY)
+            continue;
+
+        int minX = std::max(0, static_cast<int>(std::floor(std::min({v[0].x, v[1].x, v[2].x}))));
+        int maxX = std::min(Width - 1, static_cast<int>(std::ceil(std::max({v[0].x, v[1].x, v[2].x}))));
+
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        float sign = area > 0.0f ? 1.0f : -1.0f;
+
+        // E(x, y) = a x + b y + c, positive inside whichever way the triangle winds
+        float a[3], b[3], c[3];
+
+        for (int edge = 0; edge < 3; ++edge)
+        {
+            const glm::vec3 &from = v[edge];
+            const glm::vec3 &to = v[(edge + 1) % 3];
+
+            a[edge] = sign * (from.y - to.y);
+            b[edge] = sign * (to.x - from.x);
+            c[edge] = sign * ((to.y - from.y) * from.x - (to.x - from.x) * from.y);
+        }
+
+        // depth is a plane in screen space
+        float dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+        float dzdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+        float dzc = v[0].z - dzdx * v[0].x - dzdy * v[0].y;
+
+        // whole groups of four pixels, the buffer's width is a multiple of four
+        int startX = minX & ~3;
+
+        for (int y = minY; y <= maxY; ++y)
+        {
+            float centerY = y + 0.5f;
+            float *row = &depth[static_cast<size_t>(y) * Width];
+
+#ifdef OCCLUSION_SSE2
+            __m128 rowEdges[3], stepEdges[3];
+            const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+            for (int edge = 0; edge < 3; ++edge)
+            {
+                rowEdges[edge] = _mm_set1_ps(b[edge] * centerY + c[edge]);
+                stepEdges[edge] = _mm_set1_ps(a[edge]);
+            }
+
+            __m128 rowDepth = _mm_set1_ps(dzdy * centerY + dzc);
+            __m128 stepDepth = _mm_set1_ps(dzdx);
+            __m128 zero = _mm_setzero_ps();
+
+            for (int x = startX; x <= maxX; x += 4)
+            {
+                __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdges[0], centerX), rowEdges[0]), zero);
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdges[1], centerX), rowEdges[1]), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdges[2], centerX), rowEdges[2]), zero));
+
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(stepDepth, centerX), rowDepth);
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(old, z);
+
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+            }
+#else
+            for (int x = startX; x <= maxX; ++x)
+            {
+                float centerX = x + 0.5f;
+                bool inside = true;
+
+                for (int edge = 0; edge < 3; ++edge)
+                    inside = inside && a[edge] * centerX + b[edge] * centerY + c[edge] >= 0.0f;
+
+                if (inside)
+                    row[x] = std::min(row[x], dzdx * centerX + dzdy * centerY + dzc);
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+    for (size_t level = 1; level < levels.size(); ++level)
+    {
+        const std::vector<float> &source = levels[level - 1];
+        int sourceWidth = levelWidths[level - 1];
+        int sourceHeight = levelHeights[level - 1];
+        int width = levelWidths[level];
+        int height = levelHeights[level];
+
+        for (int y = 0; y < height; ++y)
+        {
+            int y0 = std::min(y * 2, sourceHeight - 1);
+            int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+            for (int x = 0; x < width; ++x)
+            {
+                int x0 = std::min(x * 2, sourceWidth - 1);
+                int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+                levels[level][static_cast<size_t>(y) * width + x] = std::max({source[static_cast<size_t>(y0) * sourceWidth + x0], source[static_cast<size_t>(y0) * sourceWidth + x1],
+                                                                              source[static_cast<size_t>(y1) * sourceWidth + x0], source[static_cast<size_t>(y1) * sourceWidth + x1]});
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::IsOccluded(const glm::mat4 &matrix, const glm::vec3 &min, const glm::vec3 &max) const
+{
+    glm::mat4 boxToClip = viewProjection * matrix;
+    glm::vec3 low(FLT_MAX);
+    glm::vec3 high(-FLT_MAX);
+
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec3 point(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+        glm::vec3 screen;
+
+        if (!ToScreen(boxToClip * glm::vec4(point, 1.0f), screen))
+            return false;
+
+        low = glm::min(low, screen);
+        high = glm::max(high, screen);
+    }
+
+    if (high.x < 0.0f || low.x > Width || high.y < 0.0f || low.y > Height)
+        return false;
+
+    int x0 = std::max(0, static_cast<int>(low.x));
+    int x1 = std::min(Width - 1, static_cast<int>(high.x));
+    int y0 = std::max(0, static_cast<int>(low.y));
+    int y1 = std::min(Height - 1, static_cast<int>(high.y));
+
+    size_t level = 0;
+
+    while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+        ++level;
+
+    int width = levelWidths[level];
+    float farthest = -FLT_MAX;
+
+    for (int y = y0 >> level; y <= (y1 >> level); ++y)
+        for (int x = x0 >> level; x <= (x1 >> level); ++x)
+            farthest = std::max(farthest, levels[level][static_cast<size_t>(y) * width + x]);
+
+    return low.z > farthest;
+}
+
+void OcclusionCuller::Test(Query *queries, size_t count) const
+{
+    Engine::JobSystem::ParallelFor(count, QueryBatchSize, [this, queries](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+            queries[i].occluded = IsOccluded(queries[i].matrix, queries[i].min, queries[i].max); });
+}
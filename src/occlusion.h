@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Occlusion culling on the CPU, so it behaves the same on every GL driver and needs no queries. A few big occluders are
+// rasterized into a small depth buffer, which is reduced into a pyramid where every texel keeps the farthest depth
+// under it. A box is hidden if its nearest point is behind the farthest depth of the few texels its screen rectangle
+// covers at the level where that's at most 2x2 of them.
+//
+// Rasterizing is split into bands of rows and testing into batches of boxes, both on the job system. Occluder triangles
+// that reach in front of the near plane are left out, so the buffer only ever hides less than it could.
+class OcclusionCuller
+{
+public:
+    static const int Width = 256;
+    static const int Height = 128;
+
+    // positions and indices have to live until Render returns, matrix takes the positions into world space
+    struct Occluder
+    {
+        glm::mat4 matrix = glm::mat4(1.0f);
+        const std::vector<glm::vec3> *positions = nullptr;
+        const std::vector<unsigned int> *indices = nullptr;
+    };
+
+    // a box that matrix takes into world space, Test fills in occluded
+    struct Query
+    {
+        glm::mat4 matrix = glm::mat4(1.0f);
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+        bool occluded = false;
+    };
+
+    OcclusionCuller();
+
+    // clears the buffer and draws the occluders as the camera sees them
+    void Render(const glm::mat4 &viewProjection, const std::vector<Occluder> &occluders);
+
+    // against what the last Render drew. boxes reaching in front of the near plane or off the screen are never hidden
+    bool IsOccluded(const glm::mat4 &matrix, const glm::vec3 &min, const glm::vec3 &max) const;
+    void Test(Query *queries, size_t count) const;
+
+    size_t GetOccluderCount() const { return occluderCount; }
+    size_t GetTriangleCount() const { return triangles.size(); }
+
+    // rows top to bottom, NDC depth
+    const std::vector<float> &GetDepth() const { return levels[0]; }
+
+private:
+    // x and y in pixels, z in NDC
+    struct Triangle
+    {
+        glm::vec3 vertices[3];
+        bool drawn = false;
+    };
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<std::vector<float>> levels; // levels[0] is the depth buffer, the last one is 1x1
+    std::vector<int> levelWidths;
+    std::vector<int> levelHeights;
+    std::vector<Triangle> triangles;
+    size_t occluderCount = 0;
+
+    void RasterizeRows(int top, int bottom);
+    void BuildPyramid();
+};
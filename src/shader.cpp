@@ -62,6 +62,18 @@ void Shader::setInt(const std::string &name, int value) const
     glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
 }
 
+void Shader::setFloat(const std::string &name, float value) const
+{
+    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+}
+
+void Shader::bindUniformBlock(const std::string &name, unsigned int binding) const
+{
+    GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, index, binding);
+}
+
 void Shader::checkCompileErrors(GLuint shader, const std::string &type)
 {
     GLint success;
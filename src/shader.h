@@ -12,6 +12,8 @@ public:
     void use();
     void setMat4(const std::string &name, const glm::mat4 &mat) const;
     void setInt(const std::string &name, int value) const;
+    void setFloat(const std::string &name, float value) const;
+    void bindUniformBlock(const std::string &name, unsigned int binding) const;
 
 private:
     void checkCompileErrors(GLuint shader, const std::string &type); // make this private too
@@ -0,0 +1,273 @@
+#include "simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+// the summed squared distance to a set of planes, the upper half of a symmetric 4x4 matrix
+struct Quadric
+{
+    double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0;
+    double yy = 0.0, yz = 0.0, yw = 0.0;
+    double zz = 0.0, zw = 0.0;
+    double ww = 0.0;
+
+    void AddPlane(const glm::dvec3 &normal, double distance)
+    {
+        xx += normal.x * normal.x;
+        xy += normal.x * normal.y;
+        xz += normal.x * normal.z;
+        xw += normal.x * distance;
+        yy += normal.y * normal.y;
+        yz += normal.y * normal.z;
+        yw += normal.y * distance;
+        zz += normal.z * normal.z;
+        zw += normal.z * distance;
+        ww += distance * distance;
+    }
+
+    void Add(const Quadric &other)
+    {
+        xx += other.xx;
+        xy += other.xy;
+        xz += other.xz;
+        xw += other.xw;
+        yy += other.yy;
+        yz += other.yz;
+        yw += other.yw;
+        zz += other.zz;
+        zw += other.zw;
+        ww += other.ww;
+    }
+
+    double Evaluate(const glm::vec3 &point) const
+    {
+        double x = point.x, y = point.y, z = point.z;
+
+        return xx * x * x + 2.0 * xy * x * y + 2.0 * xz * x * z + 2.0 * xw * x + yy * y * y + 2.0 * yz * y * z + 2.0 * yw * y +
+               zz * z * z + 2.0 * zw * z + ww;
+    }
+};
+
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+struct PositionHash
+{
+    size_t operator()(const glm::vec3 &position) const
+    {
+        uint32_t bits[3];
+        memcpy(bits, &position, sizeof(bits));
+
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+static uint64_t GetEdgeKey(unsigned int a, unsigned int b)
+{
+    if (a > b)
+        std::swap(a, b);
+
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+std::vector<unsigned int> SimplifyIndices(const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices,
+                                          size_t targetIndexCount, float &error)
+{
+    std::vector<unsigned int> result(indices);
+    size_t vertexCount = positions.size();
+    double maxCost = 0.0;
+
+    error = 0.0f;
+
+    // vertices at the same position, the first of them stands for all
+    std::vector<unsigned int> shared(vertexCount);
+    std::vector<unsigned int> sharedCount(vertexCount, 0);
+    std::unordered_map<glm::vec3, unsigned int, PositionHash> firstAt;
+
+    for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        shared[vertex] = firstAt.emplace(positions[vertex], vertex).first->second;
+        ++sharedCount[shared[vertex]];
+    }
+
+    // edges between positions that don't have exactly two triangles are open or non-manifold
+    std::unordered_map<uint64_t, int> edgeUses;
+
+    for (size_t i = 0; i + 2 < result.size(); i += 3)
+        for (int corner = 0; corner < 3; ++corner)
+            ++edgeUses[GetEdgeKey(shared[result[i + corner]], shared[result[i + (corner + 1) % 3]])];
+
+    std::vector<char> locked(vertexCount, 0);
+
+    for (const auto &edge : edgeUses)
+    {
+        if (edge.second != 2)
+        {
+            locked[edge.first >> 32] = 1;
+            locked[edge.first & 0xFFFFFFFF] = 1;
+        }
+    }
+
+    for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+        locked[vertex] = locked[shared[vertex]] || sharedCount[shared[vertex]] > 1;
+
+    // a vertex that can move is alone at its position, so its quadric is its own
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (size_t i = 0; i + 2 < result.size(); i += 3)
+    {
+        glm::dvec3 a = positions[result[i]], b = positions[result[i + 1]], c = positions[result[i + 2]];
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+
+        if (length <= 0.0)
+            continue;
+
+        normal /= length;
+
+        for (int corner = 0; corner < 3; ++corner)
+            quadrics[shared[result[i + corner]]].AddPlane(normal, -glm::dot(normal, a));
+    }
+
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<char> touched;
+
+    // every pass collapses edges whose neighbourhoods don't overlap, cheapest first, then the costs are worked out again
+    while (result.size() > targetIndexCount)
+    {
+        size_t triangleCount = result.size() / 3;
+
+        offsets.assign(vertexCount + 1, 0);
+        adjacency.resize(result.size());
+
+        for (unsigned int vertex : result)
+            ++offsets[vertex + 1];
+
+        for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+            offsets[vertex + 1] += offsets[vertex];
+
+        for (size_t i = 0; i < result.size(); ++i)
+            adjacency[offsets[result[i]]++] = static_cast<unsigned int>(i / 3);
+
+        for (size_t vertex = vertexCount; vertex > 0; --vertex)
+            offsets[vertex] = offsets[vertex - 1];
+
+        offsets[0] = 0;
+
+        collapses.clear();
+
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            unsigned int from = result[i];
+            unsigned int to = result[i - i % 3 + (i + 1) % 3];
+
+            if (locked[from])
+                continue;
+
+            Quadric sum = quadrics[from];
+            sum.Add(quadrics[shared[to]]);
+
+            collapses.push_back({from, to, sum.Evaluate(positions[to])});
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b)
+                  { return a.cost < b.cost; });
+
+        touched.assign(vertexCount, 0);
+        size_t remaining = triangleCount;
+        bool collapsed = false;
+
+        for (const Collapse &collapse : collapses)
+        {
+            if (remaining * 3 <= targetIndexCount)
+                break;
+
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // a triangle turning over or folding nearly flat means the collapse would tear the surface
+            bool flips = false;
+            size_t removed = 0;
+
+            for (unsigned int k = offsets[collapse.from]; k < offsets[collapse.from + 1] && !flips; ++k)
+            {
+                const unsigned int *triangle = &result[adjacency[k] * 3];
+
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    ++removed;
+                    continue;
+                }
+
+                glm::vec3 corners[3];
+
+                for (int corner = 0; corner < 3; ++corner)
+                    corners[corner] = positions[triangle[corner]];
+
+                glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+                for (int corner = 0; corner < 3; ++corner)
+                    if (triangle[corner] == collapse.from)
+                        corners[corner] = positions[collapse.to];
+
+                glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+                flips = glm::dot(before, after) <= 0.2f * glm::length(before) * glm::length(after);
+            }
+
+            if (flips)
+                continue;
+
+            for (unsigned int k = offsets[collapse.from]; k < offsets[collapse.from + 1]; ++k)
+            {
+                unsigned int *triangle = &result[adjacency[k] * 3];
+
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    if (triangle[corner] == collapse.from)
+                        triangle[corner] = collapse.to;
+
+                    touched[triangle[corner]] = 1;
+                }
+            }
+
+            touched[collapse.from] = 1;
+            quadrics[shared[collapse.to]].Add(quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost);
+            remaining -= removed;
+            collapsed = true;
+        }
+
+        size_t kept = 0;
+
+        for (size_t i = 0; i + 2 < result.size(); i += 3)
+        {
+            unsigned int a = result[i], b = result[i + 1], c = result[i + 2];
+
+            if (a == b || b == c || a == c)
+                continue;
+
+            result[kept++] = a;
+            result[kept++] = b;
+            result[kept++] = c;
+        }
+
+        result.resize(kept);
+
+        if (!collapsed)
+            break;
+    }
+
+    error = static_cast<float>(std::sqrt(std::max(maxCost, 0.0)));
+
+    return result;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Collapses edges of an indexed triangle list, cheapest quadric error first, until at most targetIndexCount indices are
+// left or nothing more can go without flipping a triangle. Vertices only ever move onto other vertices, so the result
+// indexes the same vertex buffer.
+//
+// Vertices on open or non-manifold edges and on seams, where several vertices share a position because their texcoords
+// or normals differ, never move. The outline and the texture layout stay where they were.
+//
+// error is how far the surface moved at most, in the positions' units.
+std::vector<unsigned int> SimplifyIndices(const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices,
+                                          size_t targetIndexCount, float &error);
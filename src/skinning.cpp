@@ -0,0 +1,309 @@
+#include "skinning.h"
+#include "meshloader.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <Engine/JobSystem.h>
+#include <Objects/Transform.h>
+
+#include <algorithm>
+#include <iostream>
+
+static glm::mat4 ToGLM(const Matrix4F &matrix)
+{
+    glm::mat4 result(1.0f);
+
+    // Data[i] is column i, same as glm
+    for (int column = 0; column < 4; ++column)
+        for (int row = 0; row < 4; ++row)
+            result[column][row] = matrix.Data[column][row];
+
+    return result;
+}
+
+static glm::mat4 PoseMatrix(const Engine::Graphics::AnimationPose &pose)
+{
+    glm::quat rotation(pose.Rotation.W, pose.Rotation.X, pose.Rotation.Y, pose.Rotation.Z);
+
+    return glm::translate(glm::mat4(1.0f), glm::vec3(pose.Translation.X, pose.Translation.Y, pose.Translation.Z)) *
+           glm::mat4_cast(rotation) *
+           glm::scale(glm::mat4(1.0f), glm::vec3(pose.Scale));
+}
+
+int SkinningSystem::CreateSkeleton(const Engine::Graphics::ModelPackage &package, std::shared_ptr<const Engine::Graphics::CompressedAnimationClip> clip)
+{
+    Skeleton skeleton;
+    size_t nodeCount = package.Nodes.size();
+
+    skeleton.parents.resize(nodeCount);
+    skeleton.bindLocal.resize(nodeCount, glm::mat4(1.0f));
+    skeleton.animatedNodes.assign(nodeCount, (size_t)-1);
+    skeleton.world.resize(nodeCount, glm::mat4(1.0f));
+
+    std::vector<size_t> depths(nodeCount, 0);
+
+    for (size_t i = 0; i < nodeCount; ++i)
+    {
+        const auto &node = package.Nodes[i];
+
+        skeleton.parents[i] = node.AttachedTo < nodeCount ? node.AttachedTo : (size_t)-1;
+
+        if (node.Transform)
+            skeleton.bindLocal[i] = node.Transform->LocalTransformGLM();
+
+        // the parser doesn't promise parents come first, so sort by depth
+        for (size_t parent = skeleton.parents[i]; parent != (size_t)-1 && depths[i] <= nodeCount; parent = skeleton.parents[parent])
+            ++depths[i];
+    }
+
+    skeleton.order.resize(nodeCount);
+
+    for (size_t i = 0; i < nodeCount; ++i)
+        skeleton.order[i] = i;
+
+    std::stable_sort(skeleton.order.begin(), skeleton.order.end(), [&depths](size_t a, size_t b)
+                     { return depths[a] < depths[b]; });
+
+    if (clip)
+    {
+        skeleton.clip = std::move(clip);
+        skeleton.poses.resize(skeleton.clip->GetNodeCount());
+
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            size_t poseIndex = skeleton.clip->GetNodeIndex(package.Nodes[i].Name);
+
+            if (poseIndex == (size_t)-1)
+                continue;
+
+            skeleton.animatedNodes[i] = poseIndex;
+
+            // channels a clip doesn't animate keep the bind pose
+            if (const auto &transform = package.Nodes[i].Transform)
+            {
+                auto &pose = skeleton.poses[poseIndex];
+
+                pose.Translation = Vector3SF(transform->GetPosition().X, transform->GetPosition().Y, transform->GetPosition().Z);
+                pose.Rotation = transform->GetOrientation();
+                pose.Scale = transform->GetScale().X;
+            }
+        }
+
+        skeleton.animation = static_cast<int>(animations.size());
+
+        animations.push_back({});
+        animations.back().Clip = skeleton.clip.get();
+    }
+
+    if (!freeSkeletons.empty())
+    {
+        int index = freeSkeletons.back();
+
+        freeSkeletons.pop_back();
+        skeletons[index] = std::move(skeleton);
+
+        return index;
+    }
+
+    skeletons.push_back(std::move(skeleton));
+
+    return static_cast<int>(skeletons.size()) - 1;
+}
+
+void SkinningSystem::RemoveSkeleton(int index)
+{
+    if (index < 0 || index >= static_cast<int>(skeletons.size()) || skeletons[index].removed)
+        return;
+
+    Skeleton &skeleton = skeletons[index];
+
+    // the last animation takes the removed one's place
+    if (skeleton.animation >= 0)
+    {
+        int last = static_cast<int>(animations.size()) - 1;
+
+        if (skeleton.animation != last)
+        {
+            animations[skeleton.animation] = std::move(animations[last]);
+
+            for (Skeleton &other : skeletons)
+                if (other.animation == last)
+                    other.animation = skeleton.animation;
+        }
+
+        animations.pop_back();
+    }
+
+    skeleton = Skeleton();
+    skeleton.removed = true;
+    freeSkeletons.push_back(index);
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        if (meshes[i].skeleton != index)
+            continue;
+
+        meshes[i] = SkinnedMesh();
+        freeMeshes.push_back(static_cast<int>(i));
+    }
+}
+
+int SkinningSystem::AddMesh(int skeleton, const Engine::Graphics::ModelPackage &package, size_t nodeIndex)
+{
+    if (skeleton < 0 || nodeIndex >= package.Nodes.size())
+        return -1;
+
+    const auto &node = package.Nodes[nodeIndex];
+
+    if (node.Bones.empty() || node.Bones.size() != node.BoneOffsets.size())
+        return -1;
+
+    if (node.Bones.size() > MaxBones)
+    {
+        std::cerr << "[Skinning] " << node.Name << " uses " << node.Bones.size() << " bones, palettes hold " << MaxBones << "\n";
+        return -1;
+    }
+
+    SkinnedMesh mesh;
+
+    mesh.skeleton = skeleton;
+    mesh.skinTransform = ToGLM(node.SkinTransform);
+
+    if (node.SkeletonRoot < package.Nodes.size())
+        mesh.rootParent = package.Nodes[node.SkeletonRoot].AttachedTo;
+
+    for (size_t i = 0; i < node.Bones.size(); ++i)
+    {
+        mesh.boneNodes.push_back(package.Bones[node.Bones[i]]);
+        mesh.boneOffsets.push_back(ToGLM(node.BoneOffsets[i]));
+    }
+
+    if (!freeMeshes.empty())
+    {
+        int index = freeMeshes.back();
+
+        freeMeshes.pop_back();
+        meshes[index] = std::move(mesh);
+
+        return index;
+    }
+
+    meshes.push_back(std::move(mesh));
+
+    return static_cast<int>(meshes.size()) - 1;
+}
+
+void SkinningSystem::Update(float deltaTime)
+{
+    if (uniformBuffer == 0)
+    {
+        GLint alignment = 256;
+
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        glGenBuffers(1, &uniformBuffer);
+
+        paletteStride = (MaxBones * sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+    }
+
+    // every palette gets a full MaxBones slot so the bound range always covers the whole block.
+    // there's always at least one so unskinned draws have a buffer behind the block too
+    size_t requiredSize = std::max<size_t>(meshes.size(), 1) * paletteStride;
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+        meshes[i].uniformOffset = i * paletteStride;
+
+    staging.resize(requiredSize);
+
+    for (Skeleton &skeleton : skeletons)
+    {
+        if (skeleton.animation < 0)
+            continue;
+
+        auto &animation = animations[skeleton.animation];
+
+        animation.Time += deltaTime;
+        animation.Poses = skeleton.poses.data();
+    }
+
+    Engine::Graphics::CompressedAnimationClip::Sample(animations.data(), animations.size());
+
+    Engine::JobSystem::ParallelFor(skeletons.size(), 16, [this](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+            UpdateSkeleton(skeletons[i]); });
+
+    Engine::JobSystem::ParallelFor(meshes.size(), 16, [this](size_t begin, size_t end)
+                                   {
+        for (size_t i = begin; i < end; ++i)
+            UpdatePalette(meshes[i]); });
+
+    glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+
+    if (requiredSize != bufferSize)
+    {
+        glBufferData(GL_UNIFORM_BUFFER, requiredSize, staging.data(), GL_DYNAMIC_DRAW);
+        bufferSize = requiredSize;
+    }
+    else
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, requiredSize, staging.data());
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, PaletteBinding, uniformBuffer, 0, MaxBones * sizeof(glm::mat4));
+}
+
+void SkinningSystem::Bind(int mesh) const
+{
+    if (mesh < 0 || mesh >= static_cast<int>(meshes.size()) || uniformBuffer == 0)
+        return;
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, PaletteBinding, uniformBuffer, meshes[mesh].uniformOffset, MaxBones * sizeof(glm::mat4));
+}
+
+void SkinningSystem::Release()
+{
+    if (uniformBuffer != 0)
+        glDeleteBuffers(1, &uniformBuffer);
+
+    uniformBuffer = 0;
+    bufferSize = 0;
+}
+
+void SkinningSystem::UpdateSkeleton(Skeleton &skeleton)
+{
+    for (size_t node : skeleton.order)
+    {
+        size_t poseIndex = skeleton.animatedNodes[node];
+        glm::mat4 local = poseIndex == (size_t)-1 ? skeleton.bindLocal[node] : PoseMatrix(skeleton.poses[poseIndex]);
+        size_t parent = skeleton.parents[node];
+
+        skeleton.world[node] = parent == (size_t)-1 ? local : skeleton.world[parent] * local;
+    }
+}
+
+// palette entries map skin space to posed skin space, then into the loader's orientation like the vertices
+void SkinningSystem::UpdatePalette(const SkinnedMesh &mesh)
+{
+    static const glm::mat4 orientation = MeshLoader::GetOrientationFix();
+    static const glm::mat4 inverseOrientation = glm::inverse(orientation);
+
+    // a free slot, its palette is never bound
+    if (mesh.skeleton < 0)
+        return;
+
+    const Skeleton &skeleton = skeletons[mesh.skeleton];
+    glm::mat4 toSkin = mesh.skinTransform;
+
+    if (mesh.rootParent < skeleton.world.size())
+        toSkin = toSkin * glm::inverse(skeleton.world[mesh.rootParent]);
+
+    glm::mat4 *palette = reinterpret_cast<glm::mat4 *>(staging.data() + mesh.uniformOffset);
+
+    for (size_t i = 0; i < mesh.boneNodes.size(); ++i)
+        palette[i] = orientation * toSkin * skeleton.world[mesh.boneNodes[i]] * mesh.boneOffsets[i] * inverseOrientation;
+
+    for (size_t i = mesh.boneNodes.size(); i < MaxBones; ++i)
+        palette[i] = glm::mat4(1.0f);
+}
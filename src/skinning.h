@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <VulkanGraphics/FileFormats/PackageNodes.h>
+#include <VulkanGraphics/Scene/CompressedAnimation.h>
+
+// Bone palettes for skinned meshes. Every frame the animated poses of all skeletons are sampled in one batch from
+// their compressed clips, turned into palettes and uploaded into a single uniform buffer that each skinned draw binds a range of.
+class SkinningSystem
+{
+public:
+    static const int MaxBones = 128; // has to match MAX_BONES in shaders/vertex.glsl
+    static const GLuint PaletteBinding = 0;
+
+    // one skeleton per placed model, every skinned mesh of that model shares it. the clip is the model's, compiled
+    // when it was loaded, and can be null for a model that doesn't animate
+    int CreateSkeleton(const Engine::Graphics::ModelPackage &package, std::shared_ptr<const Engine::Graphics::CompressedAnimationClip> clip);
+
+    // frees the skeleton and every mesh added to it, their indices are handed out again later
+    void RemoveSkeleton(int skeleton);
+
+    // returns -1 if the node isn't skinned or has more bones than a palette holds
+    int AddMesh(int skeleton, const Engine::Graphics::ModelPackage &package, size_t nodeIndex);
+
+    void Update(float deltaTime);
+    void Bind(int mesh) const;
+
+    // deletes the uniform buffer, call it while the GL context is still alive
+    void Release();
+
+    size_t GetSkeletonCount() const { return skeletons.size() - freeSkeletons.size(); }
+    size_t GetMeshCount() const { return meshes.size() - freeMeshes.size(); }
+
+private:
+    struct Skeleton
+    {
+        std::vector<size_t> parents;
+        std::vector<size_t> order; // parents come before their children
+        std::vector<glm::mat4> bindLocal;
+        std::vector<size_t> animatedNodes; // per node, index into the animation poses or -1
+        std::vector<Engine::Graphics::AnimationPose> poses;
+        std::vector<glm::mat4> world;
+        std::shared_ptr<const Engine::Graphics::CompressedAnimationClip> clip;
+        int animation = -1;
+        bool removed = false;
+    };
+
+    struct SkinnedMesh
+    {
+        int skeleton = -1;
+        size_t rootParent = (size_t)-1;
+        glm::mat4 skinTransform = glm::mat4(1.0f);
+        std::vector<size_t> boneNodes;
+        std::vector<glm::mat4> boneOffsets;
+        size_t uniformOffset = 0;
+    };
+
+    std::vector<Skeleton> skeletons;
+    std::vector<SkinnedMesh> meshes;
+    std::vector<Engine::Graphics::CompressedAnimationClip::Instance> animations;
+    std::vector<int> freeSkeletons;
+    std::vector<int> freeMeshes;
+    std::vector<unsigned char> staging;
+
+    GLuint uniformBuffer = 0;
+    size_t bufferSize = 0;
+    size_t paletteStride = 0;
+
+    void UpdateSkeleton(Skeleton &skeleton);
+    void UpdatePalette(const SkinnedMesh &mesh);
+};
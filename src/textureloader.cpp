@@ -1,5 +1,8 @@
 #include "textureloader.h"
-#include <fstream>
+#include "bcn.h"
+#include "vfs.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <glad/glad.h>
 
@@ -15,74 +18,382 @@
 #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
 #endif
 
-GLuint LoadDDSTexture(const std::string &path)
+static bool GetBlockFormat(unsigned int format, BlockFormat &blockFormat)
 {
-    std::ifstream file(path, std::ios::binary);
-    if (!file)
+    switch (format)
     {
-        std::cerr << "[ERROR] Could not open DDS file: " << path << "\n";
-        return 0;
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        blockFormat = BlockFormat::BC1;
+        return true;
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        blockFormat = BlockFormat::BC2;
+        return true;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        blockFormat = BlockFormat::BC3;
+        return true;
+    case GL_COMPRESSED_RED_RGTC1:
+        blockFormat = BlockFormat::BC4;
+        return true;
+    case GL_COMPRESSED_RG_RGTC2:
+        blockFormat = BlockFormat::BC5;
+        return true;
     }
 
-    char fileCode[4];
-    file.read(fileCode, 4);
-    if (strncmp(fileCode, "DDS ", 4) != 0)
+    return false;
+}
+
+// S3TC is an extension, RGTC is core since 3.0. asked once, on the GL thread
+static bool HasS3TC()
+{
+    static int supported = -1;
+
+    if (supported < 0)
     {
-        std::cerr << "[ERROR] Not a valid DDS file: " << path << "\n";
-        return 0;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        supported = 0;
+
+        for (GLint i = 0; i < count && !supported; ++i)
+        {
+            const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+            supported = name && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+        }
+
+        if (!supported)
+            std::cout << "[Texture] No S3TC support, DXT textures are decoded on the CPU\n";
     }
 
-    unsigned char header[124];
-    file.read(reinterpret_cast<char *>(header), 124);
+    return supported == 1;
+}
+
+bool ReadDDSFile(const std::string &path, DDSImage &image, std::ostream &log)
+{
+    std::string file;
+    if (!FileSystem::Read(path, file))
+    {
+        log << "[ERROR] Could not open DDS file: " << path << "\n";
+        return false;
+    }
+
+    if (file.size() < 4 || strncmp(file.data(), "DDS ", 4) != 0)
+    {
+        log << "[ERROR] Not a valid DDS file: " << path << "\n";
+        return false;
+    }
+
+    if (file.size() < 128)
+    {
+        log << "[ERROR] Truncated DDS header: " << path << "\n";
+        return false;
+    }
+
+    const unsigned char *header = reinterpret_cast<const unsigned char *>(file.data()) + 4;
 
     unsigned int height = *(unsigned int *)&(header[8]);
     unsigned int width = *(unsigned int *)&(header[12]);
-    unsigned int linearSize = *(unsigned int *)&(header[16]);
     unsigned int mipMapCount = *(unsigned int *)&(header[24]);
     unsigned int fourCC = *(unsigned int *)&(header[80]);
+    size_t dataOffset = 128;
 
-    unsigned char *buffer = new unsigned char[linearSize * 2];
-    file.read(reinterpret_cast<char *>(buffer), linearSize * 2);
-    file.close();
+    // DX10 files name their format in a header of their own
+    if (fourCC == '01XD')
+    {
+        if (file.size() < 148)
+        {
+            log << "[ERROR] Truncated DDS header: " << path << "\n";
+            return false;
+        }
+
+        unsigned int dxgiFormat = *(const unsigned int *)(file.data() + 128);
+        dataOffset = 148;
+
+        switch (dxgiFormat)
+        {
+        case 71: // BC1_UNORM and _SRGB
+        case 72:
+            fourCC = '1TXD';
+            break;
+        case 74:
+        case 75:
+            fourCC = '3TXD';
+            break;
+        case 77:
+        case 78:
+            fourCC = '5TXD';
+            break;
+        case 80:
+            fourCC = 'U4CB';
+            break;
+        case 83:
+            fourCC = 'U5CB';
+            break;
+        default:
+            log << "[ERROR] Unsupported DXGI format " << dxgiFormat << ": " << path << "\n";
+            return false;
+        }
+    }
 
-    unsigned int format;
     switch (fourCC)
     {
     case '1TXD':
-        format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        image.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
         break;
     case '3TXD':
-        format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        image.format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
         break;
     case '5TXD':
-        format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        break;
+    case '1ITA':
+    case 'U4CB':
+        image.format = GL_COMPRESSED_RED_RGTC1;
+        break;
+    case '2ITA':
+    case 'U5CB':
+        image.format = GL_COMPRESSED_RG_RGTC2;
         break;
     default:
-        std::cerr << "[ERROR] Unsupported DDS format: " << fourCC << "\n";
-        delete[] buffer;
-        return 0;
+        log << "[ERROR] Unsupported DDS format: " << fourCC << "\n";
+        return false;
     }
 
-    GLuint texID;
-    glGenTextures(1, &texID);
+    image.width = width;
+    image.height = height;
+    image.levels = std::max(mipMapCount, 1u);
+
+    BlockFormat blockFormat = BlockFormat::BC1;
+    GetBlockFormat(image.format, blockFormat);
+
+    // every level the header promises, a file cut short keeps the ones it has
+    size_t dataSize = 0;
+
+    for (unsigned int level = 0; level < image.levels; ++level)
+        dataSize += GetLevelSize(blockFormat, std::max(1u, width >> level), std::max(1u, height >> level));
+
+    dataSize = std::min(dataSize, file.size() - dataOffset);
+    image.data.assign(file.begin() + dataOffset, file.begin() + dataOffset + dataSize);
+
+    return true;
+}
+
+GLuint UploadDDSTexture(const DDSImage &image, GLuint texture)
+{
+    GLuint texID = texture;
+    if (texID == 0)
+        glGenTextures(1, &texID);
     glBindTexture(GL_TEXTURE_2D, texID);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
-    unsigned int offset = 0;
+    BlockFormat blockFormat = BlockFormat::BC1;
+    GetBlockFormat(image.format, blockFormat);
+
+    // without S3TC in the driver DXT levels go up decoded
+    bool decode = image.format != GL_COMPRESSED_RED_RGTC1 && image.format != GL_COMPRESSED_RG_RGTC2 && !HasS3TC();
+    std::vector<unsigned char> rgba;
 
-    for (unsigned int level = 0; level < mipMapCount && (width || height); ++level)
+    unsigned int width = image.width;
+    unsigned int height = image.height;
+    size_t offset = 0;
+    unsigned int level = 0;
+
+    for (; level < image.levels && (width || height); ++level)
     {
-        unsigned int size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
-        glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, size, buffer + offset);
+        size_t size = GetLevelSize(blockFormat, width, height);
+
+        // a file cut short keeps the levels it has
+        if (offset + size > image.data.size())
+            break;
+
+        if (decode)
+        {
+            rgba.resize(static_cast<size_t>(width) * height * 4);
+            DecodeBlocks(blockFormat, image.data.data() + offset, size, width, height, rgba.data());
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        }
+        else
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, image.format, width, height, 0, static_cast<GLsizei>(size), image.data.data() + offset);
+        }
 
         offset += size;
         width = std::max(1u, width / 2);
         height = std::max(1u, height / 2);
     }
 
+    // a reloaded file can have fewer levels than what was there before
+    if (level > 0)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+
     glBindTexture(GL_TEXTURE_2D, 0);
-    delete[] buffer;
 
     return texID;
 }
+
+GLenum GetUploadFormat(const DDSImage &image)
+{
+    bool decode = image.format != GL_COMPRESSED_RED_RGTC1 && image.format != GL_COMPRESSED_RG_RGTC2 && !HasS3TC();
+
+    return decode ? GL_RGBA8 : image.format;
+}
+
+unsigned int GetUploadLevels(const DDSImage &image, size_t &bytes)
+{
+    BlockFormat blockFormat = BlockFormat::BC1;
+    GetBlockFormat(image.format, blockFormat);
+
+    bool decode = GetUploadFormat(image) == GL_RGBA8;
+    size_t offset = 0;
+    unsigned int level = 0;
+
+    bytes = 0;
+
+    for (; level < image.levels; ++level)
+    {
+        unsigned int width = std::max(1u, image.width >> level);
+        unsigned int height = std::max(1u, image.height >> level);
+        size_t size = GetLevelSize(blockFormat, width, height);
+
+        if (offset + size > image.data.size())
+            break;
+
+        offset += size;
+        bytes += decode ? static_cast<size_t>(width) * height * 4 : size;
+    }
+
+    return level;
+}
+
+void AllocateTextureArray(GLenum format, unsigned int width, unsigned int height, unsigned int levels, int layerCount)
+{
+    BlockFormat blockFormat = BlockFormat::BC1;
+    bool compressed = GetBlockFormat(format, blockFormat);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (unsigned int level = 0; level < levels; ++level)
+    {
+        unsigned int levelWidth = std::max(1u, width >> level);
+        unsigned int levelHeight = std::max(1u, height >> level);
+
+        if (compressed)
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight, layerCount, 0,
+                                   static_cast<GLsizei>(GetLevelSize(blockFormat, levelWidth, levelHeight) * layerCount), nullptr);
+        else
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void ResizeTextureArray(GLenum format, unsigned int width, unsigned int height, unsigned int levels, int keptLayers, int layerCount)
+{
+    BlockFormat blockFormat = BlockFormat::BC1;
+    bool compressed = GetBlockFormat(format, blockFormat);
+
+    // GL 4.1 has no glCopyImageSubData, the levels take a trip through memory
+    std::vector<std::vector<unsigned char>> kept(levels);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    for (unsigned int level = 0; level < levels && keptLayers > 0; ++level)
+    {
+        GLint size = 0;
+
+        if (compressed)
+        {
+            glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            kept[level].resize(size);
+            glGetCompressedTexImage(GL_TEXTURE_2D_ARRAY, level, kept[level].data());
+        }
+        else
+        {
+            kept[level].resize(static_cast<size_t>(std::max(1u, width >> level)) * std::max(1u, height >> level) * 4 * keptLayers);
+            glGetTexImage(GL_TEXTURE_2D_ARRAY, level, GL_RGBA, GL_UNSIGNED_BYTE, kept[level].data());
+        }
+    }
+
+    AllocateTextureArray(format, width, height, levels, layerCount);
+
+    for (unsigned int level = 0; level < levels && keptLayers > 0; ++level)
+    {
+        unsigned int levelWidth = std::max(1u, width >> level);
+        unsigned int levelHeight = std::max(1u, height >> level);
+
+        // layers are stored one after the other, the first keptLayers of them are the ones that had room before
+        if (compressed)
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, levelWidth, levelHeight, keptLayers, format,
+                                      static_cast<GLsizei>(GetLevelSize(blockFormat, levelWidth, levelHeight) * keptLayers), kept[level].data());
+        else
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, levelWidth, levelHeight, keptLayers, GL_RGBA, GL_UNSIGNED_BYTE, kept[level].data());
+    }
+}
+
+void UploadDDSLayer(const DDSImage &image, int layer, unsigned int levels)
+{
+    BlockFormat blockFormat = BlockFormat::BC1;
+    GetBlockFormat(image.format, blockFormat);
+
+    bool decode = GetUploadFormat(image) == GL_RGBA8;
+    std::vector<unsigned char> rgba;
+    size_t offset = 0;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (unsigned int level = 0; level < levels; ++level)
+    {
+        unsigned int width = std::max(1u, image.width >> level);
+        unsigned int height = std::max(1u, image.height >> level);
+        size_t size = GetLevelSize(blockFormat, width, height);
+
+        if (offset + size > image.data.size())
+            break;
+
+        if (decode)
+        {
+            rgba.resize(static_cast<size_t>(width) * height * 4);
+            DecodeBlocks(blockFormat, image.data.data() + offset, size, width, height, rgba.data());
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        }
+        else
+        {
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, image.format, static_cast<GLsizei>(size),
+                                      image.data.data() + offset);
+        }
+
+        offset += size;
+    }
+}
+
+GLuint LoadDDSTexture(const std::string &path, GLuint texture)
+{
+    DDSImage image;
+
+    if (!ReadDDSFile(path, image))
+        return 0;
+
+    return UploadDDSTexture(image, texture);
+}
+
+bool DecodeDDSLevel(const DDSImage &image, unsigned int level, std::vector<unsigned char> &rgba, unsigned int &width, unsigned int &height)
+{
+    BlockFormat blockFormat = BlockFormat::BC1;
+    if (!GetBlockFormat(image.format, blockFormat) || level >= image.levels)
+        return false;
+
+    size_t offset = 0;
+
+    for (unsigned int i = 0; i < level; ++i)
+        offset += GetLevelSize(blockFormat, std::max(1u, image.width >> i), std::max(1u, image.height >> i));
+
+    width = std::max(1u, image.width >> level);
+    height = std::max(1u, image.height >> level);
+
+    if (offset > image.data.size())
+        return false;
+
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+
+    return DecodeBlocks(blockFormat, image.data.data() + offset, image.data.size() - offset, width, height, rgba.data());
+}
@@ -1,5 +1,42 @@
 #pragma once
+#include <iostream>
 #include <string>
+#include <vector>
 #include <glad/glad.h>
 
-GLuint LoadDDSTexture(const std::string &path);
+// a .dds read into memory, its compressed levels back to back
+struct DDSImage
+{
+    unsigned int format = 0;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int levels = 0;
+    std::vector<unsigned char> data;
+};
+
+// only touches the file, so it can run off the GL thread
+bool ReadDDSFile(const std::string &path, DDSImage &image, std::ostream &log = std::cerr);
+
+// loads into texture instead of a new one when it's given, its old levels are replaced
+GLuint UploadDDSTexture(const DDSImage &image, GLuint texture = 0);
+GLuint LoadDDSTexture(const std::string &path, GLuint texture = 0);
+
+// the format the image's levels go up in, RGBA8 for DXT levels when the driver has no S3TC
+GLenum GetUploadFormat(const DDSImage &image);
+
+// how many of the levels the header promises are in the data, and how many bytes they take once uploaded
+unsigned int GetUploadLevels(const DDSImage &image, size_t &bytes);
+
+// gives every level of the bound GL_TEXTURE_2D_ARRAY room for layerCount layers, without contents
+void AllocateTextureArray(GLenum format, unsigned int width, unsigned int height, unsigned int levels, int layerCount);
+
+// gives the bound GL_TEXTURE_2D_ARRAY, which has keptLayers layers, room for layerCount. the texture keeps its name and
+// its layers, they're read back and uploaded again
+void ResizeTextureArray(GLenum format, unsigned int width, unsigned int height, unsigned int levels, int keptLayers, int layerCount);
+
+// puts the image's first levels into one layer of the bound GL_TEXTURE_2D_ARRAY, which has to be in its upload format
+// and size
+void UploadDDSLayer(const DDSImage &image, int layer, unsigned int levels);
+
+// decodes one mip level to RGBA8 on the CPU, false if the level isn't in the file
+bool DecodeDDSLevel(const DDSImage &image, unsigned int level, std::vector<unsigned char> &rgba, unsigned int &width, unsigned int &height);
@@ -0,0 +1,133 @@
+#include "texturepool.h"
+
+#include "textureloader.h"
+
+#include <algorithm>
+
+TextureLayer TexturePool::Add(const DDSImage &image)
+{
+    TextureLayer added;
+    size_t layerBytes = 0;
+    GLenum format = GetUploadFormat(image);
+    unsigned int levels = GetUploadLevels(image, layerBytes);
+
+    if (levels == 0)
+        return added;
+
+    auto matches = [&](const Array &array)
+    {
+        return array.format == format && array.width == image.width && array.height == image.height && array.levels == levels;
+    };
+
+    // a free layer first, then an array that can still grow
+    auto fits = std::find_if(arrays.begin(), arrays.end(), [&](const Array &array)
+                             { return matches(array) && !array.freeLayers.empty(); });
+
+    if (fits == arrays.end())
+    {
+        fits = std::find_if(arrays.begin(), arrays.end(), [&](const Array &array)
+                            { return matches(array) && array.capacity < array.maxCapacity; });
+
+        if (fits != arrays.end())
+            Grow(*fits);
+    }
+
+    if (fits == arrays.end())
+    {
+        Array array;
+        array.format = format;
+        array.width = image.width;
+        array.height = image.height;
+        array.levels = levels;
+        array.capacity = 1;
+        array.maxCapacity = static_cast<int>(std::clamp(MaxArrayBytes / std::max<size_t>(layerBytes, 1), size_t(1), size_t(MaxLayers)));
+        array.freeLayers.push_back(0);
+        array.layerBytes = layerBytes;
+        array.bytes = layerBytes;
+
+        glGenTextures(1, &array.id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+        AllocateTextureArray(format, image.width, image.height, levels, array.capacity);
+
+        allocatedBytes += array.bytes;
+        arrays.push_back(std::move(array));
+        fits = arrays.end() - 1;
+    }
+
+    added.array = fits->id;
+    added.layer = fits->freeLayers.back();
+    fits->freeLayers.pop_back();
+    ++layerCount;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, added.array);
+    UploadDDSLayer(image, added.layer, levels);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return added;
+}
+
+void TexturePool::Grow(Array &array)
+{
+    int capacity = std::min(array.capacity * 2, array.maxCapacity);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+    ResizeTextureArray(array.format, array.width, array.height, array.levels, array.capacity, capacity);
+
+    // the lowest layers are handed out first
+    for (int layer = capacity - 1; layer >= array.capacity; --layer)
+        array.freeLayers.push_back(layer);
+
+    allocatedBytes += array.layerBytes * (capacity - array.capacity);
+    array.capacity = capacity;
+    array.bytes = array.layerBytes * capacity;
+}
+
+void TexturePool::Replace(TextureLayer &layer, const DDSImage &image)
+{
+    size_t layerBytes = 0;
+    unsigned int levels = GetUploadLevels(image, layerBytes);
+
+    auto found = std::find_if(arrays.begin(), arrays.end(), [&layer](const Array &array)
+                              { return array.id == layer.array; });
+
+    if (found != arrays.end() && levels > 0 && found->format == GetUploadFormat(image) && found->width == image.width &&
+        found->height == image.height && found->levels == levels)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, layer.array);
+        UploadDDSLayer(image, layer.layer, levels);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return;
+    }
+
+    Remove(layer);
+    layer = Add(image);
+}
+
+void TexturePool::Remove(const TextureLayer &layer)
+{
+    auto found = std::find_if(arrays.begin(), arrays.end(), [&layer](const Array &array)
+                              { return array.id == layer.array; });
+
+    if (found == arrays.end())
+        return;
+
+    found->freeLayers.push_back(layer.layer);
+    --layerCount;
+
+    if (static_cast<int>(found->freeLayers.size()) < found->capacity)
+        return;
+
+    glDeleteTextures(1, &found->id);
+    allocatedBytes -= found->bytes;
+    arrays.erase(found);
+}
+
+void TexturePool::Release()
+{
+    for (Array &array : arrays)
+        glDeleteTextures(1, &array.id);
+
+    arrays.clear();
+    layerCount = 0;
+    allocatedBytes = 0;
+}
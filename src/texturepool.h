@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+struct DDSImage;
+
+// one texture in a pool's array, array is 0 for none
+struct TextureLayer
+{
+    GLuint array = 0;
+    int layer = 0;
+};
+
+// Textures with the same upload format, size and mip count share GL_TEXTURE_2D_ARRAYs, each one a layer. Draws of
+// different textures in the same array only differ in the layer, so they need no bind in between and can be merged.
+//
+// An array starts with room for one layer and doubles whenever it's full, up to as many layers as fit in MaxArrayBytes
+// or MaxLayers. It keeps its texture name as it grows, so handed out layers stay valid. It's deleted when its last
+// layer is given back.
+class TexturePool
+{
+public:
+    static const size_t MaxArrayBytes = size_t(32) << 20;
+    static const int MaxLayers = 64;
+
+    TexturePool() = default;
+
+    TexturePool(const TexturePool &) = delete;
+    TexturePool &operator=(const TexturePool &) = delete;
+
+    // uploads into a free layer of an array that fits the image, array is 0 if the image has no complete level
+    TextureLayer Add(const DDSImage &image);
+
+    // new contents for a layer. a texture whose format or size changed moves to another array, layer is updated
+    void Replace(TextureLayer &layer, const DDSImage &image);
+
+    void Remove(const TextureLayer &layer);
+
+    // deletes every array, call it while the GL context is still alive
+    void Release();
+
+    size_t GetArrayCount() const { return arrays.size(); }
+    size_t GetLayerCount() const { return layerCount; }
+    size_t GetAllocatedBytes() const { return allocatedBytes; }
+
+private:
+    struct Array
+    {
+        GLuint id = 0;
+        GLenum format = 0;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        unsigned int levels = 0;
+        int capacity = 0;
+        int maxCapacity = 0;
+        std::vector<int> freeLayers;
+        size_t layerBytes = 0;
+        size_t bytes = 0;
+    };
+
+    void Grow(Array &array);
+
+    std::vector<Array> arrays;
+    size_t layerCount = 0;
+    size_t allocatedBytes = 0;
+};
@@ -1,4 +1,5 @@
 #include "texture_manager.h"
+#include "vfs.h"
 #include <filesystem>
 #include <iostream>
 
@@ -11,13 +12,10 @@ TextureManager::TextureManager(const std::string &textureRoot)
 
 void TextureManager::ScanDirectory(const std::string &directory)
 {
-    for (const auto &entry : fs::recursive_directory_iterator(directory))
+    for (const std::string &path : FileSystem::List(directory, ".png"))
     {
-        if (entry.is_regular_file())
-        {
-            std::string filename = entry.path().filename().string();
-            textureMap[filename] = entry.path().string();
-        }
+        std::string filename = fs::path(path).filename().string();
+        textureMap[filename] = path;
     }
 }
 
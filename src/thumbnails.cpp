@@ -0,0 +1,165 @@
+#include "thumbnails.h"
+
+#include "textureloader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static const char ThumbnailMagic[4] = {'T', 'H', 'M', 'B'};
+static const uint32_t ThumbnailVersion = 1;
+
+// the header in front of a thumbnail's pixels, what the texture looked like when it was made
+struct ThumbnailHeader
+{
+    char magic[4];
+    uint32_t version;
+    int64_t time;
+    uint64_t fileSize;
+    uint32_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+// FNV-1a, the same path gives the same file name in every build
+static uint64_t HashText(const std::string &text)
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    for (char character : text)
+    {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+ThumbnailCache::ThumbnailCache(const std::string &directory, unsigned int size) : directory(directory), size(size)
+{
+    std::error_code error;
+    fs::create_directories(directory, error);
+}
+
+bool ThumbnailCache::Get(const std::string &texturePath, Thumbnail &thumbnail)
+{
+    // textures inside archives have neither, they don't change while the editor runs
+    std::error_code timeError;
+    std::error_code sizeError;
+    fs::file_time_type writeTime = fs::last_write_time(texturePath, timeError);
+    uint64_t fileSize = fs::file_size(texturePath, sizeError);
+    int64_t time = timeError ? 0 : writeTime.time_since_epoch().count();
+
+    if (sizeError)
+        fileSize = 0;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.thumb", static_cast<unsigned long long>(HashText(texturePath)));
+    std::string path = directory + "/" + name;
+
+    {
+        std::ifstream file(path, std::ios::binary);
+        ThumbnailHeader header;
+
+        if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) && memcmp(header.magic, ThumbnailMagic, 4) == 0 &&
+            header.version == ThumbnailVersion && header.time == time && header.fileSize == fileSize && header.size == size &&
+            header.width <= size && header.height <= size)
+        {
+            thumbnail.width = header.width;
+            thumbnail.height = header.height;
+            thumbnail.pixels.resize(static_cast<size_t>(header.width) * header.height * 4);
+
+            if (file.read(reinterpret_cast<char *>(thumbnail.pixels.data()), thumbnail.pixels.size()))
+            {
+                ++cachedCount;
+                return true;
+            }
+        }
+    }
+
+    if (!Make(texturePath, thumbnail))
+        return false;
+
+    ++decodedCount;
+
+    ThumbnailHeader header;
+    memcpy(header.magic, ThumbnailMagic, 4);
+    header.version = ThumbnailVersion;
+    header.time = time;
+    header.fileSize = fileSize;
+    header.size = size;
+    header.width = thumbnail.width;
+    header.height = thumbnail.height;
+
+    // a thumbnail that can't be written is made again next time
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(thumbnail.pixels.data()), thumbnail.pixels.size());
+
+    return true;
+}
+
+bool ThumbnailCache::Make(const std::string &texturePath, Thumbnail &thumbnail) const
+{
+    DDSImage image;
+    if (!ReadDDSFile(texturePath, image))
+        return false;
+
+    unsigned int level = 0;
+
+    while (level + 1 < image.levels && std::max(image.width >> (level + 1), image.height >> (level + 1)) >= size)
+        ++level;
+
+    std::vector<unsigned char> rgba;
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    if (!DecodeDDSLevel(image, level, rgba, width, height))
+        return false;
+
+    unsigned int longer = std::max(width, height);
+
+    if (longer <= size)
+    {
+        thumbnail.width = width;
+        thumbnail.height = height;
+        thumbnail.pixels = std::move(rgba);
+
+        return true;
+    }
+
+    thumbnail.width = std::max(1u, width * size / longer);
+    thumbnail.height = std::max(1u, height * size / longer);
+    thumbnail.pixels.resize(static_cast<size_t>(thumbnail.width) * thumbnail.height * 4);
+
+    // every thumbnail pixel is the average of the level's pixels under it
+    for (unsigned int y = 0; y < thumbnail.height; ++y)
+    {
+        unsigned int top = y * height / thumbnail.height;
+        unsigned int bottom = std::max(top + 1, (y + 1) * height / thumbnail.height);
+
+        for (unsigned int x = 0; x < thumbnail.width; ++x)
+        {
+            unsigned int left = x * width / thumbnail.width;
+            unsigned int right = std::max(left + 1, (x + 1) * width / thumbnail.width);
+            unsigned int sums[4] = {};
+
+            for (unsigned int sourceY = top; sourceY < bottom; ++sourceY)
+                for (unsigned int sourceX = left; sourceX < right; ++sourceX)
+                    for (int channel = 0; channel < 4; ++channel)
+                        sums[channel] += rgba[(static_cast<size_t>(sourceY) * width + sourceX) * 4 + channel];
+
+            unsigned int count = (bottom - top) * (right - left);
+
+            for (int channel = 0; channel < 4; ++channel)
+                thumbnail.pixels[(static_cast<size_t>(y) * thumbnail.width + x) * 4 + channel] = static_cast<unsigned char>(sums[channel] / count);
+        }
+    }
+
+    return true;
+}
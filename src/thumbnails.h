@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Small RGBA previews of .dds textures, made on the CPU so no GL context is needed. The smallest mip level that's still
+// at least as big as the thumbnail is decoded and scaled down. Thumbnails are kept as files in a directory, named after
+// the texture's path, and only made again once the texture's size or modification time changed.
+class ThumbnailCache
+{
+public:
+    struct Thumbnail
+    {
+        unsigned int width = 0;
+        unsigned int height = 0;
+        std::vector<unsigned char> pixels; // RGBA8, rows top to bottom
+    };
+
+    ThumbnailCache(const std::string &directory, unsigned int size);
+
+    // the longer side of thumbnail is size, or less for a texture that's smaller
+    bool Get(const std::string &texturePath, Thumbnail &thumbnail);
+
+    size_t GetDecodedCount() const { return decodedCount; }
+    size_t GetCachedCount() const { return cachedCount; }
+
+private:
+    std::string directory;
+    unsigned int size;
+    size_t decodedCount = 0;
+    size_t cachedCount = 0;
+
+    bool Make(const std::string &texturePath, Thumbnail &thumbnail) const;
+};
@@ -0,0 +1,601 @@
+#include "vfs.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+struct MountPoint
+{
+    std::string directory; // absolute, ends with '/'
+    std::unique_ptr<FileSource> source;
+};
+
+static std::vector<MountPoint> mounts;
+
+static std::string ToLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+// the same file always ends up as the same string, whichever way it was written
+static std::string Normalize(const std::string &path)
+{
+    return fs::absolute(path).lexically_normal().generic_string();
+}
+
+static bool ReadLooseFile(const std::string &path, std::string &data)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    return true;
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string &path)
+{
+    Close();
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        Close();
+        return false;
+    }
+
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    if (size > 0)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        data = mapping ? static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    }
+#else
+    file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    size = static_cast<size_t>(status.st_size);
+
+    if (size > 0)
+    {
+        void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        data = view != MAP_FAILED ? static_cast<const char *>(view) : nullptr;
+    }
+#endif
+
+    if (size > 0 && !data)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (data)
+        munmap(const_cast<char *>(data), size);
+    if (file >= 0)
+        close(file);
+
+    file = -1;
+#endif
+
+    data = nullptr;
+    size = 0;
+}
+
+DirectorySource::DirectorySource(const std::string &root) : root(root)
+{
+    if (!this->root.empty() && this->root.back() != '/')
+        this->root += '/';
+}
+
+bool DirectorySource::Exists(const std::string &path) const
+{
+    std::error_code error;
+    return fs::is_regular_file(root + path, error);
+}
+
+bool DirectorySource::Read(const std::string &path, std::string &data) const
+{
+    return ReadLooseFile(root + path, data);
+}
+
+void DirectorySource::List(std::vector<std::string> &paths) const
+{
+    std::error_code error;
+
+    for (fs::recursive_directory_iterator entry(root, fs::directory_options::skip_permission_denied, error), end; entry != end; entry.increment(error))
+    {
+        if (error)
+            break;
+
+        if (entry->is_regular_file(error))
+            paths.push_back(entry->path().lexically_relative(root).generic_string());
+    }
+}
+
+// the .m2h's magic, the archive format changed with each of them
+static const uint32_t MS2F = 0x4632534D;
+static const uint32_t NS2F = 0x4632534E;
+static const uint32_t OS2F = 0x4632534F;
+static const uint32_t PS2F = 0x46325350;
+
+// the only compression the archives use besides none
+static const uint32_t ZlibCompression = 0xEE000009;
+
+// reads little endian values off a block and remembers when it ran past its end
+struct BlockReader
+{
+    const char *position;
+    const char *end;
+    bool valid = true;
+
+    template <typename Type>
+    Type Read()
+    {
+        Type value = 0;
+
+        if (static_cast<size_t>(end - position) < sizeof(Type))
+        {
+            valid = false;
+            return value;
+        }
+
+        memcpy(&value, position, sizeof(Type));
+        position += sizeof(Type);
+
+        return value;
+    }
+
+    const char *Skip(size_t length)
+    {
+        const char *start = position;
+
+        if (static_cast<size_t>(end - position) < length)
+            valid = false;
+        else
+            position += length;
+
+        return start;
+    }
+};
+
+static bool DecodeBase64(const char *text, size_t length, std::vector<char> &out)
+{
+    static const std::string Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    out.clear();
+    out.reserve(length / 4 * 3);
+
+    uint32_t bits = 0;
+    int count = 0;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (text[i] == '=' || text[i] == '\0')
+            break;
+
+        size_t value = Alphabet.find(text[i]);
+        if (value == std::string::npos)
+            return false;
+
+        bits = (bits << 6) | static_cast<uint32_t>(value);
+        count += 6;
+
+        if (count >= 8)
+        {
+            count -= 8;
+            out.push_back(static_cast<char>((bits >> count) & 0xFF));
+        }
+    }
+
+    return true;
+}
+
+// deflate can't shrink anything further than about 1032 to 1, a size past that is a damaged header
+static const uint64_t MaxInflateRatio = 1032;
+
+// size is straight from the archive, it's checked against what the compressed bytes could hold before anything is
+// allocated for it. stb_image counts in ints, so larger files are refused rather than truncated
+static bool Inflate(const std::vector<char> &compressed, uint64_t size, std::string &out)
+{
+    out.clear();
+
+    if (size > compressed.size() * MaxInflateRatio || size > static_cast<uint64_t>(INT_MAX) || compressed.size() > static_cast<size_t>(INT_MAX))
+        return false;
+
+    out.resize(static_cast<size_t>(size));
+
+    if (stbi_zlib_decode_buffer(out.data(), static_cast<int>(size), compressed.data(), static_cast<int>(compressed.size())) != static_cast<int>(size))
+    {
+        out.clear();
+        return false;
+    }
+
+    return true;
+}
+
+ArchiveSource::ArchiveSource(const ArchiveCipher *cipher) : cipher(cipher)
+{
+}
+
+// header blocks are base64 text of the encrypted, usually deflated, bytes
+bool ArchiveSource::ReadBlock(const char *block, size_t encodedSize, uint64_t compressedSize, uint64_t size, std::string &out) const
+{
+    std::vector<char> decoded;
+    std::vector<char> decrypted;
+
+    if (!DecodeBase64(block, encodedSize, decoded) || !cipher->Decrypt(version, size, decoded.data(), decoded.size(), decrypted))
+        return false;
+
+    if (compressedSize == size)
+    {
+        out.assign(decrypted.begin(), decrypted.end());
+        return out.size() == size;
+    }
+
+    return Inflate(decrypted, size, out);
+}
+
+bool ArchiveSource::Open(const std::string &headerPath, const std::string &dataPath)
+{
+    MappedFile header;
+
+    if (!header.Open(headerPath) || !data.Open(dataPath))
+    {
+        std::cerr << "[VFS] Couldn't open " << headerPath << " and " << dataPath << "\n";
+        return false;
+    }
+
+    BlockReader reader{header.GetData(), header.GetData() + header.GetSize()};
+    version = reader.Read<uint32_t>();
+
+    uint64_t fileCount = 0;
+
+    if (version == MS2F)
+        reader.Read<uint32_t>();
+    else if (version == NS2F || version == OS2F || version == PS2F)
+        fileCount = reader.Read<uint32_t>();
+    else
+    {
+        std::cerr << "[VFS] " << headerPath << " isn't a known archive header\n";
+        return false;
+    }
+
+    uint64_t tableCompressedSize = reader.Read<uint64_t>();
+    uint64_t tableEncodedSize = reader.Read<uint64_t>();
+    uint64_t listSize = reader.Read<uint64_t>();
+    uint64_t listCompressedSize = reader.Read<uint64_t>();
+    uint64_t listEncodedSize = reader.Read<uint64_t>();
+
+    if (version == MS2F)
+        fileCount = reader.Read<uint64_t>();
+
+    uint64_t tableSize = reader.Read<uint64_t>();
+
+    const char *listBlock = reader.Skip(listEncodedSize);
+    const char *tableBlock = reader.Skip(tableEncodedSize);
+
+    if (!reader.valid)
+    {
+        std::cerr << "[VFS] " << headerPath << " is cut short\n";
+        return false;
+    }
+
+    if (!cipher)
+    {
+        std::cerr << "[VFS] " << headerPath << " is encrypted and no cipher was given for it\n";
+        return false;
+    }
+
+    std::string list;
+    std::string table;
+
+    if (!ReadBlock(listBlock, listEncodedSize, listCompressedSize, listSize, list) || !ReadBlock(tableBlock, tableEncodedSize, tableCompressedSize, tableSize, table))
+    {
+        std::cerr << "[VFS] Couldn't decrypt the file list of " << headerPath << "\n";
+        return false;
+    }
+
+    // "index,hash,name" lines, the hash is missing in older versions. the table has a record per line in the same order
+    BlockReader records{table.data(), table.data() + table.size()};
+    size_t lineStart = 0;
+
+    // the count is straight from the header, a damaged one can't reserve more than the list has lines
+    entries.reserve(std::min<uint64_t>(fileCount, std::count(list.begin(), list.end(), '\n') + 1));
+
+    for (uint64_t i = 0; i < fileCount && lineStart < list.size(); ++i)
+    {
+        size_t lineEnd = std::min(list.find('\n', lineStart), list.size());
+        std::string line = list.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        Entry entry;
+        entry.name = line.substr(line.rfind(',') + 1);
+        std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+
+        uint32_t compression = 0;
+
+        if (version == MS2F)
+        {
+            records.Read<uint32_t>();
+            records.Read<uint32_t>(); // the line's index
+            compression = records.Read<uint32_t>();
+            records.Read<uint32_t>();
+            entry.offset = records.Read<uint64_t>();
+            entry.encodedSize = records.Read<uint64_t>();
+            entry.compressedSize = records.Read<uint64_t>();
+            entry.size = records.Read<uint64_t>();
+        }
+        else
+        {
+            compression = records.Read<uint32_t>();
+            records.Read<uint32_t>();
+            entry.encodedSize = records.Read<uint64_t>();
+            entry.compressedSize = records.Read<uint64_t>();
+            entry.size = records.Read<uint64_t>();
+            entry.offset = records.Read<uint64_t>();
+        }
+
+        if (!records.valid)
+            break;
+
+        if (entry.offset > data.GetSize() || entry.encodedSize > data.GetSize() - entry.offset)
+        {
+            std::cerr << "[VFS] " << entry.name << " is outside of " << dataPath << "\n";
+            continue;
+        }
+
+        entry.compressed = compression == ZlibCompression;
+        entry.stored = compression == 0 && entry.encodedSize == entry.size && entry.compressedSize == entry.size;
+
+        entries[ToLower(entry.name)] = std::move(entry);
+    }
+
+    std::cout << "[VFS] " << entries.size() << " files in " << dataPath << "\n";
+
+    return true;
+}
+
+const ArchiveSource::Entry *ArchiveSource::Find(const std::string &path) const
+{
+    auto found = entries.find(ToLower(path));
+    return found != entries.end() ? &found->second : nullptr;
+}
+
+bool ArchiveSource::Exists(const std::string &path) const
+{
+    return Find(path) != nullptr;
+}
+
+bool ArchiveSource::Read(const std::string &path, std::string &out) const
+{
+    const Entry *entry = Find(path);
+    if (!entry)
+        return false;
+
+    const char *bytes = data.GetData() + entry->offset;
+
+    if (entry->stored)
+    {
+        out.assign(bytes, entry->encodedSize);
+        return true;
+    }
+
+    // reused by every read on the same thread, the file is only copied once more into out
+    thread_local std::vector<char> decrypted;
+
+    if (!cipher || !cipher->Decrypt(version, entry->size, bytes, entry->encodedSize, decrypted))
+        return false;
+
+    if (!entry->compressed)
+    {
+        out.assign(decrypted.begin(), decrypted.end());
+        return true;
+    }
+
+    if (!Inflate(decrypted, entry->size, out))
+    {
+        std::cerr << "[VFS] Couldn't inflate " << entry->name << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool ArchiveSource::View(const std::string &path, std::string_view &view) const
+{
+    const Entry *entry = Find(path);
+    if (!entry || !entry->stored)
+        return false;
+
+    view = std::string_view(data.GetData() + entry->offset, entry->encodedSize);
+
+    return true;
+}
+
+void ArchiveSource::List(std::vector<std::string> &paths) const
+{
+    for (const auto &entry : entries)
+        paths.push_back(entry.second.name);
+}
+
+void FileSystem::Mount(const std::string &directory, std::unique_ptr<FileSource> source)
+{
+    std::string normalized = Normalize(directory);
+
+    if (normalized.back() != '/')
+        normalized += '/';
+
+    mounts.push_back({normalized, std::move(source)});
+}
+
+void FileSystem::UnmountAll()
+{
+    mounts.clear();
+}
+
+size_t FileSystem::GetMountCount()
+{
+    return mounts.size();
+}
+
+// the source that has the file and the path inside it, null when it's a loose file
+static const FileSource *FindSource(const std::string &path, std::string &relative)
+{
+    if (mounts.empty())
+        return nullptr;
+
+    std::string normalized = Normalize(path);
+
+    for (auto mount = mounts.rbegin(); mount != mounts.rend(); ++mount)
+    {
+        if (normalized.compare(0, mount->directory.size(), mount->directory) != 0)
+            continue;
+
+        relative = normalized.substr(mount->directory.size());
+
+        if (mount->source->Exists(relative))
+            return mount->source.get();
+    }
+
+    return nullptr;
+}
+
+bool FileSystem::Exists(const std::string &path)
+{
+    std::string relative;
+    std::error_code error;
+
+    return FindSource(path, relative) || fs::is_regular_file(path, error);
+}
+
+bool FileSystem::Read(const std::string &path, std::string &data)
+{
+    std::string relative;
+
+    if (const FileSource *source = FindSource(path, relative))
+        return source->Read(relative, data);
+
+    return ReadLooseFile(path, data);
+}
+
+bool FileSystem::View(const std::string &path, std::string_view &view)
+{
+    std::string relative;
+    const FileSource *source = FindSource(path, relative);
+
+    return source && source->View(relative, view);
+}
+
+std::vector<std::string> FileSystem::List(const std::string &directory, const std::string &extension)
+{
+    std::string prefix = directory;
+    if (!prefix.empty() && prefix.back() != '/' && prefix.back() != '\\')
+        prefix += '/';
+
+    std::string normalized = Normalize(prefix);
+    if (normalized.back() != '/')
+        normalized += '/';
+
+    std::vector<std::string> paths;
+    std::string lowerNormalized = ToLower(normalized);
+
+    // archive names don't always have the case the loose files had
+    auto Add = [&](const std::string &path)
+    {
+        if (ToLower(path.substr(0, normalized.size())) == lowerNormalized && ToLower(fs::path(path).extension().string()) == extension)
+            paths.push_back(prefix + path.substr(normalized.size()));
+    };
+
+    std::error_code error;
+
+    for (fs::recursive_directory_iterator entry(directory, fs::directory_options::skip_permission_denied, error), end; entry != end; entry.increment(error))
+    {
+        if (error)
+            break;
+
+        if (entry->is_regular_file(error))
+            Add(Normalize(entry->path().string()));
+    }
+
+    for (const MountPoint &mount : mounts)
+    {
+        // a source mounted inside the directory or the directory inside a source
+        std::string lowerMount = ToLower(mount.directory);
+
+        if (lowerMount.compare(0, lowerNormalized.size(), lowerNormalized) != 0 && lowerNormalized.compare(0, lowerMount.size(), lowerMount) != 0)
+            continue;
+
+        std::vector<std::string> files;
+        mount.source->List(files);
+
+        for (const std::string &file : files)
+            Add(mount.directory + file);
+    }
+
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    return paths;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A read-only file mapped into memory, pages are only read from the disk once they're touched.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool Open(const std::string &path);
+    void Close();
+
+    const char *GetData() const { return data; }
+    size_t GetSize() const { return size; }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#else
+    int file = -1;
+#endif
+};
+
+// Decrypts the blocks of a client archive. The keys differ between the archive versions and aren't part of MapWoader,
+// whoever has them provides a cipher when mounting archives.
+class ArchiveCipher
+{
+public:
+    virtual ~ArchiveCipher() = default;
+
+    // version is the archive's magic, size the block's size once it's decrypted and inflated. out gets length bytes
+    virtual bool Decrypt(uint32_t version, uint64_t size, const char *data, size_t length, std::vector<char> &out) const = 0;
+};
+
+// Where FileSystem reads files from. Paths are relative to where the source is mounted and use '/'.
+class FileSource
+{
+public:
+    virtual ~FileSource() = default;
+
+    virtual bool Exists(const std::string &path) const = 0;
+
+    // data is resized to the file
+    virtual bool Read(const std::string &path, std::string &data) const = 0;
+
+    // the file's bytes for as long as the source is mounted, only for files kept as they are
+    virtual bool View(const std::string &, std::string_view &) const { return false; }
+
+    virtual void List(std::vector<std::string> &paths) const = 0;
+};
+
+// Loose files below a directory.
+class DirectorySource : public FileSource
+{
+public:
+    DirectorySource(const std::string &root);
+
+    bool Exists(const std::string &path) const override;
+    bool Read(const std::string &path, std::string &data) const override;
+    void List(std::vector<std::string> &paths) const override;
+
+private:
+    std::string root;
+};
+
+// A client .m2h and .m2d pair. The .m2h holds every file's name and where it is in the .m2d, it's decrypted once when
+// the archive is opened and kept in a hash map. The .m2d stays mapped, files are decrypted and inflated from it straight
+// into the caller's buffer. Files an archive keeps as they are can be viewed without a copy, the client's own archives
+// encrypt everything.
+class ArchiveSource : public FileSource
+{
+public:
+    ArchiveSource(const ArchiveCipher *cipher);
+
+    bool Open(const std::string &headerPath, const std::string &dataPath);
+
+    bool Exists(const std::string &path) const override;
+    bool Read(const std::string &path, std::string &data) const override;
+    bool View(const std::string &path, std::string_view &view) const override;
+    void List(std::vector<std::string> &paths) const override;
+
+    size_t GetEntryCount() const { return entries.size(); }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        uint64_t offset = 0;
+        uint64_t encodedSize = 0; // in the .m2d
+        uint64_t compressedSize = 0;
+        uint64_t size = 0;
+        bool compressed = false;
+        bool stored = false; // neither encrypted nor compressed
+    };
+
+    const ArchiveCipher *cipher;
+    uint32_t version = 0;
+    MappedFile data;
+    std::unordered_map<std::string, Entry> entries; // by lowercase name
+
+    const Entry *Find(const std::string &path) const;
+    bool ReadBlock(const char *block, size_t encodedSize, uint64_t compressedSize, uint64_t size, std::string &out) const;
+};
+
+// Every asset the editor reads goes through here. Sources are mounted below a directory, a path inside it is looked up
+// in the sources mounted there, the last mounted first. A path no source has is read from the disk as it is, so loose
+// files keep working with nothing mounted.
+//
+// Mount everything before loading starts, reading from several threads at once is fine after that.
+class FileSystem
+{
+public:
+    static void Mount(const std::string &directory, std::unique_ptr<FileSource> source);
+    static void UnmountAll();
+
+    static bool Exists(const std::string &path);
+    static bool Read(const std::string &path, std::string &data);
+    static bool View(const std::string &path, std::string_view &view);
+
+    // every file below directory with the extension, which is lowercase with its dot. paths start with directory
+    static std::vector<std::string> List(const std::string &directory, const std::string &extension);
+
+    static size_t GetMountCount();
+};
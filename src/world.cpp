@@ -0,0 +1,1285 @@
+#include "world.h"
+
+#include "assets.h"
+#include "collision.h"
+#include "mesh.h"
+#include "meshloader.h"
+#include "occlusion.h"
+#include "skinning.h"
+#include "vfs.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <Objects/Transform.h>
+
+#include "tinyxml2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+
+namespace fs = std::filesystem;
+
+static const std::string TextureRoot = "resources/textures/textures";
+
+// an object alone with its texture isn't worth a second copy of its vertices
+static const size_t MinBatchObjects = 2;
+
+// the grid the maps' blocks sit on, in .xblock units. an entity is on it if its position and rotation are within the
+// tolerances of a block and a quarter turn
+static const float BlockSize = 150.0f;
+static const float BlockTolerance = 0.01f;
+static const float CubeTolerance = 0.02f; // how far, in blocks, an opaque cube's faces may be from its block's
+
+static const glm::ivec3 BlockNeighbours[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+
+// occluders are the biggest objects on screen that are at least this many pixels across
+static const float MinOccluderPixels = 64.0f;
+static const size_t MaxOccluders = 256;
+
+static std::string FormatXBlockVector(const glm::vec3 &value)
+{
+    char text[96];
+    snprintf(text, sizeof(text), "%.7g, %.7g, %.7g", value.x, value.y, value.z);
+    return text;
+}
+
+World::World(SkinningSystem &skinning, CollisionWorld &collision, AssetCache &assets, const std::string &modelBasePath,
+             const Settings &settings)
+    : skinning(skinning), collision(collision), assets(assets), settings(settings)
+{
+    for (const std::string &path : FileSystem::List(modelBasePath, ".nif"))
+    {
+        std::string stem = fs::path(path).stem().string();
+        std::transform(stem.begin(), stem.end(), stem.begin(), ::tolower);
+
+        nifLookup[stem] = path; // overwrite is fine
+    }
+
+    // textures that aren't where the nif says are looked up by file name, the first one found wins
+    for (const std::string &path : FileSystem::List(TextureRoot, ".dds"))
+    {
+        std::string fileName = fs::path(path).filename().string();
+        std::transform(fileName.begin(), fileName.end(), fileName.begin(), ::tolower);
+
+        ddsLookup.emplace(fileName, path);
+    }
+}
+
+int World::AddMap(const std::string &path, const glm::vec3 &offset)
+{
+    std::unique_ptr<Map> map = std::make_unique<Map>();
+    map->path = path;
+    map->offset = FromXBlockPosition(offset);
+
+    // the document keeps the text around for saving, the entities are read from the same text
+    tinyxml2::XMLDocument doc;
+    if (!map->document.Load(path) || doc.Parse(map->document.GetSource().data(), map->document.GetSource().size()) != tinyxml2::XML_SUCCESS)
+    {
+        std::cerr << "[ERROR] Failed to load XBlock file: " << path << "\n";
+        return -1;
+    }
+
+    tinyxml2::XMLElement *game = doc.FirstChildElement("game");
+    tinyxml2::XMLElement *entitySet = game ? game->FirstChildElement("entitySet") : nullptr;
+    if (!entitySet)
+    {
+        std::cerr << "[ERROR] No entitySet in XBlock file: " << path << "\n";
+        return -1;
+    }
+
+    int mapIndex = static_cast<int>(maps.size());
+    size_t firstEntity = entities.size();
+    size_t cellCount = cells.size();
+    int documentEntity = -1;
+
+    for (tinyxml2::XMLElement *element = entitySet->FirstChildElement("entity"); element; element = element->NextSiblingElement("entity"))
+    {
+        ++documentEntity;
+
+        const char *modelName = element->Attribute("modelName");
+        const char *name = element->Attribute("name");
+        if (!modelName || !name)
+            continue;
+
+        Entity entity;
+        entity.name = name;
+        entity.map = mapIndex;
+
+        // both walk the entitySet in file order
+        entity.documentEntity = documentEntity;
+        const char *id = element->Attribute("id");
+        if (documentEntity >= static_cast<int>(map->document.GetEntityCount()) || (id && map->document.GetId(documentEntity) != id))
+        {
+            std::cerr << "[XBlock] Entity " << name << " doesn't line up with the document, it won't be saved\n";
+            entity.documentEntity = -1;
+        }
+
+        glm::vec3 position(0.0f);
+
+        for (tinyxml2::XMLElement *prop = element->FirstChildElement("property"); prop; prop = prop->NextSiblingElement("property"))
+        {
+            const char *propName = prop->Attribute("name");
+            tinyxml2::XMLElement *setElem = prop->FirstChildElement("set");
+            if (!propName || !setElem)
+                continue;
+
+            const char *value = setElem->Attribute("value");
+            if (!value)
+                continue;
+
+            if (strcmp(propName, "Position") == 0)
+                sscanf(value, "%f, %f, %f", &position.x, &position.y, &position.z);
+            else if (strcmp(propName, "Rotation") == 0)
+                sscanf(value, "%f, %f, %f", &entity.rotation.x, &entity.rotation.y, &entity.rotation.z);
+        }
+
+        entity.position = FromXBlockPosition(position) + map->offset;
+
+        std::string cleanName = modelName;
+        if (!cleanName.empty() && cleanName.back() == '_')
+            cleanName.pop_back();
+
+        std::string lookupName = cleanName;
+        std::transform(lookupName.begin(), lookupName.end(), lookupName.begin(), ::tolower);
+
+        auto nif = nifLookup.find(lookupName);
+        if (nif == nifLookup.end())
+        {
+            std::cerr << "[WARN] Could not find NIF for: " << cleanName << "\n";
+            continue;
+        }
+
+        entity.modelPath = nif->second;
+        entity.texturePath = FindTexture(entity.modelPath, entity.name);
+        entity.cell = GetCell(entity.position);
+
+        cells[entity.cell].entities.push_back(static_cast<int>(entities.size()));
+        entities.push_back(std::move(entity));
+    }
+
+    maps.push_back(std::move(map));
+
+    for (size_t i = firstEntity; i < entities.size(); ++i)
+        AddBlock(static_cast<int>(i));
+
+    std::cout << "[World] Added " << path << ", " << entities.size() - firstEntity << " entities, " << cells.size() - cellCount
+              << " new cells\n";
+
+    return mapIndex;
+}
+
+void World::Update(const glm::vec3 &camera)
+{
+    assets.FinishLoads();
+
+    // reloaded meshes changed under the batches made from them, a reloaded texture may have moved to another layer
+    if (assets.GetReloadCount() != batchedReloadCount)
+    {
+        batchedReloadCount = assets.GetReloadCount();
+
+        for (Cell &cell : cells)
+        {
+            cell.batchesDirty = cell.state == CellState::Loaded;
+
+            if (!cell.batchesDirty)
+                continue;
+
+            for (SceneObject &object : cell.objects)
+            {
+                const std::vector<std::string> &textures = GetNodeTextures(object.modelPath);
+
+                if (object.node < textures.size())
+                    object.material.texture = assets.FindTexture(textures[object.node]);
+            }
+        }
+    }
+
+    bool unloaded = false;
+    std::vector<Cell *> ready;
+
+    for (Cell &cell : cells)
+    {
+        // distance to the nearest point of the cell on the ground plane
+        float minX = cell.x * settings.cellSize;
+        float minZ = cell.z * settings.cellSize;
+        float dx = std::max(std::max(minX - camera.x, camera.x - (minX + settings.cellSize)), 0.0f);
+        float dz = std::max(std::max(minZ - camera.z, camera.z - (minZ + settings.cellSize)), 0.0f);
+
+        cell.distance = std::sqrt(dx * dx + dz * dz);
+
+        if (cell.distance > settings.unloadRadius)
+        {
+            cell.evicted = false;
+
+            if (cell.state != CellState::Unloaded)
+            {
+                Unload(cell);
+                unloaded = true;
+            }
+
+            continue;
+        }
+
+        // a cell the budget dropped needs the camera to come half a cell closer than it was
+        bool wanted = cell.distance < settings.loadRadius && (!cell.evicted || cell.distance < cell.evictedDistance - settings.cellSize * 0.5f);
+
+        if (cell.state == CellState::Unloaded && wanted)
+        {
+            cell.evicted = false;
+            StartLoading(cell);
+        }
+
+        if (cell.state != CellState::Loading)
+            continue;
+
+        bool loading = false;
+
+        for (const std::string &model : cell.models)
+            loading = loading || assets.IsLoading(model);
+
+        for (const std::string &texture : cell.textures)
+            loading = loading || assets.IsLoading(texture);
+
+        // which textures the materials name is only known once the models are parsed
+        if (!loading)
+            for (const std::string &model : cell.models)
+                for (const std::string &texture : GetNodeTextures(model))
+                    loading = AcquireCellTexture(cell, texture) || loading;
+
+        if (!loading)
+            ready.push_back(&cell);
+    }
+
+    // the nearest cells get their objects first
+    std::sort(ready.begin(), ready.end(), [](const Cell *a, const Cell *b)
+              { return a->distance < b->distance; });
+
+    for (size_t i = 0; i < ready.size() && i < static_cast<size_t>(settings.cellsPerFrame); ++i)
+        FinishLoading(*ready[i]);
+
+    // while an entity is being dragged its cell keeps its batches and the entity is drawn by itself
+    for (Cell &cell : cells)
+    {
+        if (cell.state != CellState::Loaded || !cell.batchesDirty)
+            continue;
+
+        if (cell.batchesEdited)
+            cell.batchesEdited = false;
+        else
+            BuildBatches(cell);
+    }
+
+    if (unloaded)
+        assets.Trim();
+
+    // the nearest cell always stays
+    while (GetCpuBytes() > settings.cpuBudget || GetGpuBytes() > settings.gpuBudget)
+    {
+        Cell *farthest = nullptr;
+        size_t loaded = 0;
+
+        for (Cell &cell : cells)
+        {
+            if (cell.state != CellState::Loaded)
+                continue;
+
+            ++loaded;
+
+            if (!farthest || cell.distance > farthest->distance)
+                farthest = &cell;
+        }
+
+        if (loaded < 2)
+            break;
+
+        farthest->evicted = true;
+        farthest->evictedDistance = farthest->distance;
+
+        Unload(*farthest);
+        assets.Trim();
+        ++evictionCount;
+
+        std::cout << "[World] Over budget, dropped cell (" << farthest->x << ", " << farthest->z << ") " << farthest->distance << " away\n";
+    }
+}
+
+// a coarser level than the one drawn has to be this far within the error before it's switched to, so objects near the
+// distance where levels change don't flip between them every frame
+static const float LodHysteresis = 0.7f;
+
+// the coarsest level whose error covers at most maxPixelError pixels
+static size_t PickLevel(const std::vector<Mesh::Lod> &lods, float pixelsPerError, size_t current, float maxPixelError)
+{
+    for (size_t i = lods.size() - 1; i > 0; --i)
+    {
+        float limit = i > current ? maxPixelError * LodHysteresis : maxPixelError;
+
+        if (lods[i].error * pixelsPerError <= limit)
+            return i;
+    }
+
+    return 0;
+}
+
+void World::SelectLods(const glm::vec3 &camera, float pixelsPerUnit, float maxPixelError)
+{
+    for (Cell &cell : cells)
+    {
+        if (cell.state != CellState::Loaded)
+            continue;
+
+        for (SceneObject &object : cell.objects)
+        {
+            if (!object.mesh || object.mesh->lods.size() < 2)
+            {
+                object.lod = 0;
+                continue;
+            }
+
+            const glm::mat4 &matrix = object.modelMatrix;
+            float scale = std::max({glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))});
+            float pixelsPerError = scale * pixelsPerUnit / std::max(glm::distance(camera, object.position), 1.0f);
+
+            object.lod = PickLevel(object.mesh->lods, pixelsPerError, object.lod, maxPixelError);
+        }
+
+        // batch errors are in world units already, the nearest point of the bounds decides
+        for (Batch &batch : cell.batches)
+        {
+            float distance = glm::distance(camera, glm::clamp(camera, batch.min, batch.max));
+
+            batch.lod = PickLevel(batch.mesh->lods, pixelsPerUnit / std::max(distance, 1.0f), batch.lod, maxPixelError);
+        }
+    }
+}
+
+size_t World::CullOccluded(OcclusionCuller &culler, const glm::mat4 &viewProjection, const glm::vec3 &camera, float pixelsPerUnit)
+{
+    std::vector<std::pair<float, OcclusionCuller::Occluder>> candidates;
+    std::vector<OcclusionCuller::Query> queries;
+    std::vector<bool *> results;
+
+    for (Cell &cell : cells)
+    {
+        if (cell.state != CellState::Loaded)
+            continue;
+
+        for (SceneObject &object : cell.objects)
+        {
+            object.occluded = false;
+
+            // skinned meshes move out of their bounds
+            if (!object.mesh || object.removed || object.hidden || object.skinIndex >= 0)
+                continue;
+
+            glm::mat4 matrix = GetObjectMatrix(object);
+
+            OcclusionCuller::Query query;
+            query.matrix = matrix;
+            query.min = object.mesh->min;
+            query.max = object.mesh->max;
+            queries.push_back(query);
+            results.push_back(&object.occluded);
+
+            // what's behind glass, water or a cutout still shows through it, those are only tested
+            if (object.mesh->occluderIndices.empty() || object.material.blended || object.material.alphaTested)
+                continue;
+
+            float scale = std::max({glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))});
+            glm::vec3 center = glm::vec3(matrix * glm::vec4((object.mesh->min + object.mesh->max) * 0.5f, 1.0f));
+            float pixels = glm::length(object.mesh->max - object.mesh->min) * scale * pixelsPerUnit / std::max(glm::distance(camera, center), 1.0f);
+
+            if (pixels >= MinOccluderPixels)
+                candidates.push_back({pixels, {matrix, &object.mesh->occluderPositions, &object.mesh->occluderIndices}});
+        }
+
+        for (Batch &batch : cell.batches)
+        {
+            OcclusionCuller::Query query;
+            query.min = batch.min;
+            query.max = batch.max;
+            queries.push_back(query);
+            results.push_back(&batch.occluded);
+        }
+    }
+
+    if (candidates.size() > MaxOccluders)
+    {
+        std::nth_element(candidates.begin(), candidates.begin() + MaxOccluders, candidates.end(), [](const auto &a, const auto &b)
+                         { return a.first > b.first; });
+        candidates.resize(MaxOccluders);
+    }
+
+    std::vector<OcclusionCuller::Occluder> occluders;
+
+    for (const auto &candidate : candidates)
+        occluders.push_back(candidate.second);
+
+    culler.Render(viewProjection, occluders);
+    culler.Test(queries.data(), queries.size());
+
+    size_t occluded = 0;
+
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        *results[i] = queries[i].occluded;
+        occluded += queries[i].occluded;
+    }
+
+    return occluded;
+}
+
+size_t World::Save()
+{
+    size_t saved = 0;
+
+    for (const std::unique_ptr<Map> &map : maps)
+    {
+        size_t pending = map->document.GetPendingCount();
+
+        if (pending == 0 || !map->document.Save(map->path))
+            continue;
+
+        std::cout << "[XBlock] Saved " << pending << " entities to " << map->path << "\n";
+        ++saved;
+    }
+
+    return saved;
+}
+
+size_t World::GetPendingCount() const
+{
+    size_t pending = 0;
+
+    for (const std::unique_ptr<Map> &map : maps)
+        pending += map->document.GetPendingCount();
+
+    return pending;
+}
+
+void World::Release()
+{
+    for (Cell &cell : cells)
+        if (cell.state != CellState::Unloaded)
+            Unload(cell);
+
+    assets.Trim();
+}
+
+const SceneObject *World::GetObject(int entity) const
+{
+    if (entity < 0 || entity >= static_cast<int>(entities.size()))
+        return nullptr;
+
+    const Entity &found = entities[entity];
+
+    if (found.objectCount == 0 || cells[found.cell].state != CellState::Loaded)
+        return nullptr;
+
+    return &cells[found.cell].objects[found.firstObject];
+}
+
+glm::vec3 World::GetXBlockPosition(int entity) const
+{
+    return ToXBlockPosition(entities[entity].position - maps[entities[entity].map]->offset);
+}
+
+size_t World::GetCellCount(CellState state) const
+{
+    return std::count_if(cells.begin(), cells.end(), [state](const Cell &cell)
+                         { return cell.state == state; });
+}
+
+size_t World::GetCpuBytes() const
+{
+    return assets.GetCpuBytes() + GetObjectBytes();
+}
+
+size_t World::GetGpuBytes() const
+{
+    return assets.GetGpuBytes() + GetBatchBytes();
+}
+
+size_t World::GetObjectBytes() const
+{
+    size_t bytes = 0;
+
+    for (const Cell &cell : cells)
+        bytes += cell.bytes;
+
+    return bytes;
+}
+
+size_t World::GetBatchBytes() const
+{
+    size_t bytes = 0;
+
+    for (const Cell &cell : cells)
+        bytes += cell.batchBytes;
+
+    return bytes;
+}
+
+size_t World::GetBatchCount() const
+{
+    size_t count = 0;
+
+    for (const Cell &cell : cells)
+        count += cell.batches.size();
+
+    return count;
+}
+
+void World::MoveEntity(int entity, const glm::vec3 &positionDelta, const glm::vec3 &rotationDelta)
+{
+    if (entity < 0 || entity >= static_cast<int>(entities.size()))
+        return;
+
+    SetTransform(entity, entities[entity].position + positionDelta, entities[entity].rotation + rotationDelta);
+}
+
+void World::SetRemoved(int entity, bool removed)
+{
+    if (entity < 0 || entity >= static_cast<int>(entities.size()))
+        return;
+
+    Entity &changed = entities[entity];
+    Cell &cell = cells[changed.cell];
+
+    changed.removed = removed;
+
+    if (removed)
+        RemoveBlock(entity);
+    else
+        AddBlock(entity);
+
+    if (changed.documentEntity >= 0)
+    {
+        XBlockDocument &document = maps[changed.map]->document;
+
+        if (removed)
+            document.RemoveEntity(changed.documentEntity);
+        else
+            document.RestoreEntity(changed.documentEntity);
+    }
+
+    if (cell.state != CellState::Loaded)
+        return;
+
+    Unbatch(cell, changed);
+
+    for (size_t i = changed.firstObject; i < changed.firstObject + changed.objectCount; ++i)
+        cell.objects[i].removed = removed;
+
+    collision.SetEnabled(changed.collisionIndex, !removed);
+}
+
+void World::SetProperty(int entity, const std::string &name, const std::string &value)
+{
+    if (entity < 0 || entity >= static_cast<int>(entities.size()) || entities[entity].documentEntity < 0)
+        return;
+
+    maps[entities[entity].map]->document.SetProperty(entities[entity].documentEntity, name, value);
+}
+
+// the cell already holds the copy's model, it gets objects and collision right away if the cell is loaded
+int World::Duplicate(int entity)
+{
+    Entity copy = entities[entity];
+    int index = static_cast<int>(entities.size());
+
+    if (copy.documentEntity >= 0)
+        copy.documentEntity = maps[copy.map]->document.DuplicateEntity(copy.documentEntity);
+
+    copy.firstObject = 0;
+    copy.objectCount = 0;
+    copy.collisionIndex = -1;
+    copy.skeleton = -1;
+    copy.hidden = false;
+    copy.onGrid = false;
+
+    entities.push_back(std::move(copy));
+
+    Cell &cell = cells[entities[index].cell];
+    cell.entities.push_back(index);
+
+    if (cell.state == CellState::Loaded)
+    {
+        CreateObjects(cell, index);
+
+        cell.batchesDirty = true;
+        cell.batchesEdited = true;
+    }
+
+    AddBlock(index);
+
+    return index;
+}
+
+glm::vec3 World::ToXBlockPosition(const glm::vec3 &position)
+{
+    return glm::vec3(position.x, -position.z, position.y);
+}
+
+glm::vec3 World::FromXBlockPosition(const glm::vec3 &position)
+{
+    return glm::vec3(position.x, position.z, -position.y);
+}
+
+glm::mat4 World::GetEntityMatrix(const glm::vec3 &position, const glm::vec3 &rotation)
+{
+    glm::mat4 matrix = glm::translate(glm::mat4(1.0f), position);
+
+    matrix = glm::rotate(matrix, glm::radians(rotation.z), glm::vec3(0, 0, 1));
+    matrix = glm::rotate(matrix, glm::radians(rotation.y), glm::vec3(0, 1, 0));
+    matrix = glm::rotate(matrix, glm::radians(rotation.x), glm::vec3(1, 0, 0));
+
+    return matrix * MeshLoader::GetOrientationFix();
+}
+
+glm::mat4 World::GetObjectMatrix(const SceneObject &object)
+{
+    glm::mat4 matrix = object.modelMatrix;
+
+    // the object's own rotation comes after the node's transform
+    matrix = glm::rotate(matrix, glm::radians(object.rotation.z), glm::vec3(0, 0, 1));
+    matrix = glm::rotate(matrix, glm::radians(object.rotation.y), glm::vec3(0, 1, 0));
+    matrix = glm::rotate(matrix, glm::radians(object.rotation.x), glm::vec3(1, 0, 0));
+
+    return matrix;
+}
+
+int World::GetCell(const glm::vec3 &position)
+{
+    int x = static_cast<int>(std::floor(position.x / settings.cellSize));
+    int z = static_cast<int>(std::floor(position.z / settings.cellSize));
+    int64_t key = (static_cast<int64_t>(x) << 32) | static_cast<uint32_t>(z);
+
+    auto found = cellIndices.find(key);
+    if (found != cellIndices.end())
+        return found->second;
+
+    Cell cell;
+    cell.x = x;
+    cell.z = z;
+
+    cells.push_back(std::move(cell));
+    cellIndices[key] = static_cast<int>(cells.size()) - 1;
+
+    return static_cast<int>(cells.size()) - 1;
+}
+
+// the texture is found once per nif, every mesh of every entity using it shares it
+const std::string &World::FindTexture(const std::string &nifPath, const std::string &name)
+{
+    auto cached = modelTextures.find(nifPath);
+    if (cached != modelTextures.end())
+        return cached->second;
+
+    std::string textureFileName = fs::path(nifPath).stem().string() + ".dds";
+    std::string parentFolder = "unknown";
+    fs::path nifFolder = fs::path(nifPath).parent_path();
+    if (!nifFolder.empty())
+        parentFolder = nifFolder.parent_path().filename().string();
+
+    // First attempt: best guess path
+    std::string texturePath = TextureRoot + "/" + parentFolder + "/" + textureFileName;
+    std::replace(texturePath.begin(), texturePath.end(), '\\', '/');
+
+    if (!FileSystem::Exists(texturePath))
+    {
+        std::string lookupName = textureFileName;
+        std::transform(lookupName.begin(), lookupName.end(), lookupName.begin(), ::tolower);
+
+        auto found = ddsLookup.find(lookupName);
+
+        if (found != ddsLookup.end())
+        {
+            texturePath = found->second;
+            std::cout << "[INFO] Fallback matched texture: " << texturePath << "\n";
+        }
+        else
+        {
+            std::cerr << "[WARN] No texture found for " << name << ": " << textureFileName << "\n";
+            texturePath.clear();
+        }
+    }
+
+    return modelTextures[nifPath] = texturePath;
+}
+
+// materials name textures where they were when the game was built, only the file name is looked up. empty if there's none
+std::string World::ResolveTexture(const std::string &fileName) const
+{
+    if (fileName.empty())
+        return {};
+
+    std::string name = fs::path(fileName).filename().replace_extension(".dds").string();
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    auto found = ddsLookup.find(name);
+
+    return found == ddsLookup.end() ? std::string() : found->second;
+}
+
+// the texture of every node of a model, empty until the model is loaded. nodes whose material names no texture that's
+// there use the one guessed from the nif's name
+const std::vector<std::string> &World::GetNodeTextures(const std::string &modelPath)
+{
+    static const std::vector<std::string> none;
+
+    auto cached = nodeTextures.find(modelPath);
+    if (cached != nodeTextures.end())
+        return cached->second;
+
+    const AssetCache::Model *model = modelPath.empty() ? nullptr : assets.FindModel(modelPath);
+    if (!model)
+        return none;
+
+    const auto &package = *model->package;
+    std::vector<std::string> textures;
+
+    for (const auto &node : package.Nodes)
+    {
+        std::string texture;
+
+        if (node.MaterialIndex < package.Materials.size())
+            texture = ResolveTexture(package.Materials[node.MaterialIndex].Diffuse);
+
+        if (texture.empty())
+            texture = FindTexture(modelPath, fs::path(modelPath).stem().string());
+
+        textures.push_back(texture);
+    }
+
+    return nodeTextures[modelPath] = std::move(textures);
+}
+
+// true if the cell didn't hold the texture yet
+bool World::AcquireCellTexture(Cell &cell, const std::string &path)
+{
+    if (path.empty() || std::find(cell.textures.begin(), cell.textures.end(), path) != cell.textures.end())
+        return false;
+
+    cell.textures.push_back(path);
+    assets.AcquireTexture(path);
+
+    return true;
+}
+
+void World::StartLoading(Cell &cell)
+{
+    for (int index : cell.entities)
+    {
+        const Entity &entity = entities[index];
+
+        if (entity.modelPath.empty())
+            continue;
+
+        if (std::find(cell.models.begin(), cell.models.end(), entity.modelPath) == cell.models.end())
+        {
+            cell.models.push_back(entity.modelPath);
+            assets.AcquireModel(entity.modelPath);
+        }
+
+        // models that were loaded before already know their textures
+        auto known = nodeTextures.find(entity.modelPath);
+
+        if (known != nodeTextures.end())
+            for (const std::string &texture : known->second)
+                AcquireCellTexture(cell, texture);
+    }
+
+    cell.state = CellState::Loading;
+}
+
+void World::FinishLoading(Cell &cell)
+{
+    for (int entity : cell.entities)
+        CreateObjects(cell, entity);
+
+    cell.state = CellState::Loaded;
+    cell.batchesDirty = true;
+
+    // a model that turned out to be an opaque cube can wall in blocks of every cell, not only this one
+    for (const std::string &model : newCubes)
+        for (const Entity &entity : entities)
+            if (entity.onGrid && entity.modelPath == model)
+                UpdateBlocksAround(entity.map, entity.block);
+
+    newCubes.clear();
+}
+
+void World::Unload(Cell &cell)
+{
+    FreeBatches(cell);
+
+    for (int index : cell.entities)
+    {
+        Entity &entity = entities[index];
+
+        collision.RemoveEntity(entity.collisionIndex);
+        skinning.RemoveSkeleton(entity.skeleton);
+
+        entity.firstObject = 0;
+        entity.objectCount = 0;
+        entity.collisionIndex = -1;
+        entity.skeleton = -1;
+    }
+
+    for (const std::string &model : cell.models)
+        assets.ReleaseModel(model);
+
+    for (const std::string &texture : cell.textures)
+        assets.ReleaseTexture(texture);
+
+    // clear() would keep the capacity around
+    std::vector<SceneObject>().swap(cell.objects);
+    cell.models.clear();
+    cell.textures.clear();
+    cell.bytes = 0;
+    cell.batchesDirty = false;
+    cell.batchesEdited = false;
+    cell.state = CellState::Unloaded;
+}
+
+// the nif's bounds against the block around its pivot, a quarter turn leaves that block where it is. anything that
+// blends or tests alpha can be seen through
+static bool IsOpaqueCube(const AssetCache::Model &model)
+{
+    const auto &package = *model.package;
+    glm::vec3 low(FLT_MAX);
+    glm::vec3 high(-FLT_MAX);
+
+    for (size_t i = 0; i < package.Nodes.size() && i < model.meshes.size(); ++i)
+    {
+        const Mesh *mesh = model.meshes[i];
+        if (!mesh)
+            continue;
+
+        const auto &node = package.Nodes[i];
+
+        if (node.MaterialIndex < package.Materials.size())
+        {
+            const auto &material = package.Materials[node.MaterialIndex];
+
+            if (material.Alpha < 1.0f || (material.HasAlphaProperty && (material.BlendEnabled || material.AlphaTestEnabled)))
+                return false;
+        }
+
+        glm::mat4 matrix = node.Transform ? node.Transform->LocalTransformGLM() : glm::mat4(1.0f);
+
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            glm::vec3 point(corner & 1 ? mesh->max.x : mesh->min.x, corner & 2 ? mesh->max.y : mesh->min.y, corner & 4 ? mesh->max.z : mesh->min.z);
+            point = glm::vec3(matrix * glm::vec4(point, 1.0f));
+
+            low = glm::min(low, point);
+            high = glm::max(high, point);
+        }
+    }
+
+    if (low.x > high.x)
+        return false;
+
+    float half = BlockSize * 0.5f;
+    float tolerance = BlockSize * CubeTolerance;
+
+    for (int axis = 0; axis < 3; ++axis)
+        if (std::fabs(low[axis] + half) > tolerance || std::fabs(high[axis] - half) > tolerance)
+            return false;
+
+    return true;
+}
+
+static Material GetMaterial(const Engine::Graphics::ModelPackage &package, const Engine::Graphics::ModelPackageNode &node,
+                            const TextureLayer &texture)
+{
+    Material material;
+    material.texture = texture;
+
+    if (node.MaterialIndex >= package.Materials.size())
+        return material;
+
+    const auto &source = package.Materials[node.MaterialIndex];
+
+    material.alphaTested = source.HasAlphaProperty && source.AlphaTestEnabled;
+    material.alphaThreshold = source.TestThreshold / 255.0f;
+    material.blended = source.Alpha < 1.0f || (source.HasAlphaProperty && source.BlendEnabled);
+
+    return material;
+}
+
+void World::CreateObjects(Cell &cell, int index)
+{
+    Entity &entity = entities[index];
+
+    entity.firstObject = cell.objects.size();
+    entity.objectCount = 0;
+
+    // failed models were already reported when they were loaded
+    const AssetCache::Model *model = entity.modelPath.empty() ? nullptr : assets.FindModel(entity.modelPath);
+    if (!model)
+        return;
+
+    const auto &package = model->package;
+    const std::vector<std::string> &textures = GetNodeTextures(entity.modelPath);
+
+    if (opaqueCubes.find(entity.modelPath) == opaqueCubes.end())
+    {
+        bool cube = IsOpaqueCube(*model);
+        opaqueCubes[entity.modelPath] = cube;
+
+        if (cube)
+            newCubes.push_back(entity.modelPath);
+    }
+
+    entity.collisionIndex = collision.AddEntity(model->collisionVertices, GetEntityMatrix(entity.position, entity.rotation));
+    collision.SetEnabled(entity.collisionIndex, !entity.removed);
+
+    for (size_t i = 0; i < package->Nodes.size() && i < model->meshes.size(); ++i)
+    {
+        const auto &node = package->Nodes[i];
+        Mesh *mesh = model->meshes[i];
+
+        if (!mesh)
+            continue;
+
+        TextureLayer texture = i < textures.size() ? assets.FindTexture(textures[i]) : TextureLayer();
+
+        SceneObject obj{entity.name, entity.modelPath, entity.position, entity.rotation, mesh, GetMaterial(*package, node, texture)};
+        obj.node = i;
+        obj.modelMatrix = node.Transform ? node.Transform->LocalTransformGLM() : glm::mat4(1.0f);
+        obj.collisionIndex = entity.collisionIndex;
+        obj.entityIndex = index;
+        obj.removed = entity.removed;
+        obj.hidden = entity.hidden;
+
+        if (!node.Bones.empty())
+        {
+            if (entity.skeleton < 0)
+                entity.skeleton = skinning.CreateSkeleton(*package, model->clip);
+
+            obj.skinIndex = skinning.AddMesh(entity.skeleton, *package, i);
+        }
+
+        cell.objects.push_back(obj);
+    }
+
+    entity.objectCount = cell.objects.size() - entity.firstObject;
+    cell.bytes += entity.objectCount * sizeof(SceneObject) + collision.GetEntitySize(entity.collisionIndex);
+}
+
+void World::SetTransform(int index, const glm::vec3 &position, const glm::vec3 &rotation)
+{
+    Entity &entity = entities[index];
+    Cell &cell = cells[entity.cell];
+
+    RemoveBlock(index);
+
+    entity.position = position;
+    entity.rotation = rotation;
+
+    AddBlock(index);
+
+    if (cell.state == CellState::Loaded)
+    {
+        Unbatch(cell, entity);
+
+        for (size_t i = entity.firstObject; i < entity.firstObject + entity.objectCount; ++i)
+        {
+            cell.objects[i].position = position;
+            cell.objects[i].rotation = rotation;
+        }
+
+        collision.SetTransform(entity.collisionIndex, GetEntityMatrix(position, rotation));
+    }
+
+    if (entity.documentEntity < 0)
+        return;
+
+    XBlockDocument &document = maps[entity.map]->document;
+
+    document.SetProperty(entity.documentEntity, "Position", FormatXBlockVector(GetXBlockPosition(index)));
+    document.SetProperty(entity.documentEntity, "Rotation", FormatXBlockVector(rotation));
+}
+
+void World::BuildBatches(Cell &cell)
+{
+    FreeBatches(cell);
+
+    // skinned objects move every frame, they stay by themselves. so do the ones that test or blend, they're drawn with
+    // their own state
+    std::map<GLuint, std::vector<size_t>> groups;
+
+    for (size_t i = 0; i < cell.objects.size(); ++i)
+    {
+        const SceneObject &object = cell.objects[i];
+
+        if (object.mesh && !object.removed && !object.hidden && object.skinIndex < 0 && !object.material.alphaTested &&
+            !object.material.blended)
+            groups[object.material.texture.array].push_back(i);
+    }
+
+    // every mesh is read back once, however many objects of the cell use it
+    std::unordered_map<const Mesh *, std::pair<std::vector<Mesh::Vertex>, std::vector<unsigned int>>> downloads;
+
+    for (const auto &group : groups)
+    {
+        if (group.second.size() < MinBatchObjects)
+            continue;
+
+        Batch batch;
+        batch.material.texture.array = group.first;
+        batch.min = glm::vec3(FLT_MAX);
+        batch.max = glm::vec3(-FLT_MAX);
+
+        size_t levelCount = 0;
+
+        for (size_t i : group.second)
+            levelCount = std::max(levelCount, cell.objects[i].mesh->lods.size());
+
+        std::vector<Mesh::Vertex> vertices;
+        std::vector<std::vector<unsigned int>> levels(levelCount);
+        std::vector<float> errors(levelCount, 0.0f);
+
+        for (size_t i : group.second)
+        {
+            const SceneObject &object = cell.objects[i];
+            auto &download = downloads[object.mesh];
+
+            if (download.second.empty())
+                object.mesh->Download(download.first, download.second);
+
+            // the same normals the shader works out from the model matrix
+            glm::mat4 matrix = GetObjectMatrix(object);
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(matrix)));
+            float scale = std::max({glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))});
+            unsigned int base = static_cast<unsigned int>(vertices.size());
+
+            for (Mesh::Vertex vertex : download.first)
+            {
+                vertex.position = glm::vec3(matrix * glm::vec4(vertex.position, 1.0f));
+                vertex.normal = normalMatrix * vertex.normal;
+                vertex.tangent = glm::mat3(matrix) * vertex.tangent;
+                vertex.binormal = glm::mat3(matrix) * vertex.binormal;
+                vertex.layer = static_cast<float>(object.material.texture.layer);
+
+                batch.min = glm::min(batch.min, vertex.position);
+                batch.max = glm::max(batch.max, vertex.position);
+                vertices.push_back(vertex);
+            }
+
+            Batch::Object merged;
+            merged.entity = object.entityIndex;
+            merged.object = i;
+
+            for (size_t level = 0; level < levelCount; ++level)
+            {
+                const Mesh::Lod &lod = object.mesh->lods[std::min(level, object.mesh->lods.size() - 1)];
+
+                merged.firstIndex.push_back(levels[level].size());
+                merged.indexCount.push_back(lod.indexCount);
+
+                for (size_t k = lod.firstIndex; k < lod.firstIndex + lod.indexCount; ++k)
+                    levels[level].push_back(download.second[k] + base);
+
+                errors[level] = std::max(errors[level], lod.error * scale);
+            }
+
+            batch.objects.push_back(std::move(merged));
+        }
+
+        // the levels follow each other in the index buffer
+        std::vector<unsigned int> indices;
+        std::vector<Mesh::Lod> lods;
+
+        for (size_t level = 0; level < levelCount; ++level)
+        {
+            lods.push_back({indices.size(), levels[level].size(), errors[level]});
+
+            for (Batch::Object &merged : batch.objects)
+                merged.firstIndex[level] += indices.size();
+
+            indices.insert(indices.end(), levels[level].begin(), levels[level].end());
+        }
+
+        batch.mesh = new Mesh(vertices, indices, lods);
+        batch.mesh->maxIndexCount = indices.size();
+        cell.batchBytes += vertices.size() * sizeof(Mesh::Vertex) + indices.size() * sizeof(unsigned int);
+
+        for (const Batch::Object &merged : batch.objects)
+            cell.objects[merged.object].batch = static_cast<int>(cell.batches.size());
+
+        cell.batches.push_back(std::move(batch));
+    }
+
+    cell.batchesDirty = false;
+}
+
+void World::FreeBatches(Cell &cell)
+{
+    for (Batch &batch : cell.batches)
+        delete batch.mesh;
+
+    cell.batches.clear();
+    cell.batchBytes = 0;
+
+    for (SceneObject &object : cell.objects)
+        object.batch = -1;
+}
+
+// the entity's triangles in the batch collapse onto one vertex, the rest of the batch draws as it was
+void World::Unbatch(Cell &cell, const Entity &entity)
+{
+    for (size_t i = entity.firstObject; i < entity.firstObject + entity.objectCount; ++i)
+    {
+        SceneObject &object = cell.objects[i];
+
+        if (object.batch < 0)
+            continue;
+
+        Batch &batch = cell.batches[object.batch];
+
+        for (const Batch::Object &merged : batch.objects)
+        {
+            if (merged.object != i)
+                continue;
+
+            for (size_t level = 0; level < merged.firstIndex.size(); ++level)
+                batch.mesh->ClearIndices(merged.firstIndex[level], merged.indexCount[level]);
+        }
+
+        batch.objects.erase(std::remove_if(batch.objects.begin(), batch.objects.end(), [i](const Batch::Object &merged)
+                                           { return merged.object == i; }),
+                            batch.objects.end());
+        object.batch = -1;
+    }
+
+    cell.batchesDirty = true;
+    cell.batchesEdited = true;
+}
+
+int64_t World::GetBlockKey(int map, const glm::ivec3 &block)
+{
+    return (static_cast<int64_t>(map & 0xFFFF) << 48) | (static_cast<int64_t>(block.x & 0xFFFF) << 32) |
+           (static_cast<int64_t>(block.y & 0xFFFF) << 16) | static_cast<int64_t>(block.z & 0xFFFF);
+}
+
+void World::AddBlock(int index)
+{
+    Entity &entity = entities[index];
+
+    if (entity.removed || entity.modelPath.empty())
+        return;
+
+    glm::vec3 position = GetXBlockPosition(index) / BlockSize;
+    glm::vec3 turns = entity.rotation / 90.0f;
+
+    for (int axis = 0; axis < 3; ++axis)
+        if (std::fabs(position[axis] - std::round(position[axis])) > BlockTolerance || std::fabs(turns[axis] - std::round(turns[axis])) > BlockTolerance)
+            return;
+
+    entity.onGrid = true;
+    entity.block = glm::ivec3(glm::round(position));
+    blocks[GetBlockKey(entity.map, entity.block)].push_back(index);
+
+    UpdateBlocksAround(entity.map, entity.block);
+}
+
+void World::RemoveBlock(int index)
+{
+    Entity &entity = entities[index];
+
+    if (!entity.onGrid)
+        return;
+
+    auto found = blocks.find(GetBlockKey(entity.map, entity.block));
+
+    if (found != blocks.end())
+    {
+        found->second.erase(std::remove(found->second.begin(), found->second.end(), index), found->second.end());
+
+        if (found->second.empty())
+            blocks.erase(found);
+    }
+
+    entity.onGrid = false;
+
+    UpdateHidden(index);
+    UpdateBlocksAround(entity.map, entity.block);
+}
+
+bool World::IsOpaqueBlock(int map, const glm::ivec3 &block) const
+{
+    auto found = blocks.find(GetBlockKey(map, block));
+    if (found == blocks.end())
+        return false;
+
+    for (int index : found->second)
+    {
+        auto cube = opaqueCubes.find(entities[index].modelPath);
+
+        if (cube != opaqueCubes.end() && cube->second)
+            return true;
+    }
+
+    return false;
+}
+
+void World::UpdateBlocksAround(int map, const glm::ivec3 &block)
+{
+    for (int i = -1; i < 6; ++i)
+    {
+        auto found = blocks.find(GetBlockKey(map, i < 0 ? block : block + BlockNeighbours[i]));
+        if (found == blocks.end())
+            continue;
+
+        for (int index : found->second)
+            UpdateHidden(index);
+    }
+}
+
+// an opaque cube with opaque cubes on all six sides
+void World::UpdateHidden(int index)
+{
+    Entity &entity = entities[index];
+    auto cube = opaqueCubes.find(entity.modelPath);
+    bool hidden = interiorCulling && entity.onGrid && cube != opaqueCubes.end() && cube->second;
+
+    for (int i = 0; i < 6 && hidden; ++i)
+        hidden = IsOpaqueBlock(entity.map, entity.block + BlockNeighbours[i]);
+
+    if (hidden == entity.hidden)
+        return;
+
+    entity.hidden = hidden;
+
+    if (hidden)
+        ++hiddenCount;
+    else
+        --hiddenCount;
+
+    Cell &cell = cells[entity.cell];
+
+    if (cell.state != CellState::Loaded)
+        return;
+
+    for (size_t i = entity.firstObject; i < entity.firstObject + entity.objectCount; ++i)
+        cell.objects[i].hidden = hidden;
+
+    cell.batchesDirty = true;
+}
+
+void World::SetInteriorCulling(bool enabled)
+{
+    interiorCulling = enabled;
+
+    for (size_t i = 0; i < entities.size(); ++i)
+        UpdateHidden(static_cast<int>(i));
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "history.h"
+#include "material.h"
+#include "xblock.h"
+
+class AssetCache;
+class CollisionWorld;
+class Mesh;
+class OcclusionCuller;
+class SkinningSystem;
+
+struct SceneObject
+{
+    std::string name;
+    std::string modelPath;
+    glm::vec3 position;
+    glm::vec3 rotation;
+    Mesh *mesh = nullptr;
+    Material material;
+    glm::mat4 modelMatrix = glm::mat4(1.0f);
+    bool printed = false;
+    int skinIndex = -1;
+    int collisionIndex = -1;
+    int entityIndex = -1;
+    bool removed = false;
+    size_t lod = 0; // the mesh level to draw, picked by World::SelectLods
+    size_t node = 0;  // in the model's package
+    int batch = -1;   // in its cell's batches, -1 while it's drawn by itself
+    bool occluded = false; // hidden behind other objects as of World::CullOccluded
+    bool hidden = false;   // its entity is a block walled in by opaque blocks
+};
+
+// Any number of .xblock maps placed next to each other. Their entities are sorted into square cells on the ground
+// plane, and only the cells around the camera have scene objects, collision and models. Cells start loading when the
+// camera comes within loadRadius and are dropped again beyond unloadRadius. The nifs and textures of a loading cell are
+// read on the job system, a cell gets its objects once all of them are uploaded.
+//
+// When the loaded models and cells take more memory than the budgets allow, the farthest cells are dropped first and
+// their models freed once no other cell holds them. Those cells only come back after the camera moved closer to them.
+//
+// Entities are kept for every map whether their cell is loaded or not, so edits, undo and saving work everywhere.
+// Entity indices are the same ones EditHistory records.
+//
+// The static objects of a loaded cell that share a texture are merged into batches, one mesh with their vertices
+// already in world space, so the many models that are only placed a few times don't each cost a draw. An edited
+// entity's objects leave their batch right away and are drawn by themselves, the cell's batches are built again once an
+// update passes without edits to it.
+//
+// Entities on the maps' 150 unit grid are kept in a hash of occupied blocks. A model is an opaque cube once it's loaded
+// and turns out to fill a block without any alpha. An opaque cube whose six neighbouring blocks all hold one too can't
+// be seen and isn't drawn. Adding, removing and moving entities only looks at the blocks around them again.
+class World : public EditHistory::Target
+{
+public:
+    struct Settings
+    {
+        float cellSize = 2400.0f;
+        float loadRadius = 6000.0f;
+        float unloadRadius = 7500.0f; // the gap to loadRadius keeps cells at the edge from coming and going every frame
+        size_t cpuBudget = size_t(512) << 20;
+        size_t gpuBudget = size_t(1024) << 20;
+        int cellsPerFrame = 2; // how many cells may get their objects in one frame
+    };
+
+    enum class CellState
+    {
+        Unloaded,
+        Loading,
+        Loaded
+    };
+
+    // the opaque static objects of a cell whose textures share an array, each vertex carries its object's layer. the
+    // mesh's level i holds every object's level i, or its last one for objects that have fewer
+    struct Batch
+    {
+        struct Object
+        {
+            int entity = -1;
+            size_t object = 0;              // in the cell's objects
+            std::vector<size_t> firstIndex; // per level of the mesh
+            std::vector<size_t> indexCount;
+        };
+
+        Material material; // the array, the layers are in the vertices
+        Mesh *mesh = nullptr;
+        std::vector<Object> objects;
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+        size_t lod = 0;
+        bool occluded = false;
+    };
+
+    struct Cell
+    {
+        int x = 0;
+        int z = 0;
+        CellState state = CellState::Unloaded;
+        std::vector<int> entities;
+        std::vector<SceneObject> objects; // while loaded, an entity's objects are next to each other
+        std::vector<std::string> models;  // what the cell holds in the asset cache while loading or loaded
+        std::vector<std::string> textures;
+        size_t bytes = 0;      // the objects and their collision
+        float distance = 0.0f; // from the camera as of the last update
+        bool evicted = false;  // dropped for the budget at evictedDistance
+        float evictedDistance = 0.0f;
+        std::vector<Batch> batches;
+        size_t batchBytes = 0;      // of the batches' meshes
+        bool batchesDirty = false;  // the batches are built again on an update
+        bool batchesEdited = false; // an entity changed since the last update, the build waits a frame
+    };
+
+    // position and rotation are in the editor's space with the map's offset applied. entities stream with the cell they
+    // were in when their map was added or they were duplicated, moving them doesn't change it
+    struct Entity
+    {
+        std::string name;
+        std::string modelPath; // empty if no nif was found for the model
+        std::string texturePath; // guessed from the nif's name, nodes whose material names no texture that's there use it
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 rotation = glm::vec3(0.0f);
+        int map = -1;
+        int documentEntity = -1; // -1 if it couldn't be matched with the document, its edits aren't saved
+        int cell = -1;
+        bool removed = false;
+        bool hidden = false; // walled in on all six sides by opaque cubes
+        bool onGrid = false; // in the block hash at block
+        glm::ivec3 block = glm::ivec3(0);
+
+        // while the cell is loaded
+        size_t firstObject = 0;
+        size_t objectCount = 0;
+        int collisionIndex = -1;
+        int skeleton = -1;
+    };
+
+    World(SkinningSystem &skinning, CollisionWorld &collision, AssetCache &assets, const std::string &modelBasePath,
+          const Settings &settings);
+
+    World(const World &) = delete;
+    World &operator=(const World &) = delete;
+
+    // offset places the map in the world, in the .xblock's own coordinates. returns the map's index or -1
+    int AddMap(const std::string &path, const glm::vec3 &offset);
+
+    // loads and drops cells around the camera and keeps to the budgets
+    void Update(const glm::vec3 &camera);
+
+    // picks every loaded object's and batch's mesh level by how many pixels its error covers. pixelsPerUnit is how many
+    // pixels something one unit big one unit in front of the camera covers
+    void SelectLods(const glm::vec3 &camera, float pixelsPerUnit, float maxPixelError);
+
+    // draws the static objects that cover the most of the screen into the culler, then marks every loaded object and
+    // batch they hide. returns how many that was
+    size_t CullOccluded(OcclusionCuller &culler, const glm::mat4 &viewProjection, const glm::vec3 &camera, float pixelsPerUnit);
+
+    // writes every map that has unsaved edits, returns how many maps were saved
+    size_t Save();
+    size_t GetPendingCount() const;
+
+    // drops every cell, call it while the GL context is still alive
+    void Release();
+
+    size_t GetMapCount() const { return maps.size(); }
+    const std::string &GetMapPath(int map) const { return maps[map]->path; }
+
+    size_t GetEntityCount() const { return entities.size(); }
+    const Entity &GetEntity(int entity) const { return entities[entity]; }
+
+    // the entity's first scene object, null while its cell isn't loaded
+    const SceneObject *GetObject(int entity) const;
+
+    // the entity's position in its own map's .xblock coordinates
+    glm::vec3 GetXBlockPosition(int entity) const;
+
+    const std::vector<Cell> &GetCells() const { return cells; }
+    const Settings &GetSettings() const { return settings; }
+
+    size_t GetCellCount(CellState state) const;
+    size_t GetCpuBytes() const;
+    size_t GetGpuBytes() const;
+    size_t GetObjectBytes() const; // scene objects and their collision triangles in world space
+    size_t GetBatchBytes() const;
+    size_t GetEvictionCount() const { return evictionCount; }
+    size_t GetBatchCount() const;
+    size_t GetHiddenCount() const { return hiddenCount; }
+
+    // whether blocks walled in by opaque cubes are hidden, on by default
+    void SetInteriorCulling(bool enabled);
+
+    void MoveEntity(int entity, const glm::vec3 &positionDelta, const glm::vec3 &rotationDelta) override;
+    void SetRemoved(int entity, bool removed) override;
+    void SetProperty(int entity, const std::string &name, const std::string &value) override;
+
+    // the copy goes into the same map and cell, returns its entity index
+    int Duplicate(int entity);
+
+    // the scene is y up, the .xblock z up
+    static glm::vec3 ToXBlockPosition(const glm::vec3 &position);
+    static glm::vec3 FromXBlockPosition(const glm::vec3 &position);
+
+    // places a nif in the world the way the xblock entity describes it
+    static glm::mat4 GetEntityMatrix(const glm::vec3 &position, const glm::vec3 &rotation);
+
+    // what the shader gets as the object's model matrix, batches are built with the same
+    static glm::mat4 GetObjectMatrix(const SceneObject &object);
+
+private:
+    struct Map
+    {
+        std::string path;
+        glm::vec3 offset = glm::vec3(0.0f); // in the editor's space
+        XBlockDocument document;
+    };
+
+    SkinningSystem &skinning;
+    CollisionWorld &collision;
+    AssetCache &assets;
+    Settings settings;
+
+    std::vector<std::unique_ptr<Map>> maps;
+    std::vector<Entity> entities;
+    std::vector<Cell> cells;
+    std::unordered_map<int64_t, int> cellIndices;
+
+    // lowercase model name to nif, .dds file name to its path, nif to the texture found for it
+    std::unordered_map<std::string, std::string> nifLookup;
+    std::unordered_map<std::string, std::string> ddsLookup;
+    std::unordered_map<std::string, std::string> modelTextures;
+    std::unordered_map<std::string, std::vector<std::string>> nodeTextures; // by model, known once it was loaded
+
+    size_t evictionCount = 0;
+    size_t batchedReloadCount = 0; // the asset cache's reload count the batches and materials were made with
+
+    std::unordered_map<int64_t, std::vector<int>> blocks; // entities on the grid by map and block
+    std::unordered_map<std::string, bool> opaqueCubes; // by model, known once it was loaded
+    std::vector<std::string> newCubes;                 // models found to be opaque cubes while creating objects
+    bool interiorCulling = true;
+    size_t hiddenCount = 0;
+
+    int GetCell(const glm::vec3 &position);
+    const std::string &FindTexture(const std::string &nifPath, const std::string &name);
+    std::string ResolveTexture(const std::string &fileName) const;
+    const std::vector<std::string> &GetNodeTextures(const std::string &modelPath);
+    bool AcquireCellTexture(Cell &cell, const std::string &path);
+
+    void StartLoading(Cell &cell);
+    void FinishLoading(Cell &cell);
+    void Unload(Cell &cell);
+    void CreateObjects(Cell &cell, int entity);
+    void SetTransform(int entity, const glm::vec3 &position, const glm::vec3 &rotation);
+
+    static int64_t GetBlockKey(int map, const glm::ivec3 &block);
+    void AddBlock(int entity);
+    void RemoveBlock(int entity);
+    bool IsOpaqueBlock(int map, const glm::ivec3 &block) const;
+    void UpdateBlocksAround(int map, const glm::ivec3 &block);
+    void UpdateHidden(int entity);
+
+    void BuildBatches(Cell &cell);
+    void FreeBatches(Cell &cell);
+    void Unbatch(Cell &cell, const Entity &entity);
+};
@@ -0,0 +1,750 @@
+#include "xblock.h"
+
+#include "vfs.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+static bool IsSpace(char character)
+{
+    return character == ' ' || character == '\t' || character == '\r' || character == '\n';
+}
+
+// the '>' closing the tag that starts at position, quoted attribute values may contain '>'
+static size_t FindTagEnd(const std::string &text, size_t position)
+{
+    char quote = 0;
+
+    for (size_t i = position + 1; i < text.size(); ++i)
+    {
+        char character = text[i];
+
+        if (quote != 0)
+        {
+            if (character == quote)
+                quote = 0;
+        }
+        else if (character == '"' || character == '\'')
+            quote = character;
+        else if (character == '>')
+            return i;
+    }
+
+    return std::string::npos;
+}
+
+static std::string ReadName(const std::string &text, size_t position)
+{
+    size_t end = position;
+
+    while (end < text.size() && !IsSpace(text[end]) && text[end] != '/' && text[end] != '>')
+        ++end;
+
+    return text.substr(position, end - position);
+}
+
+// the next <name ...> or <name/> at or after position
+static size_t FindElement(const std::string &text, const char *name, size_t position)
+{
+    size_t length = strlen(name);
+
+    while ((position = text.find('<', position)) != std::string::npos)
+    {
+        size_t next = position + 1 + length;
+
+        if (text.compare(position + 1, length, name) == 0 && next < text.size() && (IsSpace(text[next]) || text[next] == '/' || text[next] == '>'))
+            return position;
+
+        ++position;
+    }
+
+    return std::string::npos;
+}
+
+// [valueBegin, valueEnd) is the attribute's value without its quotes
+static bool FindAttribute(const std::string &text, size_t tagBegin, size_t tagEnd, const char *name, size_t &valueBegin, size_t &valueEnd)
+{
+    size_t length = strlen(name);
+    size_t position = tagBegin + 1;
+
+    while (position < tagEnd && !IsSpace(text[position]) && text[position] != '/')
+        ++position;
+
+    while (position < tagEnd)
+    {
+        while (position < tagEnd && (IsSpace(text[position]) || text[position] == '/'))
+            ++position;
+
+        size_t nameBegin = position;
+
+        while (position < tagEnd && !IsSpace(text[position]) && text[position] != '=')
+            ++position;
+
+        size_t nameEnd = position;
+
+        while (position < tagEnd && IsSpace(text[position]))
+            ++position;
+
+        if (position >= tagEnd || text[position] != '=')
+            continue;
+
+        ++position;
+
+        while (position < tagEnd && IsSpace(text[position]))
+            ++position;
+
+        if (position >= tagEnd || (text[position] != '"' && text[position] != '\''))
+            return false;
+
+        char quote = text[position];
+        size_t end = text.find(quote, position + 1);
+
+        if (end == std::string::npos || end > tagEnd)
+            return false;
+
+        if (nameEnd - nameBegin == length && text.compare(nameBegin, length, name) == 0)
+        {
+            valueBegin = position + 1;
+            valueEnd = end;
+
+            return true;
+        }
+
+        position = end + 1;
+    }
+
+    return false;
+}
+
+static std::string Escape(const std::string &value)
+{
+    std::string escaped;
+
+    escaped.reserve(value.size());
+
+    for (char character : value)
+    {
+        switch (character)
+        {
+        case '&': escaped += "&amp;"; break;
+        case '<': escaped += "&lt;"; break;
+        case '>': escaped += "&gt;"; break;
+        case '"': escaped += "&quot;"; break;
+        default: escaped += character; break;
+        }
+    }
+
+    return escaped;
+}
+
+static std::string Unescape(const std::string &value)
+{
+    static const std::pair<const char *, char> entities[] = {
+        {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+
+    std::string unescaped;
+
+    unescaped.reserve(value.size());
+
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        bool replaced = false;
+
+        if (value[i] == '&')
+        {
+            for (const auto &entity : entities)
+            {
+                size_t length = strlen(entity.first);
+
+                if (value.compare(i, length, entity.first) == 0)
+                {
+                    unescaped += entity.second;
+                    i += length - 1;
+                    replaced = true;
+
+                    break;
+                }
+            }
+        }
+
+        if (!replaced)
+            unescaped += value[i];
+    }
+
+    return unescaped;
+}
+
+// finds the <property> called name inside an entity's text. valueBegin is npos if it has no <set value="...">
+static bool FindProperty(const std::string &text, const std::string &name, size_t &propertyBegin, size_t &propertyEnd, size_t &valueBegin, size_t &valueEnd)
+{
+    static const char *closeTag = "</property>";
+
+    size_t position = 0;
+
+    while ((position = FindElement(text, "property", position)) != std::string::npos)
+    {
+        size_t tagEnd = FindTagEnd(text, position);
+
+        if (tagEnd == std::string::npos)
+            return false;
+
+        bool selfClosing = text[tagEnd - 1] == '/';
+        size_t close = selfClosing ? tagEnd : text.find(closeTag, tagEnd);
+
+        if (close == std::string::npos)
+            return false;
+
+        size_t nameBegin = 0;
+        size_t nameEnd = 0;
+
+        if (FindAttribute(text, position, tagEnd, "name", nameBegin, nameEnd) && Unescape(text.substr(nameBegin, nameEnd - nameBegin)) == name)
+        {
+            propertyBegin = position;
+            propertyEnd = selfClosing ? tagEnd + 1 : close + strlen(closeTag);
+            valueBegin = std::string::npos;
+
+            size_t set = selfClosing ? std::string::npos : FindElement(text, "set", tagEnd);
+
+            if (set != std::string::npos && set < close)
+            {
+                size_t setEnd = FindTagEnd(text, set);
+
+                if (setEnd == std::string::npos || !FindAttribute(text, set, setEnd, "value", valueBegin, valueEnd))
+                    valueBegin = std::string::npos;
+            }
+
+            return true;
+        }
+
+        position = tagEnd;
+    }
+
+    return false;
+}
+
+bool XBlockDocument::Load(const std::string &path)
+{
+    std::string text;
+    if (!FileSystem::Read(path, text))
+    {
+        std::cerr << "[XBlock] Failed to open " << path << "\n";
+        return false;
+    }
+
+    *this = XBlockDocument();
+    source = std::move(text);
+
+    if (source.find("\r\n") != std::string::npos)
+        newline = "\r\n";
+
+    // only the entities of the first <game><entitySet> are tracked, the same ones the scene loads
+    std::vector<std::string> open;
+    bool entitySetDone = false;
+    int current = -1;
+    size_t position = 0;
+
+    auto InEntitySet = [&]()
+    {
+        return !entitySetDone && open.size() == 2 && open[0] == "game" && open[1] == "entitySet";
+    };
+
+    auto FinishEntity = [&](Entity &entity, size_t end)
+    {
+        entity.end = end;
+        entity.lineBegin = entity.begin;
+        entity.lineEnd = end;
+
+        size_t lineBegin = entity.begin;
+
+        while (lineBegin > 0 && (source[lineBegin - 1] == ' ' || source[lineBegin - 1] == '\t'))
+            --lineBegin;
+
+        if (lineBegin > 0 && source[lineBegin - 1] != '\n')
+            return;
+
+        size_t lineEnd = end;
+
+        while (lineEnd < source.size() && (source[lineEnd] == ' ' || source[lineEnd] == '\t' || source[lineEnd] == '\r'))
+            ++lineEnd;
+
+        if (lineEnd < source.size() && source[lineEnd] != '\n')
+            return;
+
+        entity.lineBegin = lineBegin;
+        entity.lineEnd = std::min(lineEnd + 1, source.size());
+    };
+
+    while ((position = source.find('<', position)) != std::string::npos)
+    {
+        size_t end = std::string::npos;
+
+        if (source.compare(position, 4, "<!--") == 0)
+        {
+            end = source.find("-->", position + 4);
+            position = end == std::string::npos ? end : end + 3;
+            continue;
+        }
+
+        if (source.compare(position, 9, "<![CDATA[") == 0)
+        {
+            end = source.find("]]>", position + 9);
+            position = end == std::string::npos ? end : end + 3;
+            continue;
+        }
+
+        end = FindTagEnd(source, position);
+        if (end == std::string::npos)
+            break;
+
+        char kind = position + 1 < source.size() ? source[position + 1] : 0;
+
+        if (kind == '?' || kind == '!')
+        {
+        }
+        else if (kind == '/')
+        {
+            std::string name = ReadName(source, position + 2);
+
+            if (!open.empty())
+                open.pop_back();
+
+            if (name == "entity" && current >= 0 && InEntitySet())
+            {
+                FinishEntity(entities[current], end + 1);
+                current = -1;
+            }
+            else if (name == "entitySet" && !entitySetDone && open.size() == 1 && open[0] == "game")
+            {
+                size_t lineBegin = position;
+
+                while (lineBegin > 0 && (source[lineBegin - 1] == ' ' || source[lineBegin - 1] == '\t'))
+                    --lineBegin;
+
+                entitySetEnd = lineBegin == 0 || source[lineBegin - 1] == '\n' ? lineBegin : position;
+                entitySetDone = true;
+            }
+        }
+        else
+        {
+            std::string name = ReadName(source, position + 1);
+            bool selfClosing = source[end - 1] == '/';
+
+            if (name == "entity" && InEntitySet())
+            {
+                Entity entity;
+                size_t idBegin = 0;
+                size_t idEnd = 0;
+
+                if (FindAttribute(source, position, end, "id", idBegin, idEnd))
+                    entity.id = Unescape(source.substr(idBegin, idEnd - idBegin));
+
+                entity.begin = position;
+                entity.inSource = true;
+
+                if (!entities.empty() && entity.id < entities.back().id)
+                    sortedIds = false;
+
+                if (!entity.id.empty() && !ids.emplace(entity.id, (int)entities.size()).second)
+                    std::cerr << "[XBlock] Duplicate entity id " << entity.id << " in " << path << "\n";
+
+                entities.push_back(entity);
+
+                if (selfClosing)
+                    FinishEntity(entities.back(), end + 1);
+                else
+                    current = (int)entities.size() - 1;
+            }
+
+            if (!selfClosing)
+                open.push_back(name);
+        }
+
+        position = end + 1;
+    }
+
+    if (current >= 0)
+    {
+        std::cerr << "[XBlock] Unterminated entity in " << path << "\n";
+        *this = XBlockDocument();
+        return false;
+    }
+
+    for (size_t i = 0; i < entities.size(); ++i)
+        fileOrder.push_back((int)i);
+
+    // new entities are indented like the loaded ones
+    for (const Entity &entity : entities)
+    {
+        if (entity.lineBegin == entity.begin)
+            continue;
+
+        indent = source.substr(entity.lineBegin, entity.begin - entity.lineBegin);
+        indentStep = indent[0] == ' ' ? indent.substr(0, std::max<size_t>(indent.size() / 2, 1)) : "\t";
+        break;
+    }
+
+    return true;
+}
+
+bool XBlockDocument::Save(const std::string &path)
+{
+    // unchanged entities and everything between them are copied from the loaded text as they are. added entities go
+    // in front of whatever is at their insert position
+    struct Piece
+    {
+        size_t position;
+        int order;
+        int entity;
+    };
+
+    std::vector<Piece> pieces;
+    size_t addedSize = 0;
+
+    for (int index : fileOrder)
+        pieces.push_back({entities[index].lineBegin, 1, index});
+
+    for (size_t i = 0; i < entities.size(); ++i)
+    {
+        const Entity &entity = entities[i];
+
+        if (entity.inSource || entity.removed)
+            continue;
+
+        if (entitySetEnd == std::string::npos)
+        {
+            std::cerr << "[XBlock] " << path << " has no entitySet to add entities to\n";
+            return false;
+        }
+
+        pieces.push_back({GetInsertPosition(entity), 0, (int)i});
+        addedSize += indent.size() + entity.text.size() + newline.size();
+    }
+
+    std::sort(pieces.begin(), pieces.end(), [this](const Piece &left, const Piece &right)
+    {
+        if (left.position != right.position)
+            return left.position < right.position;
+
+        if (left.order != right.order)
+            return left.order < right.order;
+
+        return entities[left.entity].id < entities[right.entity].id;
+    });
+
+    // ranges of the entities in the new text, applied once the file is in place
+    std::vector<Entity> saved(entities.size());
+    std::string output;
+    size_t cursor = 0;
+
+    output.reserve(source.size() + addedSize);
+
+    for (const Piece &piece : pieces)
+    {
+        const Entity &entity = entities[piece.entity];
+        Entity &range = saved[piece.entity];
+
+        output.append(source, cursor, piece.position - cursor);
+        cursor = piece.position;
+
+        if (entity.inSource && entity.removed)
+        {
+            cursor = entity.lineEnd;
+            continue;
+        }
+
+        range.lineBegin = output.size();
+
+        if (entity.inSource)
+            output.append(source, entity.lineBegin, entity.begin - entity.lineBegin);
+        else
+            output += indent;
+
+        range.begin = output.size();
+
+        if (entity.edited)
+            output += entity.text;
+        else
+            output.append(source, entity.begin, entity.end - entity.begin);
+
+        range.end = output.size();
+
+        if (entity.inSource)
+        {
+            output.append(source, entity.end, entity.lineEnd - entity.end);
+            cursor = entity.lineEnd;
+        }
+        else
+            output += newline;
+
+        range.lineEnd = output.size();
+        range.inSource = true;
+    }
+
+    size_t savedEntitySetEnd = entitySetEnd == std::string::npos ? entitySetEnd : output.size() + entitySetEnd - cursor;
+
+    output.append(source, cursor, std::string::npos);
+
+    std::string temporary = path + ".tmp";
+    std::error_code error;
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+        if (file)
+            file.write(output.data(), output.size());
+
+        if (!file)
+        {
+            std::cerr << "[XBlock] Failed to write " << temporary << "\n";
+            fs::remove(temporary, error);
+            return false;
+        }
+    }
+
+    // replaces the old file in one step, a crash leaves either the old file or the new one
+    fs::rename(temporary, path, error);
+    if (error)
+    {
+        std::cerr << "[XBlock] Failed to replace " << path << ": " << error.message() << "\n";
+        fs::remove(temporary, error);
+        return false;
+    }
+
+    // removed entities hold on to their text so they can still be restored
+    for (size_t i = 0; i < entities.size(); ++i)
+    {
+        Entity &entity = entities[i];
+
+        if (entity.inSource && entity.removed)
+        {
+            entity.text = source.substr(entity.begin, entity.end - entity.begin);
+            entity.edited = true;
+            entity.inSource = false;
+        }
+    }
+
+    fileOrder.clear();
+
+    for (const Piece &piece : pieces)
+    {
+        Entity &entity = entities[piece.entity];
+        const Entity &range = saved[piece.entity];
+
+        if (!range.inSource)
+            continue;
+
+        entity.lineBegin = range.lineBegin;
+        entity.begin = range.begin;
+        entity.end = range.end;
+        entity.lineEnd = range.lineEnd;
+        entity.inSource = true;
+        entity.edited = false;
+        entity.text.clear();
+
+        fileOrder.push_back(piece.entity);
+    }
+
+    source.swap(output);
+    entitySetEnd = savedEntitySetEnd;
+
+    return true;
+}
+
+int XBlockDocument::FindEntity(const std::string &id) const
+{
+    auto entity = ids.find(id);
+
+    return entity == ids.end() ? -1 : entity->second;
+}
+
+std::string XBlockDocument::GetProperty(int entity, const std::string &name) const
+{
+    std::string text = GetText(entities[entity]);
+    size_t propertyBegin = 0;
+    size_t propertyEnd = 0;
+    size_t valueBegin = 0;
+    size_t valueEnd = 0;
+
+    if (!FindProperty(text, name, propertyBegin, propertyEnd, valueBegin, valueEnd) || valueBegin == std::string::npos)
+        return std::string();
+
+    return Unescape(text.substr(valueBegin, valueEnd - valueBegin));
+}
+
+void XBlockDocument::SetProperty(int entity, const std::string &name, const std::string &value)
+{
+    Entity &target = Edit(entity);
+    std::string &text = target.text;
+    std::string entityIndent = target.inSource ? source.substr(target.lineBegin, target.begin - target.lineBegin) : indent;
+    std::string propertyIndent = entityIndent + indentStep;
+    size_t propertyBegin = 0;
+    size_t propertyEnd = 0;
+    size_t valueBegin = 0;
+    size_t valueEnd = 0;
+
+    if (FindProperty(text, name, propertyBegin, propertyEnd, valueBegin, valueEnd))
+    {
+        if (valueBegin != std::string::npos)
+            text.replace(valueBegin, valueEnd - valueBegin, Escape(value));
+        else
+            text.replace(propertyBegin, propertyEnd - propertyBegin, FormatProperty(name, value, propertyIndent));
+
+        return;
+    }
+
+    std::string property = FormatProperty(name, value, propertyIndent);
+    size_t close = text.rfind("</entity>");
+
+    if (close == std::string::npos)
+    {
+        // <entity ... /> opens up to take its first property
+        size_t slash = text.rfind('/');
+
+        text.replace(slash, std::string::npos, ">" + newline + propertyIndent + property + newline + entityIndent + "</entity>");
+
+        return;
+    }
+
+    size_t lineBegin = close;
+
+    while (lineBegin > 0 && (text[lineBegin - 1] == ' ' || text[lineBegin - 1] == '\t'))
+        --lineBegin;
+
+    if (lineBegin > 0 && text[lineBegin - 1] == '\n')
+        text.insert(lineBegin, propertyIndent + property + newline);
+    else
+        text.insert(close, newline + propertyIndent + property + newline + entityIndent);
+}
+
+void XBlockDocument::RemoveEntity(int entity)
+{
+    entities[entity].removed = true;
+}
+
+void XBlockDocument::RestoreEntity(int entity)
+{
+    entities[entity].removed = false;
+}
+
+int XBlockDocument::AddEntity(const std::string &modelName, const std::string &name, const std::vector<Property> &properties)
+{
+    Entity entity;
+    std::string propertyIndent = indent + indentStep;
+
+    entity.id = CreateId();
+    entity.edited = true;
+    entity.text = "<entity id=\"" + entity.id + "\" modelName=\"" + Escape(modelName) + "\" name=\"" + Escape(name) + "\">" + newline;
+
+    for (const Property &property : properties)
+        entity.text += propertyIndent + FormatProperty(property.first, property.second, propertyIndent) + newline;
+
+    entity.text += indent + "</entity>";
+
+    ids[entity.id] = (int)entities.size();
+    entities.push_back(entity);
+
+    return (int)entities.size() - 1;
+}
+
+int XBlockDocument::DuplicateEntity(int entity)
+{
+    Entity duplicate;
+
+    duplicate.id = CreateId();
+    duplicate.edited = true;
+    duplicate.text = GetText(entities[entity]);
+
+    size_t tagEnd = FindTagEnd(duplicate.text, 0);
+    size_t idBegin = 0;
+    size_t idEnd = 0;
+
+    if (tagEnd != std::string::npos && FindAttribute(duplicate.text, 0, tagEnd, "id", idBegin, idEnd))
+        duplicate.text.replace(idBegin, idEnd - idBegin, duplicate.id);
+    else
+        duplicate.text.insert(strlen("<entity"), " id=\"" + duplicate.id + "\"");
+
+    ids[duplicate.id] = (int)entities.size();
+    entities.push_back(duplicate);
+
+    return (int)entities.size() - 1;
+}
+
+size_t XBlockDocument::GetPendingCount() const
+{
+    size_t count = 0;
+
+    for (const Entity &entity : entities)
+    {
+        if (entity.inSource ? entity.edited || entity.removed : !entity.removed)
+            ++count;
+    }
+
+    return count;
+}
+
+std::string XBlockDocument::GetText(const Entity &entity) const
+{
+    if (entity.edited)
+        return entity.text;
+
+    return source.substr(entity.begin, entity.end - entity.begin);
+}
+
+XBlockDocument::Entity &XBlockDocument::Edit(int entity)
+{
+    Entity &target = entities[entity];
+
+    if (!target.edited)
+    {
+        target.text = source.substr(target.begin, target.end - target.begin);
+        target.edited = true;
+    }
+
+    return target;
+}
+
+// a file sorted by id stays sorted, otherwise new entities go at the end of the entitySet
+size_t XBlockDocument::GetInsertPosition(const Entity &entity) const
+{
+    if (!sortedIds)
+        return entitySetEnd;
+
+    auto next = std::upper_bound(fileOrder.begin(), fileOrder.end(), entity.id, [this](const std::string &id, int index)
+    {
+        return id < entities[index].id;
+    });
+
+    return next == fileOrder.end() ? entitySetEnd : entities[*next].lineBegin;
+}
+
+std::string XBlockDocument::FormatProperty(const std::string &name, const std::string &value, const std::string &propertyIndent) const
+{
+    return "<property name=\"" + Escape(name) + "\">" + newline +
+           propertyIndent + indentStep + "<set value=\"" + Escape(value) + "\" />" + newline +
+           propertyIndent + "</property>";
+}
+
+// ids are 32 lowercase hex digits like the ones already in the files
+std::string XBlockDocument::CreateId() const
+{
+    static std::mt19937_64 generator(std::random_device{}());
+    static const char digits[] = "0123456789abcdef";
+
+    std::string id;
+
+    do
+    {
+        id.clear();
+
+        for (int i = 0; i < 32; ++i)
+            id += digits[generator() & 15];
+    } while (ids.count(id) != 0);
+
+    return id;
+}
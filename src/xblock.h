@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The text of an .xblock together with where each <entity> of its entitySet sits in it. Saving copies everything that
+// wasn't touched straight from the loaded text and only writes out the entities that were added, changed or removed,
+// so the file keeps its formatting and a save shows up in version control as the entities that were edited.
+class XBlockDocument
+{
+public:
+    // name and value of a <property><set value="..." /></property>, unescaped
+    typedef std::pair<std::string, std::string> Property;
+
+    bool Load(const std::string &path);
+
+    // writes path + ".tmp" and renames it over path. the document keeps its edits if that fails
+    bool Save(const std::string &path);
+
+    // the text as of the last load or save, without pending edits
+    const std::string &GetSource() const { return source; }
+
+    // entities keep their index for the life of the document, removed ones included. loaded entities come first, in
+    // file order
+    size_t GetEntityCount() const { return entities.size(); }
+    int FindEntity(const std::string &id) const;
+    const std::string &GetId(int entity) const { return entities[entity].id; }
+    bool IsRemoved(int entity) const { return entities[entity].removed; }
+
+    // empty if the entity has no such property
+    std::string GetProperty(int entity, const std::string &name) const;
+
+    // changes the value of the property's <set>, or adds the property at the end of the entity
+    void SetProperty(int entity, const std::string &name, const std::string &value);
+
+    void RemoveEntity(int entity);
+    void RestoreEntity(int entity);
+
+    // added entities get a fresh id and are saved at the end of the entitySet, or in id order if the file is sorted
+    int AddEntity(const std::string &modelName, const std::string &name, const std::vector<Property> &properties);
+    int DuplicateEntity(int entity);
+
+    // entities that will be written differently on the next save
+    size_t GetPendingCount() const;
+
+private:
+    // [lineBegin, lineEnd) is the entity with its indentation and line break, [begin, end) the element itself. edited
+    // entities keep their element in text, added ones have no range until they're saved
+    struct Entity
+    {
+        std::string id;
+        size_t lineBegin = 0;
+        size_t begin = 0;
+        size_t end = 0;
+        size_t lineEnd = 0;
+        bool inSource = false;
+        bool edited = false;
+        bool removed = false;
+        std::string text;
+    };
+
+    std::string source;
+    std::vector<Entity> entities;
+    std::vector<int> fileOrder;
+    std::unordered_map<std::string, int> ids;
+
+    // where new entities go when no loaded id sorts after theirs, the start of the </entitySet> line
+    size_t entitySetEnd = std::string::npos;
+    bool sortedIds = true;
+
+    std::string indent = "\t\t";
+    std::string indentStep = "\t";
+    std::string newline = "\n";
+
+    std::string GetText(const Entity &entity) const;
+    Entity &Edit(int entity);
+    size_t GetInsertPosition(const Entity &entity) const;
+    std::string FormatProperty(const std::string &name, const std::string &value, const std::string &propertyIndent) const;
+    std::string CreateId() const;
+};
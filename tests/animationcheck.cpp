@@ -0,0 +1,222 @@
+// CompressedAnimationClip on a synthetic clip with every kind of track: linear, quadratic and euler keys, splines and a
+// constant channel. the report's errors have to stay within what 16 bit keys and smallest-three rotations allow, and
+// sampling between the report's sample times has to agree with the uncompressed sampler just as well
+
+#include <VulkanGraphics/Scene/AnimationSampler.h>
+#include <VulkanGraphics/Scene/CompressedAnimation.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace Engine::Graphics;
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    ++failures;
+    printf("failed: %s\n", what);
+}
+
+static const float Duration = 2.0f;
+
+// a translation range of about 100, 16 bit keys are good to 100 / 65535 / 2 on each axis
+static const float MaxTranslationError = 0.005f;
+static const float MaxRotationError = 0.001f; // radians
+static const float MaxScaleError = 0.0001f;
+
+static Quaternion AxisAngle(float x, float y, float z, float angle)
+{
+    float length = std::sqrt(x * x + y * y + z * z);
+    float s = std::sin(0.5f * angle) / length;
+
+    return Quaternion(std::cos(0.5f * angle), x * s, y * s, z * s);
+}
+
+static ModelPackageAnimation MakeClip()
+{
+    ModelPackageAnimation clip;
+    clip.Name = "synthetic";
+    clip.Duration = Duration;
+    clip.CycleType = AnimationCycleType::Loop;
+
+    const int keys = 41;
+
+    // linear keys on every channel, the scale never changes
+    ModelPackageAnimationNode root;
+    root.NodeName = "root";
+    root.Translation.Type = AnimationInterpolationType::Linear;
+    root.Rotation.Type = AnimationInterpolationType::Linear;
+    root.Scale.Type = AnimationInterpolationType::Linear;
+
+    // quadratic translation with tangents, euler rotation and a growing scale
+    ModelPackageAnimationNode arm;
+    arm.NodeName = "arm";
+    arm.Translation.Type = AnimationInterpolationType::Quadratic;
+    arm.Rotation.Type = AnimationInterpolationType::XyzRotation;
+    arm.EulerRotation.X.Type = AnimationInterpolationType::Linear;
+    arm.EulerRotation.Y.Type = AnimationInterpolationType::Linear;
+    arm.EulerRotation.Z.Type = AnimationInterpolationType::Linear;
+    arm.Scale.Type = AnimationInterpolationType::Linear;
+
+    for (int i = 0; i < keys; ++i)
+    {
+        float time = Duration * i / (keys - 1);
+
+        ModelPackageAnimationVectorKeyframe translation;
+        translation.Time = time;
+        translation.Value = Vector3SF(50.0f * std::sin(time * 3.0f), 10.0f * time, -30.0f * std::cos(time * 2.0f));
+        root.Translation.Keyframes.push_back(translation);
+
+        ModelPackageAnimationQuaternionKeyframe rotation;
+        rotation.Time = time;
+        rotation.Value = AxisAngle(0.3f, 1.0f, -0.2f, 2.5f * time);
+        root.Rotation.Keyframes.push_back(rotation);
+
+        ModelPackageAnimationFloatKeyframe scale;
+        scale.Time = time;
+        scale.Value = 1.5f;
+        root.Scale.Keyframes.push_back(scale);
+
+        ModelPackageAnimationVectorKeyframe quadratic;
+        quadratic.Time = time;
+        quadratic.Value = Vector3SF(5.0f * time, 2.0f * std::sin(time * 4.0f), 1.0f);
+        quadratic.Params = Vector3SF(5.0f, 8.0f * std::cos(time * 4.0f), 0.0f) * (Duration / (keys - 1));
+        quadratic.Backward = quadratic.Params;
+        arm.Translation.Keyframes.push_back(quadratic);
+
+        ModelPackageAnimationFloatKeyframe angle;
+        angle.Time = time;
+        angle.Value = 0.7f * std::sin(time * 2.0f);
+        arm.EulerRotation.X.Keyframes.push_back(angle);
+        angle.Value = -1.2f * time;
+        arm.EulerRotation.Y.Keyframes.push_back(angle);
+        angle.Value = 0.3f;
+        arm.EulerRotation.Z.Keyframes.push_back(angle);
+
+        scale.Value = 1.0f + 0.5f * time;
+        arm.Scale.Keyframes.push_back(scale);
+    }
+
+    // a b-spline on every channel
+    ModelPackageAnimationNode tail;
+    tail.NodeName = "tail";
+    tail.IsSpline = true;
+    tail.TranslationSpline.Start = tail.RotationSpline.Start = tail.ScaleSpline.Start = 0.0f;
+    tail.TranslationSpline.End = tail.RotationSpline.End = tail.ScaleSpline.End = Duration;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        tail.TranslationSpline.ControlPoints.push_back(Vector3SF(20.0f * std::cos(i * 0.8f), 20.0f * std::sin(i * 0.8f), 3.0f * i));
+        tail.RotationSpline.ControlPoints.push_back(AxisAngle(1.0f, 0.0f, 0.5f, 0.4f * i));
+        tail.ScaleSpline.ControlPoints.push_back(1.0f + 0.1f * (i % 3));
+    }
+
+    clip.Nodes = {root, arm, tail};
+
+    return clip;
+}
+
+// the angle between two rotations from the chord between the quaternions, acos of their dot product isn't precise
+// enough in floats this close to 1
+static float RotationError(const Quaternion &a, const Quaternion &b)
+{
+    float sign = a.X * b.X + a.Y * b.Y + a.Z * b.Z + a.W * b.W < 0.0f ? -1.0f : 1.0f;
+    float x = a.X - sign * b.X;
+    float y = a.Y - sign * b.Y;
+    float z = a.Z - sign * b.Z;
+    float w = a.W - sign * b.W;
+
+    return 4.0f * std::asin(std::min(0.5f * std::sqrt(x * x + y * y + z * z + w * w), 1.0f));
+}
+
+int main()
+{
+    ModelPackageAnimation source = MakeClip();
+    CompressedAnimationClip clip(source);
+
+    Expect(clip.GetNodeCount() == 3, "every node has a channel");
+    Expect(clip.GetNodeIndex("arm") != (size_t)-1 && clip.GetNodeIndex("missing") == (size_t)-1, "nodes are found by name");
+    Expect(clip.GetDuration() == Duration && clip.GetCycleType() == AnimationCycleType::Loop, "clip settings kept");
+
+    CompressedAnimationClip::Report report = clip.Measure(source);
+
+    printf("%zu tracks, %zu constant, %zu keys, %zu bytes from %zu\n", report.Tracks, report.ConstantTracks, report.Keys,
+           report.CompressedBytes, report.SourceBytes);
+    printf("errors: %g translation, %g rad rotation, %g scale\n", report.MaxTranslationError, report.MaxRotationError,
+           report.MaxScaleError);
+
+    Expect(report.Tracks >= 9, "a track per channel and euler axis");
+    Expect(report.ConstantTracks >= 2, "unchanging scale and euler z are constant");
+    Expect(report.CompressedBytes < report.SourceBytes / 2, "compressed to less than half");
+    Expect(report.CompressedBytes == clip.GetSize(), "the report counts the clip's size");
+    Expect(report.MaxTranslationError <= MaxTranslationError, "translation error in bounds");
+    Expect(report.MaxRotationError <= MaxRotationError, "rotation error in bounds");
+    Expect(report.MaxScaleError <= MaxScaleError, "scale error in bounds");
+
+    // between the report's sample times, and past the end where the clip loops
+    AnimationSampler reference(source);
+    std::vector<AnimationPose> expected(clip.GetNodeCount());
+    std::vector<AnimationPose> actual(clip.GetNodeCount());
+    std::vector<unsigned int> expectedCursors;
+    std::vector<unsigned int> actualCursors;
+
+    float worstTranslation = 0.0f;
+    float worstRotation = 0.0f;
+    float worstScale = 0.0f;
+
+    for (float time = 0.0f; time < 3.0f * Duration; time += 0.0137f)
+    {
+        reference.Sample(time, expected.data(), expectedCursors);
+        clip.Sample(time, actual.data(), actualCursors);
+
+        for (size_t node = 0; node < actual.size(); ++node)
+        {
+            const AnimationPose &a = expected[node];
+            const AnimationPose &b = actual[node];
+
+            float x = a.Translation.X - b.Translation.X;
+            float y = a.Translation.Y - b.Translation.Y;
+            float z = a.Translation.Z - b.Translation.Z;
+
+            worstTranslation = std::max(worstTranslation, std::sqrt(x * x + y * y + z * z));
+            worstRotation = std::max(worstRotation, RotationError(a.Rotation, b.Rotation));
+            worstScale = std::max(worstScale, std::abs(a.Scale - b.Scale));
+        }
+    }
+
+    Expect(worstTranslation <= MaxTranslationError, "translation between samples in bounds");
+    Expect(worstRotation <= MaxRotationError, "rotation between samples in bounds");
+    Expect(worstScale <= MaxScaleError, "scale between samples in bounds");
+
+    // a fresh instance starting somewhere else agrees with one that played up to there
+    std::vector<unsigned int> fresh;
+    std::vector<AnimationPose> jumped(clip.GetNodeCount());
+
+    clip.Sample(1.234f, actual.data(), actualCursors);
+    clip.Sample(1.234f, jumped.data(), fresh);
+
+    bool same = true;
+
+    for (size_t node = 0; node < actual.size(); ++node)
+        same = same && actual[node].Translation.X == jumped[node].Translation.X && actual[node].Rotation.W == jumped[node].Rotation.W &&
+               actual[node].Scale == jumped[node].Scale;
+
+    Expect(same, "cursors don't change the result");
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+// ArchiveSource on a synthetic .m2h and .m2d pair with a cipher that passes the bytes through: stored and deflated
+// files read back as they were written, and sizes from a damaged header are refused before anything is allocated for
+// them, both for files and for the header's own blocks
+
+#include "vfs.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    ++failures;
+    printf("failed: %s\n", what);
+}
+
+static const uint32_t NS2F = 0x4632534E;
+static const uint32_t ZlibCompression = 0xEE000009;
+
+// the bytes are already in the clear
+class PassThroughCipher : public ArchiveCipher
+{
+public:
+    bool Decrypt(uint32_t, uint64_t, const char *data, size_t length, std::vector<char> &out) const override
+    {
+        out.assign(data, data + length);
+        return true;
+    }
+};
+
+template <typename Type>
+static void Put(std::string &out, Type value)
+{
+    char bytes[sizeof(Type)];
+
+    memcpy(bytes, &value, sizeof(Type));
+    out.append(bytes, sizeof(Type));
+}
+
+static std::string EncodeBase64(const std::string &bytes)
+{
+    static const char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string out;
+    uint32_t bits = 0;
+    int count = 0;
+
+    for (unsigned char byte : bytes)
+    {
+        bits = (bits << 8) | byte;
+        count += 8;
+
+        while (count >= 6)
+        {
+            count -= 6;
+            out += Alphabet[(bits >> count) & 0x3F];
+        }
+    }
+
+    if (count > 0)
+        out += Alphabet[(bits << (6 - count)) & 0x3F];
+
+    while (out.size() % 4 != 0)
+        out += '=';
+
+    return out;
+}
+
+// a zlib stream of stored deflate blocks, inflating it gives back data
+static std::string Deflate(const std::string &data)
+{
+    std::string out = "\x78\x01";
+    size_t position = 0;
+
+    do
+    {
+        uint16_t length = static_cast<uint16_t>(std::min<size_t>(data.size() - position, 0xFFFF));
+
+        out += position + length == data.size() ? '\x01' : '\x00';
+        Put<uint16_t>(out, length);
+        Put<uint16_t>(out, static_cast<uint16_t>(~length));
+        out.append(data, position, length);
+        position += length;
+    } while (position < data.size());
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    for (unsigned char byte : data)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    uint32_t adler = (b << 16) | a;
+
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out += static_cast<char>(adler >> shift);
+
+    return out;
+}
+
+struct TestFile
+{
+    std::string name;
+    std::string encoded; // what goes into the .m2d
+    uint32_t compression = 0;
+    uint64_t compressedSize = 0;
+    uint64_t size = 0;
+};
+
+static TestFile Stored(const std::string &name, const std::string &contents)
+{
+    return {name, contents, 0, contents.size(), contents.size()};
+}
+
+static TestFile Deflated(const std::string &name, const std::string &contents)
+{
+    std::string compressed = Deflate(contents);
+
+    return {name, compressed, ZlibCompression, compressed.size(), contents.size()};
+}
+
+// listSize overrides the size the header gives for the file list when it isn't 0
+static void WriteArchive(const fs::path &header, const fs::path &data, const std::vector<TestFile> &files, uint64_t listSize = 0)
+{
+    std::string list;
+    std::string table;
+    std::string blob;
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const TestFile &file = files[i];
+
+        list += std::to_string(i + 1) + ",0," + file.name + "\r\n";
+
+        Put<uint32_t>(table, file.compression);
+        Put<uint32_t>(table, 0);
+        Put<uint64_t>(table, file.encoded.size());
+        Put<uint64_t>(table, file.compressedSize);
+        Put<uint64_t>(table, file.size);
+        Put<uint64_t>(table, blob.size());
+
+        blob += file.encoded;
+    }
+
+    std::string listBlock = EncodeBase64(Deflate(list));
+    std::string tableBlock = EncodeBase64(Deflate(table));
+    std::string out;
+
+    Put<uint32_t>(out, NS2F);
+    Put<uint32_t>(out, static_cast<uint32_t>(files.size()));
+    Put<uint64_t>(out, Deflate(table).size());
+    Put<uint64_t>(out, tableBlock.size());
+    Put<uint64_t>(out, listSize != 0 ? listSize : list.size());
+    Put<uint64_t>(out, Deflate(list).size());
+    Put<uint64_t>(out, listBlock.size());
+    Put<uint64_t>(out, table.size());
+
+    out += listBlock;
+    out += tableBlock;
+
+    std::ofstream(header, std::ios::binary) << out;
+    std::ofstream(data, std::ios::binary) << blob;
+}
+
+int main()
+{
+    fs::path directory = fs::temp_directory_path() / "archivecheck";
+    fs::path header = directory / "Test.m2h";
+    fs::path data = directory / "Test.m2d";
+    PassThroughCipher cipher;
+
+    fs::create_directories(directory);
+
+    std::string text = "a stored file, kept as it is";
+    std::string large;
+
+    // more than one stored deflate block
+    for (int i = 0; i < 20000; ++i)
+        large += "line " + std::to_string(i) + "\n";
+
+    // a damaged size on a small deflated file, one past what deflate could expand it to, and one past what stb_image's
+    // ints can count that the compressed bytes alone don't rule out
+    TestFile huge = Deflated("huge.bin", "tiny");
+    huge.size = 1ull << 40;
+
+    TestFile ratio = Deflated("ratio.bin", "tiny");
+    ratio.size = ratio.encoded.size() * 1032 + 1;
+
+    TestFile wide = Stored("wide.bin", std::string(3 << 20, '\0'));
+    wide.compression = ZlibCompression;
+    wide.size = 3ull << 30;
+
+    TestFile shorter = Deflated("short.bin", large);
+    shorter.size = large.size() - 1;
+
+    WriteArchive(header, data, {Stored("Data/Text.txt", text), Deflated("Data/Large.txt", large), huge, ratio, wide, shorter});
+
+    {
+        ArchiveSource archive(&cipher);
+
+        Expect(archive.Open(header.string(), data.string()), "archive opens");
+        Expect(archive.GetEntryCount() == 6, "every entry listed");
+        Expect(archive.Exists("data/text.txt") && archive.Exists("DATA/LARGE.TXT"), "names are found in any case");
+
+        std::string contents;
+        std::string_view view;
+
+        Expect(archive.Read("Data/Text.txt", contents) && contents == text, "stored file reads back");
+        Expect(archive.View("Data/Text.txt", view) && view == text, "stored file is viewed in place");
+        Expect(archive.Read("Data/Large.txt", contents) && contents == large, "deflated file reads back");
+        Expect(!archive.View("Data/Large.txt", view), "deflated files can't be viewed");
+
+        Expect(!archive.Read("huge.bin", contents) && contents.empty(), "a terabyte from four bytes is refused");
+        Expect(!archive.Read("ratio.bin", contents), "a size past deflate's ratio is refused");
+        Expect(!archive.Read("wide.bin", contents), "a size past 2 GB is refused rather than truncated");
+        Expect(!archive.Read("short.bin", contents), "a size short of the inflated file is refused");
+        Expect(archive.Read("Data/Text.txt", contents) && contents == text, "reads still work after refused ones");
+    }
+
+    // the header's own file list with a damaged size
+    WriteArchive(header, data, {Stored("Data/Text.txt", text)}, 1ull << 40);
+
+    {
+        ArchiveSource archive(&cipher);
+
+        Expect(!archive.Open(header.string(), data.string()), "a damaged file list size is refused");
+    }
+
+    {
+        ArchiveSource archive(nullptr);
+
+        Expect(!archive.Open(header.string(), data.string()), "archives need a cipher");
+    }
+
+    std::error_code error;
+    fs::remove_all(directory, error);
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
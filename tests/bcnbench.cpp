@@ -0,0 +1,70 @@
+// BCn decoding speed for every format, the baseline decoder against the AVX2 kernels where the cpu has them. each
+// format decodes a 1024x1024 level of noise a few times.
+//
+// usage: bcnbench [repeats, 8 by default]
+
+#include "bcn.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const unsigned int Size = 1024;
+
+// megapixels per second
+static double Measure(BlockFormat format, int repeats)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<unsigned char> blocks(GetLevelSize(format, Size, Size));
+    std::vector<unsigned char> rgba(static_cast<size_t>(Size) * Size * 4);
+    uint32_t state = 12345;
+
+    for (unsigned char &byte : blocks)
+    {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<unsigned char>(state >> 24);
+    }
+
+    // the first pass touches the output so page faults aren't timed
+    DecodeBlocks(format, blocks.data(), blocks.size(), Size, Size, rgba.data());
+
+    auto start = Clock::now();
+
+    for (int i = 0; i < repeats; ++i)
+        DecodeBlocks(format, blocks.data(), blocks.size(), Size, Size, rgba.data());
+
+    double seconds = std::max(std::chrono::duration<double>(Clock::now() - start).count(), 1e-9);
+
+    return repeats * static_cast<double>(Size) * Size / 1e6 / seconds;
+}
+
+int main(int argc, char **argv)
+{
+    int repeats = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 8;
+
+    SetWideBlockDecoding(true);
+
+    std::printf("wide decoder: %s\n", GetBlockDecoderName());
+    std::printf("%6s %14s %14s\n", "format", "baseline MP/s", "wide MP/s");
+
+    const BlockFormat formats[] = {BlockFormat::BC1, BlockFormat::BC2, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5};
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+    {
+        SetWideBlockDecoding(false);
+
+        double baseline = Measure(formats[i], repeats);
+
+        SetWideBlockDecoding(true);
+
+        double wide = Measure(formats[i], repeats);
+
+        std::printf("   BC%zu %14.0f %14.0f\n", i + 1, baseline, wide);
+    }
+
+    return 0;
+}
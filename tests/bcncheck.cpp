@@ -0,0 +1,138 @@
+// the BCn decoder: hand worked value blocks in both palette modes, and the AVX2 kernels against the baseline decoder
+// over random levels of every format, including sizes that aren't a multiple of the block size
+
+#include "bcn.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    if (failures++ < 20)
+        printf("failed (%s): %s\n", GetBlockDecoderName(), what);
+}
+
+static std::vector<unsigned char> Decode(BlockFormat format, const std::vector<unsigned char> &data, unsigned int width, unsigned int height)
+{
+    std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4, 0xCD);
+
+    Expect(DecodeBlocks(format, data.data(), data.size(), width, height, rgba.data()), "level decodes");
+
+    return rgba;
+}
+
+// pixel i of a BC4 block takes palette entry i % 8, so both rows of eight read the whole palette in order
+static std::vector<unsigned char> PaletteBlock(unsigned char a0, unsigned char a1)
+{
+    uint64_t indices = 0;
+
+    for (int i = 0; i < 16; ++i)
+        indices |= static_cast<uint64_t>(i % 8) << (i * 3);
+
+    std::vector<unsigned char> block = {a0, a1};
+
+    for (int i = 0; i < 6; ++i)
+        block.push_back(static_cast<unsigned char>(indices >> (i * 8)));
+
+    return block;
+}
+
+static void CheckKnownBlocks()
+{
+    // eight value mode, six values between the endpoints
+    const unsigned char eight[8] = {210, 20, 183, 156, 129, 101, 74, 47};
+    // six value mode, four values between the endpoints and then 0 and 255
+    const unsigned char six[8] = {20, 210, 58, 96, 134, 172, 0, 255};
+
+    std::vector<unsigned char> rgba = Decode(BlockFormat::BC4, PaletteBlock(210, 20), 4, 4);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        const unsigned char *pixel = &rgba[i * 4];
+
+        Expect(pixel[0] == eight[i % 8] && pixel[1] == eight[i % 8] && pixel[2] == eight[i % 8] && pixel[3] == 255, "BC4 eight value block");
+    }
+
+    rgba = Decode(BlockFormat::BC4, PaletteBlock(20, 210), 4, 4);
+
+    for (int i = 0; i < 16; ++i)
+        Expect(rgba[i * 4] == six[i % 8], "BC4 six value block");
+
+    // BC5 puts the second block in green, blue is 0
+    std::vector<unsigned char> twoChannels = PaletteBlock(210, 20);
+    std::vector<unsigned char> green = PaletteBlock(20, 210);
+
+    twoChannels.insert(twoChannels.end(), green.begin(), green.end());
+    rgba = Decode(BlockFormat::BC5, twoChannels, 4, 4);
+
+    for (int i = 0; i < 16; ++i)
+        Expect(rgba[i * 4] == eight[i % 8] && rgba[i * 4 + 1] == six[i % 8] && rgba[i * 4 + 2] == 0 && rgba[i * 4 + 3] == 255, "BC5 block");
+
+    // BC3 alpha with a solid white color block
+    std::vector<unsigned char> alpha = PaletteBlock(210, 20);
+    const unsigned char white[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0};
+
+    alpha.insert(alpha.end(), white, white + 8);
+    rgba = Decode(BlockFormat::BC3, alpha, 4, 4);
+
+    for (int i = 0; i < 16; ++i)
+        Expect(rgba[i * 4] == 255 && rgba[i * 4 + 2] == 255 && rgba[i * 4 + 3] == eight[i % 8], "BC3 block");
+}
+
+int main()
+{
+    std::mt19937 generator(3);
+
+    printf("decoder: %s\n", GetBlockDecoderName());
+
+    for (bool wide : {false, true})
+    {
+        SetWideBlockDecoding(wide);
+        CheckKnownBlocks();
+    }
+
+    const unsigned int sizes[][2] = {{4, 4}, {1, 1}, {13, 9}, {64, 64}, {250, 3}};
+
+    for (BlockFormat format : {BlockFormat::BC1, BlockFormat::BC2, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5})
+    {
+        for (const auto &size : sizes)
+        {
+            std::vector<unsigned char> data(GetLevelSize(format, size[0], size[1]));
+
+            for (unsigned char &byte : data)
+                byte = static_cast<unsigned char>(generator());
+
+            SetWideBlockDecoding(false);
+
+            std::vector<unsigned char> baseline = Decode(format, data, size[0], size[1]);
+
+            SetWideBlockDecoding(true);
+
+            Expect(Decode(format, data, size[0], size[1]) == baseline, "wide decoder matches the baseline");
+        }
+    }
+
+    // a level that's too short is refused
+    std::vector<unsigned char> rgba(16 * 4);
+    std::vector<unsigned char> shortLevel(GetLevelSize(BlockFormat::BC3, 4, 4) - 1);
+
+    Expect(!DecodeBlocks(BlockFormat::BC3, shortLevel.data(), shortLevel.size(), 4, 4, rgba.data()), "short level refused");
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
@@ -0,0 +1,576 @@
+// CollisionWorld's raycasts and sphere sweeps against plain loops over every triangle in double precision, on a random
+// world and on a triangle swept so the sphere first touches an edge or a vertex. the tree has to keep agreeing after
+// entities move and get refitted, and after entities are removed and the tree is built again
+//
+// hits that graze an edge are allowed either way: a query may land anywhere between the loop's answer with the
+// triangles grown by a tolerance and with them shrunk by it
+
+#include "collision.h"
+
+#include <Engine/JobSystem.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    if (failures++ < 20)
+        printf("failed: %s\n", what);
+}
+
+static const double Miss = std::numeric_limits<double>::infinity();
+
+// barycentric slack for rays and radius slack for sweeps, about what float coordinates a hundred units out allow
+static const double EdgeTolerance = 1e-3;
+static const double RadiusTolerance = 2e-3;
+
+static bool Near(float value, double expected)
+{
+    return std::abs(value - expected) <= 1e-3 * (1.0 + std::abs(expected));
+}
+
+// the distance the tree reports has to lie between the strict and the loose answer
+static bool Between(const CollisionWorld::Hit &hit, double strict, double loose)
+{
+    if (!hit.hit)
+        return strict == Miss;
+
+    return loose != Miss && hit.distance >= loose - 1e-3 * (1.0 + loose) && (strict == Miss || hit.distance <= strict + 1e-3 * (1.0 + strict));
+}
+
+struct TestEntity
+{
+    std::vector<glm::vec3> local;
+    glm::mat4 transform = glm::mat4(1.0f);
+    int index = -1;
+    bool enabled = true;
+};
+
+struct Triangle
+{
+    glm::dvec3 vertices[3];
+    int entity = -1;
+};
+
+static std::vector<Triangle> GetTriangles(const std::vector<TestEntity> &entities)
+{
+    std::vector<Triangle> triangles;
+
+    for (const TestEntity &entity : entities)
+    {
+        if (entity.index < 0 || !entity.enabled)
+            continue;
+
+        for (size_t i = 0; i + 2 < entity.local.size(); i += 3)
+        {
+            Triangle triangle;
+
+            for (int j = 0; j < 3; ++j)
+                triangle.vertices[j] = glm::dvec3(glm::vec3(entity.transform * glm::vec4(entity.local[i + j], 1.0f)));
+
+            triangle.entity = entity.index;
+            triangles.push_back(triangle);
+        }
+    }
+
+    return triangles;
+}
+
+// plane intersection then the signed areas, a different route than the tree's moller-trumbore
+static double RayTriangle(const glm::dvec3 &origin, const glm::dvec3 &direction, const Triangle &triangle, double tolerance)
+{
+    const glm::dvec3 *v = triangle.vertices;
+    glm::dvec3 normal = glm::cross(v[1] - v[0], v[2] - v[0]);
+    double facing = glm::dot(normal, direction);
+
+    if (std::abs(facing) < 1e-12)
+        return Miss;
+
+    double t = glm::dot(normal, v[0] - origin) / facing;
+
+    if (t < 0.0)
+        return Miss;
+
+    glm::dvec3 point = origin + direction * t;
+    double area = glm::dot(normal, normal);
+
+    for (int i = 0; i < 3; ++i)
+        if (glm::dot(normal, glm::cross(v[(i + 1) % 3] - point, v[(i + 2) % 3] - point)) / area < -tolerance)
+            return Miss;
+
+    return t;
+}
+
+static double BruteRaycast(const std::vector<Triangle> &triangles, const CollisionWorld::Ray &ray, double tolerance)
+{
+    glm::dvec3 direction = glm::normalize(glm::dvec3(ray.direction));
+    double best = Miss;
+
+    for (const Triangle &triangle : triangles)
+    {
+        if (triangle.entity == ray.ignoreEntity)
+            continue;
+
+        double t = RayTriangle(glm::dvec3(ray.origin), direction, triangle, tolerance);
+
+        if (t <= ray.maxDistance && t < best)
+            best = t;
+    }
+
+    return best;
+}
+
+// ericson's closest point on a triangle
+static glm::dvec3 ClosestPoint(const glm::dvec3 &p, const glm::dvec3 &a, const glm::dvec3 &b, const glm::dvec3 &c)
+{
+    glm::dvec3 ab = b - a;
+    glm::dvec3 ac = c - a;
+    glm::dvec3 ap = p - a;
+    double d1 = glm::dot(ab, ap);
+    double d2 = glm::dot(ac, ap);
+
+    if (d1 <= 0.0 && d2 <= 0.0)
+        return a;
+
+    glm::dvec3 bp = p - b;
+    double d3 = glm::dot(ab, bp);
+    double d4 = glm::dot(ac, bp);
+
+    if (d3 >= 0.0 && d4 <= d3)
+        return b;
+
+    double vc = d1 * d4 - d3 * d2;
+
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+        return a + ab * (d1 / (d1 - d3));
+
+    glm::dvec3 cp = p - c;
+    double d5 = glm::dot(ab, cp);
+    double d6 = glm::dot(ac, cp);
+
+    if (d6 >= 0.0 && d5 <= d6)
+        return c;
+
+    double vb = d5 * d2 - d1 * d6;
+
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+        return a + ac * (d2 / (d2 - d6));
+
+    double va = d3 * d6 - d5 * d4;
+
+    if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    double denominator = 1.0 / (va + vb + vc);
+
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+static double SegmentDistance(const glm::dvec3 &point, const glm::dvec3 &origin, const glm::dvec3 &direction, double length)
+{
+    double t = std::clamp(glm::dot(point - origin, direction), 0.0, length);
+
+    return glm::length(origin + direction * t - point);
+}
+
+// the distance from the moving centre to a triangle is convex in t, so its minimum is found by ternary search and the
+// first contact by bisecting up to it
+static double SweepTriangle(const glm::dvec3 &origin, const glm::dvec3 &direction, double radius, double maxDistance, const Triangle &triangle)
+{
+    const glm::dvec3 *v = triangle.vertices;
+    auto distance = [&](double t)
+    {
+        glm::dvec3 center = origin + direction * t;
+
+        return glm::length(ClosestPoint(center, v[0], v[1], v[2]) - center);
+    };
+
+    if (distance(0.0) <= radius)
+        return 0.0;
+
+    double low = 0.0;
+    double high = maxDistance;
+
+    for (int i = 0; i < 200; ++i)
+    {
+        double a = low + (high - low) / 3.0;
+        double b = high - (high - low) / 3.0;
+
+        if (distance(a) < distance(b))
+            high = b;
+        else
+            low = a;
+    }
+
+    double closest = 0.5 * (low + high);
+
+    if (distance(closest) > radius)
+        return Miss;
+
+    low = 0.0;
+    high = closest;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        double middle = 0.5 * (low + high);
+
+        if (distance(middle) <= radius)
+            high = middle;
+        else
+            low = middle;
+    }
+
+    return high;
+}
+
+static double BruteSweep(const std::vector<Triangle> &triangles, const CollisionWorld::Sweep &sweep, double radius)
+{
+    glm::dvec3 origin(sweep.origin);
+    glm::dvec3 direction = glm::normalize(glm::dvec3(sweep.direction));
+    double best = Miss;
+
+    for (const Triangle &triangle : triangles)
+    {
+        // every point of the triangle is within its bounding sphere, the sweep can't reach it if the segment passes wide
+        glm::dvec3 center = (triangle.vertices[0] + triangle.vertices[1] + triangle.vertices[2]) / 3.0;
+        double bound = 0.0;
+
+        for (const glm::dvec3 &vertex : triangle.vertices)
+            bound = std::max(bound, glm::length(vertex - center));
+
+        if (SegmentDistance(center, origin, direction, sweep.maxDistance) > radius + bound)
+            continue;
+
+        best = std::min(best, SweepTriangle(origin, direction, radius, sweep.maxDistance, triangle));
+    }
+
+    return best;
+}
+
+static bool IsLive(const std::vector<TestEntity> &entities, int index)
+{
+    for (const TestEntity &entity : entities)
+        if (entity.index == index)
+            return entity.enabled;
+
+    return false;
+}
+
+static void CheckQueries(const CollisionWorld &world, const std::vector<TestEntity> &entities, std::mt19937 &random, const char *stage)
+{
+    std::uniform_real_distribution<float> position(-80.0f, 80.0f);
+    std::uniform_real_distribution<float> size(0.2f, 3.0f);
+    std::vector<Triangle> triangles = GetTriangles(entities);
+    int mismatches = 0;
+    int hits = 0;
+
+    std::vector<CollisionWorld::Ray> rays(400);
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        CollisionWorld::Ray &ray = rays[i];
+
+        ray.origin = glm::vec3(position(random), position(random), position(random));
+        ray.direction = glm::normalize(glm::vec3(position(random), position(random), position(random)) - ray.origin);
+        ray.maxDistance = 250.0f;
+
+        // some rays look past an entity they'd otherwise hit
+        if (i % 4 == 0)
+        {
+            CollisionWorld::Hit first = world.Raycast(ray);
+
+            ray.ignoreEntity = first.entity;
+        }
+    }
+
+    std::vector<CollisionWorld::Hit> rayHits(rays.size());
+
+    world.Raycast(rays.data(), rayHits.data(), rays.size());
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        const CollisionWorld::Hit &hit = rayHits[i];
+        double strict = BruteRaycast(triangles, rays[i], -EdgeTolerance);
+        double loose = BruteRaycast(triangles, rays[i], EdgeTolerance);
+        CollisionWorld::Hit single = world.Raycast(rays[i]);
+
+        bool agrees = Between(hit, strict, loose) && single.hit == hit.hit && single.distance == hit.distance;
+
+        if (hit.hit)
+        {
+            ++hits;
+
+            agrees = agrees && IsLive(entities, hit.entity) && hit.entity != rays[i].ignoreEntity;
+            agrees = agrees && glm::dot(hit.normal, rays[i].direction) <= 0.0f && std::abs(glm::length(hit.normal) - 1.0f) < 1e-4f;
+        }
+
+        mismatches += agrees ? 0 : 1;
+    }
+
+    if (mismatches != 0)
+        printf("%s: %d of %zu rays disagree\n", stage, mismatches, rays.size());
+
+    Expect(mismatches == 0, "raycasts match the loop over every triangle");
+    Expect(hits > 40 && hits < 360, "rays both hit and miss");
+
+    std::vector<CollisionWorld::Sweep> sweeps(300);
+
+    for (CollisionWorld::Sweep &sweep : sweeps)
+    {
+        sweep.origin = glm::vec3(position(random), position(random), position(random));
+        sweep.direction = glm::vec3(position(random), position(random), position(random)) - sweep.origin;
+        sweep.radius = size(random);
+        sweep.maxDistance = 250.0f;
+    }
+
+    std::vector<CollisionWorld::Hit> sweepHits(sweeps.size());
+
+    world.SphereSweep(sweeps.data(), sweepHits.data(), sweeps.size());
+
+    mismatches = 0;
+    hits = 0;
+
+    for (size_t i = 0; i < sweeps.size(); ++i)
+    {
+        const CollisionWorld::Hit &hit = sweepHits[i];
+        double strict = BruteSweep(triangles, sweeps[i], sweeps[i].radius - RadiusTolerance);
+        double loose = BruteSweep(triangles, sweeps[i], sweeps[i].radius + RadiusTolerance);
+
+        bool agrees = Between(hit, strict, loose);
+
+        if (hit.hit)
+        {
+            ++hits;
+
+            // a sphere that starts overlapping touches somewhere inside it, otherwise the contact is on its surface
+            glm::vec3 center = sweeps[i].origin + glm::normalize(sweeps[i].direction) * hit.distance;
+            float offset = glm::length(hit.position - center);
+
+            agrees = agrees && IsLive(entities, hit.entity) && offset < sweeps[i].radius + 1e-2f;
+            agrees = agrees && (hit.distance == 0.0f || offset > sweeps[i].radius - 1e-2f);
+        }
+
+        mismatches += agrees ? 0 : 1;
+    }
+
+    if (mismatches != 0)
+        printf("%s: %d of %zu sweeps disagree\n", stage, mismatches, sweeps.size());
+
+    Expect(mismatches == 0, "sphere sweeps match the loop over every triangle");
+    Expect(hits > 40 && hits < 280, "sweeps both hit and miss");
+}
+
+// one triangle in the z = 0 plane of the entity, swept so the first contact is on an edge or a vertex
+static void CheckContacts(const CollisionWorld &world, const std::vector<TestEntity> &entities, const glm::vec3 &offset)
+{
+    struct Case
+    {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        float expected;
+        glm::vec3 contact;
+        const char *what;
+    };
+
+    const float root2 = std::sqrt(2.0f);
+    const Case cases[] = {
+        {glm::vec3(-5.0f, -5.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), 5.0f * root2 - 1.0f, glm::vec3(0.0f), "in plane onto a vertex"},
+        {glm::vec3(-0.6f, -0.6f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), 5.0f - std::sqrt(0.28f), glm::vec3(0.0f), "past a vertex"},
+        {glm::vec3(5.0f, -5.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 4.0f, glm::vec3(5.0f, 0.0f, 0.0f), "in plane onto an edge"},
+        {glm::vec3(5.0f, -0.6f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), 4.2f, glm::vec3(5.0f, 0.0f, 0.0f), "past an edge"},
+        {glm::vec3(3.0f, 3.0f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), 4.0f, glm::vec3(3.0f, 3.0f, 0.0f), "onto the face"},
+        {glm::vec3(5.0f, -1.01f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), -1.0f, glm::vec3(0.0f), "just past an edge"},
+    };
+
+    std::vector<Triangle> triangles = GetTriangles(entities);
+
+    for (const Case &test : cases)
+    {
+        CollisionWorld::Sweep sweep;
+
+        sweep.origin = test.origin + offset;
+        sweep.direction = test.direction;
+        sweep.radius = 1.0f;
+        sweep.maxDistance = 20.0f;
+
+        CollisionWorld::Hit hit = world.SphereSweep(sweep);
+
+        if (test.expected < 0.0f)
+        {
+            Expect(!hit.hit, test.what);
+            continue;
+        }
+
+        Expect(hit.hit && Near(hit.distance, test.expected) && glm::length(hit.position - (test.contact + offset)) < 1e-3f, test.what);
+        Expect(hit.hit && Near(hit.distance, BruteSweep(triangles, sweep, sweep.radius)), test.what);
+    }
+}
+
+int main()
+{
+    Engine::JobSystem::Initialize(4);
+
+    std::mt19937 random(20240611);
+    std::uniform_real_distribution<float> local(-5.0f, 5.0f);
+    std::uniform_real_distribution<float> place(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    auto randomTransform = [&]()
+    {
+        glm::vec3 axis(unit(random), unit(random), unit(random) + 2.0f);
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(place(random), place(random), place(random)));
+
+        transform = glm::rotate(transform, 3.14159f * unit(random), glm::normalize(axis));
+
+        return glm::scale(transform, glm::vec3(scale(random)));
+    };
+
+    CollisionWorld world;
+    std::vector<TestEntity> entities(150);
+
+    for (TestEntity &entity : entities)
+    {
+        for (int i = 0; i < 12 * 3; ++i)
+            entity.local.push_back(glm::vec3(local(random), local(random), local(random)));
+
+        entity.transform = randomTransform();
+        entity.index = world.AddEntity(entity.local, entity.transform);
+    }
+
+    // far from the others so nothing else is in the way
+    glm::vec3 offset(500.0f, 0.0f, 0.0f);
+    TestEntity single;
+
+    single.local = {glm::vec3(0.0f), glm::vec3(10.0f, 0.0f, 0.0f), glm::vec3(0.0f, 10.0f, 0.0f)};
+    single.transform = glm::translate(glm::mat4(1.0f), offset);
+    single.index = world.AddEntity(single.local, single.transform);
+    entities.push_back(single);
+
+    Expect(world.AddEntity({}, glm::mat4(1.0f)) == -1, "entities without triangles aren't added");
+
+    world.Update();
+
+    Expect(world.GetEntityCount() == entities.size(), "every entity added");
+    Expect(world.GetTriangleCount() == 150 * 12 + 1, "every triangle added");
+    Expect(world.GetNodeCount() > 0 && world.GetNodeCount() < 2 * world.GetTriangleCount(), "tree built");
+
+    CheckQueries(world, entities, random, "built");
+    CheckContacts(world, entities, offset);
+
+    // small moves are refitted, the tree isn't built again for them
+    size_t rebuilds = world.GetRebuildCount();
+
+    for (size_t i = 0; i < entities.size(); i += 5)
+    {
+        entities[i].transform = glm::translate(entities[i].transform, glm::vec3(unit(random), unit(random), unit(random)));
+        world.SetTransform(entities[i].index, entities[i].transform);
+    }
+
+    offset += glm::vec3(0.0f, 0.0f, 0.5f);
+    entities.back().transform = glm::translate(glm::mat4(1.0f), offset);
+    world.SetTransform(entities.back().index, entities.back().transform);
+
+    world.Update();
+
+    Expect(world.GetRebuildCount() == rebuilds, "small moves refit the tree");
+
+    CheckQueries(world, entities, random, "refitted");
+    CheckContacts(world, entities, offset);
+
+    // far moves loosen the tree until it's built again, queries stay right either way
+    for (size_t i = 1; i < entities.size() - 1; i += 3)
+    {
+        entities[i].transform = randomTransform();
+        world.SetTransform(entities[i].index, entities[i].transform);
+    }
+
+    world.Update();
+
+    CheckQueries(world, entities, random, "moved");
+
+    // disabled entities are passed through
+    for (size_t i = 2; i < entities.size() - 1; i += 4)
+    {
+        entities[i].enabled = false;
+        world.SetEnabled(entities[i].index, false);
+    }
+
+    CheckQueries(world, entities, random, "disabled");
+
+    for (size_t i = 2; i < entities.size() - 1; i += 4)
+    {
+        entities[i].enabled = true;
+        world.SetEnabled(entities[i].index, true);
+    }
+
+    // removing builds the tree again, freed indices are handed out again
+    rebuilds = world.GetRebuildCount();
+
+    std::vector<int> removed;
+
+    for (size_t i = 0; i < entities.size() - 1; i += 2)
+    {
+        world.RemoveEntity(entities[i].index);
+        removed.push_back(entities[i].index);
+        entities[i].index = -1;
+    }
+
+    world.Update();
+
+    Expect(world.GetRebuildCount() == rebuilds + 1, "removing builds the tree again");
+    Expect(world.GetTriangleCount() == (150 / 2) * 12 + 1, "removed triangles are dropped");
+
+    CheckQueries(world, entities, random, "removed");
+    CheckContacts(world, entities, offset);
+
+    // moving what's left after the removal refits the rebuilt tree
+    for (size_t i = 1; i < entities.size() - 1; i += 6)
+    {
+        entities[i].transform = glm::translate(entities[i].transform, glm::vec3(unit(random), unit(random), unit(random)));
+        world.SetTransform(entities[i].index, entities[i].transform);
+    }
+
+    world.Update();
+
+    CheckQueries(world, entities, random, "removed and refitted");
+
+    TestEntity added;
+
+    for (int i = 0; i < 12 * 3; ++i)
+        added.local.push_back(glm::vec3(local(random), local(random), local(random)));
+
+    added.transform = randomTransform();
+    added.index = world.AddEntity(added.local, added.transform);
+
+    Expect(std::find(removed.begin(), removed.end(), added.index) != removed.end(), "a removed index is reused");
+
+    entities.push_back(added);
+    world.Update();
+
+    CheckQueries(world, entities, random, "added again");
+
+    Engine::JobSystem::Shutdown();
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+// EditHistory: moves merge into one step until EndMerge, undo and redo replay every command type, and the chunk ring
+// keeps the history inside its budget while commands wrap around it
+
+#include "history.h"
+
+#include <cstdio>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    ++failures;
+    printf("failed: %s\n", what);
+}
+
+// a map of entities that edits are applied to by hand and undone through the history
+struct Scene : EditHistory::Target
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> rotations;
+    std::vector<bool> removed;
+    std::map<int, std::string> names;
+
+    explicit Scene(size_t count) : positions(count, glm::vec3(0.0f)), rotations(count, glm::vec3(0.0f)), removed(count, false) {}
+
+    void MoveEntity(int entity, const glm::vec3 &positionDelta, const glm::vec3 &rotationDelta) override
+    {
+        positions[entity] += positionDelta;
+        rotations[entity] += rotationDelta;
+    }
+
+    void SetRemoved(int entity, bool value) override { removed[entity] = value; }
+    void SetProperty(int entity, const std::string &, const std::string &value) override { names[entity] = value; }
+};
+
+static void CheckMerging()
+{
+    Scene scene(8);
+    EditHistory history;
+    int entity = 3;
+    int pair[] = {3, 4};
+
+    // a drag is a stream of small moves of the same selection
+    for (int i = 0; i < 100; ++i)
+    {
+        scene.MoveEntity(entity, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f));
+        history.RecordMove(&entity, 1, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f));
+    }
+
+    Expect(history.GetCommandCount() == 1, "a drag merges into one command");
+
+    // another selection doesn't merge, and neither does anything after EndMerge
+    history.RecordMove(pair, 2, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f));
+    history.EndMerge();
+    history.RecordMove(pair, 2, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f));
+
+    for (int moved : pair)
+        scene.positions[moved].y += 2.0f;
+
+    Expect(history.GetCommandCount() == 3, "other selections and ended merges are new commands");
+
+    Expect(history.Undo(scene) && history.Undo(scene), "undo the selection moves");
+    Expect(scene.positions[4] == glm::vec3(0.0f), "selection moves undone");
+    Expect(history.Undo(scene), "undo the drag");
+    Expect(scene.positions[3] == glm::vec3(0.0f), "the whole drag undoes in one step");
+    Expect(!history.Undo(scene), "nothing left to undo");
+}
+
+static void CheckCommands()
+{
+    Scene scene(5000);
+    EditHistory history;
+    std::vector<int> all(scene.positions.size());
+    std::iota(all.begin(), all.end(), 0);
+
+    for (int entity : all)
+        scene.positions[entity].y += 5.0f;
+
+    history.RecordMove(all.data(), all.size(), glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f));
+    history.EndMerge();
+
+    // a shared move is packed, four bytes an entity
+    Expect(history.GetUsedSize() <= all.size() * 4 + 64, "shared moves cost four bytes an entity");
+
+    std::vector<glm::vec3> positionDeltas;
+    std::vector<glm::vec3> rotationDeltas;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        positionDeltas.push_back(glm::vec3((float)i, 0.0f, 0.0f));
+        rotationDeltas.push_back(glm::vec3(0.0f, 0.0f, (float)i * 10.0f));
+        scene.MoveEntity(all[i], positionDeltas.back(), rotationDeltas.back());
+    }
+
+    history.RecordTransforms(all.data(), positionDeltas.data(), rotationDeltas.data(), positionDeltas.size());
+
+    int entity = 7;
+
+    scene.removed[entity] = true;
+    history.RecordRemove(&entity, 1);
+
+    scene.names[2] = "new";
+    history.RecordProperty(2, "Name", "old", "new");
+
+    Expect(history.Undo(scene) && scene.names[2] == "old", "undo property");
+    Expect(history.Undo(scene) && !scene.removed[entity], "undo remove");
+    Expect(history.Undo(scene) && scene.positions[9] == glm::vec3(0.0f, 5.0f, 0.0f) && scene.rotations[9] == glm::vec3(0.0f), "undo transforms");
+    Expect(history.Undo(scene) && scene.positions[4999] == glm::vec3(0.0f), "undo shared move");
+
+    Expect(history.Redo(scene) && scene.positions[4999].y == 5.0f, "redo shared move");
+    Expect(history.Redo(scene) && scene.rotations[9].z == 90.0f, "redo transforms");
+    Expect(history.Redo(scene) && scene.removed[entity], "redo remove");
+    Expect(history.Redo(scene) && scene.names[2] == "new", "redo property");
+    Expect(!history.Redo(scene), "nothing left to redo");
+
+    // recording after an undo drops what could have been redone
+    history.Undo(scene);
+    history.Undo(scene);
+    history.RecordAdd(&entity, 1);
+
+    Expect(!history.CanRedo() && history.GetCommandCount() == 3, "a new command replaces the redo steps");
+}
+
+static void CheckBudget()
+{
+    const size_t budget = 256 * 1024;
+
+    Scene scene(1000);
+    EditHistory history(budget);
+    std::vector<int> all(scene.positions.size());
+    std::iota(all.begin(), all.end(), 0);
+
+    // about 4KB a command, the stream wraps through the chunks many times over
+    for (int i = 0; i < 2000; ++i)
+    {
+        history.RecordMove(all.data(), all.size(), glm::vec3(1.0f), glm::vec3(0.0f));
+        history.EndMerge();
+    }
+
+    Expect(history.GetDroppedCount() > 0, "old commands dropped");
+    Expect(history.GetCommandCount() + history.GetDroppedCount() == 2000, "every command kept or dropped");
+    Expect(history.GetUsedSize() <= budget, "used size stays in the budget");
+    Expect(history.GetMemoryUsage() <= budget + 3 * EditHistory::ChunkSize, "chunks are recycled");
+
+    // the kept commands replay correctly after wrapping
+    size_t undone = 0;
+
+    while (history.Undo(scene))
+        ++undone;
+
+    Expect(undone == history.GetCommandCount(), "every kept command undoes");
+    Expect(scene.positions[0].x == -(float)undone && scene.positions[999].x == -(float)undone, "wrapped commands undo the right entities");
+
+    while (history.Redo(scene))
+        ;
+
+    Expect(scene.positions[0] == glm::vec3(0.0f) && scene.positions[999] == glm::vec3(0.0f), "wrapped commands redo");
+
+    // a command bigger than the whole budget can't be kept, and takes the history with it
+    std::vector<int> huge(budget, 1);
+
+    history.RecordMove(huge.data(), huge.size(), glm::vec3(1.0f), glm::vec3(0.0f));
+
+    Expect(history.GetCommandCount() == 0, "oversized command clears the history");
+    Expect(history.GetUsedSize() == 0, "oversized command leaves nothing used");
+}
+
+int main()
+{
+    CheckMerging();
+    CheckCommands();
+    CheckBudget();
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
@@ -0,0 +1,290 @@
+// IDHeap against the two-bit heap it replaced, from 10^3 to 10^7 live ids. each size is filled, then churned by
+// releasing a random live id and requesting one back, which is what objects dying and being made looks like.
+//
+// before timing anything IDHeap is checked against a plain set of free ids: no id is handed out twice, it's always the
+// lowest free one, released ids come back, and ShrinkToAllocated leaves the heap right across word and level boundaries.
+//
+// usage: idheapbench [largest power of ten, 7 by default]
+
+#include "IdentifierHeap.h"
+#include "legacyidheap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+struct Timing
+{
+    double fillNs = 0.0;  // per RequestID while filling
+    double churnNs = 0.0; // per Release + RequestID pair
+};
+
+template <typename Heap>
+static Timing Measure(size_t liveCount, size_t churnCount, const std::vector<size_t> &releaseOrder)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Heap heap;
+    Timing timing;
+    std::vector<size_t> live(liveCount);
+
+    auto start = Clock::now();
+
+    for (size_t i = 0; i < liveCount; ++i)
+        live[i] = heap.RequestID();
+
+    timing.fillNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / liveCount;
+
+    start = Clock::now();
+
+    for (size_t i = 0; i < churnCount; ++i)
+    {
+        size_t &slot = live[releaseOrder[i]];
+
+        heap.Release(slot);
+        slot = heap.RequestID();
+    }
+
+    timing.churnNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / churnCount;
+
+    if (heap.AllocatedIDs() != liveCount)
+    {
+        std::fprintf(stderr, "%zu ids allocated, expected %zu\n", heap.AllocatedIDs(), liveCount);
+        std::exit(1);
+    }
+
+    return timing;
+}
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    if (failures++ < 20)
+        std::printf("failed: %s\n", what);
+}
+
+static bool IsAllocated(const IDHeap &heap, size_t id)
+{
+    try
+    {
+        return heap.NodeAllocated(id);
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+// the ids in use and what the lowest free one has to be, the slow and obvious way
+struct Reference
+{
+    std::set<size_t> live;
+    std::set<size_t> free; // below next
+    size_t next = 0;
+
+    size_t Lowest() const { return free.empty() ? next : *free.begin(); }
+
+    void Take(size_t id)
+    {
+        live.insert(id);
+
+        if (id == next)
+            ++next;
+        else
+            free.erase(id);
+    }
+
+    void Give(size_t id)
+    {
+        live.erase(id);
+        free.insert(id);
+    }
+};
+
+static void CheckChurn()
+{
+    IDHeap heap;
+    Reference reference;
+    std::mt19937_64 random(99);
+
+    // enough live ids for three levels, with bursts of single and batched requests and releases
+    for (int round = 0; round < 200; ++round)
+    {
+        size_t requests = random() % 3000;
+
+        if (round % 2 == 0)
+        {
+            for (size_t i = 0; i < requests; ++i)
+            {
+                size_t id = heap.RequestID();
+
+                Expect(reference.live.count(id) == 0, "RequestID never hands out a live id");
+                Expect(id == reference.Lowest(), "RequestID hands out the lowest free id");
+
+                reference.Take(id);
+            }
+        }
+        else
+        {
+            std::vector<size_t> expected;
+            Reference copy = reference;
+
+            for (size_t i = 0; i < requests; ++i)
+            {
+                expected.push_back(copy.Lowest());
+                copy.Take(copy.Lowest());
+            }
+
+            Expect(heap.RequestIDs(requests) == expected, "RequestIDs hands out the lowest free ids in order");
+
+            reference = copy;
+        }
+
+        std::vector<size_t> live(reference.live.begin(), reference.live.end());
+        size_t releases = live.empty() ? 0 : random() % (live.size() / 2 + 1);
+
+        for (size_t i = 0; i < releases; ++i)
+        {
+            size_t id = live[random() % live.size()];
+
+            if (reference.live.count(id) == 0)
+                continue;
+
+            heap.Release(id);
+            reference.Give(id);
+
+            Expect(!heap.NodeAllocated(id), "a released id isn't allocated");
+        }
+
+        Expect(heap.AllocatedIDs() == reference.live.size(), "allocated count follows requests and releases");
+    }
+
+    for (size_t id : reference.live)
+        Expect(heap.NodeAllocated(id), "every live id is allocated");
+
+    // a round trip gives the same id back, releasing twice or past the end changes nothing
+    size_t id = *reference.live.begin();
+
+    heap.Release(id);
+    Expect(heap.RequestID() == std::min(id, reference.Lowest()), "a released id comes back");
+
+    size_t allocated = heap.AllocatedIDs();
+
+    heap.Release(reference.Lowest() + 1000000000);
+    Expect(heap.AllocatedIDs() == allocated, "releasing past the end is ignored");
+
+    heap.Release(0);
+    heap.Release(0);
+    Expect(heap.AllocatedIDs() == allocated - 1 && heap.RequestID() == 0, "releasing twice counts once");
+}
+
+static void CheckShrink()
+{
+    // either side of the end of a word, of a word of words and of the third level
+    for (size_t kept : {size_t(1), size_t(63), size_t(64), size_t(65), size_t(4095), size_t(4096), size_t(4097), size_t(262143),
+                        size_t(262144), size_t(262145)})
+    {
+        IDHeap heap;
+        std::vector<size_t> ids = heap.RequestIDs(kept + 200);
+
+        for (size_t id = kept; id < ids.size(); ++id)
+            heap.Release(id);
+
+        // holes below the end stay free across the shrink, one of them at a word boundary
+        std::vector<size_t> holes;
+
+        if (kept > 1)
+            holes.push_back(0);
+
+        if (kept > 65)
+            holes.push_back(64);
+
+        for (size_t hole : holes)
+            heap.Release(hole);
+
+        heap.ShrinkToAllocated();
+
+        Expect(heap.Size() >= kept && heap.Size() < kept + 64, "shrinks to the word of the last allocated id");
+        Expect(heap.AllocatedIDs() == kept - holes.size(), "shrinking keeps the allocated count");
+        Expect(IsAllocated(heap, kept - 1), "the last id stays allocated");
+        Expect(!IsAllocated(heap, kept), "ids past the last aren't allocated");
+
+        for (size_t hole : holes)
+            Expect(heap.RequestID() == hole, "holes are handed out first after shrinking");
+
+        Expect(heap.RequestID() == kept && heap.RequestID() == kept + 1, "the heap grows again past where it was shrunk");
+
+        // and grows on through the next word and level after that
+        std::vector<size_t> more = heap.RequestIDs(5000);
+        bool ascending = true;
+
+        for (size_t i = 0; i < more.size(); ++i)
+            ascending = ascending && more[i] == kept + 2 + i;
+
+        Expect(ascending, "ids after the shrink carry on in order");
+        Expect(heap.AllocatedIDs() == kept + 2 + 5000, "every id counted after the shrink");
+    }
+
+    // shrinking an empty heap, and one everything was released from
+    IDHeap heap;
+
+    heap.ShrinkToAllocated();
+    Expect(heap.Size() == 0 && heap.RequestID() == 0, "an empty heap shrinks to nothing");
+
+    std::vector<size_t> ids = heap.RequestIDs(10000);
+
+    for (size_t id = 0; id <= ids.back(); ++id)
+        heap.Release(id);
+
+    heap.ShrinkToAllocated();
+    Expect(heap.Size() == 0 && heap.AllocatedIDs() == 0, "a released heap shrinks to nothing");
+    Expect(heap.RequestID() == 0 && heap.RequestID() == 1, "a shrunk heap starts over");
+}
+
+int main(int argc, char **argv)
+{
+    CheckChurn();
+    CheckShrink();
+
+    if (failures != 0)
+    {
+        std::printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    int largest = argc > 1 ? std::atoi(argv[1]) : 7;
+    std::mt19937_64 random(1234);
+
+    std::printf("%10s %14s %14s %14s %14s\n", "live ids", "old fill ns", "new fill ns", "old churn ns", "new churn ns");
+
+    for (int exponent = 3; exponent <= largest; ++exponent)
+    {
+        size_t liveCount = 1;
+
+        for (int i = 0; i < exponent; ++i)
+            liveCount *= 10;
+
+        size_t churnCount = std::min<size_t>(liveCount, 1000000);
+        std::vector<size_t> releaseOrder(churnCount);
+        std::uniform_int_distribution<size_t> pick(0, liveCount - 1);
+
+        for (size_t &index : releaseOrder)
+            index = pick(random);
+
+        Timing legacy = Measure<LegacyIDHeap>(liveCount, churnCount, releaseOrder);
+        Timing bitset = Measure<IDHeap>(liveCount, churnCount, releaseOrder);
+
+        std::printf("%10zu %14.1f %14.1f %14.1f %14.1f\n", liveCount, legacy.fillNs, bitset.fillNs, legacy.churnNs, bitset.churnNs);
+    }
+
+    return 0;
+}
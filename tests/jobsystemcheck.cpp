@@ -0,0 +1,263 @@
+// the job system: ParallelFor covers every index once, counters wait for their whole group including jobs that
+// schedule and wait from inside a job, idle workers steal what another thread queued, and exceptions come back out of
+// Wait and ParallelFor without leaving jobs behind
+
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using Engine::JobCounter;
+using Engine::JobSystem;
+
+static std::atomic<int> failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    if (failures++ < 20)
+        printf("failed: %s\n", what);
+}
+
+static void CheckParallelFor()
+{
+    for (size_t count : {size_t(0), size_t(1), size_t(36), size_t(37), size_t(38), size_t(100000)})
+    {
+        std::vector<std::atomic<int>> hits(count);
+        std::atomic<size_t> batches = 0;
+        std::atomic<bool> batchTooBig = false;
+
+        JobSystem::ParallelFor(count, 37, [&](size_t begin, size_t end)
+        {
+            if (end - begin > 37 || begin >= end)
+                batchTooBig = true;
+
+            for (size_t i = begin; i < end; ++i)
+                ++hits[i];
+
+            ++batches;
+        });
+
+        bool once = true;
+
+        for (const auto &hit : hits)
+            once = once && hit == 1;
+
+        Expect(once, "every index visited exactly once");
+        Expect(!batchTooBig, "batches stay within the batch size");
+        Expect(batches == (count + 36) / 37, "one call per batch");
+    }
+
+    // a batch size of 0 is taken as 1
+    std::atomic<int> total = 0;
+
+    JobSystem::ParallelFor(10, 0, [&](size_t begin, size_t end) { total += int(end - begin); });
+
+    Expect(total == 10, "zero batch size");
+}
+
+static void CheckCounters()
+{
+    JobCounter counter;
+    std::atomic<int> done = 0;
+
+    for (int i = 0; i < 1000; ++i)
+        JobSystem::Schedule([&done]() { ++done; }, counter);
+
+    JobSystem::Wait(counter);
+
+    Expect(counter.IsDone() && counter.GetPending() == 0, "counter done after wait");
+    Expect(done == 1000, "every job ran before the wait returned");
+
+    // jobs that fan out again and wait on their own counters, deeper than there are workers
+    std::atomic<int> leaves = 0;
+    JobCounter outer;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        JobSystem::Schedule([&leaves]()
+        {
+            JobCounter inner;
+
+            for (int j = 0; j < 16; ++j)
+            {
+                JobSystem::Schedule([&leaves]()
+                {
+                    std::atomic<int> local = 0;
+
+                    JobSystem::ParallelFor(64, 8, [&local](size_t begin, size_t end) { local += int(end - begin); });
+
+                    leaves += local;
+                }, inner);
+            }
+
+            JobSystem::Wait(inner);
+        }, outer);
+    }
+
+    JobSystem::Wait(outer);
+
+    Expect(leaves == 16 * 16 * 64, "nested waits from inside jobs finish");
+
+    // work that isn't a job can hold a group open
+    JobCounter held;
+    std::atomic<bool> released = false;
+
+    held.Add();
+
+    std::thread holder([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        released = true;
+        held.Done();
+    });
+
+    JobSystem::Wait(held);
+
+    Expect(released, "wait holds until Done");
+
+    holder.join();
+}
+
+static void CheckStealing()
+{
+    // everything is queued on one thread's queue, only stealing gets it onto the other workers
+    std::mutex threadsLock;
+    std::set<int> threads;
+    JobCounter counter;
+
+    JobSystem::Schedule([&]()
+    {
+        JobCounter inner;
+
+        for (int i = 0; i < 64; ++i)
+        {
+            JobSystem::Schedule([&]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+                std::lock_guard<std::mutex> lock(threadsLock);
+
+                threads.insert(JobSystem::GetThreadIndex());
+            }, inner);
+        }
+
+        JobSystem::Wait(inner);
+    }, counter);
+
+    JobSystem::Wait(counter);
+
+    Expect(threads.size() >= 2, "idle workers steal queued jobs");
+}
+
+static void CheckExceptions()
+{
+    // a throwing job doesn't stop the others in its group, the first error comes out of Wait once
+    JobCounter counter;
+    std::atomic<int> done = 0;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        JobSystem::Schedule([&done, i]()
+        {
+            ++done;
+
+            if (i % 10 == 3)
+                throw std::runtime_error("job failed");
+        }, counter);
+    }
+
+    bool caught = false;
+
+    try
+    {
+        JobSystem::Wait(counter);
+    }
+    catch (const std::runtime_error &)
+    {
+        caught = true;
+    }
+
+    Expect(caught, "Wait rethrows a job's exception");
+    Expect(done == 100 && counter.IsDone(), "the other jobs still ran");
+
+    caught = false;
+
+    try
+    {
+        JobSystem::Wait(counter);
+    }
+    catch (...)
+    {
+        caught = true;
+    }
+
+    Expect(!caught, "the error is only reported once");
+
+    // from a scheduled batch and from the batch on the calling thread, every batch still finishes first
+    for (size_t failing : {size_t(0), size_t(500)})
+    {
+        std::atomic<int> visited = 0;
+        caught = false;
+
+        try
+        {
+            JobSystem::ParallelFor(1000, 10, [&](size_t begin, size_t end)
+            {
+                visited += int(end - begin);
+
+                if (begin == failing)
+                    throw std::runtime_error("batch failed");
+            });
+        }
+        catch (const std::runtime_error &)
+        {
+            caught = true;
+        }
+
+        Expect(caught, "ParallelFor rethrows a batch's exception");
+        Expect(visited == 1000, "every batch ran before ParallelFor threw");
+    }
+}
+
+int main()
+{
+    JobSystem::Initialize(4);
+
+    Expect(JobSystem::GetWorkerCount() == 4, "worker count");
+    Expect(JobSystem::GetThreadIndex() == 0 && !JobSystem::IsWorkerThread(), "the main thread isn't a worker");
+
+    CheckParallelFor();
+    CheckCounters();
+    CheckStealing();
+    CheckExceptions();
+
+    // jobs without a counter still run before the workers stop
+    std::atomic<int> detached = 0;
+
+    for (int i = 0; i < 100; ++i)
+        JobSystem::Schedule([&detached]() { ++detached; });
+
+    JobSystem::Shutdown();
+
+    Expect(detached == 100, "shutdown drains the queues");
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", (int)failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// the IDHeap this repo had before the bitset rewrite, two bits per node of a binary heap. only kept so idheapbench can
+// measure against it
+class LegacyIDHeap
+{
+public:
+	size_t RequestID()
+	{
+		size_t id = Allocate();
+
+		++Allocated;
+
+		Write(id, Used, true);
+
+		if (id > 0)
+		{
+			size_t currentID = (id - 1) / 2;
+
+			while (currentID < Capacity)
+			{
+				size_t left = 2 * currentID + 1;
+				size_t right = 2 * currentID + 2;
+
+				bool childrenUsed = (left >= Capacity || Read(left, ChildrenUsed)) && (right >= Capacity || Read(right, ChildrenUsed));
+
+				Write(currentID, ChildrenUsed, childrenUsed);
+
+				if (currentID == 0)
+					currentID = -1;
+				else
+					currentID = (currentID - 1) / 2;
+			}
+		}
+
+		return id;
+	}
+
+	void Release(size_t id)
+	{
+		if (id >= Capacity || !Read(id, Used))
+			return;
+
+		--Allocated;
+
+		Write(id, Used, false);
+
+		if (id == 0)
+			return;
+
+		id = (id - 1) / 2;
+
+		while (id < Capacity)
+		{
+			Write(id, ChildrenUsed, false);
+
+			if (id == 0)
+				id = -1;
+			else
+				id = (id - 1) / 2;
+		}
+	}
+
+	size_t AllocatedIDs() const { return Allocated; }
+
+private:
+	static const unsigned char Used = 0x1;
+	static const unsigned char ChildrenUsed = 0x2;
+
+	std::vector<unsigned char> Nodes;
+	size_t Allocated = 0;
+	size_t Capacity = 0;
+
+	static constexpr unsigned short rshift(unsigned short value, int offset)
+	{
+		return offset > 0 ? value << offset : value >> -offset;
+	}
+
+	void Write(size_t index, unsigned char bits, unsigned char srcMask)
+	{
+		unsigned char& value = Nodes[index / 4];
+		size_t offset = 2 * (index % 4);
+		srcMask = (unsigned char)rshift(0xFCFF, ((int)offset - 8)) | (srcMask << offset);
+		value = ((unsigned short)value & ((unsigned short)srcMask)) | (bits << offset);
+	}
+
+	void Write(size_t index, unsigned char bits, bool value)
+	{
+		Write(index, value ? bits : 0, (unsigned char)(0x3 ^ bits));
+	}
+
+	unsigned char Read(size_t index) const
+	{
+		return (Nodes[index / 4] >> (2 * (index % 4))) & 0x3;
+	}
+
+	bool Read(size_t index, unsigned char mask) const
+	{
+		return (Read(index) & mask) != 0;
+	}
+
+	size_t Allocate()
+	{
+		if (Nodes.size() > 0 && !Read(0, Used))
+			return 0;
+
+		if (Nodes.size() > 0 && !Read(0, ChildrenUsed))
+		{
+			size_t id = 0;
+
+			while (Read(id, Used))
+			{
+				size_t left = 2 * id + 1;
+				size_t right = 2 * id + 2;
+
+				if (left < Capacity && (!Read(left, Used) || !Read(left, ChildrenUsed)))
+					id = left;
+				else if (right < Capacity && (!Read(right, Used) || !Read(right, ChildrenUsed)))
+					id = right;
+				else
+					throw "shts fucked";
+			}
+
+			return id;
+		}
+
+		size_t id = Capacity;
+
+		if (id >= Nodes.size() * 4)
+			Nodes.push_back(0x3);
+		else
+			Write(id, Used | ChildrenUsed, true);
+
+		++Capacity;
+
+		return id;
+	}
+};
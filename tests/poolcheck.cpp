@@ -0,0 +1,137 @@
+// the object pools from several threads at once, the way loader jobs use them: objects are made on one thread and
+// often freed on another, while the debug window reads the pool stats. every object has to come back intact and
+// the pools have to end up empty
+
+#include "ObjectAllocator.h"
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Part
+{
+    std::weak_ptr<Part> This;
+    unsigned int owner = 0;
+    unsigned int values[8] = {};
+
+    void Fill(unsigned int id)
+    {
+        owner = id;
+
+        for (unsigned int &value : values)
+            value = id;
+    }
+
+    bool Intact() const
+    {
+        for (unsigned int value : values)
+            if (value != owner)
+                return false;
+
+        return true;
+    }
+};
+
+static std::atomic<int> failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    if (failures++ < 20)
+        printf("failed: %s\n", what);
+}
+
+int main()
+{
+    const unsigned int threadCount = 8;
+    const unsigned int rounds = 200;
+    const unsigned int batch = 500;
+
+    auto &pool = GameObjectAllocator<Part>::Allocator;
+
+    // what one thread made and the next one frees, like a package parsed on a worker and freed on the GL thread
+    std::mutex handoffLock;
+    std::deque<std::vector<std::shared_ptr<Part>>> handoff;
+
+    std::atomic<bool> done = false;
+    std::vector<std::thread> threads;
+
+    for (unsigned int thread = 0; thread < threadCount; ++thread)
+    {
+        threads.emplace_back([&, thread]()
+        {
+            for (unsigned int round = 0; round < rounds; ++round)
+            {
+                std::vector<std::shared_ptr<Part>> parts;
+
+                for (unsigned int i = 0; i < batch; ++i)
+                {
+                    parts.push_back(GameObjectAllocator<Part>::Create());
+                    parts.back()->Fill(thread * rounds * batch + round * batch + i + 1);
+                }
+
+                std::vector<std::shared_ptr<Part>> others;
+
+                {
+                    std::lock_guard<std::mutex> guard(handoffLock);
+
+                    handoff.push_back(std::move(parts));
+
+                    if (handoff.size() > 1)
+                    {
+                        others = std::move(handoff.front());
+                        handoff.pop_front();
+                    }
+                }
+
+                for (const auto &part : others)
+                    Expect(part->Intact() && part->This.lock() == part, "an object was handed out twice");
+            }
+        });
+    }
+
+    std::thread reader([&]()
+    {
+        while (!done)
+        {
+            AllocatorStats stats = pool.GetStats();
+
+            Expect(stats.LiveBlocks <= (threadCount + 1) * batch * 2, "live count out of range while running");
+        }
+    });
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    for (const auto &parts : handoff)
+        for (const auto &part : parts)
+            Expect(part->Intact(), "an object left in the handoff was overwritten");
+
+    handoff.clear();
+    done = true;
+    reader.join();
+
+    AllocatorStats stats = pool.GetStats();
+
+    Expect(stats.LiveBlocks == 0, "pool is empty at the end");
+
+#if ENGINE_TRACK_ALLOCATIONS
+    Expect(pool.GetLiveSites().empty(), "no live allocation sites at the end");
+#endif
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", (int)failures);
+
+        return 1;
+    }
+
+    printf("all checks passed, %zu pages at the peak\n", stats.PeakPages);
+
+    return 0;
+}
@@ -0,0 +1,318 @@
+// checks every SimdMath instruction set against the scalar kernel table, and the scalar table and the float
+// Matrix4 specializations against double precision math. batch sizes cover the empty batch, the vector widths and
+// the tails around them
+
+#include "Math/SimdMath.h"
+#include "Math/Quaternion.h"
+#include "Math/Vector3.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using SimdMath::InstructionSet;
+
+static std::mt19937 generator(5);
+static int failures = 0;
+
+static float Random(float low = -2.0f, float high = 2.0f)
+{
+    return std::uniform_real_distribution<float>(low, high)(generator);
+}
+
+static void Check(const char *what, double value, double expected, double tolerance)
+{
+    double error = std::fabs(value - expected) / (1.0 + std::fabs(expected));
+
+    if (error <= tolerance)
+        return;
+
+    if (failures++ < 20)
+        printf("%s: %s got %.9g, expected %.9g\n", SimdMath::GetInstructionSetName(SimdMath::GetInstructionSet()), what, value, expected);
+}
+
+static Matrix4D ToDouble(const Matrix4F &matrix)
+{
+    Matrix4D result;
+
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            result.Data[i][j] = matrix.Data[i][j];
+
+    return result;
+}
+
+template <typename Matrix>
+static void CheckMatrix(const char *what, const Matrix4F &value, const Matrix &expected, double tolerance)
+{
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            Check(what, value.Data[i][j], expected.Data[i][j], tolerance);
+}
+
+static Quaternion RandomRotation()
+{
+    Quaternion rotation(Random(), Random(), Random(), Random());
+
+    return rotation.Normalize();
+}
+
+// rotation and scale with a translation, what transforms in a scene look like
+static Matrix4F RandomAffine()
+{
+    Matrix4F matrix = RandomRotation().MatrixF();
+
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            matrix.Data[i][j] *= Random(0.5f, 2.0f);
+
+    for (int i = 0; i < 3; ++i)
+        matrix.Data[3][i] = Random(-10.0f, 10.0f);
+
+    return matrix;
+}
+
+static Matrix4F RandomFull()
+{
+    Matrix4F matrix;
+
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            matrix.Data[i][j] = Random();
+
+    return matrix;
+}
+
+static void CheckSingleOperations()
+{
+    for (int i = 0; i < 20000; ++i)
+    {
+        Matrix4F affine = RandomAffine();
+        Matrix4F full = RandomFull();
+
+        CheckMatrix("Matrix4F multiply", affine * full, ToDouble(affine) * ToDouble(full), 1e-5);
+        CheckMatrix("Matrix4F Inverted", affine.Inverted(), ToDouble(affine).Inverted(), 1e-4);
+        CheckMatrix("Matrix4F FullInverted on affine", affine.FullInverted(), ToDouble(affine).Inverted(), 1e-4);
+
+        // badly conditioned matrices are allowed to drift, scale the tolerance by the size of the inverse
+        Matrix4D fullInverse = ToDouble(full).FullInverted();
+        double largest = 0;
+
+        for (int x = 0; x < 4; ++x)
+            for (int y = 0; y < 4; ++y)
+                largest = std::max(largest, std::fabs(fullInverse.Data[x][y]));
+
+        if (std::isfinite(largest))
+            CheckMatrix("Matrix4F FullInverted", full.FullInverted(), fullInverse, 2e-4 * largest * largest + 1e-4);
+
+        Vector3F vector(Random(), Random(), Random(), Random());
+        Vector3F result = affine * vector;
+        Vector3D expected = ToDouble(affine) * Vector3D(vector.X, vector.Y, vector.Z, vector.W);
+
+        Check("Matrix4F * Vector3F x", result.X, expected.X, 1e-5);
+        Check("Matrix4F * Vector3F y", result.Y, expected.Y, 1e-5);
+        Check("Matrix4F * Vector3F z", result.Z, expected.Z, 1e-5);
+        Check("Matrix4F * Vector3F w", result.W, expected.W, 1e-5);
+    }
+}
+
+// one batch of inputs, run through whichever kernel table is selected
+struct Batch
+{
+    std::vector<Matrix4F> left;
+    std::vector<Matrix4F> right;
+    Matrix4F transform;
+    std::vector<Vector3F> vectors;
+    std::vector<Vector3SF> packed;
+    std::vector<Quaternion> from;
+    std::vector<Quaternion> to;
+    std::vector<float> t;
+
+    explicit Batch(size_t count) : left(count), right(count), vectors(count), packed(count), from(count), to(count), t(count)
+    {
+        transform = RandomAffine();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            left[i] = RandomAffine();
+            right[i] = RandomFull();
+            vectors[i] = Vector3F(Random(), Random(), Random(), 7.0f);
+            packed[i] = Vector3SF(Random(), Random(), Random());
+            from[i] = RandomRotation();
+            to[i] = RandomRotation();
+            t[i] = Random(0.0f, 1.0f);
+
+            // opposite hemispheres and identical rotations are the edge cases for the interpolation
+            if (i % 5 == 1)
+                to[i] = from[i] * -1.0f;
+            else if (i % 7 == 2)
+                to[i] = from[i];
+        }
+    }
+};
+
+struct Results
+{
+    std::vector<Matrix4F> pairwise;
+    std::vector<Matrix4F> broadcast;
+    std::vector<Matrix4F> broadcastInPlace;
+    std::vector<Vector3F> points;
+    std::vector<Vector3F> normals;
+    std::vector<Vector3SF> packedPoints;
+    std::vector<Vector3SF> packedNormalsInPlace;
+    std::vector<Quaternion> nlerp;
+    std::vector<Quaternion> slerp;
+    std::vector<Matrix4F> matrices;
+};
+
+static Results Run(const Batch &batch)
+{
+    size_t count = batch.left.size();
+    Results results;
+
+    results.pairwise.resize(count);
+    results.broadcast.resize(count);
+    results.broadcastInPlace = batch.right;
+    results.points.resize(count);
+    results.normals.resize(count);
+    results.packedPoints.resize(count);
+    results.packedNormalsInPlace = batch.packed;
+    results.nlerp.resize(count);
+    results.slerp.resize(count);
+    results.matrices.resize(count);
+
+    SimdMath::Multiply(batch.left.data(), batch.right.data(), results.pairwise.data(), count);
+    SimdMath::Multiply(batch.transform, batch.right.data(), results.broadcast.data(), count);
+    SimdMath::Multiply(batch.transform, results.broadcastInPlace.data(), results.broadcastInPlace.data(), count);
+    SimdMath::TransformPoints(batch.transform, batch.vectors.data(), results.points.data(), count);
+    SimdMath::TransformNormals(batch.transform, batch.vectors.data(), results.normals.data(), count);
+    SimdMath::TransformPoints(batch.transform, batch.packed.data(), results.packedPoints.data(), count);
+    SimdMath::TransformNormals(batch.transform, results.packedNormalsInPlace.data(), results.packedNormalsInPlace.data(), count);
+    SimdMath::Nlerp(batch.from.data(), batch.to.data(), batch.t.data(), results.nlerp.data(), count);
+    SimdMath::Slerp(batch.from.data(), batch.to.data(), batch.t.data(), results.slerp.data(), count);
+    SimdMath::ToMatrices(batch.from.data(), results.matrices.data(), count);
+
+    return results;
+}
+
+template <typename Vector>
+static void CheckVectors(const char *what, const std::vector<Vector> &value, const std::vector<Vector> &expected, double tolerance)
+{
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        Check(what, value[i].X, expected[i].X, tolerance);
+        Check(what, value[i].Y, expected[i].Y, tolerance);
+        Check(what, value[i].Z, expected[i].Z, tolerance);
+    }
+}
+
+static void CheckMatrices(const char *what, const std::vector<Matrix4F> &value, const std::vector<Matrix4F> &expected, double tolerance)
+{
+    for (size_t i = 0; i < value.size(); ++i)
+        CheckMatrix(what, value[i], expected[i], tolerance);
+}
+
+static void CheckQuaternions(const char *what, const std::vector<Quaternion> &value, const std::vector<Quaternion> &expected, double tolerance)
+{
+    for (size_t i = 0; i < value.size(); ++i)
+        for (int j = 0; j < 4; ++j)
+            Check(what, value[i][j], expected[i][j], tolerance);
+}
+
+// the scalar table against double precision and the generic Quaternion code
+static void CheckScalarTable(const Batch &batch, const Results &results)
+{
+    for (size_t i = 0; i < batch.left.size(); ++i)
+    {
+        Matrix4D transform = ToDouble(batch.transform);
+
+        CheckMatrix("Multiply", results.pairwise[i], ToDouble(batch.left[i]) * ToDouble(batch.right[i]), 1e-5);
+        CheckMatrix("Multiply broadcast", results.broadcast[i], transform * ToDouble(batch.right[i]), 1e-5);
+
+        const Vector3F &vector = batch.vectors[i];
+        Vector3D point = transform * Vector3D(vector.X, vector.Y, vector.Z, 1.0);
+        Vector3D normal = transform * Vector3D(vector.X, vector.Y, vector.Z, 0.0);
+
+        Check("TransformPoints", results.points[i].X, point.X, 1e-5);
+        Check("TransformPoints", results.points[i].Y, point.Y, 1e-5);
+        Check("TransformPoints", results.points[i].Z, point.Z, 1e-5);
+        Check("TransformPoints w", results.points[i].W, 1.0, 1e-6);
+        Check("TransformNormals", results.normals[i].X, normal.X, 1e-5);
+        Check("TransformNormals", results.normals[i].Y, normal.Y, 1e-5);
+        Check("TransformNormals", results.normals[i].Z, normal.Z, 1e-5);
+        Check("TransformNormals w", results.normals[i].W, 0.0, 1e-6);
+
+        Quaternion nlerp = batch.from[i].Nlerp(batch.to[i], batch.t[i]);
+        Quaternion slerp = batch.from[i].Slerp(batch.to[i], batch.t[i]);
+
+        for (int j = 0; j < 4; ++j)
+        {
+            Check("Nlerp", results.nlerp[i][j], nlerp[j], 1e-6);
+            Check("Slerp", results.slerp[i][j], slerp[j], 2e-6);
+        }
+
+        CheckMatrix("ToMatrices", results.matrices[i], batch.from[i].MatrixF(), 2e-6);
+    }
+}
+
+// the wide kernels only reorder float math, so they stay within a few ulps of the scalar table
+static void CheckAgainstScalar(const Results &results, const Results &scalar)
+{
+    CheckMatrices("Multiply", results.pairwise, scalar.pairwise, 1e-6);
+    CheckMatrices("Multiply broadcast", results.broadcast, scalar.broadcast, 1e-6);
+    CheckMatrices("Multiply broadcast in place", results.broadcastInPlace, scalar.broadcastInPlace, 1e-6);
+    CheckVectors("TransformPoints", results.points, scalar.points, 1e-6);
+    CheckVectors("TransformNormals", results.normals, scalar.normals, 1e-6);
+    CheckVectors("TransformPoints packed", results.packedPoints, scalar.packedPoints, 1e-6);
+    CheckVectors("TransformNormals packed in place", results.packedNormalsInPlace, scalar.packedNormalsInPlace, 1e-6);
+    CheckQuaternions("Nlerp", results.nlerp, scalar.nlerp, 1e-6);
+    CheckQuaternions("Slerp", results.slerp, scalar.slerp, 1e-6);
+    CheckMatrices("ToMatrices", results.matrices, scalar.matrices, 1e-6);
+
+    for (size_t i = 0; i < results.points.size(); ++i)
+    {
+        Check("TransformPoints w", results.points[i].W, scalar.points[i].W, 0.0);
+        Check("TransformNormals w", results.normals[i].W, scalar.normals[i].W, 0.0);
+    }
+}
+
+int main()
+{
+    InstructionSet supported = SimdMath::GetSupportedInstructionSet();
+
+    printf("supported instruction set: %s\n", SimdMath::GetInstructionSetName(supported));
+
+    CheckSingleOperations();
+
+    for (size_t count : { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 64, 101 })
+    {
+        Batch batch(count);
+
+        SimdMath::SetInstructionSet(InstructionSet::Scalar);
+
+        Results scalar = Run(batch);
+
+        CheckScalarTable(batch, scalar);
+
+        for (InstructionSet set : { InstructionSet::SSE, InstructionSet::AVX })
+        {
+            if (set > supported)
+                continue;
+
+            SimdMath::SetInstructionSet(set);
+            CheckAgainstScalar(Run(batch), scalar);
+        }
+    }
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
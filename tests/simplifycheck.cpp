@@ -0,0 +1,211 @@
+// SimplifyIndices on a uv sphere with a texture seam and on a bumpy open grid: the target is reached, triangles stay
+// valid and facing the same way, seam and border vertices stay put and the reported error grows with every level
+
+#include "simplify.h"
+
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *what)
+{
+    if (condition)
+        return;
+
+    if (failures++ < 20)
+        printf("failed: %s\n", what);
+}
+
+struct Surface
+{
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+};
+
+// the seam column and the pole rows are separate vertices at the same positions, like a textured mesh has them
+static Surface MakeSphere(int columns, int rows, float radius)
+{
+    Surface sphere;
+
+    for (int row = 0; row <= rows; ++row)
+    {
+        for (int column = 0; column <= columns; ++column)
+        {
+            float theta = 3.14159265f * row / rows;
+            float phi = 2.0f * 3.14159265f * column / columns;
+
+            sphere.positions.push_back(radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+        }
+    }
+
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            unsigned int a = row * (columns + 1) + column;
+            unsigned int b = a + 1;
+            unsigned int c = a + columns + 1;
+            unsigned int d = c + 1;
+
+            // the triangles at the poles would have no area
+            if (row != 0)
+                sphere.indices.insert(sphere.indices.end(), {a, c, b});
+
+            if (row != rows - 1)
+                sphere.indices.insert(sphere.indices.end(), {b, c, d});
+        }
+    }
+
+    return sphere;
+}
+
+static Surface MakeGrid(int size, float spacing)
+{
+    Surface grid;
+
+    for (int y = 0; y <= size; ++y)
+        for (int x = 0; x <= size; ++x)
+            grid.positions.push_back(glm::vec3(x * spacing, 0.01f * ((x * 7 + y * 13) % 5), y * spacing));
+
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            unsigned int a = y * (size + 1) + x;
+            unsigned int b = a + 1;
+            unsigned int c = a + size + 1;
+            unsigned int d = c + 1;
+
+            grid.indices.insert(grid.indices.end(), {a, c, b, b, c, d});
+        }
+    }
+
+    return grid;
+}
+
+static glm::vec3 Normal(const std::vector<glm::vec3> &positions, const unsigned int *triangle)
+{
+    return glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+}
+
+static void CheckTriangles(const Surface &surface, const std::vector<unsigned int> &result, size_t target)
+{
+    Expect(result.size() % 3 == 0, "whole triangles");
+    Expect(result.size() <= target, "target reached");
+
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const unsigned int *triangle = &result[i];
+
+        Expect(triangle[0] < surface.positions.size() && triangle[1] < surface.positions.size() && triangle[2] < surface.positions.size(), "indices in range");
+        Expect(triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2], "no collapsed triangles");
+    }
+}
+
+static void CheckKept(const std::vector<unsigned int> &result, const std::vector<unsigned int> &vertices, const char *what)
+{
+    std::set<unsigned int> used(result.begin(), result.end());
+
+    for (unsigned int vertex : vertices)
+        Expect(used.count(vertex) != 0, what);
+}
+
+static void CheckSphere()
+{
+    const float radius = 100.0f;
+
+    const int columns = 64;
+    const int rows = 32;
+
+    Surface sphere = MakeSphere(columns, rows, radius);
+    std::vector<unsigned int> level = sphere.indices;
+
+    // both sides of the texture seam. the pole copies can drop out once the ring next to them collapses, they never
+    // move either way
+    std::vector<unsigned int> seam;
+
+    for (int row = 1; row < rows; ++row)
+        seam.insert(seam.end(), {(unsigned int)(row * (columns + 1)), (unsigned int)(row * (columns + 1) + columns)});
+
+    float previousError = 0.0f;
+
+    for (int lod = 1; lod <= 3; ++lod)
+    {
+        size_t target = level.size() / 2 / 3 * 3;
+        float error = -1.0f;
+
+        level = SimplifyIndices(sphere.positions, level, target, error);
+
+        CheckTriangles(sphere, level, target);
+        CheckKept(level, seam, "seam vertex kept");
+
+        Expect(std::isfinite(error) && error >= previousError, "error grows with every level");
+        Expect(error < radius * 0.5f, "error stays well below the size of the sphere");
+
+        // the sphere is wound to face inwards, a flipped triangle would face out
+        for (size_t i = 0; i < level.size(); i += 3)
+        {
+            glm::vec3 center = (sphere.positions[level[i]] + sphere.positions[level[i + 1]] + sphere.positions[level[i + 2]]) / 3.0f;
+
+            Expect(glm::dot(Normal(sphere.positions, &level[i]), center) < 0.0f, "triangles keep facing the same way");
+        }
+
+        previousError = error;
+    }
+}
+
+static void CheckGrid()
+{
+    const int size = 40;
+
+    Surface grid = MakeGrid(size, 10.0f);
+    size_t target = grid.indices.size() / 8 / 3 * 3;
+    float error = -1.0f;
+
+    std::vector<unsigned int> result = SimplifyIndices(grid.positions, grid.indices, target, error);
+
+    CheckTriangles(grid, result, target);
+
+    // the bumps are a hundredth of a unit, flattening them moves the surface by about that much
+    Expect(error >= 0.0f && error < 1.0f, "flat grid simplifies with a small error");
+
+    std::vector<unsigned int> border;
+
+    for (int i = 0; i <= size; ++i)
+        border.insert(border.end(), {(unsigned int)i, (unsigned int)(size * (size + 1) + i), (unsigned int)(i * (size + 1)), (unsigned int)(i * (size + 1) + size)});
+
+    CheckKept(result, border, "border vertex kept");
+
+    for (size_t i = 0; i < result.size(); i += 3)
+        Expect(Normal(grid.positions, &result[i]).y > 0.0f, "grid triangles keep facing up");
+}
+
+static void CheckTrivial()
+{
+    Surface grid = MakeGrid(4, 1.0f);
+    float error = -1.0f;
+
+    Expect(SimplifyIndices(grid.positions, grid.indices, grid.indices.size(), error) == grid.indices && error == 0.0f, "nothing to do at the target");
+    Expect(SimplifyIndices(grid.positions, {}, 0, error).empty(), "empty input");
+}
+
+int main()
+{
+    CheckSphere();
+    CheckGrid();
+    CheckTrivial();
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
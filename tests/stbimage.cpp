@@ -0,0 +1,3 @@
+// main.cpp holds stb_image for the editor, checks that link the vfs get it from here
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
@@ -0,0 +1,198 @@
+// XBlockDocument saves: an unedited document saves byte for byte, and an edit only changes the lines of the entities
+// it touched. both line endings are covered, as are comments and entities outside the entitySet
+
+#include "xblock.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void Expect(bool condition, const std::string &what)
+{
+    if (condition)
+        return;
+
+    ++failures;
+    printf("failed: %s\n", what.c_str());
+}
+
+static std::string ReadFile(const fs::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream contents;
+
+    contents << file.rdbuf();
+
+    return contents.str();
+}
+
+static void WriteFile(const fs::path &path, const std::string &contents)
+{
+    std::ofstream file(path, std::ios::binary);
+
+    file << contents;
+}
+
+static std::string WithNewline(std::string text, const std::string &newline)
+{
+    if (newline == "\n")
+        return text;
+
+    std::string result;
+
+    for (char c : text)
+    {
+        if (c == '\n')
+            result += newline;
+        else
+            result += c;
+    }
+
+    return result;
+}
+
+static const char *Map = R"(<?xml version="1.0" encoding="utf-8"?>
+<game>
+	<!-- <entity id="commented" /> isn't an entity -->
+	<entitySet>
+		<entity id="0a" modelName="he_wall_" name="he_wall_[1, 2, 3]">
+			<property name="Position">
+				<set value="1, 2, 3" />
+			</property>
+			<property  name="Rotation" >
+				<set value = "0, 0, 90"/>
+			</property>
+		</entity>
+		<entity id="0b" modelName="he_floor_" name="a &amp; b" />
+		<entity id="0c" modelName="he_tree_" name="he_tree_[5, 5, 0]">
+			<property name="Position">
+				<set value="5, 5, 0" />
+			</property>
+		</entity>
+	</entitySet>
+	<entity id="outside" />
+</game>
+)";
+
+// the text before the first and after the last differing byte, what a diff tool would show as unchanged
+static void CompareAround(const std::string &before, const std::string &after, size_t &prefix, size_t &suffix)
+{
+    prefix = 0;
+
+    while (prefix < before.size() && prefix < after.size() && before[prefix] == after[prefix])
+        ++prefix;
+
+    suffix = 0;
+
+    while (suffix < before.size() - prefix && suffix < after.size() - prefix &&
+           before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix])
+        ++suffix;
+}
+
+static void CheckRoundTrip(const fs::path &directory, const std::string &newline)
+{
+    std::string label = newline == "\n" ? "lf: " : "crlf: ";
+    std::string source = WithNewline(Map, newline);
+    fs::path path = directory / "map.xblock";
+
+    WriteFile(path, source);
+
+    XBlockDocument document;
+
+    Expect(document.Load(path.string()), label + "load");
+    Expect(document.GetEntityCount() == 3, label + "three entities in the entitySet");
+    Expect(document.GetProperty(document.FindEntity("0a"), "Rotation") == "0, 0, 90", label + "property with odd spacing");
+    Expect(document.GetProperty(document.FindEntity("0b"), "Position").empty(), label + "self closing entity has no properties");
+    Expect(document.FindEntity("commented") < 0 && document.FindEntity("outside") < 0, label + "only entitySet entities");
+
+    // nothing edited, nothing changes
+    Expect(document.Save(path.string()), label + "save unedited");
+    Expect(ReadFile(path) == source, label + "unedited save is byte identical");
+
+    // an edit only touches the edited entity's lines
+    int tree = document.FindEntity("0c");
+
+    document.SetProperty(tree, "Position", "6, 5, 0");
+    Expect(document.GetPendingCount() == 1, label + "one pending entity");
+    Expect(document.Save(path.string()), label + "save edit");
+
+    std::string edited = ReadFile(path);
+    size_t prefix = 0;
+    size_t suffix = 0;
+
+    CompareAround(source, edited, prefix, suffix);
+
+    size_t treeBegin = source.find("<entity id=\"0c\"");
+    size_t treeEnd = source.find("</entity>", treeBegin) + 9;
+
+    Expect(prefix >= treeBegin && source.size() - suffix <= treeEnd, label + "edit stays inside the entity");
+    Expect(edited.find("<set value=\"6, 5, 0\" />" + newline) != std::string::npos, label + "edited value keeps the line ending");
+    Expect(document.GetSource() == edited, label + "source is the saved text");
+    Expect(document.GetPendingCount() == 0, label + "nothing pending after save");
+
+    // saving again without edits is a no-op, including for the ranges the last save moved
+    Expect(document.Save(path.string()), label + "save again");
+    Expect(ReadFile(path) == edited, label + "second save is byte identical");
+
+    // removing and restoring an entity comes back to the same bytes
+    int floor = document.FindEntity("0b");
+
+    document.RemoveEntity(floor);
+    Expect(document.Save(path.string()), label + "save removal");
+    Expect(ReadFile(path).find("id=\"0b\"") == std::string::npos, label + "removed entity is gone");
+
+    document.RestoreEntity(floor);
+    Expect(document.Save(path.string()), label + "save restore");
+    Expect(ReadFile(path) == edited, label + "restored entity is byte identical");
+
+    // an added entity ends up on its own lines in the entitySet and nothing else moves
+    int added = document.AddEntity("he_rock_", "he_rock_[0, 0, 0]", {{"Position", "0, 0, 0"}, {"Note", "a<b & \"c\""}});
+
+    Expect(document.Save(path.string()), label + "save addition");
+
+    std::string withAdded = ReadFile(path);
+
+    CompareAround(edited, withAdded, prefix, suffix);
+
+    Expect(withAdded.size() > edited.size() && edited.compare(0, prefix, withAdded, 0, prefix) == 0, label + "addition leaves the rest alone");
+    Expect(withAdded.find("\t\t<entity id=\"" + document.GetId(added) + "\"") != std::string::npos, label + "added entity is indented like the others");
+    Expect(withAdded.find("</entitySet>") > withAdded.find(document.GetId(added)), label + "added entity is inside the entitySet");
+
+    XBlockDocument reloaded;
+
+    Expect(reloaded.Load(path.string()), label + "reload");
+    Expect(reloaded.GetEntityCount() == 4, label + "four entities after reload");
+    Expect(reloaded.GetProperty(reloaded.FindEntity("0c"), "Position") == "6, 5, 0", label + "edited property reloads");
+    Expect(reloaded.GetProperty(reloaded.FindEntity(document.GetId(added)), "Note") == "a<b & \"c\"", label + "added property reloads unescaped");
+    Expect(reloaded.Save(path.string()) && ReadFile(path) == withAdded, label + "reloaded document saves byte identical");
+}
+
+int main()
+{
+    fs::path directory = fs::temp_directory_path() / "xblockcheck";
+    std::error_code error;
+
+    fs::create_directories(directory, error);
+
+    CheckRoundTrip(directory, "\n");
+    CheckRoundTrip(directory, "\r\n");
+
+    fs::remove_all(directory, error);
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}